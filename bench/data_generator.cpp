@@ -0,0 +1,320 @@
+#include "data_generator.h"
+
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+
+const char* const kWords[] = {
+    "the", "court", "of", "appeals", "held", "that", "defendant", "plaintiff", "motion", "to",
+    "dismiss", "was", "denied", "under", "rule", "summary", "judgment", "in", "favor", "and",
+    "we", "affirm", "reverse", "remand", "for", "further", "proceedings", "consistent", "with",
+    "this", "opinion", "statute", "limitations", "jurisdiction", "petitioner", "respondent",
+    "evidence", "trial", "jury", "verdict", "sentence", "conviction", "habeas", "corpus",
+    "constitutional", "due", "process", "amendment", "contract", "breach", "damages", "tort",
+    "negligence", "liability", "injunction", "district", "circuit", "supreme", "state", "federal",
+    "agency", "review", "standard", "abuse", "discretion", "de", "novo", "error", "harmless",
+    "precedent", "claim", "party", "counsel", "argument", "brief", "record", "finding", "fact",
+};
+const size_t kWordCount = sizeof(kWords) / sizeof(kWords[0]);
+
+const char* const kReporters[] = {
+    "U.S.", "S. Ct.", "L. Ed. 2d", "F.2d", "F.3d", "F.4th", "F. Supp.", "F. Supp. 2d",
+    "So. 2d", "So. 3d", "N.E.2d", "N.W.2d", "P.3d", "A.3d", "S.W.3d", "Cal. Rptr. 3d",
+};
+const char* const kSources[] = {"C", "R", "CR", "LR", "U", "CU", "H", "Z", "M"};
+const char* const kStatuses[] = {"Published", "Unpublished", "Errata", "Separate", "In-chambers"};
+const char* const kTypes[] = {"010combined", "020lead", "030concurrence", "040dissent", "050addendum"};
+const char* const kJudges[] = {"Smith", "Garcia", "O'Connor", "Nguyen", "Thompson", "Okafor", "Rossi"};
+
+// RFC 4180 quoting: embedded quotes doubled
+std::string quoted(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    return out + "\"";
+}
+
+// Dump-style quoting: embedded quotes backslash-escaped
+std::string escaped(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"') out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+} // namespace
+
+DataGenerator::DataGenerator(Options options) : options_(options) {
+    if (options_.rows == 0 && options_.target_bytes == 0) {
+        throw std::invalid_argument("DataGenerator needs a row count or a target size");
+    }
+}
+
+const std::vector<DataGenerator::Table>& DataGenerator::allTables() {
+    static const std::vector<Table> tables = {
+        Table::Opinions, Table::Clusters, Table::Cited, Table::Citations,
+        Table::Parentheticals, Table::Panels, Table::JoinedBy,
+    };
+    return tables;
+}
+
+const char* DataGenerator::tableName(Table table) {
+    switch (table) {
+        case Table::Opinions: return "opinions";
+        case Table::Clusters: return "clusters";
+        case Table::Cited: return "cited";
+        case Table::Citations: return "citations";
+        case Table::Parentheticals: return "parentheticals";
+        case Table::Panels: return "panels";
+        case Table::JoinedBy: return "joined_by";
+    }
+    return "unknown";
+}
+
+DataGenerator::Table DataGenerator::tableFromName(const std::string& name) {
+    for (Table table : allTables()) {
+        if (name == tableName(table)) return table;
+    }
+    throw std::invalid_argument("Unknown table: " + name);
+}
+
+size_t DataGenerator::below(size_t n) {
+    return n == 0 ? 0 : static_cast<size_t>(next() % n);
+}
+
+bool DataGenerator::chance(double p) {
+    // 53 random bits -> [0, 1)
+    return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0) < p;
+}
+
+size_t DataGenerator::skewedLength(size_t lo, size_t hi) {
+    double u = static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0);
+    return lo + static_cast<size_t>(static_cast<double>(hi - lo) * u * u * u * u);
+}
+
+std::string DataGenerator::timestamp() {
+    char buf[48];
+    std::snprintf(buf, sizeof(buf), "%04zu-%02zu-%02zu %02zu:%02zu:%02zu.%06zu+00", 2008 + below(18),
+                  1 + below(12), 1 + below(28), below(24), below(60), below(60), below(1000000));
+    return buf;
+}
+
+std::string DataGenerator::date() {
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "%04zu-%02zu-%02zu", 1850 + below(176), 1 + below(12), 1 + below(28));
+    return buf;
+}
+
+std::string DataGenerator::sha1() {
+    static const char hex[] = "0123456789abcdef";
+    std::string out(40, '0');
+    for (auto& c : out) c = hex[below(16)];
+    return out;
+}
+
+std::string DataGenerator::words(size_t min_bytes, bool newlines) {
+    std::string out;
+    out.reserve(min_bytes + 64);
+    size_t sentence = 0;
+    while (out.size() < min_bytes) {
+        size_t len = 6 + below(20);
+        for (size_t i = 0; i < len; ++i) {
+            if (i > 0) out += ' ';
+            // Quotations come in pairs, so either quoting style keeps the quote count even
+            if (i == 3 && chance(0.1)) {
+                out += "\"";
+                out += kWords[below(kWordCount)];
+                out += ' ';
+                out += kWords[below(kWordCount)];
+                out += "\"";
+            } else {
+                out += kWords[below(kWordCount)];
+            }
+        }
+        out += ", ";
+        out += std::to_string(1 + below(999));
+        out += " U.S. ";
+        out += std::to_string(1 + below(600));
+        out += ". ";
+        if (newlines && ++sentence % 6 == 0) out += "\n\n";
+    }
+    return out;
+}
+
+std::string DataGenerator::html(size_t min_bytes) {
+    std::string out = "<div><p class=\"case-title\"><b>" + caseName() + "</b></p>\n";
+    while (out.size() < min_bytes) {
+        out += "<p id=\"p" + std::to_string(below(100000)) + "\">";
+        out += words(256 + below(1024), false);
+        out += "<a href=\"/opinion/" + std::to_string(below(10000000)) + "/\" class=\"citation\">";
+        out += std::to_string(1 + below(999)) + " " + kReporters[below(16)] + " " + std::to_string(1 + below(1500));
+        out += "</a></p>\n";
+    }
+    return out + "</div>";
+}
+
+std::string DataGenerator::caseName() {
+    std::string a = kJudges[below(7)];
+    std::string b = kJudges[below(7)];
+    return a + " v. " + b + (chance(0.2) ? ", et al." : "");
+}
+
+void DataGenerator::row(Table table, size_t id, std::vector<std::string>& f) {
+    f.clear();
+    auto num = [&](size_t lo, size_t hi) { return std::to_string(lo + below(hi - lo)); };
+    auto maybe = [&](double p, const std::string& value) { return chance(p) ? value : std::string(); };
+    double scale = options_.text_scale;
+    auto big = [&](size_t lo, size_t hi) {
+        return static_cast<size_t>(static_cast<double>(skewedLength(lo, hi)) * scale);
+    };
+
+    switch (table) {
+    case Table::Opinions: {
+        // One source format carries the text; html_with_citations nearly always does too
+        size_t source = below(5);
+        bool multiline = chance(options_.multiline_rate);
+        std::string plain = source == 0 ? words(big(1000, 60000), multiline) : "";
+        f = {std::to_string(id), timestamp(), timestamp(), kTypes[below(5)], sha1(),
+             maybe(0.3, "https://www.courtlistener.com/pdf/" + sha1() + ".pdf"),
+             maybe(0.3, quoted("pdf/" + date() + "/" + sha1() + ".pdf")),
+             quoted(plain),
+             escaped(source == 1 ? html(big(1000, 60000)) : ""),
+             escaped(source == 2 ? html(big(1000, 50000)) : ""),
+             escaped(source == 3 ? html(big(1000, 50000)) : ""),
+             escaped(chance(0.9) ? html(big(1500, 80000)) : ""),
+             chance(0.1) ? "true" : "false",
+             maybe(0.4, num(1, 20000)),
+             num(1, 9000000),
+             chance(0.05) ? "true" : "false",
+             maybe(0.5, num(1, 120)),
+             quoted(maybe(0.5, kJudges[below(7)])),
+             quoted(maybe(0.2, std::string(kJudges[below(7)]) + ", " + kJudges[below(7)])),
+             escaped(source == 4 ? "<?xml version=\"1.0\"?><opinion>" + words(big(1000, 40000), multiline) +
+                                       "</opinion>" : ""),
+             quoted(""),
+             maybe(0.8, std::to_string(static_cast<int32_t>(next()))),
+             maybe(0.1, num(1, 9000000))};
+        break;
+    }
+    case Table::Clusters: {
+        bool multiline = chance(options_.multiline_rate);
+        std::string name = caseName();
+        std::string slug;
+        for (char c : name) {
+            if (std::isalnum(static_cast<unsigned char>(c))) slug += static_cast<char>(std::tolower(c));
+            else if (!slug.empty() && slug.back() != '-') slug += '-';
+        }
+        f = {std::to_string(id), timestamp(), timestamp(),
+             quoted(std::string(kJudges[below(7)]) + ", " + kJudges[below(7)]),
+             date(), chance(0.05) ? "true" : "false",
+             quoted(slug), quoted(name.substr(0, name.find(' '))), quoted(name),
+             quoted(name + " and " + caseName()), quoted(maybe(0.05, "1999-0" + num(10, 99))),
+             maybe(0.05, num(1, 3)), maybe(0.05, num(0, 9)), maybe(0.05, num(0, 9)),
+             kSources[below(9)],
+             quoted(maybe(0.2, words(big(100, 2000), multiline))),
+             quoted(maybe(0.3, words(big(50, 1000), multiline))),
+             quoted(maybe(0.2, "Civil Rights")), quoted(maybe(0.2, words(200, false))),
+             quoted(maybe(0.3, words(big(200, 20000), multiline))),
+             quoted(maybe(0.2, words(big(200, 10000), multiline))),
+             quoted(maybe(0.3, words(big(200, 5000), multiline))),
+             quoted(maybe(0.3, "Affirmed.")), quoted(maybe(0.1, words(200, false))),
+             quoted(maybe(0.1, "Rehearing denied " + date())), quoted(""), quoted(""),
+             num(0, 500), kStatuses[below(5)], maybe(0.01, date()), chance(0.01) ? "true" : "false",
+             quoted(maybe(0.2, "law.free.cap/" + num(1, 999) + "/" + num(1, 9999) + ".json")),
+             quoted(maybe(0.1, "harvard_pdf/" + num(1, 99999) + ".pdf")),
+             num(1, 70000000),
+             quoted(maybe(0.1, words(big(200, 5000), multiline))),
+             escaped(maybe(0.1, html(big(500, 20000))))};
+        break;
+    }
+    case Table::Cited:
+        f = {std::to_string(id), num(1, 8), num(1, 11000000), num(1, 11000000)};
+        break;
+    case Table::Citations:
+        f = {std::to_string(id), num(1, 999), quoted(kReporters[below(16)]), quoted(num(1, 1500)),
+             num(1, 9), num(1, 9000000)};
+        break;
+    case Table::Parentheticals: {
+        // Parentheticals quote the opinion they describe, in both quoting styles; the
+        // reader is line based, so no embedded newlines here
+        std::string text = "holding that " + words(40 + below(300), false);
+        f = {std::to_string(id), chance(0.2) ? escaped(text) : quoted(text),
+             std::to_string(below(1000000) / 1e6), num(1, 11000000), num(1, 11000000), num(1, 3000000)};
+        break;
+    }
+    case Table::Panels:
+        f = {std::to_string(id), num(1, 9000000), num(1, 20000)};
+        break;
+    case Table::JoinedBy:
+        f = {std::to_string(id), num(1, 11000000), num(1, 20000)};
+        break;
+    }
+}
+
+void DataGenerator::corrupt(std::vector<std::string>& f) {
+    switch (below(3)) {
+        case 0: f[0] = "n/a"; break;                  // non-numeric id
+        case 1: f.resize(f.size() > 2 ? f.size() / 2 : 1); break; // truncated row
+        case 2: f.push_back("42"); f.push_back(quoted("extra")); break; // too many columns
+    }
+}
+
+size_t DataGenerator::write(Table table, std::ostream& out) {
+    static const char* const kHeaders[] = {
+        "id,date_created,date_modified,type,sha1,download_url,local_path,plain_text,html,html_lawbox,"
+        "html_columbia,html_with_citations,extracted_by_ocr,author_id,cluster_id,per_curiam,page_count,"
+        "author_str,joined_by_str,xml_harvard,html_anon_2020,ordering_key,main_version_id",
+        "id,date_created,date_modified,judges,date_filed,date_filed_is_approximate,slug,case_name_short,"
+        "case_name,case_name_full,scdb_id,scdb_decision_direction,scdb_votes_majority,scdb_votes_minority,"
+        "source,procedural_history,attorneys,nature_of_suit,posture,syllabus,headnotes,summary,disposition,"
+        "history,other_dates,cross_reference,correction,citation_count,precedential_status,date_blocked,"
+        "blocked,filepath_json_harvard,filepath_pdf_harvard,docket_id,arguments,headmatter",
+        "id,depth,cited_opinion_id,citing_opinion_id",
+        "id,volume,reporter,page,type,cluster_id",
+        "id,text,score,described_opinion_id,describing_opinion_id,group_id",
+        "id,opinioncluster_id,person_id",
+        "id,opinion_id,person_id",
+    };
+    // Each table gets its own sequence, independent of which tables were written before
+    rng_.seed(options_.seed * 1000003 + static_cast<uint64_t>(table));
+
+    std::string buffer = std::string(kHeaders[static_cast<size_t>(table)]) + "\n";
+    size_t bytes = 0;
+    size_t rows = 0;
+    size_t id = 1000 + below(1000);
+    std::vector<std::string> fields;
+    while ((options_.rows == 0 || rows < options_.rows) &&
+           (options_.target_bytes == 0 || bytes + buffer.size() < options_.target_bytes)) {
+        row(table, id, fields);
+        if (chance(options_.malformed_rate)) corrupt(fields);
+        for (size_t i = 0; i < fields.size(); ++i) {
+            if (i > 0) buffer += ',';
+            buffer += fields[i];
+        }
+        buffer += '\n';
+        rows++;
+        id += 1 + below(4); // ids are increasing but not dense, as in the dumps
+        if (buffer.size() >= (1 << 20)) {
+            out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            bytes += buffer.size();
+            buffer.clear();
+        }
+    }
+    out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    return rows;
+}
+
+size_t DataGenerator::writeFile(Table table, const std::string& path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) throw std::runtime_error("Failed to create " + path);
+    size_t rows = write(table, out);
+    if (!out.flush()) throw std::runtime_error("Failed to write " + path);
+    return rows;
+}
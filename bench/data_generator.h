@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Deterministic CourtListener-shaped CSV generator for the benchmarks.
+//
+// Column order follows the bulk data dumps, so the readers' record-boundary
+// heuristics see the same layout as in production. Text fields are built from
+// legal vocabulary with skewed lengths (most opinions are a few KB, a few are
+// hundreds), and carry embedded newlines, doubled quotes ("") and backslash
+// escapes (\") wherever the dumps have them. A configurable fraction of rows is
+// malformed (non-numeric ids, missing columns, junk in integer fields).
+//
+// Output depends only on the options: the generator uses the raw mt19937_64
+// sequence, whose values the standard fixes, rather than the distributions,
+// which differ between standard libraries.
+class DataGenerator {
+public:
+    enum class Table { Opinions, Clusters, Cited, Citations, Parentheticals, Panels, JoinedBy };
+
+    struct Options {
+        uint64_t seed = 42;
+        size_t rows = 0;              // stop after this many rows (0 = no limit)
+        size_t target_bytes = 8 << 20; // stop once the file reaches this size (0 = no limit)
+        double malformed_rate = 0.001;
+        double multiline_rate = 0.3;  // share of text fields with embedded newlines
+        double text_scale = 1.0;      // multiplies the length of large text fields
+    };
+
+    explicit DataGenerator(Options options);
+
+    // Writes the header and rows; returns the number of rows written
+    size_t write(Table table, std::ostream& out);
+    // Same, to a file; throws std::runtime_error if it cannot be written
+    size_t writeFile(Table table, const std::string& path);
+
+    static const std::vector<Table>& allTables();
+    // "opinions", "clusters", "cited", "citations", "parentheticals", "panels", "joined_by"
+    static const char* tableName(Table table);
+    // Throws std::invalid_argument for an unknown name
+    static Table tableFromName(const std::string& name);
+
+private:
+    Options options_;
+    std::mt19937_64 rng_;
+
+    uint64_t next() { return rng_(); }
+    size_t below(size_t n);
+    bool chance(double p);
+    // Mostly near lo, with a long tail up to hi
+    size_t skewedLength(size_t lo, size_t hi);
+
+    std::string timestamp();
+    std::string date();
+    std::string sha1();
+    std::string words(size_t min_bytes, bool newlines);
+    std::string html(size_t min_bytes);
+    std::string caseName();
+
+    // Encoded CSV fields of one row
+    void row(Table table, size_t id, std::vector<std::string>& fields);
+    void corrupt(std::vector<std::string>& fields);
+};
@@ -0,0 +1,391 @@
+// Database-path benchmark against FakePgServer, the loopback PostgreSQL stand-in.
+//
+// Each table is generated and parsed up front, then loaded through its *Database
+// class the way its ingestion app drives it (ID cache load, then one insert call
+// per batch), once per mode, each against a fresh fake server:
+//   rows      the default path (per-row statements, savepoints, placeholder retries)
+//   copy      setBulkCopy(true), for opinions and clusters
+//   pipeline  setPipelineWindow(N), for cited and citations
+// Staging mode (setStagingMerge) is left out: it reads the table's columns from
+// the catalog, which the fake server does not have.
+// Reported per run: round trips, statements (simple queries + executes), bytes the
+// client sent, and wall time. The fake server stores nothing, so the ID caches load
+// empty and placeholder traffic is that of a fresh database. Counts are exact except
+// round trips under pipelining; time only means something with --latency-us.
+#include "data_generator.h"
+#include "fake_pg_server.h"
+#include "int32_batch.h"
+#include "opinion.h"
+#include "opinion_cited.h"
+#include "opinion_cited_db.h"
+#include "opinion_cluster.h"
+#include "opinion_cluster_db.h"
+#include "opinion_cluster_panel.h"
+#include "opinion_cluster_panel_db.h"
+#include "opinion_db.h"
+#include "opinion_joined_by.h"
+#include "opinion_joined_by_db.h"
+#include "parenthetical.h"
+#include "parenthetical_db.h"
+#include "search_citation.h"
+#include "search_citation_db.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+struct Result {
+    std::string table;
+    std::string mode;
+    size_t records = 0;
+    double seconds = 0;
+    FakePgServer::Stats stats;
+};
+
+struct Settings {
+    size_t batch = 500;
+    size_t pipeline_window = 64;
+    FakePgServer::Options server;
+};
+
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+// Silences the per-row logging of the database classes for the scope's lifetime
+class Quiet {
+public:
+    Quiet() : out_(std::cout.rdbuf(&null_)), err_(std::cerr.rdbuf(&null_)) {}
+    ~Quiet() {
+        std::cout.rdbuf(out_);
+        std::cerr.rdbuf(err_);
+    }
+
+private:
+    NullBuffer null_;
+    std::streambuf* out_;
+    std::streambuf* err_;
+};
+
+// Records of a memory-mapped reader; malformed rows are dropped, as the apps reject them
+template <typename Reader, typename Record>
+std::vector<Record> readMapped(const std::string& path) {
+    Reader reader(path);
+    std::vector<std::string_view> views;
+    std::vector<Record> records;
+    while (reader.readNextBatch(views, 1000)) {
+        for (auto view : views) {
+            try {
+                records.push_back(reader.parseCsvLine(view));
+            } catch (const std::exception&) {
+            }
+        }
+    }
+    return records;
+}
+
+template <typename Reader>
+auto readBatches(const std::string& path) {
+    Reader reader(path);
+    decltype(reader.readBatch(1)) records;
+    while (reader.hasMore()) {
+        auto batch = reader.readBatch(1000);
+        if (batch.empty() && !reader.hasMore()) break;
+        records.insert(records.end(), batch.begin(), batch.end());
+    }
+    return records;
+}
+
+// The whole table read into one column batch, through the reader's columnar readBatch
+template <typename Reader>
+Int32Batch readColumns(const std::string& path) {
+    Reader reader(path);
+    Int32Batch records, batch;
+    while (reader.hasMore()) {
+        if (reader.readBatch(batch, 1000) == 0 && !reader.hasMore()) break;
+        records.append(batch);
+    }
+    return records;
+}
+
+template <typename Record>
+void slice(std::vector<Record>& batch, const std::vector<Record>& records, size_t begin, size_t end) {
+    batch.assign(records.begin() + begin, records.begin() + end);
+}
+
+void slice(Int32Batch& batch, const Int32Batch& records, size_t begin, size_t end) {
+    batch.clear();
+    batch.append(records, begin, end);
+}
+
+// One load of records (a std::vector of rows or an Int32Batch) into a fresh fake server.
+// setup runs before the counters are reset (connection test, ID cache load); insert gets
+// one batch at a time.
+template <typename Db, typename Batch>
+Result load(const std::string& table, const std::string& mode, const Settings& settings,
+            const Batch& records, const std::function<void(Db&)>& setup,
+            const std::function<void(Db&, const Batch&)>& insert) {
+    FakePgServer server(settings.server);
+    Result result{table, mode, records.size(), 0, {}};
+    Quiet quiet;
+    // A database name per run keeps the process-wide connection pools apart, even
+    // if a later server gets the same port
+    Db db(server.host(), server.port(), "bench_" + table + "_" + mode, "postgres", "postgres");
+    if (!db.testConnection()) throw std::runtime_error("Cannot connect to the fake server");
+    setup(db);
+    server.resetStats();
+
+    auto t0 = std::chrono::steady_clock::now();
+    Batch batch;
+    for (size_t i = 0; i < records.size(); i += settings.batch) {
+        slice(batch, records, i, std::min(records.size(), i + settings.batch));
+        insert(db, batch);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t0;
+    result.seconds = elapsed.count();
+    result.stats = server.stats();
+    return result;
+}
+
+const char* targetTable(DataGenerator::Table table) {
+    using Table = DataGenerator::Table;
+    switch (table) {
+        case Table::Opinions: return "search_opinion";
+        case Table::Clusters: return "search_opinioncluster";
+        case Table::Cited: return "search_opinionscited";
+        case Table::Citations: return "search_citation";
+        case Table::Parentheticals: return "search_parenthetical";
+        case Table::Panels: return "search_opinioncluster_panel";
+        case Table::JoinedBy: return "search_opinion_joined_by";
+    }
+    return "";
+}
+
+void runTable(DataGenerator::Table table, const std::string& path, const Settings& settings,
+              std::vector<Result>& results) {
+    using Table = DataGenerator::Table;
+    std::string name = DataGenerator::tableName(table);
+    switch (table) {
+        case Table::Opinions: {
+            auto records = readMapped<OpinionReader, Opinion>(path);
+            auto insert = [](OpinionDatabase& db, const std::vector<Opinion>& batch) { db.insertOpinions(batch); };
+            results.push_back(load<OpinionDatabase, std::vector<Opinion>>(name, "rows", settings, records,
+                [](OpinionDatabase&) {}, insert));
+            results.push_back(load<OpinionDatabase, std::vector<Opinion>>(name, "copy", settings, records,
+                [](OpinionDatabase& db) { db.setBulkCopy(true); }, insert));
+            break;
+        }
+        case Table::Clusters: {
+            auto records = readMapped<OpinionClusterReader, OpinionCluster>(path);
+            auto insert = [](OpinionClusterDatabase& db, const std::vector<OpinionCluster>& batch) {
+                std::vector<OpinionCluster> rejected;
+                std::vector<std::string> reasons;
+                db.insertClusters(batch, rejected, reasons);
+            };
+            results.push_back(load<OpinionClusterDatabase, std::vector<OpinionCluster>>(name, "rows", settings, records,
+                [](OpinionClusterDatabase&) {}, insert));
+            results.push_back(load<OpinionClusterDatabase, std::vector<OpinionCluster>>(name, "copy", settings, records,
+                [](OpinionClusterDatabase& db) { db.setBulkCopy(true); }, insert));
+            break;
+        }
+        case Table::Cited: {
+            auto records = readColumns<OpinionCitedReader>(path);
+            auto insert = [](OpinionCitedDatabase& db, const Int32Batch& batch) {
+                Int32Batch rejected;
+                std::vector<std::string> reasons;
+                db.insertCitations(batch, rejected, reasons);
+            };
+            results.push_back(load<OpinionCitedDatabase, Int32Batch>(name, "rows", settings, records,
+                [](OpinionCitedDatabase& db) { db.loadValidOpinionIds(); }, insert));
+            size_t window = settings.pipeline_window;
+            results.push_back(load<OpinionCitedDatabase, Int32Batch>(name, "pipeline", settings, records,
+                [window](OpinionCitedDatabase& db) {
+                    db.setPipelineWindow(window);
+                    db.loadValidOpinionIds();
+                }, insert));
+            break;
+        }
+        case Table::Citations: {
+            auto records = readBatches<SearchCitationReader>(path);
+            auto insert = [](SearchCitationDatabase& db, const std::vector<SearchCitation>& batch) {
+                std::vector<SearchCitation> rejected;
+                std::vector<std::string> reasons;
+                std::vector<int> placeholders;
+                db.insertCitations(batch, rejected, reasons, placeholders);
+            };
+            results.push_back(load<SearchCitationDatabase, std::vector<SearchCitation>>(name, "rows", settings, records,
+                [](SearchCitationDatabase& db) { db.loadValidClusterIds(); }, insert));
+            size_t window = settings.pipeline_window;
+            results.push_back(load<SearchCitationDatabase, std::vector<SearchCitation>>(name, "pipeline", settings,
+                records, [window](SearchCitationDatabase& db) {
+                    db.setPipelineWindow(window);
+                    db.loadValidClusterIds();
+                }, insert));
+            break;
+        }
+        case Table::Parentheticals: {
+            auto records = readBatches<ParentheticalReader>(path);
+            results.push_back(load<ParentheticalDatabase, std::vector<Parenthetical>>(name, "rows", settings, records,
+                [](ParentheticalDatabase& db) { db.loadValidGroupIds(); },
+                [](ParentheticalDatabase& db, const std::vector<Parenthetical>& batch) {
+                    std::vector<Parenthetical> rejected;
+                    std::vector<std::string> reasons;
+                    std::vector<int> placeholders;
+                    db.insertParentheticals(batch, rejected, reasons, placeholders);
+                }));
+            break;
+        }
+        case Table::Panels: {
+            auto records = readColumns<OpinionClusterPanelReader>(path);
+            results.push_back(load<OpinionClusterPanelDatabase, Int32Batch>(name, "rows", settings, records,
+                [](OpinionClusterPanelDatabase& db) { db.loadValidClusterIds(); },
+                [](OpinionClusterPanelDatabase& db, const Int32Batch& batch) {
+                    Int32Batch rejected;
+                    std::vector<std::string> reasons;
+                    db.insertPanels(batch, rejected, reasons);
+                }));
+            break;
+        }
+        case Table::JoinedBy: {
+            auto records = readColumns<OpinionJoinedByReader>(path);
+            results.push_back(load<OpinionJoinedByDatabase, Int32Batch>(name, "rows", settings, records,
+                [](OpinionJoinedByDatabase& db) { db.loadValidOpinionIds(); },
+                [](OpinionJoinedByDatabase& db, const Int32Batch& batch) {
+                    Int32Batch rejected;
+                    std::vector<std::string> reasons;
+                    db.insertJoinedBy(batch, rejected, reasons);
+                }));
+            break;
+        }
+    }
+}
+
+void printUsage() {
+    std::cout << "Usage: db_bench [--rows=N] [--batch=N] [--seed=N] [--malformed=RATE] [--tables=a,b,...]\n"
+              << "                [--latency-us=N] [--fk-every=N] [--unique-every=N] [--pipeline-window=N] [--csv]\n";
+    std::cout << "  --rows=N             Rows generated per table (default 2000)\n";
+    std::cout << "  --batch=N            Records per insert call (default 500)\n";
+    std::cout << "  --seed=N             Generator seed (default 42)\n";
+    std::cout << "  --malformed=RATE     Share of malformed rows (default 0.001)\n";
+    std::cout << "  --tables=LIST        Subset of: opinions,clusters,cited,citations,parentheticals,panels,joined_by\n";
+    std::cout << "  --latency-us=N       Delay the fake server adds per round trip (default 0)\n";
+    std::cout << "  --fk-every=N         Fail every Nth INSERT/COPY into the loaded table with an FK violation\n";
+    std::cout << "  --unique-every=N     Fail every Nth INSERT/COPY into the loaded table with a unique violation\n";
+    std::cout << "  --pipeline-window=N  Window of the pipeline mode (default 64)\n";
+    std::cout << "  --csv                Print results as CSV (for comparing runs)\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    DataGenerator::Options gen;
+    gen.rows = 2000;
+    gen.target_bytes = 0;
+    Settings settings;
+    size_t fk_every = 0;
+    size_t unique_every = 0;
+    bool csv = false;
+    std::vector<DataGenerator::Table> tables = DataGenerator::allTables();
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.rfind("--rows=", 0) == 0) {
+                gen.rows = std::max<size_t>(1, static_cast<size_t>(std::stoull(arg.substr(7))));
+            } else if (arg.rfind("--batch=", 0) == 0) {
+                settings.batch = std::max<size_t>(1, static_cast<size_t>(std::stoull(arg.substr(8))));
+            } else if (arg.rfind("--seed=", 0) == 0) {
+                gen.seed = std::stoull(arg.substr(7));
+            } else if (arg.rfind("--malformed=", 0) == 0) {
+                gen.malformed_rate = std::stod(arg.substr(12));
+            } else if (arg.rfind("--tables=", 0) == 0) {
+                tables.clear();
+                std::stringstream list(arg.substr(9));
+                std::string name;
+                while (std::getline(list, name, ',')) tables.push_back(DataGenerator::tableFromName(name));
+            } else if (arg.rfind("--latency-us=", 0) == 0) {
+                settings.server.latency = std::chrono::microseconds(std::stoll(arg.substr(13)));
+            } else if (arg.rfind("--fk-every=", 0) == 0) {
+                fk_every = static_cast<size_t>(std::stoull(arg.substr(11)));
+            } else if (arg.rfind("--unique-every=", 0) == 0) {
+                unique_every = static_cast<size_t>(std::stoull(arg.substr(15)));
+            } else if (arg.rfind("--pipeline-window=", 0) == 0) {
+                settings.pipeline_window = std::max<size_t>(1, static_cast<size_t>(std::stoull(arg.substr(18))));
+            } else if (arg == "--csv") {
+                csv = true;
+            } else {
+                printUsage();
+                return arg == "--help" || arg == "-h" ? 0 : 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid option: " << e.what() << "\n";
+        printUsage();
+        return 1;
+    }
+
+    char tmpl[] = "/tmp/db_bench.XXXXXX";
+    if (!mkdtemp(tmpl)) {
+        std::cerr << "Failed to create a temporary directory\n";
+        return 1;
+    }
+    std::string dir = tmpl;
+
+    std::vector<Result> results;
+    int status = 0;
+    try {
+        DataGenerator generator(gen);
+        for (auto table : tables) {
+            std::string path = dir + "/" + DataGenerator::tableName(table) + ".csv";
+            generator.writeFile(table, path);
+            settings.server.faults.clear();
+            if (fk_every) settings.server.faults.push_back({targetTable(table), "23503", fk_every});
+            if (unique_every) settings.server.faults.push_back({targetTable(table), "23505", unique_every});
+            try {
+                runTable(table, path, settings, results);
+            } catch (...) {
+                std::remove(path.c_str());
+                throw;
+            }
+            std::remove(path.c_str());
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Benchmark failed: " << e.what() << "\n";
+        status = 1;
+    }
+    rmdir(dir.c_str());
+
+    if (csv) {
+        std::cout << "table,mode,records,seconds,round_trips,statements,copy_rows,faults,bytes_sent,bytes_received\n";
+    } else if (!results.empty()) {
+        std::printf("%-15s %-8s %8s %9s %11s %11s %9s %7s %12s %10s\n", "table", "mode", "records", "seconds",
+                    "round trips", "statements", "copy rows", "faults", "bytes sent", "B/record");
+    }
+    for (const auto& r : results) {
+        const auto& s = r.stats;
+        size_t statements = s.queries + s.executes;
+        if (csv) {
+            std::printf("%s,%s,%zu,%.6f,%zu,%zu,%zu,%zu,%zu,%zu\n", r.table.c_str(), r.mode.c_str(), r.records,
+                        r.seconds, s.round_trips, statements, s.copy_rows, s.faults, s.bytes_received, s.bytes_sent);
+        } else {
+            std::printf("%-15s %-8s %8zu %9.3f %11zu %11zu %9zu %7zu %12zu %10.0f\n", r.table.c_str(),
+                        r.mode.c_str(), r.records, r.seconds, s.round_trips, statements, s.copy_rows, s.faults,
+                        s.bytes_received,
+                        static_cast<double>(s.bytes_received) / static_cast<double>(std::max<size_t>(1, r.records)));
+        }
+    }
+    return status;
+}
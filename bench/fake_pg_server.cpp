@@ -0,0 +1,703 @@
+#include "fake_pg_server.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+
+namespace {
+
+constexpr int32_t kProtocolVersion3 = 196608;
+constexpr int32_t kSslRequest = 80877103;
+constexpr int32_t kGssEncRequest = 80877104;
+constexpr int32_t kTextOid = 25;
+
+struct Disconnected {};
+
+void putInt32(std::string& out, int32_t value) {
+    uint32_t n = htonl(static_cast<uint32_t>(value));
+    out.append(reinterpret_cast<const char*>(&n), 4);
+}
+
+void putInt16(std::string& out, int16_t value) {
+    uint16_t n = htons(static_cast<uint16_t>(value));
+    out.append(reinterpret_cast<const char*>(&n), 2);
+}
+
+void putString(std::string& out, const std::string& value) {
+    out += value;
+    out += '\0';
+}
+
+int32_t getInt32(const char* p) {
+    uint32_t n;
+    std::memcpy(&n, p, 4);
+    return static_cast<int32_t>(ntohl(n));
+}
+
+int16_t getInt16(const char* p) {
+    uint16_t n;
+    std::memcpy(&n, p, 2);
+    return static_cast<int16_t>(ntohs(n));
+}
+
+// Reads the fields of one frontend message body
+class Cursor {
+public:
+    explicit Cursor(const std::string& body) : body_(body) {}
+
+    std::string str() {
+        size_t end = body_.find('\0', pos_);
+        if (end == std::string::npos) end = body_.size();
+        std::string value = body_.substr(pos_, end - pos_);
+        pos_ = std::min(end + 1, body_.size());
+        return value;
+    }
+    char byte() { return pos_ < body_.size() ? body_[pos_++] : '\0'; }
+
+private:
+    const std::string& body_;
+    size_t pos_ = 0;
+};
+
+// Lowercase, whitespace runs collapsed to one space, trimmed; only used to classify statements
+std::string normalize(const std::string& sql) {
+    std::string out;
+    bool space = false;
+    for (unsigned char c : sql) {
+        if (std::isspace(c)) {
+            space = !out.empty();
+            continue;
+        }
+        if (space) out += ' ';
+        space = false;
+        out += static_cast<char>(std::tolower(c));
+    }
+    return out;
+}
+
+std::string firstWord(const std::string& normalized) {
+    size_t end = 0;
+    while (end < normalized.size() && std::isalpha(static_cast<unsigned char>(normalized[end]))) ++end;
+    return normalized.substr(0, end);
+}
+
+bool startsWith(const std::string& text, const std::string& prefix) {
+    return text.compare(0, prefix.size(), prefix) == 0;
+}
+
+// Statements of a simple Query, split on semicolons outside quotes
+std::vector<std::string> splitStatements(const std::string& sql) {
+    std::vector<std::string> statements;
+    std::string current;
+    char quote = 0;
+    for (char c : sql) {
+        if (quote) {
+            if (c == quote) quote = 0;
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+        } else if (c == ';') {
+            if (!normalize(current).empty()) statements.push_back(current);
+            current.clear();
+            continue;
+        }
+        current += c;
+    }
+    if (!normalize(current).empty()) statements.push_back(current);
+    return statements;
+}
+
+// Table written by "insert into T ..." or "copy T ...", empty for anything else
+std::string targetTable(const std::string& normalized) {
+    size_t pos;
+    if (startsWith(normalized, "insert into ")) pos = 12;
+    else if (startsWith(normalized, "copy ")) pos = 5;
+    else return "";
+    std::string table;
+    for (; pos < normalized.size(); ++pos) {
+        char c = normalized[pos];
+        if (c == '"') continue;
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '.') break;
+        table += c;
+    }
+    return table;
+}
+
+// Highest $N placeholder in a statement
+int16_t parameterCount(const std::string& sql) {
+    int highest = 0;
+    for (size_t i = 0; i < sql.size(); ++i) {
+        if (sql[i] != '$') continue;
+        int n = 0;
+        while (i + 1 < sql.size() && std::isdigit(static_cast<unsigned char>(sql[i + 1]))) n = n * 10 + (sql[++i] - '0');
+        highest = std::max(highest, n);
+    }
+    return static_cast<int16_t>(highest);
+}
+
+// Tuples in a binary COPY stream (signature, flags, extension, then field count + fields per row)
+size_t countBinaryCopyRows(const std::string& data) {
+    size_t pos = 11 + 4;
+    if (data.size() < pos + 4) return 0;
+    pos += 4 + static_cast<size_t>(getInt32(data.data() + pos));
+    size_t rows = 0;
+    while (pos + 2 <= data.size()) {
+        int16_t fields = getInt16(data.data() + pos);
+        pos += 2;
+        if (fields < 0) break; // trailer
+        for (int16_t f = 0; f < fields && pos + 4 <= data.size(); ++f) {
+            int32_t len = getInt32(data.data() + pos);
+            pos += 4 + (len > 0 ? static_cast<size_t>(len) : 0);
+        }
+        ++rows;
+    }
+    return rows;
+}
+
+bool returnsRows(const std::string& normalized, const std::string& word) {
+    return word == "select" || word == "with" || word == "values" || word == "show" ||
+           normalized.find(" returning ") != std::string::npos;
+}
+
+// Text columns in a row-returning statement: the items of its last top-level
+// SELECT list or RETURNING clause (CTE bodies and subqueries sit inside parentheses)
+int16_t resultColumns(const std::string& normalized) {
+    size_t list_start = std::string::npos;
+    int depth = 0;
+    char quote = 0;
+    for (size_t i = 0; i < normalized.size(); ++i) {
+        char c = normalized[i];
+        if (quote) {
+            if (c == quote) quote = 0;
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+        } else if (c == '(') {
+            depth++;
+        } else if (c == ')') {
+            depth--;
+        } else if (depth == 0 && (i == 0 || normalized[i - 1] == ' ')) {
+            if (normalized.compare(i, 7, "select ") == 0) list_start = i + 7;
+            else if (normalized.compare(i, 10, "returning ") == 0) list_start = i + 10;
+        }
+    }
+    if (list_start == std::string::npos) return 1;
+
+    int16_t columns = 1;
+    depth = 0;
+    quote = 0;
+    for (size_t i = list_start; i < normalized.size(); ++i) {
+        char c = normalized[i];
+        if (quote) {
+            if (c == quote) quote = 0;
+        } else if (c == '\'' || c == '"') {
+            quote = c;
+        } else if (c == '(') {
+            depth++;
+        } else if (c == ')') {
+            depth--;
+        } else if (depth == 0 && c == ',') {
+            columns++;
+        } else if (depth == 0 && normalized.compare(i, 6, " from ") == 0) {
+            break;
+        }
+    }
+    return columns;
+}
+
+struct Reply {
+    bool returns_rows = false;
+    int16_t columns = 1; // text columns per row
+    std::vector<std::string> rows; // first column; any others are NULL
+    std::string tag;
+};
+
+Reply answer(const std::string& normalized, const std::string& word) {
+    Reply reply;
+    reply.returns_rows = returnsRows(normalized, word);
+    if (reply.returns_rows) reply.columns = resultColumns(normalized);
+    if (word == "select" || word == "with" || word == "values" || word == "show") {
+        auto has = [&](const char* text) { return normalized.find(text) != std::string::npos; };
+        if (has("exists")) reply.rows = {"f"};
+        else if (has("count(") || has("max(") || has("min(") || has("coalesce(")) reply.rows = {"0"};
+        else if (!has(" from ")) reply.rows = {"1"};
+        reply.tag = "SELECT " + std::to_string(reply.rows.size());
+    } else if (word == "insert") {
+        reply.tag = "INSERT 0 1";
+    } else if (word == "update" || word == "delete") {
+        reply.tag = word == "update" ? "UPDATE 1" : "DELETE 1";
+    } else {
+        reply.tag = word;
+        std::transform(reply.tag.begin(), reply.tag.end(), reply.tag.begin(), ::toupper);
+    }
+    return reply;
+}
+
+} // namespace
+
+// One client connection. Replies are buffered and flushed whenever the session
+// needs more input, which is where the configured latency is paid.
+class FakePgServer::Session {
+public:
+    Session(FakePgServer& server, int fd) : server_(server), fd_(fd) {}
+
+    void run() {
+        try {
+            if (!startup()) return;
+            char type;
+            std::string body;
+            for (;;) {
+                readMessage(type, body);
+                // After an extended-protocol error the server discards everything up to Sync
+                if (skip_to_sync_ && type != 'S' && type != 'X') continue;
+                switch (type) {
+                    case 'Q': simpleQuery(Cursor(body).str()); break;
+                    case 'P': parse(body); break;
+                    case 'B': bind(body); break;
+                    case 'D': describe(body); break;
+                    case 'E': execute(body); break;
+                    case 'C': close(body); break;
+                    case 'H': flush(); break;
+                    case 'S':
+                        server_.counters_.syncs++;
+                        skip_to_sync_ = false;
+                        readyForQuery();
+                        break;
+                    case 'X': return;
+                    default: break; // CopyData/CopyDone/CopyFail left over from a failed COPY
+                }
+            }
+        } catch (const Disconnected&) {
+        }
+    }
+
+private:
+    enum class Txn { Idle, Block, Failed };
+
+    struct Error {
+        std::string sqlstate;
+        std::string message;
+        std::string table;
+        std::string column;
+        std::string constraint;
+    };
+
+    FakePgServer& server_;
+    int fd_;
+    std::string in_;
+    size_t in_pos_ = 0;
+    std::string out_;
+    Txn txn_ = Txn::Idle;
+    bool skip_to_sync_ = false;
+    std::map<std::string, std::string> statements_; // prepared statement name -> SQL
+    std::map<std::string, std::string> portals_;    // portal name -> SQL
+
+    void flush() {
+        if (out_.empty()) return;
+        if (server_.options_.latency.count() > 0) std::this_thread::sleep_for(server_.options_.latency);
+        size_t sent = 0;
+        while (sent < out_.size()) {
+            ssize_t n = ::send(fd_, out_.data() + sent, out_.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) throw Disconnected();
+            sent += static_cast<size_t>(n);
+        }
+        server_.counters_.bytes_sent += sent;
+        server_.counters_.round_trips++;
+        out_.clear();
+    }
+
+    // Buffers at least need unread bytes, flushing pending replies before blocking
+    void fill(size_t need) {
+        while (in_.size() - in_pos_ < need) {
+            flush();
+            in_.erase(0, in_pos_);
+            in_pos_ = 0;
+            char buf[65536];
+            ssize_t n = ::recv(fd_, buf, sizeof(buf), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) throw Disconnected();
+            in_.append(buf, static_cast<size_t>(n));
+            server_.counters_.bytes_received += static_cast<size_t>(n);
+        }
+    }
+
+    void readMessage(char& type, std::string& body) {
+        fill(5);
+        type = in_[in_pos_];
+        size_t len = static_cast<size_t>(getInt32(in_.data() + in_pos_ + 1));
+        fill(1 + len);
+        body.assign(in_, in_pos_ + 5, len - 4);
+        in_pos_ += 1 + len;
+        server_.counters_.messages++;
+    }
+
+    void message(char type, const std::string& body) {
+        out_ += type;
+        putInt32(out_, static_cast<int32_t>(body.size() + 4));
+        out_ += body;
+    }
+
+    // Declines SSL/GSS encryption, then trusts whatever user and database the client names
+    bool startup() {
+        for (;;) {
+            fill(4);
+            size_t len = static_cast<size_t>(getInt32(in_.data() + in_pos_));
+            if (len < 8) return false;
+            fill(len);
+            int32_t code = getInt32(in_.data() + in_pos_ + 4);
+            in_pos_ += len;
+            if (code == kSslRequest || code == kGssEncRequest) {
+                out_ += 'N';
+                continue;
+            }
+            if (code != kProtocolVersion3) return false; // cancel requests, protocol 2
+            break;
+        }
+        std::string auth_ok;
+        putInt32(auth_ok, 0);
+        message('R', auth_ok);
+        const char* parameters[][2] = {
+            {"server_version", "16.0"},         {"server_encoding", "UTF8"},
+            {"client_encoding", "UTF8"},        {"DateStyle", "ISO, MDY"},
+            {"integer_datetimes", "on"},        {"standard_conforming_strings", "on"},
+            {"TimeZone", "UTC"},
+        };
+        for (const auto& parameter : parameters) {
+            std::string body;
+            putString(body, parameter[0]);
+            putString(body, parameter[1]);
+            message('S', body);
+        }
+        std::string key;
+        putInt32(key, static_cast<int32_t>(fd_));
+        putInt32(key, 0);
+        message('K', key);
+        readyForQuery();
+        return true;
+    }
+
+    void readyForQuery() {
+        message('Z', std::string(1, txn_ == Txn::Idle ? 'I' : txn_ == Txn::Block ? 'T' : 'E'));
+    }
+
+    void rowDescription(int16_t columns) {
+        std::string body;
+        putInt16(body, columns);
+        for (int16_t i = 0; i < columns; ++i) {
+            putString(body, "?column?");
+            putInt32(body, 0);        // table oid
+            putInt16(body, 0);        // column number
+            putInt32(body, kTextOid);
+            putInt16(body, -1);       // variable length
+            putInt32(body, -1);       // no type modifier
+            putInt16(body, 0);        // text format
+        }
+        message('T', body);
+    }
+
+    void commandComplete(const std::string& tag) {
+        std::string body;
+        putString(body, tag);
+        message('C', body);
+    }
+
+    // Sends the ErrorResponse and aborts an open transaction block; always false
+    bool fail(const Error& error) {
+        std::string body;
+        auto field = [&](char code, const std::string& value) {
+            if (value.empty()) return;
+            body += code;
+            putString(body, value);
+        };
+        field('S', "ERROR");
+        field('V', "ERROR");
+        field('C', error.sqlstate);
+        field('M', error.message);
+        field('t', error.table);
+        field('c', error.column);
+        field('n', error.constraint);
+        body += '\0';
+        message('E', body);
+        if (txn_ == Txn::Block) txn_ = Txn::Failed;
+        return false;
+    }
+
+    // Counts normalized against every fault on its table; true (error filled in) on a hit
+    bool injectFault(const std::string& normalized, Error& error) {
+        std::string table = targetTable(normalized);
+        const auto& faults = server_.options_.faults;
+        for (size_t i = 0; i < faults.size(); ++i) {
+            const Fault& fault = faults[i];
+            if (fault.every == 0 || (!fault.table.empty() && fault.table != table)) continue;
+            if (++server_.fault_hits_[i] % fault.every != 0) continue;
+            server_.counters_.faults++;
+            error = Error{fault.sqlstate, "", table, "", ""};
+            if (fault.sqlstate == "23503") {
+                error.constraint = table + "_fk";
+                error.message = "insert or update on table \"" + table + "\" violates foreign key constraint \"" +
+                                error.constraint + "\"";
+            } else if (fault.sqlstate == "23505") {
+                error.constraint = table + "_pkey";
+                error.message = "duplicate key value violates unique constraint \"" + error.constraint + "\"";
+            } else if (fault.sqlstate == "23502") {
+                error.column = "id";
+                error.message = "null value in column \"id\" of relation \"" + table + "\" violates not-null constraint";
+            } else {
+                error.message = "injected error";
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // Runs one statement; false if it failed (the ErrorResponse is already queued).
+    // The simple protocol describes result rows itself, the extended one on Describe.
+    bool runStatement(const std::string& sql, bool simple) {
+        std::string normalized = normalize(sql);
+        std::string word = firstWord(normalized);
+        if (normalized.empty()) {
+            message('I', "");
+            return true;
+        }
+
+        bool ends_block = word == "commit" || word == "end" || word == "rollback" || word == "abort";
+        if (txn_ == Txn::Failed && !ends_block) {
+            return fail({"25P02", "current transaction is aborted, commands ignored until end of transaction block",
+                         "", "", ""});
+        }
+
+        if (word == "begin" || word == "start") {
+            txn_ = Txn::Block;
+            commandComplete("BEGIN");
+        } else if (startsWith(normalized, "rollback to")) {
+            if (txn_ == Txn::Failed) txn_ = Txn::Block;
+            commandComplete("ROLLBACK");
+        } else if (ends_block) {
+            bool commit = (word == "commit" || word == "end") && txn_ == Txn::Block;
+            txn_ = Txn::Idle;
+            commandComplete(commit ? "COMMIT" : "ROLLBACK");
+        } else if (word == "copy" && normalized.find(" from stdin") != std::string::npos) {
+            return copyIn(normalized);
+        } else if (word == "copy" && normalized.find(" to stdout") != std::string::npos) {
+            std::string body;
+            body += '\0';
+            putInt16(body, 1);
+            putInt16(body, 0);
+            message('H', body);
+            message('c', "");
+            commandComplete("COPY 0");
+        } else {
+            Error error;
+            if (word == "insert" && injectFault(normalized, error)) return fail(error);
+            Reply reply = answer(normalized, word);
+            if (reply.returns_rows && simple) rowDescription(reply.columns);
+            for (const auto& value : reply.rows) {
+                std::string body;
+                putInt16(body, reply.columns);
+                putInt32(body, static_cast<int32_t>(value.size()));
+                body += value;
+                for (int16_t i = 1; i < reply.columns; ++i) putInt32(body, -1);
+                message('D', body);
+            }
+            commandComplete(reply.tag);
+        }
+        return true;
+    }
+
+    bool copyIn(const std::string& normalized) {
+        bool binary = normalized.find("binary") != std::string::npos;
+        std::string response;
+        response += static_cast<char>(binary ? 1 : 0);
+        putInt16(response, 0);
+        message('G', response);
+
+        std::string data;
+        char type;
+        std::string body;
+        for (;;) {
+            readMessage(type, body);
+            if (type == 'd') data += body;
+            else if (type == 'c') break;
+            else if (type == 'f') return fail({"57014", "COPY from stdin failed: " + Cursor(body).str(), "", "", ""});
+            // Flush and Sync are ignored during COPY, as the server does
+        }
+        size_t rows = binary ? countBinaryCopyRows(data) : static_cast<size_t>(std::count(data.begin(), data.end(), '\n'));
+
+        Error error;
+        if (injectFault(normalized, error)) return fail(error);
+        server_.counters_.copy_rows += rows;
+        commandComplete("COPY " + std::to_string(rows));
+        return true;
+    }
+
+    void simpleQuery(const std::string& sql) {
+        server_.counters_.queries++;
+        auto statements = splitStatements(sql);
+        if (statements.empty()) message('I', "");
+        for (const auto& statement : statements) {
+            if (!runStatement(statement, true)) break;
+        }
+        readyForQuery();
+    }
+
+    void extendedError(const Error& error) {
+        fail(error);
+        skip_to_sync_ = true;
+    }
+
+    void parse(const std::string& body) {
+        Cursor cursor(body);
+        std::string name = cursor.str();
+        statements_[name] = cursor.str();
+        message('1', "");
+    }
+
+    void bind(const std::string& body) {
+        Cursor cursor(body);
+        std::string portal = cursor.str();
+        std::string statement = cursor.str();
+        auto it = statements_.find(statement);
+        if (it == statements_.end()) {
+            return extendedError({"26000", "prepared statement \"" + statement + "\" does not exist", "", "", ""});
+        }
+        // Parameter values are not needed: nothing is stored
+        portals_[portal] = it->second;
+        message('2', "");
+    }
+
+    void describe(const std::string& body) {
+        Cursor cursor(body);
+        char kind = cursor.byte();
+        std::string name = cursor.str();
+        auto& names = kind == 'S' ? statements_ : portals_;
+        auto it = names.find(name);
+        if (it == names.end()) {
+            return extendedError({kind == 'S' ? "26000" : "34000", "\"" + name + "\" does not exist", "", "", ""});
+        }
+        std::string normalized = normalize(it->second);
+        if (kind == 'S') {
+            int16_t count = parameterCount(it->second);
+            std::string parameters;
+            putInt16(parameters, count);
+            for (int16_t i = 0; i < count; ++i) putInt32(parameters, kTextOid);
+            message('t', parameters);
+        }
+        if (returnsRows(normalized, firstWord(normalized))) rowDescription(resultColumns(normalized));
+        else message('n', "");
+    }
+
+    void execute(const std::string& body) {
+        server_.counters_.executes++;
+        std::string portal = Cursor(body).str();
+        auto it = portals_.find(portal);
+        if (it == portals_.end()) {
+            return extendedError({"34000", "portal \"" + portal + "\" does not exist", "", "", ""});
+        }
+        if (!runStatement(it->second, false)) skip_to_sync_ = true;
+    }
+
+    void close(const std::string& body) {
+        Cursor cursor(body);
+        char kind = cursor.byte();
+        (kind == 'S' ? statements_ : portals_).erase(cursor.str());
+        message('3', "");
+    }
+};
+
+FakePgServer::FakePgServer() : FakePgServer(Options()) {}
+
+FakePgServer::FakePgServer(Options options)
+    : options_(std::move(options)), fault_hits_(new std::atomic<size_t>[options_.faults.size()]()) {
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    int one = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    socklen_t len = sizeof(addr);
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(listen_fd_, 64) < 0 ||
+        ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&addr), &len) < 0) {
+        std::string error = std::strerror(errno);
+        ::close(listen_fd_);
+        throw std::runtime_error("Failed to listen on 127.0.0.1: " + error);
+    }
+    port_ = ntohs(addr.sin_port);
+    accept_thread_ = std::thread(&FakePgServer::acceptLoop, this);
+}
+
+FakePgServer::~FakePgServer() {
+    stop();
+}
+
+void FakePgServer::acceptLoop() {
+    while (!stopping_) {
+        int fd = ::accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            break; // listener shut down
+        }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        if (stopping_) {
+            ::close(fd);
+            break;
+        }
+        counters_.connections++;
+        // Sessions leave their socket open; stop() closes it after the thread ends, so
+        // the descriptor cannot be reused while stop() still shuts it down
+        session_fds_.push_back(fd);
+        session_threads_.emplace_back([this, fd]() { Session(*this, fd).run(); });
+    }
+}
+
+void FakePgServer::stop() {
+    if (stopping_.exchange(true)) return;
+    ::shutdown(listen_fd_, SHUT_RDWR);
+    if (accept_thread_.joinable()) accept_thread_.join();
+    ::close(listen_fd_);
+
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(sessions_mutex_);
+        for (int fd : session_fds_) ::shutdown(fd, SHUT_RDWR);
+        threads.swap(session_threads_);
+    }
+    for (auto& thread : threads) thread.join();
+    for (int fd : session_fds_) ::close(fd);
+    session_fds_.clear();
+}
+
+FakePgServer::Stats FakePgServer::stats() const {
+    Stats stats;
+    stats.connections = counters_.connections;
+    stats.round_trips = counters_.round_trips;
+    stats.messages = counters_.messages;
+    stats.queries = counters_.queries;
+    stats.executes = counters_.executes;
+    stats.syncs = counters_.syncs;
+    stats.copy_rows = counters_.copy_rows;
+    stats.faults = counters_.faults;
+    stats.bytes_received = counters_.bytes_received;
+    stats.bytes_sent = counters_.bytes_sent;
+    return stats;
+}
+
+void FakePgServer::resetStats() {
+    for (auto* counter : {&counters_.connections, &counters_.round_trips, &counters_.messages, &counters_.queries,
+                          &counters_.executes, &counters_.syncs, &counters_.copy_rows, &counters_.faults,
+                          &counters_.bytes_received, &counters_.bytes_sent}) {
+        counter->store(0);
+    }
+}
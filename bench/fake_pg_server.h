@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Loopback stand-in for PostgreSQL, for benchmarking the *Database classes
+// without a live server.
+//
+// Listens on 127.0.0.1 (ephemeral port) and speaks enough of protocol v3 for
+// libpq and libpqxx: startup (SSL/GSS requests are declined, no auth), simple
+// and extended queries, COPY FROM STDIN (text and binary), COPY TO STDOUT and
+// pipelined syncs. Nothing is stored. INSERT/UPDATE/DELETE report one row,
+// SELECTs answer with an empty result, except aggregates (one "0"), EXISTS
+// (one "f") and FROM-less selects like the pool's health check (one "1").
+// Results have as many text columns as the last top-level SELECT list or
+// RETURNING clause; columns after the first are NULL. So ID caches load empty,
+// and loaders create placeholders as on a fresh database. The catalog is empty
+// too, so the cluster staging merge cannot build its SQL and is not supported. Transaction blocks are tracked, including aborted blocks and
+// savepoints, because pqxx checks the status byte.
+//
+// Faults are deterministic: a Fault fails every Nth INSERT or COPY into its
+// table with the given SQLSTATE, with the constraint name set, as PostgreSQL
+// would report it. The latency is slept before each reply is flushed, so it
+// costs once per client round trip and pipelining hides it as it would on a
+// real network.
+class FakePgServer {
+public:
+    struct Fault {
+        std::string table;    // target of INSERT INTO / COPY ("" = any)
+        std::string sqlstate; // e.g. "23503" (foreign key), "23505" (unique)
+        size_t every = 0;     // fail every Nth matching statement (0 = never)
+    };
+
+    struct Options {
+        std::chrono::microseconds latency{0};
+        std::vector<Fault> faults;
+    };
+
+    struct Stats {
+        size_t connections = 0;
+        size_t round_trips = 0;    // reply flushes (approximate once the client pipelines)
+        size_t messages = 0;       // frontend messages, including CopyData
+        size_t queries = 0;        // simple Query messages
+        size_t executes = 0;       // extended-protocol Execute messages
+        size_t syncs = 0;
+        size_t copy_rows = 0;
+        size_t faults = 0;         // errors injected
+        size_t bytes_received = 0; // client -> server
+        size_t bytes_sent = 0;     // server -> client
+    };
+
+    // Starts listening; throws std::runtime_error if the socket cannot be set up
+    FakePgServer();
+    explicit FakePgServer(Options options);
+    ~FakePgServer();
+
+    FakePgServer(const FakePgServer&) = delete;
+    FakePgServer& operator=(const FakePgServer&) = delete;
+
+    int port() const { return port_; }
+    const char* host() const { return "127.0.0.1"; }
+
+    Stats stats() const;
+    void resetStats();
+
+    // Closes the listener and every open session (also done by the destructor)
+    void stop();
+
+private:
+    struct Counters {
+        std::atomic<size_t> connections{0}, round_trips{0}, messages{0}, queries{0}, executes{0}, syncs{0},
+            copy_rows{0}, faults{0}, bytes_received{0}, bytes_sent{0};
+    };
+    class Session;
+
+    Options options_;
+    std::unique_ptr<std::atomic<size_t>[]> fault_hits_; // matching statements seen per fault
+    Counters counters_;
+    int listen_fd_ = -1;
+    int port_ = 0;
+    std::atomic<bool> stopping_{false};
+    std::thread accept_thread_;
+    std::mutex sessions_mutex_;
+    std::vector<int> session_fds_;
+    std::vector<std::thread> session_threads_;
+
+    void acceptLoop();
+};
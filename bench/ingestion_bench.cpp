@@ -0,0 +1,341 @@
+// Reader throughput benchmark over generated CourtListener-shaped data.
+//
+// For every table it times three paths over the same file and reports MB/s and
+// records/s (best of --reps runs):
+//   split  finding record boundaries only (RecordScanner for the memory-mapped
+//          readers, getline through InputStream for the line-oriented ones)
+//   parse  parseCsvLine over records that were already split
+//   e2e    the reader's own batch loop, as the ingestion apps drive it
+// Parse warnings the readers print for malformed rows are suppressed while timing.
+#include "data_generator.h"
+#include "input_stream.h"
+#include "opinion.h"
+#include "opinion_cited.h"
+#include "opinion_cluster.h"
+#include "opinion_cluster_panel.h"
+#include "opinion_joined_by.h"
+#include "parenthetical.h"
+#include "search_citation.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+struct Result {
+    std::string table;
+    std::string phase;
+    size_t records = 0;
+    size_t bytes = 0;
+    double seconds = 0;
+};
+
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+};
+
+// Runs fn reps times with std::cerr silenced; returns the fastest run and the record
+// count it reported
+Result timeBest(const std::string& table, const std::string& phase, size_t bytes, size_t reps,
+                const std::function<size_t()>& fn) {
+    NullBuffer null;
+    Result best{table, phase, 0, bytes, 0};
+    for (size_t r = 0; r < reps; ++r) {
+        std::streambuf* saved = std::cerr.rdbuf(&null);
+        auto t0 = std::chrono::steady_clock::now();
+        size_t records = 0;
+        try {
+            records = fn();
+        } catch (...) {
+            std::cerr.rdbuf(saved);
+            throw;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t0;
+        std::cerr.rdbuf(saved);
+        if (r == 0 || elapsed.count() < best.seconds) {
+            best.seconds = elapsed.count();
+            best.records = records;
+        }
+    }
+    return best;
+}
+
+size_t fileSize(const std::string& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    return in.is_open() ? static_cast<size_t>(in.tellg()) : 0;
+}
+
+// Physical lines after the header, as the line-oriented readers see them
+std::vector<std::string> splitLines(const std::string& path) {
+    std::vector<std::string> lines;
+    InputStream in(path);
+    std::string line;
+    std::getline(in, line); // header
+    while (std::getline(in, line)) lines.push_back(line);
+    return lines;
+}
+
+// 1 if the record parsed; malformed rows throw, and the apps count them as rejected
+template <typename Reader, typename Record>
+size_t parseRecord(Reader& reader, const Record& record) {
+    try {
+        return reader.parseCsvLine(record).id != 0;
+    } catch (const std::exception&) {
+        return 0;
+    }
+}
+
+// split / parse / e2e for the memory-mapped readers (OpinionReader, OpinionClusterReader)
+template <typename Reader>
+void benchMapped(const std::string& table, const std::string& path, size_t bytes, size_t reps,
+                 size_t batch, std::vector<Result>& results) {
+    results.push_back(timeBest(table, "split", bytes, reps, [&]() {
+        Reader reader(path);
+        std::vector<std::string_view> records;
+        size_t n = 0;
+        while (reader.readNextBatch(records, batch)) n += records.size();
+        return n;
+    }));
+
+    // Views into the mapping stay valid while the reader lives
+    Reader reader(path);
+    std::vector<std::string_view> all, records;
+    while (reader.readNextBatch(records, batch)) all.insert(all.end(), records.begin(), records.end());
+    results.push_back(timeBest(table, "parse", bytes, reps, [&]() {
+        size_t n = 0;
+        for (auto record : all) n += parseRecord(reader, record);
+        return n;
+    }));
+
+    results.push_back(timeBest(table, "e2e", bytes, reps, [&]() {
+        Reader e2e(path);
+        std::vector<std::string_view> views;
+        size_t n = 0;
+        while (e2e.readNextBatch(views, batch)) {
+            for (auto record : views) n += parseRecord(e2e, record);
+        }
+        return n;
+    }));
+}
+
+// split / parse / e2e for the line-oriented readers. Their header parsing is private
+// and happens on the first read, so parse reuses the reader of the last e2e run.
+// ParentheticalReader keeps parseCsvLine private; it gets no parse row.
+template <typename Reader>
+void benchLines(const std::string& table, const std::string& path, size_t bytes, size_t reps,
+                const std::function<size_t(Reader&)>& read_all,
+                const std::function<bool(Reader&, const std::string&)>& parse, std::vector<Result>& results) {
+    std::vector<std::string> lines;
+    results.push_back(timeBest(table, "split", bytes, reps, [&]() {
+        lines = splitLines(path);
+        return lines.size();
+    }));
+
+    std::unique_ptr<Reader> last;
+    Result e2e = timeBest(table, "e2e", bytes, reps, [&]() {
+        last = std::make_unique<Reader>(path);
+        return read_all(*last);
+    });
+
+    if (parse) {
+        results.push_back(timeBest(table, "parse", bytes, reps, [&]() {
+            size_t n = 0;
+            for (const auto& line : lines) n += parse(*last, line);
+            return n;
+        }));
+    }
+    results.push_back(e2e);
+}
+
+template <typename Reader>
+bool parseLine(Reader& reader, const std::string& line) {
+    return parseRecord(reader, line) != 0;
+}
+
+template <typename Reader>
+size_t drainBatches(Reader& reader, size_t batch) {
+    size_t n = 0;
+    while (reader.hasMore()) {
+        auto records = reader.readBatch(batch);
+        if (records.empty() && !reader.hasMore()) break;
+        n += records.size();
+    }
+    return n;
+}
+
+void runTable(DataGenerator::Table table, const std::string& path, size_t reps, size_t batch,
+              std::vector<Result>& results) {
+    using Table = DataGenerator::Table;
+    std::string name = DataGenerator::tableName(table);
+    size_t bytes = fileSize(path);
+    switch (table) {
+        case Table::Opinions:
+            benchMapped<OpinionReader>(name, path, bytes, reps, batch, results);
+            break;
+        case Table::Clusters:
+            benchMapped<OpinionClusterReader>(name, path, bytes, reps, batch, results);
+            break;
+        case Table::Cited:
+            benchLines<OpinionCitedReader>(name, path, bytes, reps,
+                [batch](OpinionCitedReader& r) { return drainBatches(r, batch); },
+                parseLine<OpinionCitedReader>, results);
+            break;
+        case Table::Citations:
+            benchLines<SearchCitationReader>(name, path, bytes, reps,
+                [batch](SearchCitationReader& r) { return drainBatches(r, batch); },
+                parseLine<SearchCitationReader>, results);
+            break;
+        case Table::Parentheticals:
+            benchLines<ParentheticalReader>(name, path, bytes, reps,
+                [batch](ParentheticalReader& r) { return drainBatches(r, batch); }, nullptr, results);
+            break;
+        case Table::Panels:
+            benchLines<OpinionClusterPanelReader>(name, path, bytes, reps,
+                [batch](OpinionClusterPanelReader& r) { return drainBatches(r, batch); },
+                parseLine<OpinionClusterPanelReader>, results);
+            break;
+        case Table::JoinedBy:
+            benchLines<OpinionJoinedByReader>(name, path, bytes, reps,
+                [batch](OpinionJoinedByReader& r) { return drainBatches(r, batch); },
+                parseLine<OpinionJoinedByReader>, results);
+            break;
+    }
+}
+
+void printUsage() {
+    std::cout << "Usage: ingestion_bench [--size-mb=N] [--rows=N] [--reps=N] [--batch=N] [--seed=N]\n"
+              << "                       [--malformed=RATE] [--tables=a,b,...] [--dir=DIR] [--generate-only] [--csv]\n";
+    std::cout << "  --size-mb=N        Size of each generated file (default 16)\n";
+    std::cout << "  --rows=N           Row count per file instead of a size\n";
+    std::cout << "  --reps=N           Runs per measurement, the fastest is reported (default 3)\n";
+    std::cout << "  --batch=N          Records per reader batch (default 1000)\n";
+    std::cout << "  --seed=N           Generator seed; equal seeds give identical files (default 42)\n";
+    std::cout << "  --malformed=RATE   Share of malformed rows (default 0.001)\n";
+    std::cout << "  --tables=LIST      Subset of: opinions,clusters,cited,citations,parentheticals,panels,joined_by\n";
+    std::cout << "  --dir=DIR          Write the files to DIR and keep them (default: a temporary directory)\n";
+    std::cout << "  --generate-only    Write the files and exit\n";
+    std::cout << "  --csv              Print results as CSV (for comparing runs)\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    DataGenerator::Options gen;
+    gen.target_bytes = 16 << 20;
+    size_t reps = 3;
+    size_t batch = 1000;
+    std::string dir;
+    bool generate_only = false;
+    bool csv = false;
+    std::vector<DataGenerator::Table> tables = DataGenerator::allTables();
+
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg.rfind("--size-mb=", 0) == 0) {
+                gen.target_bytes = static_cast<size_t>(std::stod(arg.substr(10)) * (1 << 20));
+                gen.rows = 0;
+            } else if (arg.rfind("--rows=", 0) == 0) {
+                gen.rows = static_cast<size_t>(std::stoull(arg.substr(7)));
+                gen.target_bytes = 0;
+            } else if (arg.rfind("--reps=", 0) == 0) {
+                reps = std::max<size_t>(1, static_cast<size_t>(std::stoull(arg.substr(7))));
+            } else if (arg.rfind("--batch=", 0) == 0) {
+                batch = std::max<size_t>(1, static_cast<size_t>(std::stoull(arg.substr(8))));
+            } else if (arg.rfind("--seed=", 0) == 0) {
+                gen.seed = std::stoull(arg.substr(7));
+            } else if (arg.rfind("--malformed=", 0) == 0) {
+                gen.malformed_rate = std::stod(arg.substr(12));
+            } else if (arg.rfind("--tables=", 0) == 0) {
+                tables.clear();
+                std::stringstream list(arg.substr(9));
+                std::string name;
+                while (std::getline(list, name, ',')) tables.push_back(DataGenerator::tableFromName(name));
+            } else if (arg.rfind("--dir=", 0) == 0) {
+                dir = arg.substr(6);
+            } else if (arg == "--generate-only") {
+                generate_only = true;
+            } else if (arg == "--csv") {
+                csv = true;
+            } else {
+                printUsage();
+                return arg == "--help" || arg == "-h" ? 0 : 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid option: " << e.what() << "\n";
+        printUsage();
+        return 1;
+    }
+
+    bool keep = !dir.empty();
+    if (!keep) {
+        char tmpl[] = "/tmp/ingestion_bench.XXXXXX";
+        if (!mkdtemp(tmpl)) {
+            std::cerr << "Failed to create a temporary directory\n";
+            return 1;
+        }
+        dir = tmpl;
+    }
+
+    std::vector<std::string> paths;
+    std::vector<Result> results;
+    int status = 0;
+    try {
+        DataGenerator generator(gen);
+        for (auto table : tables) {
+            std::string path = dir + "/" + DataGenerator::tableName(table) + ".csv";
+            auto t0 = std::chrono::steady_clock::now();
+            size_t rows = generator.writeFile(table, path);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t0;
+            paths.push_back(path);
+            std::cerr << "Generated " << path << ": " << rows << " rows, " << fileSize(path) << " bytes in "
+                      << elapsed.count() << " s\n";
+        }
+
+        if (!generate_only) {
+            for (size_t i = 0; i < tables.size(); ++i) runTable(tables[i], paths[i], reps, batch, results);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Benchmark failed: " << e.what() << "\n";
+        status = 1;
+    }
+
+    if (csv) {
+        std::cout << "table,phase,records,bytes,seconds,mb_per_s,records_per_s\n";
+    } else if (!results.empty()) {
+        std::printf("%-15s %-6s %10s %9s %9s %10s %12s\n", "table", "phase", "records", "MB", "seconds", "MB/s",
+                    "records/s");
+    }
+    for (const auto& r : results) {
+        double mb = static_cast<double>(r.bytes) / (1 << 20);
+        double secs = std::max(r.seconds, 1e-9);
+        if (csv) {
+            std::printf("%s,%s,%zu,%zu,%.6f,%.2f,%.0f\n", r.table.c_str(), r.phase.c_str(), r.records, r.bytes,
+                        r.seconds, mb / secs, static_cast<double>(r.records) / secs);
+        } else {
+            std::printf("%-15s %-6s %10zu %9.1f %9.3f %10.1f %12.0f\n", r.table.c_str(), r.phase.c_str(),
+                        r.records, mb, r.seconds, mb / secs, static_cast<double>(r.records) / secs);
+        }
+    }
+
+    if (!keep) {
+        for (const auto& path : paths) std::remove(path.c_str());
+        rmdir(dir.c_str());
+    }
+    return status;
+}
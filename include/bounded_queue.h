@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Single-producer / single-consumer bounded ring buffer. push() and pop() are
+// lock-free (one atomic index each); when the ring is full or empty the caller
+// backs off (spin, yield, then short sleeps) so a stage waiting on PostgreSQL
+// does not burn a core. A full queue is the backpressure signal for the
+// producer. close() ends the stream: pop() drains what is left, then fails.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : slots_(capacity + 1) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Blocks while full. Returns false (and drops value) if the queue was closed.
+    bool push(T value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        size_t next = increment(tail);
+        for (unsigned spins = 0; next == head_.load(std::memory_order_acquire); ++spins) {
+            if (closed_.load(std::memory_order_acquire)) return false;
+            backoff(spins);
+        }
+        if (closed_.load(std::memory_order_acquire)) return false;
+        slots_[tail] = std::move(value);
+        tail_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Blocks while empty. Returns false once the queue is closed and drained.
+    bool pop(T& out) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        for (unsigned spins = 0; head == tail_.load(std::memory_order_acquire); ++spins) {
+            if (closed_.load(std::memory_order_acquire)) {
+                // Re-check: the producer may have pushed just before closing
+                if (head == tail_.load(std::memory_order_acquire)) return false;
+                break;
+            }
+            backoff(spins);
+        }
+        out = std::move(*slots_[head]);
+        slots_[head].reset();
+        head_.store(increment(head), std::memory_order_release);
+        return true;
+    }
+
+    void close() { closed_.store(true, std::memory_order_release); }
+    bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+    size_t capacity() const { return slots_.size() - 1; }
+    size_t size() const {
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        return tail >= head ? tail - head : slots_.size() - head + tail;
+    }
+
+private:
+    std::vector<std::optional<T>> slots_;
+    alignas(64) std::atomic<size_t> head_{0}; // consumer index
+    alignas(64) std::atomic<size_t> tail_{0}; // producer index
+    alignas(64) std::atomic<bool> closed_{false};
+
+    size_t increment(size_t i) const { return i + 1 == slots_.size() ? 0 : i + 1; }
+
+    static void backoff(unsigned spins) {
+        if (spins < 64) return;
+        if (spins < 128) { std::this_thread::yield(); return; }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "connection_pool.h"
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Index and FK deferral for the initial load of an empty table (--bulk-initial).
+//
+// begin() records the table's secondary indexes in a state file, drops them and
+// disables the table's triggers, which include the FK check triggers. Rows then
+// go in without per-row index maintenance or FK lookups. finish() rebuilds the
+// indexes concurrently (one pooled connection each), turns the triggers back on,
+// and checks every FK with a single anti-join, deleting the violating rows and
+// writing them to the bad-records stream, then ANALYZEs the table.
+//
+// Primary keys and unique indexes are kept: ON CONFLICT and duplicate detection
+// still rely on them. Disabling the FK triggers needs a superuser connection. If
+// a run dies mid-load, the state file keeps the dropped definitions and a rerun
+// with --bulk-initial picks them up.
+class BulkInitialLoad {
+public:
+    struct ForeignKey {
+        std::string name;
+        std::vector<std::string> columns;
+        std::string ref_table;
+        std::vector<std::string> ref_columns;
+    };
+
+    BulkInitialLoad(std::shared_ptr<ConnectionPool> pool, std::string table, std::string state_file);
+
+    void begin();
+
+    // Returns the number of FK violators removed. Throws (leaving the state file
+    // in place) if an index cannot be rebuilt; the triggers are re-enabled and the
+    // FK check runs before that error is rethrown.
+    size_t finish(size_t threads, std::ostream& bad_records);
+
+    const std::vector<std::string>& indexDefinitions() const { return index_defs_; }
+
+    // <csv>.indexes.sql
+    static std::string defaultStatePath(const std::string& csv_path);
+
+    // FK constraints declared on table, from the catalog
+    static std::vector<ForeignKey> foreignKeys(pqxx::transaction_base& txn, const std::string& table);
+
+    // Statement text helpers (no database access)
+    static std::string ifNotExists(const std::string& index_def);
+    static std::string violationQuery(const std::string& table, const std::vector<ForeignKey>& fks);
+    static void saveState(const std::string& path, const std::string& table, const std::vector<std::string>& defs);
+    static bool loadState(const std::string& path, std::vector<std::string>& defs);
+
+private:
+    std::shared_ptr<ConnectionPool> pool_;
+    std::string table_;
+    std::string state_file_;
+    std::vector<std::string> index_defs_;
+
+    void rebuildIndexes(size_t threads);
+    size_t removeViolators(std::ostream& bad_records);
+};
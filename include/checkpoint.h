@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Resume point for a streaming ingestion run.
+//
+// offset is the byte offset of the first record whose batch has not been
+// committed; file_size identifies the input so a checkpoint is not applied to a
+// different dump. Stored as a small key=value text file next to the input.
+struct Checkpoint {
+    size_t offset = 0;
+    size_t file_size = 0;
+    size_t records = 0; // records committed before offset (progress reporting only)
+
+    // Replace path atomically (temp file + rename); throws std::runtime_error on I/O failure
+    void save(const std::string& path) const;
+
+    // Returns false if path does not exist; throws std::runtime_error if it is malformed
+    bool load(const std::string& path);
+
+    static std::string defaultPath(const std::string& input) { return input + ".checkpoint"; }
+};
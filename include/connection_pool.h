@@ -0,0 +1,97 @@
+#pragma once
+
+#include <pqxx/pqxx>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+// Pool of open pqxx connections for one connection string.
+//
+// Database classes borrow a connection per call with acquire() and hand it back
+// when the Lease goes out of scope, so a run pays the TCP/auth/backend-fork cost
+// once per pooled connection instead of once per batch or placeholder.
+// Connections that sat idle longer than the health-check interval are probed
+// with SELECT 1 before reuse; broken ones are dropped and replaced.
+class ConnectionPool {
+public:
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease();
+
+        pqxx::connection& operator*() const { return *conn_; }
+        pqxx::connection* operator->() const { return conn_.get(); }
+        pqxx::connection& get() const { return *conn_; }
+
+        // Close the connection instead of returning it (e.g. after a protocol error)
+        void discard();
+
+    private:
+        friend class ConnectionPool;
+        Lease(ConnectionPool* pool, std::unique_ptr<pqxx::connection> conn)
+            : pool_(pool), conn_(std::move(conn)) {}
+        ConnectionPool* pool_ = nullptr;
+        std::unique_ptr<pqxx::connection> conn_;
+    };
+
+    explicit ConnectionPool(std::string connection_string, size_t max_size = defaultSize());
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // Prepare a named statement on conn unless it is already prepared there. Prepared
+    // statements live for the whole session, so each pooled connection parses and
+    // plans a statement once no matter how many batches reuse it. Call it before
+    // opening a transaction on conn.
+    void prepare(pqxx::connection& conn, const std::string& name, const std::string& sql);
+
+    // Borrow a connection; waits up to the acquire timeout when all max_size are in use
+    // and throws std::runtime_error if none becomes free.
+    Lease acquire();
+
+    size_t maxSize() const;
+    void setMaxSize(size_t max_size);
+    size_t idleCount() const;
+    size_t openCount() const;
+    size_t createdCount() const;
+
+    void setHealthCheckInterval(std::chrono::milliseconds interval);
+    void setAcquireTimeout(std::chrono::milliseconds timeout);
+
+    // Process-wide pool per connection string, shared by every *Database instance
+    static std::shared_ptr<ConnectionPool> shared(const std::string& connection_string);
+
+    // Size used by pools created after the call (default 4)
+    static void setDefaultSize(size_t max_size);
+    static size_t defaultSize();
+
+private:
+    struct Idle {
+        std::unique_ptr<pqxx::connection> conn;
+        std::chrono::steady_clock::time_point since;
+    };
+
+    const std::string connection_string_;
+    mutable std::mutex mutex_;
+    std::condition_variable available_;
+    std::vector<Idle> idle_;
+    std::map<const pqxx::connection*, std::set<std::string>> prepared_; // statement names per open connection
+    size_t max_size_;
+    size_t open_ = 0;     // idle + leased
+    size_t created_ = 0;  // total connections ever opened
+    std::chrono::milliseconds health_check_interval_{30000};
+    std::chrono::milliseconds acquire_timeout_{60000};
+
+    void release(std::unique_ptr<pqxx::connection> conn, bool reusable);
+    static bool healthy(pqxx::connection& conn);
+};
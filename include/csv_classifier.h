@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Classifies 64-byte blocks of CSV input into bitmasks of quote, comma and
+// newline positions (bit i = byte i of the block). The kernel is picked at
+// runtime from the host CPU (AVX2, SSE4.2 or scalar), so one binary runs
+// everywhere and uses the widest vectors available.
+class CsvClassifier {
+public:
+    enum class Isa { Scalar, Sse42, Avx2 };
+
+    struct Masks {
+        uint64_t quote = 0;
+        uint64_t comma = 0;
+        uint64_t newline = 0;
+    };
+
+    static constexpr size_t kBlockSize = 64;
+
+    // Uses the best kernel supported by this CPU
+    CsvClassifier();
+    // Forces a kernel (falls back to scalar if the CPU lacks it)
+    explicit CsvClassifier(Isa isa);
+
+    // block must point at kBlockSize readable bytes
+    Masks classify(const char* block) const { return fn_(block); }
+    Isa isa() const { return isa_; }
+
+    // Bytes inside a quoted region for this block. in_quotes carries the state
+    // across blocks. Doubled quotes ("") toggle twice and so cancel out.
+    static uint64_t quotedRegion(uint64_t quote_mask, bool& in_quotes) {
+        uint64_t region = prefixXor(quote_mask) ^ (in_quotes ? ~0ULL : 0ULL);
+        in_quotes = (region >> 63) != 0;
+        return region;
+    }
+
+    // Bit i of the result = XOR of bits 0..i of x
+    static uint64_t prefixXor(uint64_t x) {
+        x ^= x << 1;
+        x ^= x << 2;
+        x ^= x << 4;
+        x ^= x << 8;
+        x ^= x << 16;
+        x ^= x << 32;
+        return x;
+    }
+
+    static Isa detect();
+    static bool supported(Isa isa);
+    static const char* name(Isa isa);
+
+private:
+    using ClassifyFn = Masks (*)(const char* block);
+    Isa isa_;
+    ClassifyFn fn_;
+};
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "id_set.h"
+#include <pqxx/pqxx>
+#include <string>
+
+// Fill ids with every id of table (a trusted, unquoted table name).
+//
+// With a snapshot directory the load starts from <dir>/<table>.ids and streams
+// only rows with id above the snapshot's max id, then rewrites the snapshot,
+// so a restart costs a MAX(id) lookup plus one small range scan instead of a
+// full table scan. A snapshot whose max id exceeds the table's (restored or
+// truncated database) is discarded. Within one process the last cache loaded
+// for a table is kept in memory and used the same way, ahead of the snapshot,
+// so stages of one run share a single full scan.
+//
+// The range refresh cannot see ids inserted below the cached max id or deleted
+// since. With verify, a cache that was refreshed rather than scanned is also
+// checked against COUNT(*) and reloaded in full on a mismatch; that count is a
+// full scan of the table, so it is off unless asked for (--verify-id-cache).
+// Returns the number of ids read from the database.
+size_t loadIdCache(pqxx::transaction_base& txn, const std::string& table, IdSet& ids,
+                   const std::string& snapshot_dir, bool verify);
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Set of non-negative database ids stored as a dense bitmap over [0, max id].
+//
+// CourtListener ids are dense serials, so one bit per possible id is far
+// smaller than a std::set<int> node (~40 bytes) and membership is a single
+// word load. Negative ids are never members; insert() ignores them.
+class IdSet {
+public:
+    IdSet() = default;
+
+    // Pre-size the bitmap so ids up to max_id insert without reallocating
+    void reserve(int max_id);
+
+    // Returns true if id was not already present
+    bool insert(int id);
+
+    template <typename It>
+    void insert(It first, It last) {
+        for (; first != last; ++first) insert(*first);
+    }
+
+    bool contains(int id) const {
+        if (id < 0) return false;
+        size_t word = static_cast<size_t>(id) >> 6;
+        return word < words_.size() && (words_[word] >> (id & 63)) & 1u;
+    }
+
+    // True if every id in ids is present
+    bool containsAll(const std::vector<int>& ids) const;
+
+    // Append the ids not present to missing (in input order, duplicates kept)
+    void collectMissing(const std::vector<int>& ids, std::vector<int>& missing) const;
+
+    // Largest id inserted so far, -1 when empty
+    int maxId() const { return max_id_; }
+
+    // Write the set to path as a versioned snapshot tagged with tag (e.g. the table
+    // name). The bitmap words follow an 8-byte aligned header, so the file can be
+    // mapped and read in place. Written via a temp file + rename; throws on I/O errors.
+    void save(const std::string& path, const std::string& tag) const;
+
+    // Replace the contents with the snapshot at path. Returns false, leaving the set
+    // empty, if the file is missing, truncated, from another version or has another tag.
+    bool load(const std::string& path, const std::string& tag);
+
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    void clear();
+
+    // Bytes held by the bitmap
+    size_t memoryBytes() const { return words_.capacity() * sizeof(uint64_t); }
+
+private:
+    std::vector<uint64_t> words_;
+    size_t count_ = 0;
+    int max_id_ = -1;
+};
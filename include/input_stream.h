@@ -0,0 +1,101 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Transparent input decompression for the CSV readers.
+//
+// CourtListener bulk files ship as .gz/.bz2 (and recently .zst). Instead of
+// unpacking them to scratch disk first, readers open them through InputStream
+// (line-oriented readers) or RecordScanner (memory-mapped readers), both of which
+// fall back to the plain file when it is not compressed.
+
+enum class Compression { None, Gzip, Bzip2, Zstd };
+
+// Detected from the leading magic bytes, so a misnamed file still works.
+// Returns None for plain or unreadable files.
+Compression detectCompression(const std::string& path);
+const char* compressionName(Compression c);
+// False for codecs this build was compiled without (zlib, libbz2, libzstd are optional)
+bool compressionSupported(Compression c);
+
+// Decompresses a file on a background thread into a fixed-size ring buffer.
+//
+// The thread keeps one ring's worth of decompressed bytes ahead of the consumer,
+// so inflating overlaps with record splitting and parsing. Multi-member gzip and
+// multi-stream bzip2 files (pigz, pbzip2) are read to the end. Decompression
+// errors, including truncated input, are rethrown from read().
+class DecompressingReader {
+public:
+    DecompressingReader(const std::string& path, Compression compression, size_t ring_bytes = 8 << 20);
+    ~DecompressingReader();
+
+    DecompressingReader(const DecompressingReader&) = delete;
+    DecompressingReader& operator=(const DecompressingReader&) = delete;
+
+    // Copy the next n decompressed bytes to dst, blocking as needed. Returns fewer
+    // than n only at the end of the data.
+    size_t read(char* dst, size_t n);
+
+    // Size of the compressed file on disk
+    size_t compressedSize() const { return compressed_size_; }
+
+private:
+    std::string path_;
+    Compression compression_;
+    std::ifstream source_;
+    size_t compressed_size_ = 0;
+
+    std::vector<char> ring_;
+    size_t head_ = 0;  // next byte to read
+    size_t count_ = 0; // bytes buffered
+    bool done_ = false;
+    bool stop_ = false;
+    std::exception_ptr error_;
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::thread thread_;
+
+    void run();
+    void inflateGzip();
+    void decompressBzip2();
+    void decompressZstd();
+    // Append to the ring, blocking while it is full; false once the reader is shutting down
+    bool write(const char* src, size_t n);
+};
+
+// std::ifstream replacement that decompresses .gz/.bz2/.zst input on the fly.
+//
+// Plain files go through an ordinary std::filebuf. For compressed files a read
+// error sets badbit, which is enabled as an exception so a corrupt archive
+// cannot look like a clean end of file.
+class InputStream : public std::istream {
+public:
+    InputStream();
+    explicit InputStream(const std::string& path);
+    ~InputStream() override;
+
+    // Like std::ifstream::open: sets failbit if the file cannot be opened. Throws
+    // std::runtime_error for a compressed file whose codec is not compiled in.
+    void open(const std::string& path);
+    bool is_open() const;
+    void close();
+
+    Compression compression() const { return compression_; }
+
+private:
+    class DecompressingBuf;
+    std::filebuf file_buf_;
+    std::unique_ptr<DecompressingBuf> decompress_buf_;
+    Compression compression_ = Compression::None;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// The row structs hold their ids as int; columns are handed to IdSet's
+// std::vector<int> API without conversion
+static_assert(std::is_same<int32_t, int>::value, "Int32Batch columns must be std::vector<int>");
+
+// Batch of all-integer rows stored column by column (struct of arrays).
+//
+// Used for the narrow link tables (search_opinionscited,
+// search_opinioncluster_panel, search_opinion_joined_by), whose rows are three
+// or four ids. Each column is one contiguous array, so an FK check is a loop
+// over a single column (IdSet::collectMissing(batch.column(k), ...)), and
+// slicing or appending rows copies whole column ranges instead of structs one
+// by one. clear() keeps the capacity, so a reader refilling the same batch
+// does not allocate once it has grown to the batch size.
+class Int32Batch {
+public:
+    explicit Int32Batch(size_t columns = 0) : columns_(columns) {}
+
+    size_t columnCount() const { return columns_.size(); }
+    size_t size() const { return columns_.empty() ? 0 : columns_[0].size(); }
+    bool empty() const { return size() == 0; }
+
+    const std::vector<int32_t>& column(size_t c) const { return columns_[c]; }
+    int32_t at(size_t row, size_t c) const { return columns_[c][row]; }
+
+    // One value per column, in column order. A batch without columns takes the
+    // shape of the first row or batch appended; any other mismatch throws
+    // std::invalid_argument.
+    void append(std::initializer_list<int32_t> row);
+    // Rows [begin, end) of other
+    void append(const Int32Batch& other, size_t begin, size_t end);
+    void append(const Int32Batch& other) { append(other, 0, other.size()); }
+
+    void reserve(size_t rows);
+    // Drops the rows, keeping the columns and their capacity
+    void clear();
+
+    // The row's values joined with commas, in column order (the tables' CSV layout)
+    std::string rowCsv(size_t row) const;
+
+private:
+    std::vector<std::vector<int32_t>> columns_;
+
+    void matchColumns(size_t count);
+};
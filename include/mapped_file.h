@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of a whole file (POSIX mmap, MADV_SEQUENTIAL).
+// Pages already consumed can be dropped with release() so that scanning a
+// multi-GB dump keeps a roughly constant resident set; dropped pages are
+// re-read from the file if touched again, so earlier views stay valid.
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    std::string_view view() const { return std::string_view(data_, size_); }
+
+    // Drop resident pages that lie entirely before offset
+    void release(size_t offset);
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    size_t released_ = 0;
+};
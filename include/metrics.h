@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+// Per-stage latency histograms and record/byte counters, labelled by table.
+//
+// Stages used by the readers, drivers and database classes:
+//   read         readNextBatch / readBatch (the line readers parse inside it too)
+//   parse        parseCsvLine over one batch
+//   insert       one insert call on the database class (a whole batch)
+//   placeholder  one placeholder row for a missing FK target
+//   commit       one COMMIT
+// Counters: records_read, bytes_read, records_parsed, records_inserted,
+// records_rejected, placeholders_created.
+//
+// Everything records into Metrics::global(); a MetricsExporter started by the
+// driver (--metrics=FILE) writes it out periodically.
+
+// HDR-style histogram of microsecond latencies: exact below 16 us, then 16
+// linear sub-buckets per power of two (at most 6.25% relative error) up to
+// 2^63 us. Recording is a few relaxed atomic adds, so any thread may record.
+class LatencyHistogram {
+public:
+    void record(std::chrono::nanoseconds elapsed);
+    void recordMicros(uint64_t micros);
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t sumMicros() const { return sum_.load(std::memory_order_relaxed); }
+    uint64_t maxMicros() const { return max_.load(std::memory_order_relaxed); }
+    // Upper bound of the bucket holding the q-quantile (0 when empty)
+    uint64_t percentileMicros(double q) const;
+    // Recorded values in buckets that lie entirely at or below micros
+    uint64_t countAtOrBelow(uint64_t micros) const;
+
+    static size_t bucketIndex(uint64_t micros);
+    static uint64_t bucketUpperBound(size_t index);
+
+private:
+    static constexpr size_t kSubBuckets = 16;
+    static constexpr size_t kBuckets = 61 * kSubBuckets;
+    std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+class Metrics {
+public:
+    static Metrics& global();
+
+    // Created on first use; references stay valid for the registry's lifetime
+    LatencyHistogram& latency(const std::string& stage, const std::string& table);
+    std::atomic<uint64_t>& counter(const std::string& name, const std::string& table);
+    void add(const std::string& name, const std::string& table, uint64_t n) {
+        counter(name, table).fetch_add(n, std::memory_order_relaxed);
+    }
+
+    // Prometheus text exposition format (histograms with le buckets from 100 us to 100 s)
+    std::string prometheus() const;
+    // One JSON object per call: timestamp, per-histogram percentiles, counters
+    std::string jsonLine() const;
+
+private:
+    using Key = std::pair<std::string, std::string>; // (stage or counter name, table)
+    mutable std::mutex mutex_;
+    std::map<Key, std::unique_ptr<LatencyHistogram>> latencies_;
+    std::map<Key, std::unique_ptr<std::atomic<uint64_t>>> counters_;
+};
+
+// Records the time from construction to destruction into a histogram
+class StageTimer {
+public:
+    explicit StageTimer(LatencyHistogram& histogram)
+        : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+    StageTimer(const std::string& stage, const std::string& table)
+        : StageTimer(Metrics::global().latency(stage, table)) {}
+    ~StageTimer() { histogram_.record(std::chrono::steady_clock::now() - start_); }
+
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    LatencyHistogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+struct MetricsOptions {
+    enum class Format { Prometheus, JsonLines };
+
+    std::string path;              // empty: no export
+    Format format = Format::Prometheus;
+    bool format_set = false;       // otherwise picked from the extension (.json/.jsonl -> JsonLines)
+    unsigned interval_seconds = 15;
+};
+
+// Consumes --metrics=FILE, --metrics-format=prom|jsonl and --metrics-interval=SEC; returns
+// false for any other argument. Throws std::invalid_argument for a bad value.
+bool parseMetricsOption(const std::string& arg, MetricsOptions& options);
+// Usage lines for the options above
+const char* metricsUsage();
+
+// Writes the registry every interval on a background thread, and once more when
+// destroyed. The Prometheus file is replaced atomically (write + rename), as the
+// node exporter's textfile collector expects; JSON lines are appended.
+class MetricsExporter {
+public:
+    explicit MetricsExporter(MetricsOptions options, Metrics& metrics = Metrics::global());
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    // Throws std::runtime_error if the file cannot be written
+    void dump();
+
+    // Null when options.path is empty
+    static std::unique_ptr<MetricsExporter> start(const MetricsOptions& options);
+
+private:
+    MetricsOptions options_;
+    Metrics& metrics_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    std::thread thread_;
+};
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "input_stream.h"
+#include "int32_batch.h"
 #include <string>
 #include <vector>
 #include <map>
@@ -13,6 +15,14 @@ struct OpinionCited {
     int cited_opinion_id;
     int citing_opinion_id;
     
+    // Column order in an Int32Batch
+    enum Column : size_t { kId, kDepth, kCitedOpinionId, kCitingOpinionId, kColumnCount };
+    static OpinionCited fromBatch(const Int32Batch& batch, size_t row) {
+        return {batch.at(row, kId), batch.at(row, kDepth), batch.at(row, kCitedOpinionId),
+                batch.at(row, kCitingOpinionId)};
+    }
+    void appendTo(Int32Batch& batch) const { batch.append({id, depth, cited_opinion_id, citing_opinion_id}); }
+    
     std::string toString() const;
     std::string toCsv() const; // For outputting to bad records file
 };
@@ -29,6 +39,9 @@ public:
     // Read next batch of records (streaming mode)
     std::vector<OpinionCited> readBatch(size_t batch_size);
     
+    // Same, parsed straight into columns; batch is cleared first. Returns the rows read.
+    size_t readBatch(Int32Batch& batch, size_t batch_size);
+    
     // Check if there are more records to read
     bool hasMore() const;
     
@@ -42,11 +55,14 @@ private:
     std::string filename_;
     std::vector<std::string> header_;
     std::map<std::string, size_t> column_map_;
-    std::ifstream file_;
+    InputStream file_; // plain or .gz/.bz2/.zst
     bool header_parsed_;
     size_t total_lines_read_;
     
     void parseHeader(const std::string& header_line);
+    void ensureHeader();
+    // Next parseable record; false at end of file. Adds the bytes consumed to bytes.
+    bool nextRecord(OpinionCited& record, size_t& bytes);
     std::optional<std::string> getColumn(const std::vector<std::string>& cols, const std::string& name);
     std::vector<std::string> splitCsvLine(const std::string& line);
 };
@@ -1,10 +1,13 @@
 #pragma once
 
 #include "opinion_cited.h"
+#include "connection_pool.h"
+#include "id_set.h"
+#include "pg_raw_connection.h"
 #include <pqxx/pqxx>
+#include <memory>
 #include <string>
 #include <vector>
-#include <set>
 
 class OpinionCitedDatabase {
 public:
@@ -19,10 +22,11 @@ public:
     // Check if an opinion ID exists (foreign key validation)
     bool isValidOpinionId(int opinion_id) const;
     
-    // Insert citation records with FK handling
+    // Insert citation records (OpinionCited columns) with FK handling. When the ID cache
+    // is loaded, missing cited/citing opinions are created up front in one statement per batch.
     // Returns number of records successfully inserted
-    size_t insertCitations(const std::vector<OpinionCited>& records,
-                          std::vector<OpinionCited>& rejected_records,
+    size_t insertCitations(const Int32Batch& records,
+                          Int32Batch& rejected_records,
                           std::vector<std::string>& rejection_reasons);
     
     // Create placeholder record in search_opinion for missing opinion ID
@@ -30,8 +34,42 @@ public:
     
     // Test connection
     bool testConnection();
+    
+    // Keep an ID snapshot in dir so later runs only fetch ids added since (empty = off)
+    void setIdSnapshotDir(const std::string& dir) { id_snapshot_dir_ = dir; }
+    
+    // Check a cache refreshed from a snapshot or memory against COUNT(*) (a full scan)
+    void setVerifyIdCache(bool enabled) { verify_id_cache_ = enabled; }
+    
+    // Send up to window upserts before waiting for results (libpq pipeline mode);
+    // 0 keeps one round trip per record. Failed rows are still retried one by one.
+    void setPipelineWindow(size_t window) { pipeline_window_ = window; }
+    size_t pipelineWindow() const { return pipeline_window_; }
 
 private:
     std::string connection_string_;
-    std::set<int> valid_opinion_ids_; // Cache of valid opinion IDs
+    std::shared_ptr<ConnectionPool> pool_; // shared by every *Database on the same server
+    std::string id_snapshot_dir_;
+    bool verify_id_cache_ = false;
+    IdSet valid_opinion_ids_; // Cache of valid opinion IDs
+    bool valid_ids_loaded_ = false;   // set by loadValidOpinionIds()
+    size_t pipeline_window_ = 0;
+    std::unique_ptr<PgRawConnection> pipeline_conn_; // opened on first pipelined batch
+    
+    // Same as the public overload, on a connection the caller already holds
+    bool createPlaceholderOpinion(pqxx::connection& conn, int opinion_id);
+    
+    // Create placeholders for all opinion_ids in one transaction; throws on failure
+    void createPlaceholderOpinions(pqxx::connection& conn, const std::vector<int>& opinion_ids);
+    
+    // Prepare this table's statements on conn (once per pooled connection)
+    void prepareStatements(pqxx::connection& conn);
+    
+    // Classify a failed upsert by SQLSTATE; on an FK miss create the placeholder(s) and retry.
+    // Returns true if the record ended up inserted, otherwise records the rejection.
+    bool recoverFailedRow(pqxx::connection& conn, const OpinionCited& record, const PgError& error,
+                          Int32Batch& rejected_records,
+                          std::vector<std::string>& rejection_reasons);
+    
+    PgRawConnection& pipelineConnection();
 };
@@ -1,10 +1,12 @@
 #pragma once
 
+#include "record_scanner.h"
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
+#include <memory>
 #include <optional>
-#include <fstream>
 
 class OpinionCluster {
 public:
@@ -84,6 +86,7 @@ public:
 
     // For debugging/display
     std::string toString() const;
+    std::string toCsv() const; // For outputting to bad records file (database column order)
 };
 
 // CSV reader class for opinion clusters
@@ -94,16 +97,31 @@ public:
     // Extract raw CSV records (multi-line aware, detects newline + comma + text/null + comma + date)
     std::vector<std::string> extractRawRecords(size_t max_records = 100);
     
-    // Streaming API for large files
-    // Initialize internal stream and parse header once
+    // Streaming API for large files (memory-mapped, see RecordScanner)
+    // Initialize internal scanner and parse header once
     void initStream();
     // Read next batch of raw records into outRecords. Returns false when EOF reached and no more records.
-    bool readNextBatch(std::vector<std::string>& outRecords, size_t max_records = 1000, size_t chunk_bytes = 1024 * 1024);
-    bool eof() const { return eof_; }
+    // Records are views into the mapped file and stay valid for the lifetime of the reader.
+    bool readNextBatch(std::vector<std::string_view>& outRecords, size_t max_records = 1000);
+    bool eof() const { return scanner_ && scanner_->eof(); }
+    // Pre-split the remaining file into records on a worker pool (see RecordScanner::buildIndex)
+    size_t buildRecordIndex(ThreadPool& pool);
+    // Batches whose record views must stay resident after later reads (pipelined consumers)
+    void setReleaseLag(size_t batches);
+    // Byte offset of the first record not yet read, and the file size. A batch is fully
+    // consumed up to offset() as read right after it, which is what checkpoints store.
+    size_t offset() const { return scanner_ ? scanner_->offset() : 0; }
+    size_t size() const { return scanner_ ? scanner_->size() : 0; }
+    // Resume reading at a checkpointed offset (see RecordScanner::seek)
+    void seek(size_t offset);
+    
+    // Record boundary test used by the scanner: newline + ID + 3 fields + date_filed
+    static bool isRecordStart(const char* data, size_t size, size_t pos);
     
     // Public for testing
-    OpinionCluster parseCsvLine(const std::string& line);
-    std::vector<std::string> splitCsvLine(const std::string& line);
+    // Parsing only reads the header map, so these are safe to call from several threads
+    OpinionCluster parseCsvLine(std::string_view line) const;
+    std::vector<std::string> splitCsvLine(std::string_view line) const;
     void parseHeader(const std::string& header_line);
     
     // Get the parsed CSV header columns (after initStream or extractRawRecords)
@@ -115,11 +133,8 @@ private:
     std::map<std::string, size_t> column_map_;
     
     // Streaming state
-    bool streamed_initialized_ = false;
-    bool eof_ = false;
-    std::ifstream file_stream_;
-    std::string leftover_;
+    std::unique_ptr<RecordScanner> scanner_;
     
-    std::optional<std::string> getColumn(const std::vector<std::string>& cols, const std::string& name);
-    bool isValidRow(const std::vector<std::string>& cols);
+    std::optional<std::string> getColumn(const std::vector<std::string>& cols, const std::string& name) const;
+    bool isValidRow(const std::vector<std::string>& cols) const;
 };
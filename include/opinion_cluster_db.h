@@ -1,7 +1,10 @@
 #pragma once
 
 #include "opinion_cluster.h"
+#include "connection_pool.h"
+#include "pg_raw_connection.h"
 #include <pqxx/pqxx>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -18,12 +21,70 @@ public:
     // Insert multiple cluster records in a transaction
     void insertClusters(const std::vector<OpinionCluster>& clusters);
     
+    // Same, also returning the rows that were not inserted and why
+    void insertClusters(const std::vector<OpinionCluster>& clusters,
+                        std::vector<OpinionCluster>& rejected_records,
+                        std::vector<std::string>& reasons);
+    
+    // Bulk mode: send each batch as one binary COPY (int4/bool/date/timestamptz encoded
+    // client-side, optionals as NULL). Rows that cannot be encoded, or a batch the server
+    // rejects, go through the per-row savepoint path instead.
+    void setBulkCopy(bool enabled) { bulk_copy_ = enabled; }
+    bool bulkCopy() const { return bulk_copy_; }
+    
+    // Staging mode: binary COPY each batch into the UNLOGGED, constraint-free table
+    // search_opinioncluster_stage, then merge it with one INSERT ... SELECT ... ON CONFLICT
+    // that leaves out rows failing a NOT NULL, length or FK check. Those come back as
+    // rejected records, so no per-row savepoints are taken. Rows that cannot be encoded,
+    // or a batch the merge fails on, go through the per-row savepoint path as in bulk
+    // mode. Batches from concurrent writers serialize on the staging table.
+    void setStagingMerge(bool enabled) { staging_merge_ = enabled; }
+    bool stagingMerge() const { return staging_merge_; }
+    
+    // Pool this instance draws from (e.g. for BulkInitialLoad on the same server)
+    std::shared_ptr<ConnectionPool> pool() const { return pool_; }
+    
     // Test connection
     bool testConnection();
 
 private:
     std::string connection_string_;
+    std::shared_ptr<ConnectionPool> pool_; // shared by every *Database on the same server
+    bool bulk_copy_ = false;
+    bool staging_merge_ = false;
+    std::string staging_create_sql_; // built from the catalog on first use
+    std::string staging_merge_sql_;
+    bool staging_created_ = false; // staging DDL has run on the server
+    std::unique_ptr<PgRawConnection> raw_conn_; // opened on first COPY or staging batch
+    
+    // Connection for the bulk and staging paths, reopened after a failed batch
+    PgRawConnection& rawConnection();
+    
+    // Binary COPY of a batch; rows failing client-side conversion are returned in unencodable
+    bool copyClustersBinary(const std::vector<OpinionCluster>& clusters,
+                            std::vector<OpinionCluster>& unencodable,
+                            std::string& error);
+    
+    // Staging merge of a batch; returns false (with error set) if the server rejected it.
+    // Rows failing client-side conversion are returned in unencodable.
+    bool mergeThroughStaging(const std::vector<OpinionCluster>& clusters,
+                             std::vector<OpinionCluster>& unencodable,
+                             std::vector<OpinionCluster>& rejected_records,
+                             std::vector<std::string>& reasons,
+                             std::string& error);
+    
+    // Staging DDL and merge statement for the current schema
+    void buildStagingSql();
+    
+    // Per-row INSERT with one savepoint per record; failed rows are appended to
+    // rejected_records with the server's error
+    void insertClustersPerRow(const std::vector<OpinionCluster>& clusters,
+                              std::vector<OpinionCluster>& rejected_records,
+                              std::vector<std::string>& reasons);
     
     // Helper to format optional values
     std::string formatOptionalString(const std::optional<std::string>& val);
+    
+    // Prepare this table's statements on conn (once per pooled connection)
+    void prepareStatements(pqxx::connection& conn);
 };
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "input_stream.h"
+#include "int32_batch.h"
 #include <string>
 #include <vector>
 #include <map>
@@ -12,18 +14,41 @@ struct OpinionClusterPanel {
     int opinioncluster_id;
     int person_id;
     
+    // Column order in an Int32Batch
+    enum Column : size_t { kId, kOpinionClusterId, kPersonId, kColumnCount };
+    static OpinionClusterPanel fromBatch(const Int32Batch& batch, size_t row) {
+        return {batch.at(row, kId), batch.at(row, kOpinionClusterId), batch.at(row, kPersonId)};
+    }
+    void appendTo(Int32Batch& batch) const { batch.append({id, opinioncluster_id, person_id}); }
+    
     std::string toString() const;
     std::string toCsv() const; // For outputting to bad records file
 };
 
-// CSV reader for opinion cluster panel data
+// CSV reader for opinion cluster panel data - streaming implementation
 class OpinionClusterPanelReader {
 public:
     explicit OpinionClusterPanelReader(const std::string& filename);
+    ~OpinionClusterPanelReader();
     
-    // Read all records from CSV file
+    // Read all records from CSV file (for small files)
     std::vector<OpinionClusterPanel> readAll();
     
+    // Same, parsed straight into columns (batch is cleared first)
+    void readAll(Int32Batch& batch);
+    
+    // Read next batch of records (streaming mode)
+    std::vector<OpinionClusterPanel> readBatch(size_t batch_size);
+    
+    // Same, parsed straight into columns; batch is cleared first. Returns the rows read.
+    size_t readBatch(Int32Batch& batch, size_t batch_size);
+    
+    // Check if there are more records to read
+    bool hasMore() const;
+    
+    // Get total lines read so far
+    size_t getTotalLinesRead() const { return total_lines_read_; }
+    
     // Parse a single CSV line into OpinionClusterPanel
     OpinionClusterPanel parseCsvLine(const std::string& line);
 
@@ -31,8 +56,14 @@ private:
     std::string filename_;
     std::vector<std::string> header_;
     std::map<std::string, size_t> column_map_;
+    InputStream file_; // plain or .gz/.bz2/.zst
+    bool header_parsed_;
+    size_t total_lines_read_;
     
     void parseHeader(const std::string& header_line);
+    void ensureHeader();
+    // Next parseable record; false at end of file. Adds the bytes consumed to bytes.
+    bool nextRecord(OpinionClusterPanel& record, size_t& bytes);
     std::optional<std::string> getColumn(const std::vector<std::string>& cols, const std::string& name);
     std::vector<std::string> splitCsvLine(const std::string& line);
 };
@@ -1,10 +1,12 @@
 #pragma once
 
 #include "opinion_cluster_panel.h"
+#include "connection_pool.h"
+#include "id_set.h"
 #include <pqxx/pqxx>
+#include <memory>
 #include <string>
 #include <vector>
-#include <set>
 
 class OpinionClusterPanelDatabase {
 public:
@@ -19,10 +21,11 @@ public:
     // Check if a cluster ID exists (foreign key validation)
     bool isValidClusterId(int cluster_id) const;
     
-    // Insert panel records that pass FK validation
+    // Insert panel records (OpinionClusterPanel columns). When the ID cache is loaded,
+    // clusters missing from it get their placeholders before the batch is inserted.
     // Returns number of records successfully inserted
-    size_t insertPanels(const std::vector<OpinionClusterPanel>& panels,
-                        std::vector<OpinionClusterPanel>& rejected_panels,
+    size_t insertPanels(const Int32Batch& panels,
+                        Int32Batch& rejected_panels,
                         std::vector<std::string>& rejection_reasons);
     
     // Create placeholder record in search_opinioncluster for missing cluster ID
@@ -30,8 +33,24 @@ public:
     
     // Test connection
     bool testConnection();
+    
+    // Keep an ID snapshot in dir so later runs only fetch ids added since (empty = off)
+    void setIdSnapshotDir(const std::string& dir) { id_snapshot_dir_ = dir; }
+    
+    // Check a cache refreshed from a snapshot or memory against COUNT(*) (a full scan)
+    void setVerifyIdCache(bool enabled) { verify_id_cache_ = enabled; }
 
 private:
     std::string connection_string_;
-    std::set<int> valid_cluster_ids_; // Cache of valid cluster IDs
+    std::shared_ptr<ConnectionPool> pool_; // shared by every *Database on the same server
+    std::string id_snapshot_dir_;
+    bool verify_id_cache_ = false;
+    IdSet valid_cluster_ids_; // Cache of valid cluster IDs
+    bool valid_ids_loaded_ = false;   // set by loadValidClusterIds()
+    
+    // Same as the public overload, on a connection the caller already holds
+    bool createPlaceholderCluster(pqxx::connection& conn, int cluster_id);
+    
+    // Prepare this table's statements on conn (once per pooled connection)
+    void prepareStatements(pqxx::connection& conn);
 };
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "opinion.h"
+#include "connection_pool.h"
 #include <pqxx/pqxx>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -18,16 +20,37 @@ public:
     // Insert multiple opinion records in a transaction
     void insertOpinions(const std::vector<Opinion>& opinions);
     
+    // Bulk mode: stream each batch with COPY FROM STDIN in one round trip.
+    // A batch rejected by COPY (duplicate id, missing cluster, bad value) is
+    // replayed through the per-row savepoint path so bad rows are isolated.
+    void setBulkCopy(bool enabled) { bulk_copy_ = enabled; }
+    bool bulkCopy() const { return bulk_copy_; }
+    
+    // Pool this instance draws from (e.g. for BulkInitialLoad on the same server)
+    std::shared_ptr<ConnectionPool> pool() const { return pool_; }
+    
     // Test connection
     bool testConnection();
 
 private:
     std::string connection_string_;
+    std::shared_ptr<ConnectionPool> pool_; // shared by every *Database on the same server
+    bool bulk_copy_ = false;
+    
+    // COPY the whole batch in a single transaction; returns false (with error set) if rejected
+    bool copyOpinions(const std::vector<Opinion>& opinions, std::string& error);
+    
+    // Per-row INSERT with one savepoint per record (placeholder cluster retry on FK failure)
+    void insertOpinionsPerRow(const std::vector<Opinion>& opinions);
     
     // Helper to escape and format optional values
     std::string formatOptionalInt(const std::optional<int>& val);
     std::string formatOptionalString(const std::optional<std::string>& val);
     
-    // Create placeholder opinion cluster for missing FK (can work with work or subtransaction)
-    void createPlaceholderCluster(pqxx::transaction_base& txn, int cluster_id, int docket_id);
+    // Create placeholder opinion cluster for missing FK (can work with work or subtransaction);
+    // false if the cluster already existed
+    bool createPlaceholderCluster(pqxx::transaction_base& txn, int cluster_id, int docket_id);
+    
+    // Prepare this table's statements on conn (once per pooled connection)
+    void prepareStatements(pqxx::connection& conn);
 };
@@ -1,10 +1,12 @@
 #pragma once
 
 #include "opinion_joined_by.h"
+#include "connection_pool.h"
+#include "id_set.h"
 #include <pqxx/pqxx>
+#include <memory>
 #include <string>
 #include <vector>
-#include <set>
 
 class OpinionJoinedByDatabase {
 public:
@@ -19,10 +21,11 @@ public:
     // Check if an opinion ID exists (foreign key validation)
     bool isValidOpinionId(int opinion_id) const;
     
-    // Insert joined_by records with FK handling
-    // Returns number of records successfully inserted
-    size_t insertJoinedBy(const std::vector<OpinionJoinedBy>& records,
-                         std::vector<OpinionJoinedBy>& rejected_records,
+    // Insert joined_by records (OpinionJoinedBy columns) with FK handling. When the ID
+    // cache is loaded, opinions missing from it get their placeholders before the batch
+    // is inserted. Returns number of records successfully inserted
+    size_t insertJoinedBy(const Int32Batch& records,
+                         Int32Batch& rejected_records,
                          std::vector<std::string>& rejection_reasons);
     
     // Create placeholder record in search_opinion for missing opinion ID
@@ -30,8 +33,24 @@ public:
     
     // Test connection
     bool testConnection();
+    
+    // Keep an ID snapshot in dir so later runs only fetch ids added since (empty = off)
+    void setIdSnapshotDir(const std::string& dir) { id_snapshot_dir_ = dir; }
+    
+    // Check a cache refreshed from a snapshot or memory against COUNT(*) (a full scan)
+    void setVerifyIdCache(bool enabled) { verify_id_cache_ = enabled; }
 
 private:
     std::string connection_string_;
-    std::set<int> valid_opinion_ids_; // Cache of valid opinion IDs
+    std::shared_ptr<ConnectionPool> pool_; // shared by every *Database on the same server
+    std::string id_snapshot_dir_;
+    bool verify_id_cache_ = false;
+    IdSet valid_opinion_ids_; // Cache of valid opinion IDs
+    bool valid_ids_loaded_ = false;   // set by loadValidOpinionIds()
+    
+    // Same as the public overload, on a connection the caller already holds
+    bool createPlaceholderOpinion(pqxx::connection& conn, int opinion_id);
+    
+    // Prepare this table's statements on conn (once per pooled connection)
+    void prepareStatements(pqxx::connection& conn);
 };
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "input_stream.h"
 #include <string>
 #include <vector>
 #include <fstream>
@@ -59,7 +60,7 @@ public:
     bool hasMore() const;
 
 private:
-    std::ifstream file_;
+    InputStream file_; // plain or .gz/.bz2/.zst
     std::vector<std::string> header_;
     bool header_parsed_;
     
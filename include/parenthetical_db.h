@@ -1,10 +1,12 @@
 #pragma once
 
 #include "parenthetical.h"
+#include "connection_pool.h"
+#include "id_set.h"
 #include <pqxx/pqxx>
+#include <memory>
 #include <string>
 #include <vector>
-#include <set>
 
 class ParentheticalDatabase {
 public:
@@ -34,8 +36,24 @@ public:
     
     // Test connection
     bool testConnection();
+    
+    // Keep an ID snapshot in dir so later runs only fetch ids added since (empty = off)
+    void setIdSnapshotDir(const std::string& dir) { id_snapshot_dir_ = dir; }
+    
+    // Check a cache refreshed from a snapshot or memory against COUNT(*) (a full scan)
+    void setVerifyIdCache(bool enabled) { verify_id_cache_ = enabled; }
 
 private:
     std::string connection_string_;
-    std::set<int> valid_group_ids_; // Cache of valid group IDs
+    std::shared_ptr<ConnectionPool> pool_; // shared by every *Database on the same server
+    std::string id_snapshot_dir_;
+    bool verify_id_cache_ = false;
+    IdSet valid_group_ids_; // Cache of valid group IDs
+    
+    // Same as the public overloads, on a connection the caller already holds
+    bool createPlaceholderGroup(pqxx::connection& conn, int group_id, std::vector<int>& search_parentheticalgroup_placeholders);
+    bool createPlaceholderOpinion(pqxx::connection& conn, int opinion_id);
+    
+    // Prepare this table's statements on conn (once per pooled connection)
+    void prepareStatements(pqxx::connection& conn);
 };
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Builder for the PostgreSQL binary COPY format (COPY ... FROM STDIN (FORMAT binary)).
+// All integers are written in network byte order; std::nullopt values become real NULLs.
+// Dates and timestamps are converted client-side so the server does no text parsing.
+class PgBinaryCopyWriter {
+public:
+    PgBinaryCopyWriter();
+
+    // Start a new tuple with the given number of fields
+    void beginRow(int16_t field_count);
+
+    void addNull();
+    void addInt4(int32_t value);
+    void addInt8(int64_t value);
+    void addBool(bool value);
+    void addText(const std::string& value);
+    void addFloat8(double value);
+
+    // date: "YYYY-MM-DD" (throws std::invalid_argument if malformed)
+    void addDate(const std::string& value);
+    // timestamptz: "YYYY-MM-DD[ T]HH:MM:SS[.ffffff][Z|+HH[:MM]|-HH[:MM]]"; no offset means UTC
+    void addTimestamptz(const std::string& value);
+
+    void addInt4(const std::optional<int>& value) { if (value) addInt4(*value); else addNull(); }
+    void addText(const std::optional<std::string>& value) { if (value) addText(*value); else addNull(); }
+    void addDate(const std::optional<std::string>& value) { if (value) addDate(*value); else addNull(); }
+
+    // Append the file trailer; the buffer is then ready to send
+    void finish();
+
+    const std::string& data() const { return buffer_; }
+    size_t rowCount() const { return rows_; }
+
+    // Drop the row started by the last beginRow() (e.g. after a conversion error)
+    void rollbackRow();
+
+    // Conversions exposed for testing: days / microseconds relative to 2000-01-01 UTC
+    static int32_t parseDate(const std::string& value);
+    static int64_t parseTimestamptz(const std::string& value);
+
+private:
+    std::string buffer_;
+    size_t rows_ = 0;
+    size_t row_mark_ = 0;
+
+    void putInt16(int16_t v);
+    void putInt32(int32_t v);
+    void putInt64(int64_t v);
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <libpq-fe.h>
+#include <exception>
+#include <string>
+
+// Insert failures classified by SQLSTATE instead of by message text.
+//
+// The message is localized (lc_messages) and costly to scan once per rejected
+// row; the five-character SQLSTATE is neither. A libpq result also carries the
+// violated constraint and column as separate diagnostic fields. libpqxx
+// exceptions only expose the SQLSTATE, so for those constraint and column stay
+// empty and callers must not depend on them.
+enum class PgErrorKind { ForeignKey, Unique, NotNull, Check, Other };
+
+struct PgError {
+    PgErrorKind kind = PgErrorKind::Other;
+    std::string sqlstate;
+    std::string constraint; // PG_DIAG_CONSTRAINT_NAME
+    std::string column;     // PG_DIAG_COLUMN_NAME (NOT NULL violations)
+    std::string message;
+
+    // "fk", "unique", "not_null", "check" or "other"
+    const char* kindName() const;
+    // Rejection reason for bad records files: kind, SQLSTATE, constraint if known, message
+    std::string describe() const;
+};
+
+// Class 23 (integrity constraint violation) codes map to their kind, everything else to Other
+PgErrorKind pgErrorKind(const std::string& sqlstate);
+
+// From a caught exception: the SQLSTATE of a pqxx::sql_error, Other for anything else
+PgError pgError(const std::exception& e);
+
+// From a failed libpq result, diagnostic fields included
+PgError pgError(const PGresult* res);
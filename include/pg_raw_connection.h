@@ -0,0 +1,54 @@
+#pragma once
+
+#include "pg_error.h"
+#include <libpq-fe.h>
+#include <string>
+#include <vector>
+
+// Thin RAII wrapper over a libpq connection, used for protocol features that
+// libpqxx does not expose (binary COPY FROM STDIN, pipeline mode).
+class PgRawConnection {
+public:
+    // Outcome of one row sent through execPipelined(); error is only set when !ok
+    struct RowResult {
+        bool ok = false;
+        PgError error;
+    };
+
+    explicit PgRawConnection(const std::string& connection_string);
+    ~PgRawConnection();
+
+    PgRawConnection(const PgRawConnection&) = delete;
+    PgRawConnection& operator=(const PgRawConnection&) = delete;
+
+    PGconn* get() const { return conn_; }
+
+    // Run a command that returns no rows (BEGIN, COMMIT, SET ...); throws on error
+    void exec(const std::string& sql);
+
+    // Run a statement and return its rows as text (NULL reads as ""); throws on error
+    std::vector<std::vector<std::string>> query(const std::string& sql);
+
+    // Run "COPY ... FROM STDIN ..." and stream payload to the server; throws on error
+    void copyIn(const std::string& copy_sql, const std::string& payload);
+
+    bool isOpen() const { return conn_ && PQstatus(conn_) == CONNECTION_OK; }
+
+    // Prepare a named statement for execPipelined(); throws on error
+    void prepare(const std::string& name, const std::string& sql);
+
+    // Execute prepared statement `name` once per entry of rows (text parameters),
+    // keeping at most window rows in flight. Every row is followed by a sync, so it
+    // runs in its own implicit transaction and a failing row does not abort its
+    // neighbours. results[i] belongs to rows[i]. The connection is non-blocking
+    // meanwhile and results are read as they arrive, so a large window cannot
+    // deadlock on full socket buffers. Falls back to one round trip per
+    // row when libpq predates pipeline mode (PostgreSQL 14). Throws only when the
+    // connection itself fails.
+    std::vector<RowResult> execPipelined(const std::string& name,
+                                         const std::vector<std::vector<std::string>>& rows,
+                                         size_t window);
+
+private:
+    PGconn* conn_ = nullptr;
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "bounded_queue.h"
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+// Staged ingestion pipelines: each stage runs on its own thread and hands
+// batches to the next through a BoundedQueue of depth batches, so file I/O,
+// parsing and database work overlap. The last stage runs on the calling
+// thread. An exception in any stage closes every queue, stops the other
+// stages, and is rethrown from the run function once all threads are joined.
+
+class PipelineErrors {
+public:
+    void capture() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_) error_ = std::current_exception();
+    }
+    void rethrow() {
+        if (error_) std::rethrow_exception(error_);
+    }
+
+private:
+    std::mutex mutex_;
+    std::exception_ptr error_;
+};
+
+// read(Batch&) -> bool fills the next batch (false at end of input), on a reader thread.
+// write(Batch&&) consumes batches in order on the calling thread.
+template <typename Batch, typename Read, typename Write>
+void runReadWritePipeline(size_t depth, Read read, Write write) {
+    BoundedQueue<Batch> queue(depth == 0 ? 1 : depth);
+    PipelineErrors errors;
+
+    std::thread reader([&]() {
+        try {
+            for (;;) {
+                Batch batch;
+                if (!read(batch)) break;
+                if (!queue.push(std::move(batch))) break;
+            }
+        } catch (...) {
+            errors.capture();
+        }
+        queue.close();
+    });
+
+    try {
+        Batch batch;
+        while (queue.pop(batch)) write(std::move(batch));
+    } catch (...) {
+        errors.capture();
+    }
+    queue.close();
+    reader.join();
+    errors.rethrow();
+}
+
+// read(Raw&) -> bool on a reader thread, parse(Raw&&) -> Parsed on a parser
+// thread, write(Parsed&&) on the calling thread.
+template <typename Raw, typename Parsed, typename Read, typename Parse, typename Write>
+void runReadParseWritePipeline(size_t depth, Read read, Parse parse, Write write) {
+    BoundedQueue<Raw> raw_queue(depth == 0 ? 1 : depth);
+    BoundedQueue<Parsed> parsed_queue(depth == 0 ? 1 : depth);
+    PipelineErrors errors;
+
+    std::thread reader([&]() {
+        try {
+            for (;;) {
+                Raw raw;
+                if (!read(raw)) break;
+                if (!raw_queue.push(std::move(raw))) break;
+            }
+        } catch (...) {
+            errors.capture();
+            parsed_queue.close();
+        }
+        raw_queue.close();
+    });
+
+    std::thread parser([&]() {
+        try {
+            Raw raw;
+            while (raw_queue.pop(raw)) {
+                if (!parsed_queue.push(parse(std::move(raw)))) break;
+            }
+        } catch (...) {
+            errors.capture();
+        }
+        raw_queue.close();
+        parsed_queue.close();
+    });
+
+    try {
+        Parsed parsed;
+        while (parsed_queue.pop(parsed)) write(std::move(parsed));
+    } catch (...) {
+        errors.capture();
+    }
+    raw_queue.close();
+    parsed_queue.close();
+    reader.join();
+    parser.join();
+    errors.rethrow();
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "csv_classifier.h"
+#include "input_stream.h"
+#include "mapped_file.h"
+#include "thread_pool.h"
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Multi-line CSV record splitter over a memory-mapped file.
+//
+// Records are returned as std::string_view slices into the mapping (no copies).
+// A newline ends a record only if is_record_start() accepts the bytes after it;
+// with quote_aware set, newlines inside double-quoted fields are never considered.
+// Candidate newlines are found 64 bytes at a time with CsvClassifier, so the
+// boundary heuristic only runs on newlines that can actually end a record.
+//
+// Compressed input (.gz/.bz2/.zst, see input_stream.h) cannot be mapped; it is
+// decompressed on a background thread and scanned sequentially instead. Each
+// batch is then copied into its own buffer, which stays alive for the release
+// lag, and buildIndex() is a no-op.
+class RecordScanner {
+public:
+    // Returns true if a record begins at data[pos] (pos is just past a newline)
+    using RecordStartFn = bool (*)(const char* data, size_t size, size_t pos);
+
+    RecordScanner(const std::string& filename, RecordStartFn is_record_start, bool quote_aware);
+
+    // First line of the file, without its line terminator
+    std::string_view header() const { return header_; }
+
+    // Next batch of up to max_records records (trailing newline stripped).
+    // Views remain valid for the lifetime of the scanner (for compressed input, until
+    // release lag + 1 further batches have been read).
+    bool nextBatch(std::vector<std::string_view>& out, size_t max_records);
+
+    bool eof() const { return stream_ ? stream_eof_ && carry_.empty() : pos_ >= file_->size(); }
+
+    // Keep the pages of the last `batches` batches resident (for consumers that hold
+    // views across later nextBatch() calls, e.g. a pipelined parser). Default 0.
+    void setReleaseLag(size_t batches) { release_lag_ = batches; }
+
+    // Byte offset of the first record not yet returned (in decompressed bytes)
+    size_t offset() const { return pos_; }
+    // Size of the input file on disk (the compressed size for compressed input)
+    size_t size() const { return stream_ ? stream_->compressedSize() : file_->size(); }
+    Compression compression() const { return compression_; }
+
+    // Continue from offset, which must be a record start previously reported by
+    // offset() for this file (e.g. a checkpoint). Throws std::invalid_argument
+    // otherwise. Works before or after buildIndex(). Compressed input can only
+    // move forward; the bytes in between are decompressed and discarded.
+    void seek(size_t offset);
+
+    // Split the rest of the file into records up front, in parallel. Byte ranges are
+    // scanned speculatively as starting both inside and outside quotes, then a serial
+    // stitch pass keeps the assumption consistent with the previous range. Later
+    // nextBatch() calls slice from the index. Returns the number of records indexed
+    // (0 for compressed input).
+    size_t buildIndex(ThreadPool& pool, size_t min_range_bytes = 4 << 20);
+    CsvClassifier::Isa isa() const { return classifier_.isa(); }
+
+private:
+    std::unique_ptr<MappedFile> file_;
+    CsvClassifier classifier_;
+    RecordStartFn is_record_start_;
+    bool quote_aware_;
+    std::string_view header_;
+    size_t pos_ = 0;
+    size_t first_record_ = 0; // just past the header line
+    size_t release_lag_ = 0;
+    std::deque<size_t> batch_starts_;
+
+    // Record start offsets after pos_ (filled by buildIndex)
+    bool indexed_ = false;
+    std::vector<size_t> index_;
+    size_t index_pos_ = 0;
+
+    // Compressed input: bytes from pos_ onwards that have been decompressed but not yet
+    // returned, and one buffer per batch still inside the release lag
+    Compression compression_ = Compression::None;
+    std::unique_ptr<DecompressingReader> stream_;
+    std::string header_storage_;
+    std::vector<char> carry_;
+    std::deque<std::vector<char>> chunks_;
+    bool stream_eof_ = false;
+
+    // End of the record starting at start: offset of the next record start, or size()
+    size_t findRecordEnd(size_t start) const;
+    bool nextStreamBatch(std::vector<std::string_view>& out, size_t max_records);
+    void seekStream(size_t offset);
+    // Append up to n decompressed bytes to buf; sets stream_eof_ at the end of the data
+    void fill(std::vector<char>& buf, size_t n);
+};
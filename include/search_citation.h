@@ -1,5 +1,6 @@
 #pragma once
 
+#include "input_stream.h"
 #include <string>
 #include <vector>
 #include <map>
@@ -41,7 +42,7 @@ private:
     std::string filename_;
     std::vector<std::string> header_;
     std::map<std::string, size_t> column_map_;
-    std::ifstream file_;
+    InputStream file_; // plain or .gz/.bz2/.zst
     bool header_parsed_;
     size_t total_lines_read_;
     
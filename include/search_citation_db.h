@@ -1,10 +1,13 @@
 #pragma once
 
 #include "search_citation.h"
+#include "connection_pool.h"
+#include "id_set.h"
+#include "pg_raw_connection.h"
 #include <pqxx/pqxx>
+#include <memory>
 #include <string>
 #include <vector>
-#include <set>
 
 class SearchCitationDatabase {
 public:
@@ -31,8 +34,40 @@ public:
     
     // Test connection
     bool testConnection();
+    
+    // Keep an ID snapshot in dir so later runs only fetch ids added since (empty = off)
+    void setIdSnapshotDir(const std::string& dir) { id_snapshot_dir_ = dir; }
+    
+    // Check a cache refreshed from a snapshot or memory against COUNT(*) (a full scan)
+    void setVerifyIdCache(bool enabled) { verify_id_cache_ = enabled; }
+    
+    // Send up to window upserts before waiting for results (libpq pipeline mode);
+    // 0 keeps one round trip per record. Failed rows are still retried one by one.
+    void setPipelineWindow(size_t window) { pipeline_window_ = window; }
+    size_t pipelineWindow() const { return pipeline_window_; }
 
 private:
     std::string connection_string_;
-    std::set<int> valid_cluster_ids_; // Cache of valid cluster IDs
+    std::shared_ptr<ConnectionPool> pool_; // shared by every *Database on the same server
+    std::string id_snapshot_dir_;
+    bool verify_id_cache_ = false;
+    IdSet valid_cluster_ids_; // Cache of valid cluster IDs
+    size_t pipeline_window_ = 0;
+    std::unique_ptr<PgRawConnection> pipeline_conn_; // opened on first pipelined batch
+    
+    // Same as the public overload, on a connection the caller already holds
+    bool createPlaceholderCluster(pqxx::connection& conn, int cluster_id, std::vector<int>& search_opinioncluster_placeholders);
+    
+    // Prepare this table's statements on conn (once per pooled connection)
+    void prepareStatements(pqxx::connection& conn);
+    
+    // Classify a failed upsert by SQLSTATE; on an FK miss create the placeholder cluster and retry.
+    // Returns true if the record ended up inserted, otherwise records the rejection.
+    bool recoverFailedRow(pqxx::connection& conn, const SearchCitation& record, const PgError& error,
+                          std::vector<SearchCitation>& rejected_records,
+                          std::vector<std::string>& rejection_reasons,
+                          std::vector<int>& search_opinioncluster_placeholders,
+                          size_t& placeholders_created);
+    
+    PgRawConnection& pipelineConnection();
 };
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Runs named stages as a dependency DAG.
+//
+// A stage starts as soon as every stage it depends on has succeeded, with at
+// most max_parallel stages running at once; independent stages therefore
+// overlap. A stage that throws is marked Failed and everything downstream of it
+// is Skipped, while unrelated branches keep going. Stages are started in the
+// order they were added when several are ready.
+class StageScheduler {
+public:
+    enum class Status { Pending, Running, Succeeded, Failed, Skipped };
+
+    // Dependencies must name stages added before run(); throws std::invalid_argument
+    // for a duplicate name
+    void add(const std::string& name, std::vector<std::string> deps, std::function<void()> fn);
+    bool has(const std::string& name) const;
+
+    // Stages grouped by depth in the DAG (level 0 has no dependencies). Throws
+    // std::invalid_argument for an unknown dependency or a cycle.
+    std::vector<std::vector<std::string>> levels() const;
+
+    // Run every stage; returns true if all succeeded. Validates like levels().
+    bool run(size_t max_parallel);
+
+    Status status(const std::string& name) const;
+    // Exception message for Failed stages, the blocking dependency for Skipped ones
+    const std::string& error(const std::string& name) const;
+    double seconds(const std::string& name) const;
+    std::vector<std::string> names() const;
+
+    static const char* statusName(Status status);
+
+private:
+    struct Stage {
+        std::string name;
+        std::vector<std::string> deps;
+        std::vector<size_t> dep_index;
+        std::function<void()> fn;
+        Status status = Status::Pending;
+        std::string error;
+        double seconds = 0;
+    };
+    std::vector<Stage> stages_;
+
+    size_t indexOf(const std::string& name) const;
+    void resolveDependencies();
+};
@@ -0,0 +1,277 @@
+#include "bulk_initial_load.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+std::string quoteIdent(const std::string& name) {
+    std::string out = "\"";
+    for (char c : name) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    return out + "\"";
+}
+
+std::string quoteLiteral(const std::string& text) {
+    std::string out = "'";
+    for (char c : text) {
+        if (c == '\'') out += '\'';
+        out += c;
+    }
+    return out + "'";
+}
+
+std::string csvQuote(const std::string& text) {
+    std::string out = "\"";
+    for (char c : text) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    return out + "\"";
+}
+
+std::vector<std::string> splitNames(const std::string& list) {
+    std::vector<std::string> out;
+    std::stringstream ss(list);
+    std::string name;
+    while (std::getline(ss, name, ',')) out.push_back(name);
+    return out;
+}
+
+// Secondary indexes that no constraint owns (primary key, unique and exclusion
+// constraints keep theirs); unique indexes are kept as well
+const char* kSecondaryIndexesSql = R"(
+    SELECT x.indexrelid::regclass::text, pg_get_indexdef(x.indexrelid)
+    FROM pg_index x
+    WHERE x.indrelid = %TABLE%::regclass
+      AND NOT x.indisprimary AND NOT x.indisunique
+      AND NOT EXISTS (SELECT 1 FROM pg_constraint c WHERE c.conindid = x.indexrelid)
+    ORDER BY 1
+)";
+
+const char* kForeignKeysSql = R"(
+    SELECT c.conname, c.confrelid::regclass::text,
+           array_to_string(ARRAY(SELECT a.attname FROM unnest(c.conkey) WITH ORDINALITY k(attnum, n)
+                                 JOIN pg_attribute a ON a.attrelid = c.conrelid AND a.attnum = k.attnum
+                                 ORDER BY k.n), ','),
+           array_to_string(ARRAY(SELECT a.attname FROM unnest(c.confkey) WITH ORDINALITY k(attnum, n)
+                                 JOIN pg_attribute a ON a.attrelid = c.confrelid AND a.attnum = k.attnum
+                                 ORDER BY k.n), ',')
+    FROM pg_constraint c
+    WHERE c.contype = 'f' AND c.conrelid = %TABLE%::regclass
+    ORDER BY c.conname
+)";
+
+std::string withTable(const char* sql, const std::string& table) {
+    std::string out = sql;
+    out.replace(out.find("%TABLE%"), 7, quoteLiteral(table));
+    return out;
+}
+
+} // namespace
+
+BulkInitialLoad::BulkInitialLoad(std::shared_ptr<ConnectionPool> pool, std::string table, std::string state_file)
+    : pool_(std::move(pool)), table_(std::move(table)), state_file_(std::move(state_file)) {}
+
+std::string BulkInitialLoad::defaultStatePath(const std::string& csv_path) {
+    return csv_path + ".indexes.sql";
+}
+
+std::string BulkInitialLoad::ifNotExists(const std::string& index_def) {
+    const std::string keyword = "INDEX ";
+    size_t pos = index_def.find(keyword);
+    if (pos == std::string::npos || index_def.compare(pos + keyword.size(), 14, "IF NOT EXISTS ") == 0) {
+        return index_def;
+    }
+    std::string out = index_def;
+    out.insert(pos + keyword.size(), "IF NOT EXISTS ");
+    return out;
+}
+
+std::string BulkInitialLoad::violationQuery(const std::string& table, const std::vector<ForeignKey>& fks) {
+    // One anti-join per FK (MATCH SIMPLE: rows with a NULL key column are not checked),
+    // grouped so a row breaking several FKs is deleted and reported once
+    std::string misses;
+    for (const auto& fk : fks) {
+        std::string not_null, join;
+        for (size_t i = 0; i < fk.columns.size(); ++i) {
+            if (i > 0) { not_null += " AND "; join += " AND "; }
+            not_null += "t." + quoteIdent(fk.columns[i]) + " IS NOT NULL";
+            join += "r." + quoteIdent(fk.ref_columns[i]) + " = t." + quoteIdent(fk.columns[i]);
+        }
+        std::string reason = fk.name + ": no matching " + fk.ref_table + " row";
+        if (!misses.empty()) misses += "\n        UNION ALL\n";
+        misses += "        SELECT t.id, " + quoteLiteral(reason) + " AS reason FROM " + table + " t WHERE " +
+                  not_null + " AND NOT EXISTS (SELECT 1 FROM " + fk.ref_table + " r WHERE " + join + ")";
+    }
+    return "DELETE FROM " + table + " AS d USING (\n"
+           "    SELECT id, string_agg(reason, '; ') AS reason FROM (\n" + misses + "\n"
+           "    ) misses GROUP BY id\n"
+           ") bad WHERE d.id = bad.id\n"
+           "RETURNING d.*, bad.reason";
+}
+
+void BulkInitialLoad::saveState(const std::string& path, const std::string& table,
+                                const std::vector<std::string>& defs) {
+    // Written as runnable SQL so the indexes can also be restored by hand with psql
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out.is_open()) throw std::runtime_error("Failed to write index state: " + tmp);
+        out << "-- Secondary indexes of " << table << " dropped by --bulk-initial\n";
+        for (const auto& def : defs) out << def << ";\n";
+        if (!out.flush()) throw std::runtime_error("Failed to write index state: " + tmp);
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Failed to replace index state: " + path);
+    }
+}
+
+bool BulkInitialLoad::loadState(const std::string& path, std::vector<std::string>& defs) {
+    std::ifstream in(path);
+    if (!in.is_open()) return false;
+    defs.clear();
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line.rfind("--", 0) == 0) continue;
+        if (line.back() == ';') line.pop_back();
+        defs.push_back(line);
+    }
+    return true;
+}
+
+void BulkInitialLoad::begin() {
+    bool resumed = loadState(state_file_, index_defs_);
+
+    auto conn = pool_->acquire();
+    pqxx::work txn(*conn);
+
+    std::vector<std::string> drop;
+    for (const auto& row : txn.exec(withTable(kSecondaryIndexesSql, table_))) {
+        std::string def = row[1].as<std::string>();
+        drop.push_back(row[0].as<std::string>());
+        if (std::find(index_defs_.begin(), index_defs_.end(), def) == index_defs_.end()) index_defs_.push_back(def);
+    }
+    if (!resumed && txn.query_value<bool>("SELECT EXISTS (SELECT 1 FROM " + table_ + ")")) {
+        std::cout << "Warning: " << table_ << " is not empty; --bulk-initial will rebuild its indexes "
+                  << "and recheck its FKs over the existing rows too\n";
+    }
+
+    // Record the definitions before anything is dropped
+    saveState(state_file_, table_, index_defs_);
+    for (const auto& name : drop) txn.exec("DROP INDEX " + name);
+    txn.exec("ALTER TABLE " + table_ + " DISABLE TRIGGER ALL");
+    txn.commit();
+
+    std::cout << "Bulk initial load of " << table_ << ": dropped " << drop.size()
+              << " secondary indexes, triggers disabled (definitions saved to " << state_file_ << ")"
+              << (resumed ? " [resumed]" : "") << "\n";
+}
+
+size_t BulkInitialLoad::finish(size_t threads, std::ostream& bad_records) {
+    // A failed index build must not leave the FK triggers off for later runs: the
+    // triggers come back and the loaded rows are checked regardless, and only the
+    // index definitions stay in the state file for the rerun
+    std::exception_ptr rebuild_error;
+    try { rebuildIndexes(threads); }
+    catch (...) { rebuild_error = std::current_exception(); }
+    {
+        auto conn = pool_->acquire();
+        pqxx::work txn(*conn);
+        txn.exec("ALTER TABLE " + table_ + " ENABLE TRIGGER ALL");
+        txn.commit();
+    }
+    size_t removed = removeViolators(bad_records);
+    if (rebuild_error) std::rethrow_exception(rebuild_error);
+    {
+        auto conn = pool_->acquire();
+        pqxx::work txn(*conn);
+        txn.exec("ANALYZE " + table_);
+        txn.commit();
+    }
+    std::remove(state_file_.c_str());
+    return removed;
+}
+
+void BulkInitialLoad::rebuildIndexes(size_t threads) {
+    if (index_defs_.empty()) return;
+    auto t0 = std::chrono::steady_clock::now();
+    ThreadPool workers(std::min(std::max<size_t>(threads, 1), index_defs_.size()));
+    std::vector<std::future<void>> builds;
+    for (const auto& def : index_defs_) {
+        builds.push_back(workers.submit([this, def]() {
+            auto start = std::chrono::steady_clock::now();
+            auto conn = pool_->acquire();
+            pqxx::work txn(*conn);
+            txn.exec(ifNotExists(def));
+            txn.commit();
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            std::cout << "Rebuilt index in " << ms << " ms: " << def << "\n";
+        }));
+    }
+
+    // Let every build finish before reporting, so the next run only redoes the failed ones
+    std::string errors;
+    for (auto& build : builds) {
+        try { build.get(); }
+        catch (const std::exception& e) { errors += std::string("\n  ") + e.what(); }
+    }
+    if (!errors.empty()) {
+        throw std::runtime_error("Index rebuild on " + table_ + " failed (definitions kept in " +
+                                 state_file_ + "):" + errors);
+    }
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "Rebuilt " << index_defs_.size() << " indexes on " << table_ << " with "
+              << workers.size() << " connections in " << ms << " ms\n";
+}
+
+std::vector<BulkInitialLoad::ForeignKey> BulkInitialLoad::foreignKeys(pqxx::transaction_base& txn,
+                                                                      const std::string& table) {
+    std::vector<ForeignKey> fks;
+    for (const auto& row : txn.exec(withTable(kForeignKeysSql, table))) {
+        ForeignKey fk;
+        fk.name = row[0].as<std::string>();
+        fk.ref_table = row[1].as<std::string>();
+        fk.columns = splitNames(row[2].as<std::string>());
+        fk.ref_columns = splitNames(row[3].as<std::string>());
+        fks.push_back(std::move(fk));
+    }
+    return fks;
+}
+
+size_t BulkInitialLoad::removeViolators(std::ostream& bad_records) {
+    auto conn = pool_->acquire();
+    pqxx::work txn(*conn);
+    std::vector<ForeignKey> fks = foreignKeys(txn, table_);
+    if (fks.empty()) return 0;
+
+    pqxx::result removed = txn.exec(violationQuery(table_, fks));
+    for (const auto& row : removed) {
+        // Same "reason","raw_record" layout as the parse failures; NULL columns stay empty
+        size_t reason_col = row.size() - 1;
+        std::string record;
+        for (size_t i = 0; i < reason_col; ++i) {
+            if (i > 0) record += ',';
+            if (!row[static_cast<int>(i)].is_null()) record += csvQuote(row[static_cast<int>(i)].c_str());
+        }
+        bad_records << csvQuote(row[static_cast<int>(reason_col)].c_str()) << "," << csvQuote(record) << "\n";
+    }
+    // Only delete what was safely written out
+    if (!bad_records.flush()) throw std::runtime_error("Failed to write FK violators of " + table_);
+    txn.commit();
+
+    std::cout << "FK check on " << table_ << " (" << fks.size() << " constraints): removed "
+              << removed.size() << " violating rows\n";
+    return removed.size();
+}
@@ -0,0 +1,49 @@
+#include "checkpoint.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+void Checkpoint::save(const std::string& path) const {
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) throw std::runtime_error("Could not write checkpoint: " + tmp + " (" + std::strerror(errno) + ")");
+        out << "offset=" << offset << "\n"
+            << "file_size=" << file_size << "\n"
+            << "records=" << records << "\n";
+        if (!out.flush()) throw std::runtime_error("Could not write checkpoint: " + tmp);
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        int err = errno;
+        std::remove(tmp.c_str());
+        throw std::runtime_error("Could not replace checkpoint: " + path + " (" + std::strerror(err) + ")");
+    }
+}
+
+bool Checkpoint::load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) return false;
+
+    bool have_offset = false, have_size = false;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) throw std::runtime_error("Malformed checkpoint line in " + path + ": " + line);
+        std::string key = line.substr(0, eq);
+        size_t value;
+        try {
+            value = static_cast<size_t>(std::stoull(line.substr(eq + 1)));
+        } catch (...) {
+            throw std::runtime_error("Malformed checkpoint value in " + path + ": " + line);
+        }
+        if (key == "offset") { offset = value; have_offset = true; }
+        else if (key == "file_size") { file_size = value; have_size = true; }
+        else if (key == "records") { records = value; }
+    }
+    if (!have_offset || !have_size) throw std::runtime_error("Incomplete checkpoint: " + path);
+    return true;
+}
@@ -2,25 +2,42 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <exception>
 #include <optional>
+#include <chrono>
+#include <memory>
 #include "opinion_cluster.h"
 #include "opinion_cluster_db.h"
+#include "bulk_initial_load.h"
+#include "checkpoint.h"
+#include "metrics.h"
+#include "thread_pool.h"
+#include "pipeline.h"
 
 int main(int argc, char** argv) {
 
-    // CLI parsing: cluster_ingestion_app <clusters.csv> [--no-db] [--limit=N] [--bad-records=file.csv]
+    // CLI parsing: cluster_ingestion_app <clusters.csv> [--no-db] [--limit=N] [--bad-records=file.csv] [--copy] [--index-threads=N] [--queue-depth=N] [--resume] [--checkpoint=FILE] [--staging] [--bulk-initial] [--metrics=FILE]
     std::string csvPath;
     std::string bad_records_file; // optional output file for bad records
     bool skip_db = false;
+    bool bulk_copy = false; // binary COPY per batch
+    bool resume = false; // continue from the checkpoint instead of the start of the file
+    std::string checkpoint_file; // default: <clusters.csv>.checkpoint
+    bool bulk_initial = false; // defer indexes and FK triggers to the end of the load
+    bool staging = false; // merge each batch through an UNLOGGED staging table
     size_t limit = 100; // default record limit (for parse-only mode)
     size_t batch_records = 5000; // records per DB batch
-    size_t chunk_bytes = 1024 * 1024; // 1MB default chunk
+    size_t index_threads = 1; // >1 (or 0 = all cores): build a record index in parallel before streaming
+    size_t queue_depth = 4; // batches buffered between read, parse and insert stages
+    MetricsOptions metrics_options; // --metrics=FILE: periodic histogram/counter dumps
 
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
         if (arg == "--no-db") {
             skip_db = true;
+        } else if (arg == "--copy") {
+            bulk_copy = true;
         } else if (arg == "--limit" && i + 1 < argc) {
             try {
                 limit = static_cast<size_t>(std::stoull(argv[++i]));
@@ -42,51 +59,81 @@ int main(int argc, char** argv) {
         } else if (arg.rfind("--batch=", 0) == 0) {
             try { batch_records = static_cast<size_t>(std::stoull(arg.substr(8))); }
             catch (...) { std::cerr << "Invalid --batch value\n"; return 1; }
-        } else if (arg == "--chunk" && i + 1 < argc) {
-            try { chunk_bytes = static_cast<size_t>(std::stoull(argv[++i])); }
-            catch (...) { std::cerr << "Invalid --chunk value\n"; return 1; }
-        } else if (arg.rfind("--chunk=", 0) == 0) {
-            try { chunk_bytes = static_cast<size_t>(std::stoull(arg.substr(8))); }
-            catch (...) { std::cerr << "Invalid --chunk value\n"; return 1; }
+        } else if (arg == "--index-threads" && i + 1 < argc) {
+            try { index_threads = static_cast<size_t>(std::stoull(argv[++i])); }
+            catch (...) { std::cerr << "Invalid --index-threads value\n"; return 1; }
+        } else if (arg.rfind("--index-threads=", 0) == 0) {
+            try { index_threads = static_cast<size_t>(std::stoull(arg.substr(16))); }
+            catch (...) { std::cerr << "Invalid --index-threads value\n"; return 1; }
+        } else if (arg == "--queue-depth" && i + 1 < argc) {
+            try { queue_depth = static_cast<size_t>(std::stoull(argv[++i])); }
+            catch (...) { std::cerr << "Invalid --queue-depth value\n"; return 1; }
+        } else if (arg.rfind("--queue-depth=", 0) == 0) {
+            try { queue_depth = static_cast<size_t>(std::stoull(arg.substr(14))); }
+            catch (...) { std::cerr << "Invalid --queue-depth value\n"; return 1; }
         } else if (arg == "--bad-records" && i + 1 < argc) {
             bad_records_file = argv[++i];
         } else if (arg.rfind("--bad-records=", 0) == 0) {
             bad_records_file = arg.substr(14);
+        } else if (arg == "--resume") {
+            resume = true;
+        } else if (arg == "--bulk-initial") {
+            bulk_initial = true;
+        } else if (arg == "--staging") {
+            staging = true;
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            checkpoint_file = argv[++i];
+        } else if (arg.rfind("--checkpoint=", 0) == 0) {
+            checkpoint_file = arg.substr(13);
+        } else if (arg.rfind("--metrics", 0) == 0) {
+            try { if (!parseMetricsOption(arg, metrics_options)) throw std::invalid_argument("Unknown option: " + arg); }
+            catch (const std::invalid_argument& e) { std::cerr << e.what() << "\n"; return 1; }
         } else if (!arg.empty() && arg[0] == '-') {
             std::cerr << "Unknown option: " << arg << "\n";
-            std::cout << "Usage: cluster_ingestion_app <clusters.csv> [--no-db] [--limit=N] [--bad-records=file.csv]\n";
+            std::cout << "Usage: cluster_ingestion_app <clusters.csv> [--no-db] [--limit=N] [--bad-records=file.csv] [--copy] [--index-threads=N] [--queue-depth=N] [--resume] [--checkpoint=FILE] [--staging] [--bulk-initial] [--metrics=FILE]\n";
             return 1;
         } else if (csvPath.empty()) {
             csvPath = arg; // first non-option argument is the CSV path
         } else {
             std::cerr << "Unexpected extra argument: " << arg << "\n";
-            std::cout << "Usage: cluster_ingestion_app <clusters.csv> [--no-db] [--limit=N] [--bad-records=file.csv]\n";
+            std::cout << "Usage: cluster_ingestion_app <clusters.csv> [--no-db] [--limit=N] [--bad-records=file.csv] [--copy] [--index-threads=N] [--queue-depth=N] [--resume] [--checkpoint=FILE] [--staging] [--bulk-initial] [--metrics=FILE]\n";
             return 1;
         }
     }
 
     if (csvPath.empty()) {
-        std::cout << "Usage: cluster_ingestion_app <clusters.csv> [--no-db] [--limit=N] [--bad-records=file.csv]\n";
+        std::cout << "Usage: cluster_ingestion_app <clusters.csv> [--no-db] [--limit=N] [--bad-records=file.csv] [--copy] [--index-threads=N] [--queue-depth=N] [--resume] [--checkpoint=FILE] [--staging] [--bulk-initial] [--metrics=FILE]\n";
         std::cout << "  --no-db              Skip database insertion (just parse and display)\n";
         std::cout << "  --limit=N            Maximum number of records to extract (default 100)\n";
         std::cout << "  --bad-records=FILE   Save bad records to CSV file\n";
+        std::cout << "  --copy               Bulk load each batch with binary COPY (per-row fallback)\n";
+        std::cout << "  --index-threads=N    Split the file into records on N threads before DB streaming\n";
+        std::cout << "  --queue-depth=N      Batches buffered between read/parse/insert stages (default 4)\n";
+        std::cout << "  --resume             Continue after the last committed batch recorded in the checkpoint\n";
+        std::cout << "  --checkpoint=FILE    Checkpoint location (default <clusters.csv>.checkpoint)\n";
+        std::cout << "  --staging            COPY batches into an UNLOGGED staging table and merge them with one\n";
+        std::cout << "                       INSERT ... SELECT; rows failing NOT NULL/length/FK checks go to bad records\n";
+        std::cout << "  --bulk-initial       Initial load: drop secondary indexes and FK triggers, COPY, then rebuild\n";
+        std::cout << "                       and check FKs; violators go to the bad records file (default <clusters.csv>.bad.csv)\n";
+        std::cout << metricsUsage();
         return 0;
     }
+    auto metrics_exporter = MetricsExporter::start(metrics_options);
     
     std::cout << "Reading raw cluster records from: " << csvPath << "\n";
-    std::cout << "Record limit: " << limit << " (parse-only), batch_records=" << batch_records
-              << ", chunk_bytes=" << chunk_bytes << "\n";
+    std::cout << "Record limit: " << limit << " (parse-only), batch_records=" << batch_records << "\n";
+    std::cout << "Record scanner kernel: " << CsvClassifier::name(CsvClassifier::detect()) << "\n";
     
     try {
         OpinionClusterReader reader(csvPath);
         
-        // Streaming mode: iterate through file in chunks and process batches
+        // Streaming mode: scan the memory-mapped file and process batches
         reader.initStream();
         
         // If parse-only (skip_db), we'll read a single batch of size 'limit' and print
         if (skip_db) {
-            std::vector<std::string> raw_records;
-            if (!reader.readNextBatch(raw_records, limit, chunk_bytes)) {
+            std::vector<std::string_view> raw_records;
+            if (!reader.readNextBatch(raw_records, limit)) {
                 std::cout << "No records found." << std::endl; return 0;
             }
             std::cout << "Extracted " << raw_records.size() << " raw cluster records\n";
@@ -98,7 +145,7 @@ int main(int argc, char** argv) {
                 catch (const std::exception& e) {
                     std::string msg = e.what();
                     if (msg.find("key") != std::string::npos || msg.find("insufficient columns") != std::string::npos) {
-                        bad_records.push_back(raw_records[i]); bad_reasons.push_back(msg);
+                        bad_records.emplace_back(raw_records[i]); bad_reasons.push_back(msg);
                     }
                 }
             }
@@ -117,119 +164,217 @@ int main(int argc, char** argv) {
         OpinionClusterDatabase db("localhost", 5432, "courtlistener", "postgres", "postgres");
         if (!db.testConnection()) { std::cerr << "Failed to connect to database.\n"; return 1; }
         std::cout << "Connection successful!\n";
+        if (bulk_initial) bulk_copy = true; // nothing left for COPY to trip over but duplicate ids
+        db.setBulkCopy(bulk_copy);
+        if (bulk_copy) std::cout << "Binary COPY mode enabled\n";
+        db.setStagingMerge(staging);
+        if (staging) std::cout << "Staging merge mode enabled\n";
+
+        // Checkpoint: written after every committed batch; seek past it before indexing
+        if (checkpoint_file.empty()) checkpoint_file = Checkpoint::defaultPath(csvPath);
+        Checkpoint checkpoint;
+        bool resumed = false;
+        if (resume) {
+            if (!checkpoint.load(checkpoint_file)) {
+                std::cout << "No checkpoint at " << checkpoint_file << ", starting from the beginning\n";
+            } else if (checkpoint.file_size != reader.size()) {
+                std::cerr << "Checkpoint " << checkpoint_file << " was written for a " << checkpoint.file_size
+                          << "-byte file but " << csvPath << " has " << reader.size() << " bytes; refusing to resume\n";
+                return 1;
+            } else {
+                reader.seek(checkpoint.offset);
+                resumed = true;
+                std::cout << "Resuming at byte " << checkpoint.offset << " of " << checkpoint.file_size
+                          << " (" << checkpoint.records << " records already committed)\n";
+            }
+        }
+        checkpoint.file_size = reader.size();
+        bool checkpointing = true; // cleared once a batch fails or the file cannot be written
+
+        if (index_threads != 1) {
+            ThreadPool index_pool(index_threads);
+            auto t0 = std::chrono::steady_clock::now();
+            size_t indexed = reader.buildRecordIndex(index_pool);
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+            std::cout << "Indexed " << indexed << " records with " << index_pool.size() << " threads in " << ms << " ms\n";
+        }
         
 
         
+        std::unique_ptr<BulkInitialLoad> bulk_load;
+        if (bulk_initial) {
+            if (bad_records_file.empty()) bad_records_file = csvPath + ".bad.csv";
+            bulk_load = std::make_unique<BulkInitialLoad>(db.pool(), "search_opinioncluster",
+                                                          BulkInitialLoad::defaultStatePath(csvPath));
+            bulk_load->begin();
+        }
+
         // Open bad records file if specified
         std::ofstream bad_records_stream;
         if (!bad_records_file.empty()) {
-            bad_records_stream.open(bad_records_file);
+            // A resumed run appends to the bad records of the run it continues
+            bad_records_stream.open(bad_records_file, resumed ? std::ios::app : std::ios::trunc);
             if (!bad_records_stream.is_open()) {
                 std::cerr << "Failed to open bad records file: " << bad_records_file << "\n";
                 return 1;
             }
             // Write CSV header
-            bad_records_stream << "reason,raw_record\n";
+            if (!resumed) bad_records_stream << "reason,raw_record\n";
             std::cout << "Bad records will be saved to: " << bad_records_file << "\n";
         }
         
     size_t total_inserted = 0, total_bad = 0, batch_index = 0;
     size_t total_processed = 0; // good + bad (parsed) records across all batches
     size_t failed_batches = 0;  // number of batches whose DB insertion failed entirely
-        std::vector<std::string> raw_records; raw_records.reserve(batch_records);
-        std::vector<OpinionCluster> clusters; clusters.reserve(batch_records);
-        std::vector<std::string> bad_records; bad_records.reserve(64);
-        std::vector<std::string> bad_reasons; bad_reasons.reserve(64);
-        
-        while (reader.readNextBatch(raw_records, batch_records, chunk_bytes)) {
-            clusters.clear(); bad_records.clear(); bad_reasons.clear();
-            size_t batch_start_offset = total_processed; // offset BEFORE processing this batch
-            for (size_t i = 0; i < raw_records.size(); ++i) {
-                try { 
-                    auto cluster = reader.parseCsvLine(raw_records[i]);
-                    
-                    // Debug: analyze records with wrong column count or specific IDs
-                    auto cols = reader.splitCsvLine(raw_records[i]);
-                    if ((cols.size() != 36 && cluster.id == 8027875) || cluster.id == 2131251) {
-                        std::cout << "\n=== ANALYZING BAD RECORD id=" << cluster.id << " ===\n";
-                        std::cout << "Column count: " << cols.size() << " (expected 36)\n";
-                        std::cout << "Raw record length: " << raw_records[i].length() << " bytes\n";
-                        
-                        // Count quotes in raw record
-                        int quote_count = 0;
-                        for (char c : raw_records[i]) {
-                            if (c == '"') quote_count++;
+        // Reader, parser and DB writer run concurrently; queue depth bounds the batches in flight.
+        // Raw records are views into the mapped file, so keep their pages until the parser is done.
+        reader.setReleaseLag(queue_depth + 1);
+        struct RawBatch {
+            std::vector<std::string_view> records;
+            size_t end_offset = 0; // reader offset just past the batch
+        };
+        struct ParsedBatch {
+            size_t end_offset = 0;
+            std::vector<OpinionCluster> clusters;
+            std::vector<std::string> bad_records;
+            std::vector<std::string> bad_reasons;
+        };
+        runReadParseWritePipeline<RawBatch, ParsedBatch>(queue_depth,
+            [&](RawBatch& raw) {
+                if (!reader.readNextBatch(raw.records, batch_records)) return false;
+                raw.end_offset = reader.offset();
+                return true;
+            },
+            [&](RawBatch&& raw) {
+                StageTimer timer("parse", "search_opinioncluster");
+                const auto& raw_records = raw.records;
+                ParsedBatch parsed;
+                parsed.end_offset = raw.end_offset;
+                parsed.clusters.reserve(raw_records.size());
+                for (size_t i = 0; i < raw_records.size(); ++i) {
+                    try { 
+                        auto cluster = reader.parseCsvLine(raw_records[i]);
+
+                        // Debug: analyze records with wrong column count or specific IDs
+                        auto cols = reader.splitCsvLine(raw_records[i]);
+                        if ((cols.size() != 36 && cluster.id == 8027875) || cluster.id == 2131251) {
+                            std::cout << "\n=== ANALYZING BAD RECORD id=" << cluster.id << " ===\n";
+                            std::cout << "Column count: " << cols.size() << " (expected 36)\n";
+                            std::cout << "Raw record length: " << raw_records[i].length() << " bytes\n";
+
+                            // Count quotes in raw record
+                            int quote_count = 0;
+                            for (char c : raw_records[i]) {
+                                if (c == '"') quote_count++;
+                            }
+                            std::cout << "Total quotes in raw record: " << quote_count << " (should be even for balanced quotes)\n";
+
+                            // Count newlines in raw record
+                            int newline_count = 0;
+                            for (char c : raw_records[i]) {
+                                if (c == '\n') newline_count++;
+                            }
+                            std::cout << "Newlines in raw record: " << newline_count << "\n";
+
+                            // Print entire raw record for examination
+                            std::cout << "\n=== COMPLETE RAW RECORD ===\n";
+                            std::cout << raw_records[i] << "\n";
+                            std::cout << "=== END COMPLETE RAW RECORD ===\n\n";
+                        }
+
+                        parsed.clusters.push_back(cluster);
+                    }
+                    catch (const std::exception& e) {
+                        std::string msg = e.what();
+                        if (msg.find("key") != std::string::npos || msg.find("insufficient columns") != std::string::npos) {
+                            parsed.bad_records.emplace_back(raw_records[i]); parsed.bad_reasons.push_back(msg);
                         }
-                        std::cout << "Total quotes in raw record: " << quote_count << " (should be even for balanced quotes)\n";
-                        
-                        // Count newlines in raw record
-                        int newline_count = 0;
-                        for (char c : raw_records[i]) {
-                            if (c == '\n') newline_count++;
+                    }
+                }
+                Metrics::global().add("records_parsed", "search_opinioncluster", parsed.clusters.size());
+                return parsed;
+            },
+            [&](ParsedBatch&& parsed) {
+                size_t batch_start_offset = total_processed; // offset BEFORE processing this batch
+                // Update processed count (parsed good + bad in this batch)
+                size_t batch_records_seen = parsed.clusters.size() + parsed.bad_records.size();
+                total_processed += batch_records_seen;
+                bool batch_insert_failed = false;
+                size_t batch_rejected = 0;
+                if (!parsed.clusters.empty()) {
+                    try {
+                        std::vector<OpinionCluster> rejected;
+                        std::vector<std::string> rejected_reasons;
+                        db.insertClusters(parsed.clusters, rejected, rejected_reasons);
+                        batch_rejected = rejected.size();
+                        total_inserted += parsed.clusters.size() - batch_rejected;
+                        // Rows the database rejected are reported like parse failures
+                        for (size_t i = 0; i < rejected.size(); ++i) {
+                            parsed.bad_records.push_back(rejected[i].toCsv());
+                            parsed.bad_reasons.push_back(rejected_reasons[i]);
                         }
-                        std::cout << "Newlines in raw record: " << newline_count << "\n";
-                        
-                        // Print entire raw record for examination
-                        std::cout << "\n=== COMPLETE RAW RECORD ===\n";
-                        std::cout << raw_records[i] << "\n";
-                        std::cout << "=== END COMPLETE RAW RECORD ===\n\n";
+                    } catch (const std::exception& ex) {
+                        batch_insert_failed = true;
+                        failed_batches++;
+                        std::cerr << "DB insertion failure for batch " << (batch_index + 1)
+                                  << ": starting_offset=" << batch_start_offset
+                                  << ", batch_records_attempted=" << parsed.clusters.size()
+                                  << ", reason=" << ex.what() << "\n";
                     }
-                    
-                    clusters.push_back(cluster);
                 }
-                catch (const std::exception& e) {
-                    std::string msg = e.what();
-                    if (msg.find("key") != std::string::npos || msg.find("insufficient columns") != std::string::npos) {
-                        bad_records.push_back(raw_records[i]); bad_reasons.push_back(msg);
+
+                // Write bad records to file if specified
+                if (bad_records_stream.is_open() && !parsed.bad_records.empty()) {
+                    for (size_t i = 0; i < parsed.bad_records.size(); ++i) {
+                        // Escape the reason and record for CSV format
+                        std::string escaped_reason = parsed.bad_reasons[i];
+                        std::string escaped_record = parsed.bad_records[i];
+                        // Replace quotes with double quotes for CSV escaping
+                        size_t pos = 0;
+                        while ((pos = escaped_reason.find('"', pos)) != std::string::npos) {
+                            escaped_reason.replace(pos, 1, "\"\"");
+                            pos += 2;
+                        }
+                        pos = 0;
+                        while ((pos = escaped_record.find('"', pos)) != std::string::npos) {
+                            escaped_record.replace(pos, 1, "\"\"");
+                            pos += 2;
+                        }
+                        bad_records_stream << "\"" << escaped_reason << "\",\"" << escaped_record << "\"\n";
                     }
                 }
-            }
-            // Update processed count (parsed good + bad in this batch)
-            total_processed += clusters.size() + bad_records.size();
-            bool batch_insert_failed = false;
-            if (!clusters.empty()) {
-                try {
-                    db.insertClusters(clusters);
-                    total_inserted += clusters.size();
-                } catch (const std::exception& ex) {
-                    batch_insert_failed = true;
-                    failed_batches++;
-                    std::cerr << "DB insertion failure for batch " << (batch_index + 1)
-                              << ": starting_offset=" << batch_start_offset
-                              << ", batch_records_attempted=" << clusters.size()
-                              << ", reason=" << ex.what() << "\n";
+
+                if (checkpointing && batch_insert_failed) {
+                    // Later batches may still commit, but a resume has to start at this one
+                    std::cerr << "Checkpoint frozen at byte " << checkpoint.offset << " after failed batch\n";
+                    checkpointing = false;
                 }
-            }
-            
-            // Write bad records to file if specified
-            if (bad_records_stream.is_open() && !bad_records.empty()) {
-                for (size_t i = 0; i < bad_records.size(); ++i) {
-                    // Escape the reason and record for CSV format
-                    std::string escaped_reason = bad_reasons[i];
-                    std::string escaped_record = bad_records[i];
-                    // Replace quotes with double quotes for CSV escaping
-                    size_t pos = 0;
-                    while ((pos = escaped_reason.find('"', pos)) != std::string::npos) {
-                        escaped_reason.replace(pos, 1, "\"\"");
-                        pos += 2;
+                if (checkpointing) {
+                    if (bad_records_stream.is_open()) bad_records_stream.flush();
+                    checkpoint.offset = parsed.end_offset;
+                    checkpoint.records += batch_records_seen;
+                    try { checkpoint.save(checkpoint_file); }
+                    catch (const std::exception& e) {
+                        std::cerr << "Checkpointing disabled: " << e.what() << "\n";
+                        checkpointing = false;
                     }
-                    pos = 0;
-                    while ((pos = escaped_record.find('"', pos)) != std::string::npos) {
-                        escaped_record.replace(pos, 1, "\"\"");
-                        pos += 2;
-                    }
-                    bad_records_stream << "\"" << escaped_reason << "\",\"" << escaped_record << "\"\n";
                 }
-            }
-            
-            total_bad += bad_records.size();
-            batch_index++;
-            std::cout << "Batch " << batch_index << ": inserted=" << (batch_insert_failed ? 0 : clusters.size())
-                      << ", bad=" << bad_records.size()
-                      << ", start_offset=" << batch_start_offset
-                      << ", processed_total=" << total_processed
-                      << (batch_insert_failed ? " [INSERT FAILED]" : "")
-                      << " (total_inserted=" << total_inserted << ", total_bad=" << total_bad << ")\n";
+
+                total_bad += parsed.bad_records.size();
+                batch_index++;
+                std::cout << "Batch " << batch_index << ": inserted=" << (batch_insert_failed ? 0 : parsed.clusters.size() - batch_rejected)
+                          << ", bad=" << parsed.bad_records.size()
+                          << ", start_offset=" << batch_start_offset
+                          << ", processed_total=" << total_processed
+                          << (batch_insert_failed ? " [INSERT FAILED]" : "")
+                          << " (total_inserted=" << total_inserted << ", total_bad=" << total_bad << ")\n";
+            });
+
+        if (bulk_load) {
+            // Runs even after failed batches so the table never stays without indexes and FK checks
+            size_t violators = bulk_load->finish(db.pool()->maxSize(), bad_records_stream);
+            total_bad += violators;
+            if (violators > 0) std::cout << violators << " FK violators removed after the load\n";
         }
         
         if (bad_records_stream.is_open()) {
@@ -0,0 +1,171 @@
+#include "connection_pool.h"
+
+#include <iostream>
+#include <stdexcept>
+
+static std::mutex g_registry_mutex;
+static size_t g_default_size = 4;
+
+ConnectionPool::Lease::Lease(Lease&& other) noexcept
+    : pool_(other.pool_), conn_(std::move(other.conn_)) {
+    other.pool_ = nullptr;
+}
+
+ConnectionPool::Lease& ConnectionPool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        if (pool_ && conn_) pool_->release(std::move(conn_), true);
+        pool_ = other.pool_;
+        conn_ = std::move(other.conn_);
+        other.pool_ = nullptr;
+    }
+    return *this;
+}
+
+ConnectionPool::Lease::~Lease() {
+    if (pool_ && conn_) pool_->release(std::move(conn_), true);
+}
+
+void ConnectionPool::Lease::discard() {
+    if (pool_ && conn_) pool_->release(std::move(conn_), false);
+    pool_ = nullptr;
+}
+
+ConnectionPool::ConnectionPool(std::string connection_string, size_t max_size)
+    : connection_string_(std::move(connection_string)), max_size_(max_size == 0 ? 1 : max_size) {}
+
+ConnectionPool::Lease ConnectionPool::acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        while (!idle_.empty()) {
+            Idle idle = std::move(idle_.back());
+            idle_.pop_back();
+            bool stale = std::chrono::steady_clock::now() - idle.since >= health_check_interval_;
+            // Probe outside the lock; a dead backend should not stall other borrowers
+            lock.unlock();
+            bool ok = idle.conn->is_open() && (!stale || healthy(*idle.conn));
+            lock.lock();
+            if (ok) return Lease(this, std::move(idle.conn));
+            prepared_.erase(idle.conn.get());
+            open_--;
+            std::cerr << "Connection pool: dropping unhealthy connection" << std::endl;
+        }
+
+        if (open_ < max_size_) {
+            open_++;
+            lock.unlock();
+            try {
+                auto conn = std::make_unique<pqxx::connection>(connection_string_);
+                lock.lock();
+                created_++;
+                return Lease(this, std::move(conn));
+            } catch (...) {
+                lock.lock();
+                open_--;
+                available_.notify_one();
+                throw;
+            }
+        }
+
+        if (!available_.wait_for(lock, acquire_timeout_, [this] { return !idle_.empty() || open_ < max_size_; })) {
+            throw std::runtime_error("Connection pool exhausted: all " + std::to_string(max_size_) +
+                                     " connections in use");
+        }
+    }
+}
+
+void ConnectionPool::release(std::unique_ptr<pqxx::connection> conn, bool reusable) {
+    bool keep = reusable && conn && conn->is_open();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (keep && open_ <= max_size_) {
+        idle_.push_back(Idle{std::move(conn), std::chrono::steady_clock::now()});
+    } else {
+        prepared_.erase(conn.get());
+        open_--;
+        conn.reset();
+    }
+    available_.notify_one();
+}
+
+void ConnectionPool::prepare(pqxx::connection& conn, const std::string& name, const std::string& sql) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (prepared_[&conn].count(name)) return;
+    }
+    conn.prepare(name, sql);
+    std::lock_guard<std::mutex> lock(mutex_);
+    prepared_[&conn].insert(name);
+}
+
+bool ConnectionPool::healthy(pqxx::connection& conn) {
+    try {
+        pqxx::nontransaction txn(conn);
+        txn.exec("SELECT 1");
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+size_t ConnectionPool::maxSize() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return max_size_;
+}
+
+void ConnectionPool::setMaxSize(size_t max_size) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    max_size_ = max_size == 0 ? 1 : max_size;
+    // Shrink by closing surplus idle connections; leased ones close on return
+    while (open_ > max_size_ && !idle_.empty()) {
+        prepared_.erase(idle_.back().conn.get());
+        idle_.pop_back();
+        open_--;
+    }
+    available_.notify_all();
+}
+
+size_t ConnectionPool::idleCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idle_.size();
+}
+
+size_t ConnectionPool::openCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return open_;
+}
+
+size_t ConnectionPool::createdCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return created_;
+}
+
+void ConnectionPool::setHealthCheckInterval(std::chrono::milliseconds interval) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    health_check_interval_ = interval;
+}
+
+void ConnectionPool::setAcquireTimeout(std::chrono::milliseconds timeout) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    acquire_timeout_ = timeout;
+}
+
+std::shared_ptr<ConnectionPool> ConnectionPool::shared(const std::string& connection_string) {
+    static std::map<std::string, std::weak_ptr<ConnectionPool>> registry;
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
+    auto& slot = registry[connection_string];
+    auto pool = slot.lock();
+    if (!pool) {
+        pool = std::make_shared<ConnectionPool>(connection_string, g_default_size);
+        slot = pool;
+    }
+    return pool;
+}
+
+void ConnectionPool::setDefaultSize(size_t max_size) {
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
+    g_default_size = max_size == 0 ? 1 : max_size;
+}
+
+size_t ConnectionPool::defaultSize() {
+    std::lock_guard<std::mutex> lock(g_registry_mutex);
+    return g_default_size;
+}
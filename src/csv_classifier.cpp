@@ -0,0 +1,96 @@
+#include "csv_classifier.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define CSV_CLASSIFIER_X86 1
+#include <immintrin.h>
+#endif
+
+static CsvClassifier::Masks classifyScalar(const char* block) {
+    CsvClassifier::Masks m;
+    for (size_t i = 0; i < CsvClassifier::kBlockSize; ++i) {
+        uint64_t bit = 1ULL << i;
+        switch (block[i]) {
+            case '"': m.quote |= bit; break;
+            case ',': m.comma |= bit; break;
+            case '\n': m.newline |= bit; break;
+            default: break;
+        }
+    }
+    return m;
+}
+
+#ifdef CSV_CLASSIFIER_X86
+
+__attribute__((target("sse4.2")))
+static CsvClassifier::Masks classifySse42(const char* block) {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    CsvClassifier::Masks m;
+    for (int lane = 0; lane < 4; ++lane) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + lane * 16));
+        int shift = lane * 16;
+        m.quote |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)))) << shift;
+        m.comma |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, comma)))) << shift;
+        m.newline |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)))) << shift;
+    }
+    return m;
+}
+
+__attribute__((target("avx2")))
+static uint64_t matchAvx2(__m256i lo, __m256i hi, __m256i needle) {
+    uint64_t l = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, needle)));
+    uint64_t h = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, needle)));
+    return l | (h << 32);
+}
+
+__attribute__((target("avx2")))
+static CsvClassifier::Masks classifyAvx2(const char* block) {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+    CsvClassifier::Masks m;
+    m.quote = matchAvx2(lo, hi, quote);
+    m.comma = matchAvx2(lo, hi, comma);
+    m.newline = matchAvx2(lo, hi, newline);
+    return m;
+}
+
+#endif // CSV_CLASSIFIER_X86
+
+CsvClassifier::CsvClassifier() : CsvClassifier(detect()) {}
+
+CsvClassifier::CsvClassifier(Isa isa) : isa_(supported(isa) ? isa : Isa::Scalar), fn_(classifyScalar) {
+#ifdef CSV_CLASSIFIER_X86
+    if (isa_ == Isa::Avx2) fn_ = classifyAvx2;
+    else if (isa_ == Isa::Sse42) fn_ = classifySse42;
+#endif
+}
+
+bool CsvClassifier::supported(Isa isa) {
+    switch (isa) {
+        case Isa::Scalar: return true;
+#ifdef CSV_CLASSIFIER_X86
+        case Isa::Sse42: return __builtin_cpu_supports("sse4.2");
+        case Isa::Avx2: return __builtin_cpu_supports("avx2");
+#endif
+        default: return false;
+    }
+}
+
+CsvClassifier::Isa CsvClassifier::detect() {
+    static const Isa best = supported(Isa::Avx2) ? Isa::Avx2
+                          : supported(Isa::Sse42) ? Isa::Sse42
+                          : Isa::Scalar;
+    return best;
+}
+
+const char* CsvClassifier::name(Isa isa) {
+    switch (isa) {
+        case Isa::Avx2: return "avx2";
+        case Isa::Sse42: return "sse4.2";
+        default: return "scalar";
+    }
+}
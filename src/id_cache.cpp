@@ -0,0 +1,95 @@
+#include "id_cache.h"
+
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+// Last cache loaded per table in this process
+struct SharedIds {
+    std::mutex mutex;
+    IdSet ids;
+    bool loaded = false;
+};
+
+SharedIds& sharedIds(const std::string& table) {
+    static std::mutex registry_mutex;
+    static std::map<std::string, std::unique_ptr<SharedIds>> registry;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    auto& slot = registry[table];
+    if (!slot) slot = std::make_unique<SharedIds>();
+    return *slot;
+}
+
+} // namespace
+
+size_t loadIdCache(pqxx::transaction_base& txn, const std::string& table, IdSet& ids,
+                   const std::string& snapshot_dir, bool verify) {
+    // Loaders of the same table take turns, so a concurrent one only refreshes
+    SharedIds& shared = sharedIds(table);
+    std::lock_guard<std::mutex> lock(shared.mutex);
+
+    ids.clear();
+    std::string snapshot = snapshot_dir.empty() ? "" : snapshot_dir + "/" + table + ".ids";
+
+    int db_max = txn.query_value<int>("SELECT COALESCE(MAX(id), 0) FROM " + table);
+    std::string source;
+    if (shared.loaded) {
+        ids = shared.ids;
+        source = "memory";
+    } else if (!snapshot.empty() && ids.load(snapshot, table)) {
+        source = "snapshot " + snapshot;
+    }
+    if (!source.empty()) {
+        if (ids.maxId() > db_max) {
+            std::cerr << "ID cache from " << source << " is ahead of " << table
+                      << " (max " << ids.maxId() << " > " << db_max << "), reloading from scratch\n";
+            ids.clear();
+        } else {
+            std::cout << "Loaded " << ids.size() << " " << table << " ids from " << source << "\n";
+        }
+    }
+    ids.reserve(db_max);
+
+    bool warm = !ids.empty();
+    std::string query = "SELECT id FROM " + table;
+    if (warm) query += " WHERE id > " + std::to_string(ids.maxId());
+
+    size_t fetched = 0;
+    for (auto [id] : txn.stream<int>(query)) {
+        ids.insert(id);
+        fetched++;
+    }
+
+    // The range scan misses ids inserted below the cached max and keeps ids deleted
+    // since, neither of which moves MAX(id); a count mismatch catches both
+    if (warm && verify) {
+        size_t db_count = txn.query_value<size_t>("SELECT COUNT(*) FROM " + table);
+        if (db_count != ids.size()) {
+            std::cerr << "ID cache for " << table << " has " << ids.size() << " ids but the table has "
+                      << db_count << " rows, reloading from scratch\n";
+            ids.clear();
+            ids.reserve(db_max);
+            fetched = 0;
+            for (auto [id] : txn.stream<int>("SELECT id FROM " + table)) {
+                ids.insert(id);
+                fetched++;
+            }
+        }
+    }
+
+    shared.ids = ids;
+    shared.loaded = true;
+
+    if (!snapshot.empty()) {
+        try {
+            ids.save(snapshot, table);
+        } catch (const std::exception& e) {
+            // The cache is complete either way; only the next restart gets slower
+            std::cerr << "Warning: " << e.what() << std::endl;
+        }
+    }
+    return fetched;
+}
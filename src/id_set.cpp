@@ -0,0 +1,130 @@
+#include "id_set.h"
+
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+
+namespace {
+
+constexpr char kSnapshotMagic[8] = {'I', 'D', 'S', 'N', 'A', 'P', '\0', '\0'};
+constexpr uint32_t kSnapshotVersion = 1;
+
+// Followed by the tag (padded to 8 bytes) and word_count uint64 bitmap words
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t tag_len;
+    int64_t max_id;
+    uint64_t count;
+    uint64_t word_count;
+};
+
+size_t padded(size_t n) { return (n + 7) & ~size_t{7}; }
+
+} // namespace
+
+void IdSet::reserve(int max_id) {
+    if (max_id < 0) return;
+    size_t words = (static_cast<size_t>(max_id) >> 6) + 1;
+    if (words > words_.size()) words_.resize(words, 0);
+}
+
+bool IdSet::insert(int id) {
+    if (id < 0) return false;
+    size_t word = static_cast<size_t>(id) >> 6;
+    if (word >= words_.size()) {
+        // Grow geometrically; loads arrive in id order, so this amortises to O(1)
+        words_.resize(std::max(word + 1, words_.size() + words_.size() / 2), 0);
+    }
+    uint64_t bit = uint64_t{1} << (id & 63);
+    if (words_[word] & bit) return false;
+    words_[word] |= bit;
+    count_++;
+    if (id > max_id_) max_id_ = id;
+    return true;
+}
+
+bool IdSet::containsAll(const std::vector<int>& ids) const {
+    for (int id : ids) {
+        if (!contains(id)) return false;
+    }
+    return true;
+}
+
+void IdSet::collectMissing(const std::vector<int>& ids, std::vector<int>& missing) const {
+    for (int id : ids) {
+        if (!contains(id)) missing.push_back(id);
+    }
+}
+
+void IdSet::clear() {
+    words_.clear();
+    count_ = 0;
+    max_id_ = -1;
+}
+
+void IdSet::save(const std::string& path, const std::string& tag) const {
+    // Only words up to max_id carry bits; the geometric slack is not written
+    size_t used = max_id_ < 0 ? 0 : (static_cast<size_t>(max_id_) >> 6) + 1;
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, kSnapshotMagic, sizeof(header.magic));
+    header.version = kSnapshotVersion;
+    header.tag_len = static_cast<uint32_t>(tag.size());
+    header.max_id = max_id_;
+    header.count = count_;
+    header.word_count = used;
+
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) throw std::runtime_error("Could not write ID snapshot: " + tmp + " (" + std::strerror(errno) + ")");
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        std::string tag_block = tag;
+        tag_block.resize(padded(tag.size()), '\0');
+        out.write(tag_block.data(), static_cast<std::streamsize>(tag_block.size()));
+        out.write(reinterpret_cast<const char*>(words_.data()), static_cast<std::streamsize>(used * sizeof(uint64_t)));
+        if (!out.flush()) throw std::runtime_error("Could not write ID snapshot: " + tmp);
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        int err = errno;
+        std::remove(tmp.c_str());
+        throw std::runtime_error("Could not replace ID snapshot: " + path + " (" + std::strerror(err) + ")");
+    }
+}
+
+bool IdSet::load(const std::string& path, const std::string& tag) {
+    clear();
+    std::unique_ptr<MappedFile> file;
+    try {
+        file = std::make_unique<MappedFile>(path);
+    } catch (const std::exception&) {
+        return false;
+    }
+
+    SnapshotHeader header;
+    if (file->size() < sizeof(header)) return false;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, kSnapshotMagic, sizeof(header.magic)) != 0 ||
+        header.version != kSnapshotVersion || header.tag_len != tag.size()) {
+        return false;
+    }
+    size_t words_offset = sizeof(header) + padded(header.tag_len);
+    if (file->size() < words_offset ||
+        (file->size() - words_offset) / sizeof(uint64_t) < header.word_count ||
+        std::memcmp(file->data() + sizeof(header), tag.data(), tag.size()) != 0) {
+        return false;
+    }
+
+    words_.resize(header.word_count);
+    std::memcpy(words_.data(), file->data() + words_offset, header.word_count * sizeof(uint64_t));
+    count_ = header.count;
+    max_id_ = static_cast<int>(header.max_id);
+    return true;
+}
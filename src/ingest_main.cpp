@@ -0,0 +1,551 @@
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include "opinion.h"
+#include "opinion_db.h"
+#include "opinion_cluster.h"
+#include "opinion_cluster_db.h"
+#include "opinion_cluster_panel.h"
+#include "opinion_cluster_panel_db.h"
+#include "opinion_joined_by.h"
+#include "opinion_joined_by_db.h"
+#include "opinion_cited.h"
+#include "opinion_cited_db.h"
+#include "search_citation.h"
+#include "search_citation_db.h"
+#include "parenthetical.h"
+#include "parenthetical_db.h"
+#include "bulk_initial_load.h"
+#include "connection_pool.h"
+#include "metrics.h"
+#include "pipeline.h"
+#include "stage_scheduler.h"
+
+// courtlistener_ingest: loads every CSV named in a manifest in one process.
+//
+// Each table is a stage of a DAG that follows the foreign keys, so a table only
+// starts once the tables it references are loaded, and independent tables
+// (e.g. panels and citations, both only needing clusters) load concurrently.
+// All stages share one connection pool and the in-memory FK id caches.
+
+struct IngestOptions {
+    size_t batch_records = 5000;
+    size_t queue_depth = 4;
+    size_t pipeline_window = 0;
+    bool bulk_copy = false;
+    bool bulk_initial = false; // clusters/opinions: defer indexes and FK triggers to the end of the load
+    bool staging = false; // clusters: merge batches through an UNLOGGED staging table
+    std::string id_snapshot_dir;
+    bool verify_id_cache = false; // check refreshed id caches against COUNT(*)
+    std::string bad_records_dir; // <dir>/<stage>.bad.csv per stage when set
+    size_t jobs = 1; // stages sharing the connection pool at once
+};
+
+struct TableSpec {
+    const char* key;   // manifest key and stage name
+    const char* table; // destination table (for logs)
+    std::vector<std::string> deps;
+};
+
+// FK order: cluster -> opinion -> cited/joined_by/parenthetical, cluster -> panel/citation
+static const std::vector<TableSpec> kTables = {
+    {"clusters", "search_opinioncluster", {}},
+    {"opinions", "search_opinion", {"clusters"}},
+    {"citation_map", "search_opinionscited", {"opinions"}},
+    {"joined_by", "search_opinion_joined_by", {"opinions"}},
+    {"parentheticals", "search_parenthetical", {"opinions"}},
+    {"panels", "search_opinioncluster_panel", {"clusters"}},
+    {"citations", "search_citation", {"clusters"}},
+};
+
+static std::mutex g_log_mutex;
+
+// Stages run concurrently; keep each summary line whole
+static void logStage(const std::string& stage, const std::string& msg) {
+    std::lock_guard<std::mutex> lock(g_log_mutex);
+    std::cout << "[" << stage << "] " << msg << std::endl;
+}
+
+template <typename Db>
+static std::unique_ptr<Db> openDatabase(const std::string& stage) {
+    auto db = std::make_unique<Db>("localhost", 5432, "courtlistener", "postgres", "postgres");
+    if (!db->testConnection()) throw std::runtime_error("Failed to connect to database");
+    logStage(stage, "Connection successful");
+    return db;
+}
+
+// Optional per-stage file of rejected rows, in the same format as the single-table apps
+class BadRecords {
+public:
+    BadRecords(const IngestOptions& opt, const std::string& stage, const char* header) {
+        if (opt.bad_records_dir.empty()) return;
+        std::string path = opt.bad_records_dir + "/" + stage + ".bad.csv";
+        out_.open(path);
+        if (!out_.is_open()) throw std::runtime_error("Failed to open bad records file: " + path);
+        out_ << header << "\n";
+    }
+
+    template <typename Record>
+    void write(const std::vector<Record>& records, const std::vector<std::string>& reasons) {
+        if (!out_.is_open()) return;
+        for (size_t i = 0; i < records.size(); ++i) {
+            out_ << records[i].toCsv() << ",\"" << reasons[i] << "\"\n";
+        }
+        out_.flush();
+    }
+
+    void write(const Int32Batch& records, const std::vector<std::string>& reasons) {
+        if (!out_.is_open()) return;
+        for (size_t i = 0; i < records.size(); ++i) {
+            out_ << records.rowCsv(i) << ",\"" << reasons[i] << "\"\n";
+        }
+        out_.flush();
+    }
+
+private:
+    std::ofstream out_;
+};
+
+// --bulk-initial: indexes and FK triggers of table are off until finishBulkInitial
+template <typename Db>
+static std::unique_ptr<BulkInitialLoad> beginBulkInitial(Db& db, const std::string& table, const std::string& path,
+                                                         const IngestOptions& opt) {
+    db.setBulkCopy(opt.bulk_copy || opt.bulk_initial);
+    if (!opt.bulk_initial) return nullptr;
+    auto load = std::make_unique<BulkInitialLoad>(db.pool(), table, BulkInitialLoad::defaultStatePath(path));
+    load->begin();
+    return load;
+}
+
+// Rebuild indexes, re-enable triggers and write FK violators next to the stage's bad records.
+// The index builds run for minutes while other stages keep inserting, so they only take
+// this stage's share of the shared pool; the rest stays free for the other stages' acquire().
+static void finishBulkInitial(BulkInitialLoad& load, size_t pool_size, const std::string& stage,
+                              const std::string& path, const IngestOptions& opt) {
+    size_t threads = std::max<size_t>(1, pool_size / std::max<size_t>(1, opt.jobs));
+    std::string bad_path = opt.bad_records_dir.empty() ? path + ".bad.csv"
+                                                       : opt.bad_records_dir + "/" + stage + ".fk_violations.csv";
+    std::ofstream bad(bad_path, std::ios::app | std::ios::ate);
+    if (!bad.is_open()) throw std::runtime_error("Failed to open bad records file: " + bad_path);
+    if (bad.tellp() == 0) bad << "reason,raw_record\n";
+    size_t violators = load.finish(threads, bad);
+    logStage(stage, "fk_violators=" + std::to_string(violators) + (violators ? " (written to " + bad_path + ")" : ""));
+}
+
+// Parse raw records with parseCsvLine, logging (not failing on) bad ones
+template <typename Reader, typename Record>
+static std::vector<Record> parseRecords(const Reader& reader, const std::vector<std::string_view>& raw,
+                                        const std::string& stage, const char* table, size_t& parse_failures) {
+    StageTimer timer("parse", table);
+    std::vector<Record> out;
+    out.reserve(raw.size());
+    for (const auto& record : raw) {
+        try { out.push_back(reader.parseCsvLine(record)); }
+        catch (const std::exception& e) {
+            if (parse_failures++ < 5) logStage(stage, std::string("Parse failure: ") + e.what());
+        }
+    }
+    Metrics::global().add("records_parsed", table, out.size());
+    return out;
+}
+
+static void loadClusters(const std::string& stage, const std::string& path, const IngestOptions& opt) {
+    OpinionClusterReader reader(path);
+    reader.initStream();
+    auto db = openDatabase<OpinionClusterDatabase>(stage);
+    auto bulk_load = beginBulkInitial(*db, "search_opinioncluster", path, opt);
+    db->setStagingMerge(opt.staging);
+    BadRecords bad(opt, stage,
+                   "id,judges,date_created,date_modified,date_filed,slug,case_name_short,case_name,case_name_full,"
+                   "scdb_id,source,procedural_history,attorneys,nature_of_suit,posture,syllabus,citation_count,"
+                   "precedential_status,date_blocked,blocked,docket_id,scdb_decision_direction,scdb_votes_majority,"
+                   "scdb_votes_minority,date_filed_is_approximate,correction,cross_reference,disposition,"
+                   "filepath_json_harvard,headnotes,history,other_dates,summary,arguments,headmatter,"
+                   "filepath_pdf_harvard,reason");
+
+    reader.setReleaseLag(opt.queue_depth + 1);
+    size_t parsed_total = 0, parse_failures = 0, failed_batches = 0, rejected = 0;
+    runReadParseWritePipeline<std::vector<std::string_view>, std::vector<OpinionCluster>>(opt.queue_depth,
+        [&](std::vector<std::string_view>& raw) { return reader.readNextBatch(raw, opt.batch_records); },
+        [&](std::vector<std::string_view>&& raw) {
+            return parseRecords<OpinionClusterReader, OpinionCluster>(reader, raw, stage, "search_opinioncluster",
+                                                                   parse_failures);
+        },
+        [&](std::vector<OpinionCluster>&& clusters) {
+            parsed_total += clusters.size();
+            if (clusters.empty()) return;
+            try {
+                std::vector<OpinionCluster> rejected_records;
+                std::vector<std::string> reasons;
+                db->insertClusters(clusters, rejected_records, reasons);
+                rejected += rejected_records.size();
+                bad.write(rejected_records, reasons);
+            } catch (const std::exception& e) {
+                failed_batches++;
+                logStage(stage, std::string("Batch insert failed: ") + e.what());
+            }
+        });
+
+    logStage(stage, "parsed=" + std::to_string(parsed_total) + " parse_failures=" + std::to_string(parse_failures) +
+                    " rejected=" + std::to_string(rejected) + " failed_batches=" + std::to_string(failed_batches));
+    if (bulk_load) finishBulkInitial(*bulk_load, db->pool()->maxSize(), stage, path, opt);
+    if (failed_batches > 0) throw std::runtime_error(std::to_string(failed_batches) + " cluster batches failed");
+}
+
+static void loadOpinions(const std::string& stage, const std::string& path, const IngestOptions& opt) {
+    OpinionReader reader(path);
+    reader.initStream();
+    auto db = openDatabase<OpinionDatabase>(stage);
+    auto bulk_load = beginBulkInitial(*db, "search_opinion", path, opt);
+
+    reader.setReleaseLag(opt.queue_depth + 1);
+    size_t parsed_total = 0, parse_failures = 0, failed_batches = 0;
+    runReadParseWritePipeline<std::vector<std::string_view>, std::vector<Opinion>>(opt.queue_depth,
+        [&](std::vector<std::string_view>& raw) { return reader.readNextBatch(raw, opt.batch_records); },
+        [&](std::vector<std::string_view>&& raw) {
+            return parseRecords<OpinionReader, Opinion>(reader, raw, stage, "search_opinion", parse_failures);
+        },
+        [&](std::vector<Opinion>&& opinions) {
+            parsed_total += opinions.size();
+            if (opinions.empty()) return;
+            try { db->insertOpinions(opinions); }
+            catch (const std::exception& e) {
+                failed_batches++;
+                logStage(stage, std::string("Batch insert failed: ") + e.what());
+            }
+        });
+
+    logStage(stage, "parsed=" + std::to_string(parsed_total) + " parse_failures=" + std::to_string(parse_failures) +
+                    " failed_batches=" + std::to_string(failed_batches));
+    if (bulk_load) finishBulkInitial(*bulk_load, db->pool()->maxSize(), stage, path, opt);
+    if (failed_batches > 0) throw std::runtime_error(std::to_string(failed_batches) + " opinion batches failed");
+}
+
+static void loadCitationMap(const std::string& stage, const std::string& path, const IngestOptions& opt) {
+    OpinionCitedReader reader(path);
+    auto db = openDatabase<OpinionCitedDatabase>(stage);
+    db->setIdSnapshotDir(opt.id_snapshot_dir);
+    db->setVerifyIdCache(opt.verify_id_cache);
+    db->setPipelineWindow(opt.pipeline_window);
+    db->loadValidOpinionIds();
+    BadRecords bad(opt, stage, "id,depth,cited_opinion_id,citing_opinion_id,reason");
+
+    size_t total = 0, inserted = 0, rejected = 0;
+    runReadWritePipeline<Int32Batch>(opt.queue_depth,
+        [&](Int32Batch& batch) {
+            if (!reader.hasMore()) return false;
+            return reader.readBatch(batch, opt.batch_records) > 0;
+        },
+        [&](Int32Batch&& batch) {
+            Int32Batch rejected_records(OpinionCited::kColumnCount);
+            std::vector<std::string> reasons;
+            inserted += db->insertCitations(batch, rejected_records, reasons);
+            total += batch.size();
+            rejected += rejected_records.size();
+            bad.write(rejected_records, reasons);
+        });
+    logStage(stage, "records=" + std::to_string(total) + " inserted=" + std::to_string(inserted) +
+                    " rejected=" + std::to_string(rejected));
+}
+
+static void loadJoinedBy(const std::string& stage, const std::string& path, const IngestOptions& opt) {
+    OpinionJoinedByReader reader(path);
+    auto db = openDatabase<OpinionJoinedByDatabase>(stage);
+    db->setIdSnapshotDir(opt.id_snapshot_dir);
+    db->setVerifyIdCache(opt.verify_id_cache);
+    db->loadValidOpinionIds();
+    BadRecords bad(opt, stage, "id,opinion_id,person_id,reason");
+
+    size_t total = 0, inserted = 0, rejected = 0;
+    runReadWritePipeline<Int32Batch>(opt.queue_depth,
+        [&](Int32Batch& batch) {
+            if (!reader.hasMore()) return false;
+            return reader.readBatch(batch, opt.batch_records) > 0;
+        },
+        [&](Int32Batch&& batch) {
+            Int32Batch rejected_records(OpinionJoinedBy::kColumnCount);
+            std::vector<std::string> reasons;
+            inserted += db->insertJoinedBy(batch, rejected_records, reasons);
+            total += batch.size();
+            rejected += rejected_records.size();
+            bad.write(rejected_records, reasons);
+        });
+    logStage(stage, "records=" + std::to_string(total) + " inserted=" + std::to_string(inserted) +
+                    " rejected=" + std::to_string(rejected));
+}
+
+static void loadParentheticals(const std::string& stage, const std::string& path, const IngestOptions& opt) {
+    ParentheticalReader reader(path);
+    auto db = openDatabase<ParentheticalDatabase>(stage);
+    db->setIdSnapshotDir(opt.id_snapshot_dir);
+    db->setVerifyIdCache(opt.verify_id_cache);
+    db->loadValidGroupIds();
+    BadRecords bad(opt, stage, "id,text,score,described_opinion_id,describing_opinion_id,group_id,reason");
+
+    size_t total = 0, inserted = 0, rejected = 0, placeholders = 0;
+    std::vector<int> placeholder_groups;
+    runReadWritePipeline<std::vector<Parenthetical>>(opt.queue_depth,
+        [&](std::vector<Parenthetical>& batch) {
+            if (!reader.hasMore()) return false;
+            batch = reader.readBatch(opt.batch_records);
+            return !batch.empty();
+        },
+        [&](std::vector<Parenthetical>&& batch) {
+            std::vector<Parenthetical> rejected_records;
+            std::vector<std::string> reasons;
+            auto [batch_inserted, batch_placeholders] =
+                db->insertParentheticals(batch, rejected_records, reasons, placeholder_groups);
+            total += batch.size();
+            inserted += batch_inserted;
+            placeholders += batch_placeholders;
+            rejected += rejected_records.size();
+            bad.write(rejected_records, reasons);
+        });
+    logStage(stage, "records=" + std::to_string(total) + " inserted=" + std::to_string(inserted) +
+                    " rejected=" + std::to_string(rejected) + " placeholder_groups=" + std::to_string(placeholders));
+}
+
+static void loadPanels(const std::string& stage, const std::string& path, const IngestOptions& opt) {
+    OpinionClusterPanelReader reader(path);
+    auto db = openDatabase<OpinionClusterPanelDatabase>(stage);
+    db->setIdSnapshotDir(opt.id_snapshot_dir);
+    db->setVerifyIdCache(opt.verify_id_cache);
+    db->loadValidClusterIds();
+    BadRecords bad(opt, stage, "id,opinioncluster_id,person_id,reason");
+
+    size_t total = 0, inserted = 0, rejected = 0;
+    runReadWritePipeline<Int32Batch>(opt.queue_depth,
+        [&](Int32Batch& batch) {
+            if (!reader.hasMore()) return false;
+            return reader.readBatch(batch, opt.batch_records) > 0;
+        },
+        [&](Int32Batch&& batch) {
+            Int32Batch rejected_records(OpinionClusterPanel::kColumnCount);
+            std::vector<std::string> reasons;
+            inserted += db->insertPanels(batch, rejected_records, reasons);
+            total += batch.size();
+            rejected += rejected_records.size();
+            bad.write(rejected_records, reasons);
+        });
+    logStage(stage, "records=" + std::to_string(total) + " inserted=" + std::to_string(inserted) +
+                    " rejected=" + std::to_string(rejected));
+}
+
+static void loadSearchCitations(const std::string& stage, const std::string& path, const IngestOptions& opt) {
+    SearchCitationReader reader(path);
+    auto db = openDatabase<SearchCitationDatabase>(stage);
+    db->setIdSnapshotDir(opt.id_snapshot_dir);
+    db->setVerifyIdCache(opt.verify_id_cache);
+    db->setPipelineWindow(opt.pipeline_window);
+    db->loadValidClusterIds();
+    BadRecords bad(opt, stage, "id,volume,reporter,page,type,cluster_id,reason");
+
+    size_t total = 0, inserted = 0, rejected = 0, placeholders = 0;
+    std::vector<int> placeholder_clusters;
+    runReadWritePipeline<std::vector<SearchCitation>>(opt.queue_depth,
+        [&](std::vector<SearchCitation>& batch) {
+            if (!reader.hasMore()) return false;
+            batch = reader.readBatch(opt.batch_records);
+            return !batch.empty();
+        },
+        [&](std::vector<SearchCitation>&& batch) {
+            std::vector<SearchCitation> rejected_records;
+            std::vector<std::string> reasons;
+            auto [batch_inserted, batch_placeholders] =
+                db->insertCitations(batch, rejected_records, reasons, placeholder_clusters);
+            total += batch.size();
+            inserted += batch_inserted;
+            placeholders += batch_placeholders;
+            rejected += rejected_records.size();
+            bad.write(rejected_records, reasons);
+        });
+    logStage(stage, "records=" + std::to_string(total) + " inserted=" + std::to_string(inserted) +
+                    " rejected=" + std::to_string(rejected) + " placeholder_clusters=" + std::to_string(placeholders));
+}
+
+using StageFn = void (*)(const std::string&, const std::string&, const IngestOptions&);
+
+static const std::map<std::string, StageFn> kLoaders = {
+    {"clusters", &loadClusters},
+    {"opinions", &loadOpinions},
+    {"citation_map", &loadCitationMap},
+    {"joined_by", &loadJoinedBy},
+    {"parentheticals", &loadParentheticals},
+    {"panels", &loadPanels},
+    {"citations", &loadSearchCitations},
+};
+
+// Manifest: one "<table>=<csv path>" per line; blank lines and # comments ignored
+static std::map<std::string, std::string> readManifest(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("Could not open manifest: " + path);
+    std::map<std::string, std::string> files;
+    std::string line;
+    size_t line_no = 0;
+    while (std::getline(in, line)) {
+        line_no++;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            throw std::runtime_error("Manifest line " + std::to_string(line_no) + ": expected <table>=<path>");
+        }
+        std::string key = line.substr(first, eq - first);
+        std::string value = line.substr(eq + 1);
+        while (!key.empty() && (key.back() == ' ' || key.back() == '\t')) key.pop_back();
+        size_t vstart = value.find_first_not_of(" \t");
+        size_t vend = value.find_last_not_of(" \t\r");
+        value = vstart == std::string::npos ? "" : value.substr(vstart, vend - vstart + 1);
+        if (!kLoaders.count(key)) {
+            throw std::runtime_error("Manifest line " + std::to_string(line_no) + ": unknown table '" + key + "'");
+        }
+        if (value.empty()) throw std::runtime_error("Manifest line " + std::to_string(line_no) + ": empty path");
+        files[key] = value;
+    }
+    return files;
+}
+
+static void printUsage() {
+    std::cout << "Usage: courtlistener_ingest <manifest> [--jobs=N] [--pool-size=N] [--batch=N] [--queue-depth=N] [--copy] [--staging] [--bulk-initial] [--pipeline-window=N] [--id-snapshot-dir=DIR] [--verify-id-cache] [--bad-records-dir=DIR] [--plan] [--metrics=FILE]\n";
+}
+
+int main(int argc, char** argv) {
+
+    // CLI parsing: courtlistener_ingest <manifest> [options]
+    std::string manifest_path;
+    IngestOptions opt;
+    size_t jobs = 3; // stages running at once
+    size_t pool_size = 0; // pooled connections (0 = 2 per job)
+    bool plan_only = false;
+    MetricsOptions metrics_options; // --metrics=FILE: periodic histogram/counter dumps, all tables
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto number = [&](const std::string& name, size_t prefix, size_t& out) {
+            try { out = static_cast<size_t>(std::stoull(arg.substr(prefix))); return true; }
+            catch (...) { std::cerr << "Invalid " << name << " value\n"; return false; }
+        };
+        if (arg == "--copy") {
+            opt.bulk_copy = true;
+        } else if (arg == "--bulk-initial") {
+            opt.bulk_initial = true;
+        } else if (arg == "--staging") {
+            opt.staging = true;
+        } else if (arg == "--plan") {
+            plan_only = true;
+        } else if (arg.rfind("--jobs=", 0) == 0) {
+            if (!number("--jobs", 7, jobs)) return 1;
+        } else if (arg.rfind("--pool-size=", 0) == 0) {
+            if (!number("--pool-size", 12, pool_size)) return 1;
+        } else if (arg.rfind("--batch=", 0) == 0) {
+            if (!number("--batch", 8, opt.batch_records)) return 1;
+        } else if (arg.rfind("--queue-depth=", 0) == 0) {
+            if (!number("--queue-depth", 14, opt.queue_depth)) return 1;
+        } else if (arg.rfind("--pipeline-window=", 0) == 0) {
+            if (!number("--pipeline-window", 18, opt.pipeline_window)) return 1;
+        } else if (arg.rfind("--id-snapshot-dir=", 0) == 0) {
+            opt.id_snapshot_dir = arg.substr(18);
+        } else if (arg == "--verify-id-cache") {
+            opt.verify_id_cache = true;
+        } else if (arg.rfind("--bad-records-dir=", 0) == 0) {
+            opt.bad_records_dir = arg.substr(18);
+        } else if (arg.rfind("--metrics", 0) == 0) {
+            try { if (!parseMetricsOption(arg, metrics_options)) throw std::invalid_argument("Unknown option: " + arg); }
+            catch (const std::invalid_argument& e) { std::cerr << e.what() << "\n"; return 1; }
+        } else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "Unknown option: " << arg << "\n";
+            printUsage();
+            return 1;
+        } else if (manifest_path.empty()) {
+            manifest_path = arg;
+        } else {
+            std::cerr << "Unexpected extra argument: " << arg << "\n";
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (manifest_path.empty()) {
+        printUsage();
+        std::cout << "  manifest             Lines of <table>=<csv path> (.gz/.bz2/.zst accepted); tables:\n";
+        std::cout << "                       clusters, opinions, citation_map, joined_by, parentheticals, panels, citations\n";
+        std::cout << "  --jobs=N             Tables loaded concurrently (default 3)\n";
+        std::cout << "  --pool-size=N        Shared PostgreSQL connections (default 2 per job)\n";
+        std::cout << "  --batch=N            Records per DB batch (default 5000)\n";
+        std::cout << "  --queue-depth=N      Batches read ahead while inserting (default 4)\n";
+        std::cout << "  --copy               Bulk load clusters/opinions with COPY\n";
+        std::cout << "  --staging            Merge cluster batches through an UNLOGGED staging table (no savepoints)\n";
+        std::cout << "  --bulk-initial       Initial load of clusters/opinions: COPY with secondary indexes and FK\n";
+        std::cout << "                       triggers off, then rebuild them and move FK violators to bad records\n";
+        std::cout << "  --pipeline-window=N  Pipelined upserts for citation_map/citations (default 0 = off)\n";
+        std::cout << "  --id-snapshot-dir=D  Reuse/refresh FK id cache snapshots in directory D\n";
+        std::cout << "  --verify-id-cache    Check refreshed id caches against COUNT(*) (full table scan)\n";
+        std::cout << "  --bad-records-dir=D  Write rejected rows to D/<table>.bad.csv\n";
+        std::cout << "  --plan               Print the load order and exit\n";
+        std::cout << metricsUsage();
+        return 0;
+    }
+    if (jobs == 0) jobs = 1;
+    opt.jobs = jobs;
+
+    try {
+        std::map<std::string, std::string> files = readManifest(manifest_path);
+        if (files.empty()) {
+            std::cerr << "Manifest " << manifest_path << " lists no tables\n";
+            return 1;
+        }
+
+        // Dependencies on tables absent from the manifest are assumed to be loaded already
+        StageScheduler scheduler;
+        for (const auto& spec : kTables) {
+            auto file = files.find(spec.key);
+            if (file == files.end()) continue;
+            std::vector<std::string> deps;
+            for (const auto& dep : spec.deps) {
+                if (files.count(dep)) deps.push_back(dep);
+            }
+            std::string stage = spec.key, path = file->second, table = spec.table;
+            StageFn loader = kLoaders.at(stage);
+            scheduler.add(stage, deps, [stage, path, table, loader, &opt]() {
+                logStage(stage, "Loading " + path + " into " + table);
+                loader(stage, path, opt);
+            });
+        }
+
+        auto levels = scheduler.levels();
+        std::cout << "Load plan (" << jobs << " concurrent):\n";
+        for (size_t l = 0; l < levels.size(); ++l) {
+            std::cout << "  " << (l + 1) << ":";
+            for (const auto& stage : levels[l]) std::cout << " " << stage << " (" << files[stage] << ")";
+            std::cout << "\n";
+        }
+        if (plan_only) return 0;
+
+        ConnectionPool::setDefaultSize(pool_size ? pool_size : 2 * jobs);
+        auto metrics_exporter = MetricsExporter::start(metrics_options);
+        bool ok = scheduler.run(jobs);
+
+        std::cout << "\n=== SUMMARY ===\n";
+        for (const auto& stage : scheduler.names()) {
+            auto status = scheduler.status(stage);
+            std::cout << "  " << stage << ": " << StageScheduler::statusName(status);
+            if (status == StageScheduler::Status::Succeeded || status == StageScheduler::Status::Failed) {
+                std::cout << " in " << scheduler.seconds(stage) << "s";
+            }
+            if (!scheduler.error(stage).empty()) std::cout << " (" << scheduler.error(stage) << ")";
+            std::cout << "\n";
+        }
+        return ok ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,334 @@
+#include "input_stream.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef INGEST_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef INGEST_HAVE_BZIP2
+#include <bzlib.h>
+#endif
+#ifdef INGEST_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+constexpr size_t kCompressedChunk = 1 << 20;
+constexpr size_t kDecompressedChunk = 1 << 20;
+
+} // namespace
+
+Compression detectCompression(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    unsigned char magic[4] = {0, 0, 0, 0};
+    in.read(reinterpret_cast<char*>(magic), sizeof(magic));
+    size_t got = static_cast<size_t>(in.gcount());
+    if (got >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) return Compression::Gzip;
+    if (got >= 3 && magic[0] == 'B' && magic[1] == 'Z' && magic[2] == 'h') return Compression::Bzip2;
+    if (got >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) return Compression::Zstd;
+    return Compression::None;
+}
+
+const char* compressionName(Compression c) {
+    switch (c) {
+        case Compression::Gzip: return "gzip";
+        case Compression::Bzip2: return "bzip2";
+        case Compression::Zstd: return "zstd";
+        case Compression::None: break;
+    }
+    return "none";
+}
+
+bool compressionSupported(Compression c) {
+    switch (c) {
+        case Compression::None: return true;
+#ifdef INGEST_HAVE_ZLIB
+        case Compression::Gzip: return true;
+#endif
+#ifdef INGEST_HAVE_BZIP2
+        case Compression::Bzip2: return true;
+#endif
+#ifdef INGEST_HAVE_ZSTD
+        case Compression::Zstd: return true;
+#endif
+        default: return false;
+    }
+}
+
+DecompressingReader::DecompressingReader(const std::string& path, Compression compression, size_t ring_bytes)
+    : path_(path), compression_(compression), ring_(std::max<size_t>(ring_bytes, 1)) {
+    if (!compressionSupported(compression)) {
+        throw std::runtime_error(std::string("Cannot read ") + path + ": built without " +
+                                 compressionName(compression) + " support");
+    }
+    source_.open(path, std::ios::binary);
+    if (!source_) {
+        throw std::runtime_error("Could not open file: " + path + " (" + std::strerror(errno) + ")");
+    }
+    struct stat st;
+    if (::stat(path.c_str(), &st) == 0) compressed_size_ = static_cast<size_t>(st.st_size);
+    thread_ = std::thread(&DecompressingReader::run, this);
+}
+
+DecompressingReader::~DecompressingReader() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    not_full_.notify_all();
+    if (thread_.joinable()) thread_.join();
+}
+
+size_t DecompressingReader::read(char* dst, size_t n) {
+    size_t total = 0;
+    while (total < n) {
+        size_t head, take;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_empty_.wait(lock, [this] { return count_ > 0 || done_; });
+            if (count_ == 0) {
+                if (error_) std::rethrow_exception(error_);
+                break;
+            }
+            head = head_;
+            take = std::min(count_, n - total);
+        }
+        // Single producer, single consumer: bytes counted as buffered are not touched by
+        // the decompressor until the consumer releases them, so copy outside the lock
+        size_t first = std::min(take, ring_.size() - head);
+        std::memcpy(dst + total, ring_.data() + head, first);
+        std::memcpy(dst + total + first, ring_.data(), take - first);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            head_ = (head_ + take) % ring_.size();
+            count_ -= take;
+        }
+        not_full_.notify_one();
+        total += take;
+    }
+    return total;
+}
+
+bool DecompressingReader::write(const char* src, size_t n) {
+    while (n > 0) {
+        size_t tail, put;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_full_.wait(lock, [this] { return count_ < ring_.size() || stop_; });
+            if (stop_) return false;
+            tail = (head_ + count_) % ring_.size();
+            put = std::min(ring_.size() - count_, n);
+        }
+        size_t first = std::min(put, ring_.size() - tail);
+        std::memcpy(ring_.data() + tail, src, first);
+        std::memcpy(ring_.data(), src + first, put - first);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            count_ += put;
+        }
+        not_empty_.notify_one();
+        src += put;
+        n -= put;
+    }
+    return true;
+}
+
+void DecompressingReader::run() {
+    try {
+        switch (compression_) {
+            case Compression::Gzip: inflateGzip(); break;
+            case Compression::Bzip2: decompressBzip2(); break;
+            case Compression::Zstd: decompressZstd(); break;
+            case Compression::None: {
+                std::vector<char> buf(kCompressedChunk);
+                while (source_.read(buf.data(), static_cast<std::streamsize>(buf.size())) || source_.gcount() > 0) {
+                    if (!write(buf.data(), static_cast<size_t>(source_.gcount()))) break;
+                }
+                break;
+            }
+        }
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        error_ = std::current_exception();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_ = true;
+    }
+    not_empty_.notify_all();
+}
+
+void DecompressingReader::inflateGzip() {
+#ifdef INGEST_HAVE_ZLIB
+    z_stream zs{};
+    // 15 + 32: maximum window, accept both gzip and zlib headers
+    if (inflateInit2(&zs, 15 + 32) != Z_OK) throw std::runtime_error("inflateInit2 failed");
+    struct Guard { z_stream* zs; ~Guard() { inflateEnd(zs); } } guard{&zs};
+
+    std::vector<char> in(kCompressedChunk), out(kDecompressedChunk);
+    bool member_done = false;
+    for (;;) {
+        source_.read(in.data(), static_cast<std::streamsize>(in.size()));
+        size_t got = static_cast<size_t>(source_.gcount());
+        if (got == 0) break;
+        zs.next_in = reinterpret_cast<Bytef*>(in.data());
+        zs.avail_in = static_cast<uInt>(got);
+        do {
+            if (member_done) {
+                if (zs.avail_in == 0) break;
+                // Another gzip member follows (pigz, concatenated dumps)
+                inflateReset(&zs);
+                member_done = false;
+            }
+            zs.next_out = reinterpret_cast<Bytef*>(out.data());
+            zs.avail_out = static_cast<uInt>(out.size());
+            int rc = inflate(&zs, Z_NO_FLUSH);
+            if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) {
+                throw std::runtime_error("Corrupt gzip data in " + path_ + ": " + (zs.msg ? zs.msg : "inflate failed"));
+            }
+            size_t produced = out.size() - zs.avail_out;
+            if (produced > 0 && !write(out.data(), produced)) return;
+            if (rc == Z_STREAM_END) member_done = true;
+            else if (rc == Z_BUF_ERROR) break; // needs more input
+        } while (zs.avail_in > 0 || zs.avail_out == 0);
+    }
+    if (!member_done) throw std::runtime_error("Truncated gzip input: " + path_);
+#endif
+}
+
+void DecompressingReader::decompressBzip2() {
+#ifdef INGEST_HAVE_BZIP2
+    bz_stream bs{};
+    if (BZ2_bzDecompressInit(&bs, 0, 0) != BZ_OK) throw std::runtime_error("BZ2_bzDecompressInit failed");
+    struct Guard { bz_stream* bs; ~Guard() { BZ2_bzDecompressEnd(bs); } } guard{&bs};
+
+    std::vector<char> in(kCompressedChunk), out(kDecompressedChunk);
+    bool stream_done = false;
+    for (;;) {
+        source_.read(in.data(), static_cast<std::streamsize>(in.size()));
+        size_t got = static_cast<size_t>(source_.gcount());
+        if (got == 0) break;
+        bs.next_in = in.data();
+        bs.avail_in = static_cast<unsigned>(got);
+        do {
+            if (stream_done) {
+                if (bs.avail_in == 0) break;
+                // pbzip2 writes one bzip2 stream per block; start the next one
+                BZ2_bzDecompressEnd(&bs);
+                if (BZ2_bzDecompressInit(&bs, 0, 0) != BZ_OK) throw std::runtime_error("BZ2_bzDecompressInit failed");
+                stream_done = false;
+            }
+            bs.next_out = out.data();
+            bs.avail_out = static_cast<unsigned>(out.size());
+            int rc = BZ2_bzDecompress(&bs);
+            if (rc != BZ_OK && rc != BZ_STREAM_END) {
+                throw std::runtime_error("Corrupt bzip2 data in " + path_ + " (error " + std::to_string(rc) + ")");
+            }
+            size_t produced = out.size() - bs.avail_out;
+            if (produced > 0 && !write(out.data(), produced)) return;
+            if (rc == BZ_STREAM_END) stream_done = true;
+            else if (produced == 0 && bs.avail_in == 0) break;
+        } while (bs.avail_in > 0 || bs.avail_out == 0);
+    }
+    if (!stream_done) throw std::runtime_error("Truncated bzip2 input: " + path_);
+#endif
+}
+
+void DecompressingReader::decompressZstd() {
+#ifdef INGEST_HAVE_ZSTD
+    ZSTD_DStream* ds = ZSTD_createDStream();
+    if (!ds) throw std::runtime_error("ZSTD_createDStream failed");
+    struct Guard { ZSTD_DStream* ds; ~Guard() { ZSTD_freeDStream(ds); } } guard{ds};
+    ZSTD_initDStream(ds);
+
+    std::vector<char> in(kCompressedChunk), out(kDecompressedChunk);
+    size_t pending = 0; // 0 once the last frame is complete
+    for (;;) {
+        source_.read(in.data(), static_cast<std::streamsize>(in.size()));
+        size_t got = static_cast<size_t>(source_.gcount());
+        if (got == 0) break;
+        ZSTD_inBuffer input{in.data(), got, 0};
+        bool out_full = false;
+        while (input.pos < input.size || out_full) {
+            ZSTD_outBuffer output{out.data(), out.size(), 0};
+            pending = ZSTD_decompressStream(ds, &output, &input);
+            if (ZSTD_isError(pending)) {
+                throw std::runtime_error("Corrupt zstd data in " + path_ + ": " + ZSTD_getErrorName(pending));
+            }
+            if (output.pos > 0 && !write(out.data(), output.pos)) return;
+            out_full = output.pos == output.size;
+        }
+    }
+    if (pending != 0) throw std::runtime_error("Truncated zstd input: " + path_);
+#endif
+}
+
+class InputStream::DecompressingBuf : public std::streambuf {
+public:
+    DecompressingBuf(const std::string& path, Compression compression)
+        : reader_(path, compression), buf_(64 << 10) {}
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        size_t n = reader_.read(buf_.data(), buf_.size());
+        if (n == 0) return traits_type::eof();
+        setg(buf_.data(), buf_.data(), buf_.data() + n);
+        return traits_type::to_int_type(buf_[0]);
+    }
+
+private:
+    DecompressingReader reader_;
+    std::vector<char> buf_;
+};
+
+InputStream::InputStream() : std::istream(nullptr) {}
+
+InputStream::InputStream(const std::string& path) : std::istream(nullptr) {
+    open(path);
+}
+
+InputStream::~InputStream() {
+    close();
+}
+
+void InputStream::open(const std::string& path) {
+    close();
+    compression_ = detectCompression(path);
+    if (compression_ == Compression::None) {
+        if (file_buf_.open(path, std::ios::in | std::ios::binary)) {
+            rdbuf(&file_buf_);
+        } else {
+            setstate(std::ios::failbit);
+        }
+        return;
+    }
+    try {
+        decompress_buf_ = std::make_unique<DecompressingBuf>(path, compression_);
+    } catch (const std::runtime_error&) {
+        if (!compressionSupported(compression_)) throw;
+        setstate(std::ios::failbit);
+        return;
+    }
+    rdbuf(decompress_buf_.get());
+    exceptions(std::ios::badbit);
+}
+
+bool InputStream::is_open() const {
+    return file_buf_.is_open() || decompress_buf_ != nullptr;
+}
+
+void InputStream::close() {
+    exceptions(std::ios::goodbit);
+    // Detaching the buffer sets badbit, so reads after close() fail
+    rdbuf(nullptr);
+    decompress_buf_.reset();
+    if (file_buf_.is_open()) file_buf_.close();
+    compression_ = Compression::None;
+}
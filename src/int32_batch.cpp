@@ -0,0 +1,44 @@
+#include "int32_batch.h"
+
+#include <stdexcept>
+
+void Int32Batch::matchColumns(size_t count) {
+    if (columns_.empty()) columns_.resize(count);
+    if (columns_.size() != count) {
+        throw std::invalid_argument("Int32Batch column count mismatch: " + std::to_string(count) +
+                                    " appended to " + std::to_string(columns_.size()));
+    }
+}
+
+void Int32Batch::append(std::initializer_list<int32_t> row) {
+    matchColumns(row.size());
+    size_t c = 0;
+    for (int32_t value : row) columns_[c++].push_back(value);
+}
+
+void Int32Batch::append(const Int32Batch& other, size_t begin, size_t end) {
+    if (begin > end || end > other.size()) throw std::out_of_range("Int32Batch append range out of bounds");
+    if (begin == end) return;
+    matchColumns(other.columnCount());
+    for (size_t c = 0; c < columns_.size(); ++c) {
+        const auto& source = other.columns_[c];
+        columns_[c].insert(columns_[c].end(), source.begin() + begin, source.begin() + end);
+    }
+}
+
+void Int32Batch::reserve(size_t rows) {
+    for (auto& column : columns_) column.reserve(rows);
+}
+
+void Int32Batch::clear() {
+    for (auto& column : columns_) column.clear();
+}
+
+std::string Int32Batch::rowCsv(size_t row) const {
+    std::string out;
+    for (size_t c = 0; c < columns_.size(); ++c) {
+        if (c > 0) out += ',';
+        out += std::to_string(columns_[c][row]);
+    }
+    return out;
+}
@@ -2,24 +2,86 @@
 #include <fstream>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <exception>
 #include <optional>
+#include <memory>
+#include <iterator>
+#include <chrono>
 #include "opinion.h"
 #include "opinion_db.h"
+#include "bulk_initial_load.h"
+#include "checkpoint.h"
+#include "metrics.h"
+#include "thread_pool.h"
+#include "pipeline.h"
+
+// Parse a batch of raw records into out, preserving input order.
+// With a pool the batch is split into contiguous ranges parsed concurrently
+// and concatenated afterwards; parse failures are reported in record order.
+static void parseOpinionBatch(const OpinionReader& reader, const std::vector<std::string_view>& raw_records,
+                              std::vector<Opinion>& out, ThreadPool* pool, const std::string& label) {
+    out.clear();
+    if (!pool || pool->size() < 2 || raw_records.size() < 2) {
+        for (size_t i = 0; i < raw_records.size(); ++i) {
+            try { out.push_back(reader.parseCsvLine(raw_records[i])); }
+            catch (const std::exception& e) { std::cerr << "Parse failure " << label << "rec=" << i << ": " << e.what() << std::endl; }
+        }
+        return;
+    }
+
+    std::vector<std::vector<Opinion>> parts(pool->size());
+    std::vector<std::vector<std::pair<size_t, std::string>>> failures(pool->size());
+    size_t ranges = pool->parallelRanges(raw_records.size(), [&](size_t begin, size_t end, size_t part) {
+        parts[part].reserve(end - begin);
+        for (size_t i = begin; i < end; ++i) {
+            try { parts[part].push_back(reader.parseCsvLine(raw_records[i])); }
+            catch (const std::exception& e) { failures[part].emplace_back(i, e.what()); }
+        }
+    });
+    for (size_t part = 0; part < ranges; ++part) {
+        for (const auto& f : failures[part]) {
+            std::cerr << "Parse failure " << label << "rec=" << f.first << ": " << f.second << std::endl;
+        }
+        std::move(parts[part].begin(), parts[part].end(), std::back_inserter(out));
+    }
+}
 
 int main(int argc, char** argv) {
 
-    // CLI parsing: ingestion_app <opinions.csv> [--no-db] [--limit=N]
+    // CLI parsing: ingestion_app <opinions.csv> [--no-db] [--limit=N] [--copy] [--parse-threads=N] [--index-threads=N] [--queue-depth=N] [--resume] [--checkpoint=FILE] [--bulk-initial] [--bad-records=FILE] [--metrics=FILE]
     std::string csvPath;
     bool skip_db = false;
+    bool bulk_copy = false; // stream batches with COPY FROM STDIN
     size_t limit = 100; // default record limit (parse-only mode)
     size_t batch_records = 5000; // default batch size for streaming DB insertion
-    size_t chunk_bytes = 1024 * 1024; // 1MB chunk reads
+    size_t parse_threads = 1; // 1 = parse on the main thread
+    size_t index_threads = 1; // >1 (or 0 = all cores): build a record index in parallel before streaming
+    size_t queue_depth = 4; // batches buffered between read, parse and insert stages
+    bool resume = false; // continue from the checkpoint instead of the start of the file
+    std::string checkpoint_file; // default: <opinions.csv>.checkpoint
+    bool bulk_initial = false; // defer indexes and FK triggers to the end of the load
+    std::string bad_records_file; // FK violators removed by --bulk-initial (default <opinions.csv>.bad.csv)
+    MetricsOptions metrics_options; // --metrics=FILE: periodic histogram/counter dumps
 
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
         if (arg == "--no-db") {
             skip_db = true;
+        } else if (arg == "--copy") {
+            bulk_copy = true;
+        } else if (arg == "--resume") {
+            resume = true;
+        } else if (arg == "--bulk-initial") {
+            bulk_initial = true;
+        } else if (arg == "--bad-records" && i + 1 < argc) {
+            bad_records_file = argv[++i];
+        } else if (arg.rfind("--bad-records=",0)==0) {
+            bad_records_file = arg.substr(14);
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            checkpoint_file = argv[++i];
+        } else if (arg.rfind("--checkpoint=",0)==0) {
+            checkpoint_file = arg.substr(13);
         } else if (arg == "--limit" && i + 1 < argc) {
             try {
                 limit = static_cast<size_t>(std::stoull(argv[++i]));
@@ -41,49 +103,77 @@ int main(int argc, char** argv) {
         } else if (arg.rfind("--batch=",0)==0) {
             try { batch_records = static_cast<size_t>(std::stoull(arg.substr(8))); }
             catch (...) { std::cerr << "Invalid --batch value" << std::endl; return 1; }
-        } else if (arg == "--chunk" && i + 1 < argc) {
-            try { chunk_bytes = static_cast<size_t>(std::stoull(argv[++i])); }
-            catch (...) { std::cerr << "Invalid --chunk value" << std::endl; return 1; }
-        } else if (arg.rfind("--chunk=",0)==0) {
-            try { chunk_bytes = static_cast<size_t>(std::stoull(arg.substr(8))); }
-            catch (...) { std::cerr << "Invalid --chunk value" << std::endl; return 1; }
+        } else if (arg == "--parse-threads" && i + 1 < argc) {
+            try { parse_threads = static_cast<size_t>(std::stoull(argv[++i])); }
+            catch (...) { std::cerr << "Invalid --parse-threads value" << std::endl; return 1; }
+        } else if (arg.rfind("--parse-threads=",0)==0) {
+            try { parse_threads = static_cast<size_t>(std::stoull(arg.substr(16))); }
+            catch (...) { std::cerr << "Invalid --parse-threads value" << std::endl; return 1; }
+        } else if (arg == "--index-threads" && i + 1 < argc) {
+            try { index_threads = static_cast<size_t>(std::stoull(argv[++i])); }
+            catch (...) { std::cerr << "Invalid --index-threads value" << std::endl; return 1; }
+        } else if (arg.rfind("--index-threads=",0)==0) {
+            try { index_threads = static_cast<size_t>(std::stoull(arg.substr(16))); }
+            catch (...) { std::cerr << "Invalid --index-threads value" << std::endl; return 1; }
+        } else if (arg == "--queue-depth" && i + 1 < argc) {
+            try { queue_depth = static_cast<size_t>(std::stoull(argv[++i])); }
+            catch (...) { std::cerr << "Invalid --queue-depth value" << std::endl; return 1; }
+        } else if (arg.rfind("--queue-depth=",0)==0) {
+            try { queue_depth = static_cast<size_t>(std::stoull(arg.substr(14))); }
+            catch (...) { std::cerr << "Invalid --queue-depth value" << std::endl; return 1; }
+        } else if (arg.rfind("--metrics", 0) == 0) {
+            try { if (!parseMetricsOption(arg, metrics_options)) throw std::invalid_argument("Unknown option: " + arg); }
+            catch (const std::invalid_argument& e) { std::cerr << e.what() << "\n"; return 1; }
         } else if (!arg.empty() && arg[0] == '-') {
             std::cerr << "Unknown option: " << arg << "\n";
-            std::cout << "Usage: ingestion_app <opinions.csv> [--no-db] [--limit=N]\n";
+            std::cout << "Usage: ingestion_app <opinions.csv> [--no-db] [--limit=N] [--copy] [--parse-threads=N] [--index-threads=N] [--queue-depth=N] [--resume] [--checkpoint=FILE] [--bulk-initial] [--bad-records=FILE] [--metrics=FILE]\n";
             return 1;
         } else if (csvPath.empty()) {
             csvPath = arg; // first non-option argument is the CSV path
         } else {
             std::cerr << "Unexpected extra argument: " << arg << "\n";
-            std::cout << "Usage: ingestion_app <opinions.csv> [--no-db] [--limit=N]\n";
+            std::cout << "Usage: ingestion_app <opinions.csv> [--no-db] [--limit=N] [--copy] [--parse-threads=N] [--index-threads=N] [--queue-depth=N] [--resume] [--checkpoint=FILE] [--bulk-initial] [--bad-records=FILE] [--metrics=FILE]\n";
             return 1;
         }
     }
 
     if (csvPath.empty()) {
-        std::cout << "Usage: ingestion_app <opinions.csv> [--no-db] [--limit=N]\n";
+        std::cout << "Usage: ingestion_app <opinions.csv> [--no-db] [--limit=N] [--copy] [--parse-threads=N] [--index-threads=N] [--queue-depth=N] [--resume] [--checkpoint=FILE] [--bulk-initial] [--bad-records=FILE] [--metrics=FILE]\n";
         std::cout << "  --no-db     Skip database insertion (just parse and display)\n";
         std::cout << "  --limit=N   Maximum number of records to extract (default 100)\n";
+        std::cout << "  --copy      Bulk load each batch with COPY (per-row fallback on rejection)\n";
+        std::cout << "  --parse-threads=N  Parse each batch on N worker threads (0 = all cores, default 1)\n";
+        std::cout << "  --index-threads=N  Split the file into records on N threads before DB streaming\n";
+        std::cout << "  --queue-depth=N    Batches buffered between read/parse/insert stages (default 4)\n";
+        std::cout << "  --resume           Continue after the last committed batch recorded in the checkpoint\n";
+        std::cout << "  --checkpoint=FILE  Checkpoint location (default <opinions.csv>.checkpoint)\n";
+        std::cout << "  --bulk-initial     Initial load: drop secondary indexes and FK triggers, COPY, then rebuild and check FKs\n";
+        std::cout << "  --bad-records=FILE Where --bulk-initial writes FK violators (default <opinions.csv>.bad.csv)\n";
+        std::cout << metricsUsage();
         return 0;
     }
+    auto metrics_exporter = MetricsExporter::start(metrics_options);
     
     std::cout << "Reading raw opinion records from: " << csvPath << "\n";
-    std::cout << "Record limit (parse-only): " << limit << ", batch_records=" << batch_records << ", chunk_bytes=" << chunk_bytes << "\n";
+    std::cout << "Record limit (parse-only): " << limit << ", batch_records=" << batch_records << "\n";
+    std::cout << "Record scanner kernel: " << CsvClassifier::name(CsvClassifier::detect()) << "\n";
     
     try {
         OpinionReader reader(csvPath);
+        std::unique_ptr<ThreadPool> parse_pool;
+        if (parse_threads != 1) {
+            parse_pool = std::make_unique<ThreadPool>(parse_threads);
+            std::cout << "Parsing with " << parse_pool->size() << " threads\n";
+        }
         
         // Streaming ingestion path (parse-only handled later)
         // Parse-only simple mode
         if (skip_db) {
             reader.initStream();
-            std::vector<std::string> raw_records;
-            if (!reader.readNextBatch(raw_records, limit, chunk_bytes)) { std::cout << "No records found." << std::endl; return 0; }
+            std::vector<std::string_view> raw_records;
+            if (!reader.readNextBatch(raw_records, limit)) { std::cout << "No records found." << std::endl; return 0; }
             std::vector<Opinion> opinions; opinions.reserve(raw_records.size());
-            for (size_t i = 0; i < raw_records.size(); ++i) {
-                try { opinions.push_back(reader.parseCsvLine(raw_records[i])); }
-                catch (const std::exception& e) { std::cerr << "Parse failure rec=" << i << ": " << e.what() << std::endl; }
-            }
+            parseOpinionBatch(reader, raw_records, opinions, parse_pool.get(), "");
             std::cout << "Parsed " << opinions.size() << " opinions" << std::endl;
             for (size_t i = 0; i < opinions.size() && i < 2; ++i) {
                 std::cout << "=== Opinion " << i << " ===\n" << opinions[i].toString() << "\n";
@@ -95,26 +185,104 @@ int main(int argc, char** argv) {
         OpinionDatabase db("localhost", 5432, "courtlistener", "postgres", "postgres");
         if (!db.testConnection()) { std::cerr << "Database connection failed" << std::endl; return 1; }
         std::cout << "DB connection OK" << std::endl;
+        if (bulk_initial) bulk_copy = true; // nothing left for COPY to trip over but duplicate ids
+        db.setBulkCopy(bulk_copy);
+        if (bulk_copy) std::cout << "Bulk COPY mode enabled" << std::endl;
 
         reader.initStream();
-        size_t batch_index = 0;
-        std::vector<std::string> raw_records; raw_records.reserve(batch_records);
-        std::vector<Opinion> opinions; opinions.reserve(batch_records);
-        while (reader.readNextBatch(raw_records, batch_records, chunk_bytes)) {
-            opinions.clear();
-            for (size_t i = 0; i < raw_records.size(); ++i) {
-                try { opinions.push_back(reader.parseCsvLine(raw_records[i])); }
-                catch (const std::exception& e) { std::cerr << "Parse failure batch=" << (batch_index+1) << " rec=" << i << ": " << e.what() << std::endl; }
-            }
-            std::cout << "Batch " << (batch_index+1) << " parsed=" << opinions.size() << " raw=" << raw_records.size() << std::endl;
-            if (!opinions.empty()) {
-                try { db.insertOpinions(opinions); }
-                catch (const std::exception& e) { std::cerr << "DB insertion error batch=" << (batch_index+1) << ": " << e.what() << std::endl; }
+        // Checkpoint: written after every committed batch; --resume seeks past what it covers
+        if (checkpoint_file.empty()) checkpoint_file = Checkpoint::defaultPath(csvPath);
+        Checkpoint checkpoint;
+        if (resume) {
+            if (!checkpoint.load(checkpoint_file)) {
+                std::cout << "No checkpoint at " << checkpoint_file << ", starting from the beginning\n";
+            } else if (checkpoint.file_size != reader.size()) {
+                std::cerr << "Checkpoint " << checkpoint_file << " was written for a " << checkpoint.file_size
+                          << "-byte file but " << csvPath << " has " << reader.size() << " bytes; refusing to resume\n";
+                return 1;
+            } else {
+                reader.seek(checkpoint.offset);
+                std::cout << "Resuming at byte " << checkpoint.offset << " of " << checkpoint.file_size
+                          << " (" << checkpoint.records << " records already committed)\n";
             }
-            batch_index++;
-            if (reader.eof()) break;
         }
+        checkpoint.file_size = reader.size();
+        bool checkpointing = true; // cleared once a batch fails or the file cannot be written
+
+        if (index_threads != 1) {
+            ThreadPool index_pool(index_threads);
+            auto t0 = std::chrono::steady_clock::now();
+            size_t indexed = reader.buildRecordIndex(index_pool);
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+            std::cout << "Indexed " << indexed << " records with " << index_pool.size() << " threads in " << ms << " ms\n";
+        }
+        std::unique_ptr<BulkInitialLoad> bulk_load;
+        if (bulk_initial) {
+            bulk_load = std::make_unique<BulkInitialLoad>(db.pool(), "search_opinion",
+                                                          BulkInitialLoad::defaultStatePath(csvPath));
+            bulk_load->begin();
+        }
+        // Reader, parser and DB writer run concurrently; queue depth bounds the batches in flight.
+        // Raw records are views into the mapped file, so keep their pages until the parser is done.
+        reader.setReleaseLag(queue_depth + 1);
+        // Each batch carries the reader offset just past it, i.e. where a resume would continue
+        struct RawBatch { std::vector<std::string_view> records; size_t end_offset = 0; };
+        struct ParsedBatch { size_t raw = 0; size_t end_offset = 0; std::vector<Opinion> opinions; };
+        size_t parsed_index = 0, batch_index = 0;
+        runReadParseWritePipeline<RawBatch, ParsedBatch>(queue_depth,
+            [&](RawBatch& raw) {
+                if (!reader.readNextBatch(raw.records, batch_records)) return false;
+                raw.end_offset = reader.offset();
+                return true;
+            },
+            [&](RawBatch&& raw) {
+                StageTimer timer("parse", "search_opinion");
+                ParsedBatch parsed;
+                parsed.raw = raw.records.size();
+                parsed.end_offset = raw.end_offset;
+                parsed.opinions.reserve(raw.records.size());
+                parseOpinionBatch(reader, raw.records, parsed.opinions, parse_pool.get(),
+                                  "batch=" + std::to_string(++parsed_index) + " ");
+                Metrics::global().add("records_parsed", "search_opinion", parsed.opinions.size());
+                return parsed;
+            },
+            [&](ParsedBatch&& parsed) {
+                std::cout << "Batch " << (batch_index+1) << " parsed=" << parsed.opinions.size() << " raw=" << parsed.raw << std::endl;
+                bool committed = true;
+                if (!parsed.opinions.empty()) {
+                    try { db.insertOpinions(parsed.opinions); }
+                    catch (const std::exception& e) {
+                        std::cerr << "DB insertion error batch=" << (batch_index+1) << ": " << e.what() << std::endl;
+                        committed = false;
+                    }
+                }
+                if (checkpointing && !committed) {
+                    // Later batches may still commit, but a resume has to start at this one
+                    std::cerr << "Checkpoint frozen at byte " << checkpoint.offset << " after failed batch" << std::endl;
+                    checkpointing = false;
+                }
+                if (checkpointing) {
+                    checkpoint.offset = parsed.end_offset;
+                    checkpoint.records += parsed.raw;
+                    try { checkpoint.save(checkpoint_file); }
+                    catch (const std::exception& e) {
+                        std::cerr << "Checkpointing disabled: " << e.what() << std::endl;
+                        checkpointing = false;
+                    }
+                }
+                batch_index++;
+            });
         std::cout << "Opinion streaming ingestion finished after " << batch_index << " batches" << std::endl;
+
+        if (bulk_load) {
+            // Runs even after failed batches so the table never stays without indexes and FK checks
+            if (bad_records_file.empty()) bad_records_file = csvPath + ".bad.csv";
+            std::ofstream bad_records(bad_records_file, std::ios::app | std::ios::ate);
+            if (!bad_records.is_open()) { std::cerr << "Failed to open bad records file: " << bad_records_file << std::endl; return 1; }
+            if (bad_records.tellp() == 0) bad_records << "reason,raw_record\n";
+            size_t violators = bulk_load->finish(db.pool()->maxSize(), bad_records);
+            if (violators > 0) std::cout << violators << " FK violators written to " << bad_records_file << std::endl;
+        }
         return 0;
     } catch (const std::exception& ex) {
         std::cerr << "Fatal error: " << ex.what() << std::endl;
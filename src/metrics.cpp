@@ -0,0 +1,243 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+// Prometheus le bounds in microseconds: 1-2.5-5 steps from 100 us to 100 s
+const uint64_t kPromBoundsMicros[] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000, 25000000, 50000000, 100000000,
+};
+
+std::string escapeLabel(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '\\' || c == '"') out += '\\';
+        if (c == '\n') { out += "\\n"; continue; }
+        out += c;
+    }
+    return out;
+}
+
+std::string seconds(uint64_t micros) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.6f", static_cast<double>(micros) / 1e6);
+    return buf;
+}
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+size_t LatencyHistogram::bucketIndex(uint64_t micros) {
+    if (micros < kSubBuckets) return static_cast<size_t>(micros);
+    size_t exponent = 63 - static_cast<size_t>(__builtin_clzll(micros)); // >= 4
+    size_t sub = static_cast<size_t>(micros >> (exponent - 4)) & (kSubBuckets - 1);
+    return (exponent - 3) * kSubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index) {
+    if (index < kSubBuckets) return index;
+    size_t exponent = index / kSubBuckets + 3;
+    uint64_t sub = index % kSubBuckets;
+    uint64_t width = uint64_t{1} << (exponent - 4);
+    return ((kSubBuckets + sub) << (exponent - 4)) + width - 1;
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds elapsed) {
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    recordMicros(micros < 0 ? 0 : static_cast<uint64_t>(micros));
+}
+
+void LatencyHistogram::recordMicros(uint64_t micros) {
+    buckets_[bucketIndex(micros)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(micros, std::memory_order_relaxed);
+    uint64_t seen = max_.load(std::memory_order_relaxed);
+    while (micros > seen && !max_.compare_exchange_weak(seen, micros, std::memory_order_relaxed)) {}
+}
+
+uint64_t LatencyHistogram::percentileMicros(double q) const {
+    // Summed from the buckets rather than count_, so a concurrent record cannot push the
+    // rank past the end
+    uint64_t total = 0;
+    for (const auto& b : buckets_) total += b.load(std::memory_order_relaxed);
+    if (total == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen >= rank) return std::min(bucketUpperBound(i), maxMicros());
+    }
+    return maxMicros();
+}
+
+uint64_t LatencyHistogram::countAtOrBelow(uint64_t micros) const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBuckets && bucketUpperBound(i) <= micros; ++i) {
+        total += buckets_[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+Metrics& Metrics::global() {
+    static Metrics metrics;
+    return metrics;
+}
+
+LatencyHistogram& Metrics::latency(const std::string& stage, const std::string& table) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& slot = latencies_[Key(stage, table)];
+    if (!slot) slot = std::make_unique<LatencyHistogram>();
+    return *slot;
+}
+
+std::atomic<uint64_t>& Metrics::counter(const std::string& name, const std::string& table) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& slot = counters_[Key(name, table)];
+    if (!slot) slot = std::make_unique<std::atomic<uint64_t>>(0);
+    return *slot;
+}
+
+std::string Metrics::prometheus() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ostringstream out;
+    if (!latencies_.empty()) {
+        out << "# HELP ingest_stage_latency_seconds Latency of one ingestion stage step (batch, row or commit)\n";
+        out << "# TYPE ingest_stage_latency_seconds histogram\n";
+    }
+    for (const auto& [key, histogram] : latencies_) {
+        std::string labels = "stage=\"" + escapeLabel(key.first) + "\",table=\"" + escapeLabel(key.second) + "\"";
+        // Count first, so a concurrent record cannot make +Inf smaller than a finite bucket
+        uint64_t count = histogram->count();
+        for (uint64_t bound : kPromBoundsMicros) {
+            out << "ingest_stage_latency_seconds_bucket{" << labels << ",le=\"" << seconds(bound) << "\"} "
+                << std::min(count, histogram->countAtOrBelow(bound)) << "\n";
+        }
+        out << "ingest_stage_latency_seconds_bucket{" << labels << ",le=\"+Inf\"} " << count << "\n";
+        out << "ingest_stage_latency_seconds_sum{" << labels << "} " << seconds(histogram->sumMicros()) << "\n";
+        out << "ingest_stage_latency_seconds_count{" << labels << "} " << count << "\n";
+    }
+    std::string current;
+    for (const auto& [key, value] : counters_) {
+        std::string name = "ingest_" + key.first + "_total";
+        if (name != current) {
+            out << "# TYPE " << name << " counter\n";
+            current = name;
+        }
+        out << name << "{table=\"" << escapeLabel(key.second) << "\"} " << value->load(std::memory_order_relaxed)
+            << "\n";
+    }
+    return out.str();
+}
+
+std::string Metrics::jsonLine() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ostringstream out;
+    out << "{\"ts\":" << std::time(nullptr) << ",\"latency\":[";
+    bool first = true;
+    for (const auto& [key, h] : latencies_) {
+        out << (first ? "" : ",") << "{\"stage\":\"" << escapeLabel(key.first) << "\",\"table\":\""
+            << escapeLabel(key.second) << "\",\"count\":" << h->count() << ",\"sum_us\":" << h->sumMicros()
+            << ",\"p50_us\":" << h->percentileMicros(0.5) << ",\"p90_us\":" << h->percentileMicros(0.9)
+            << ",\"p99_us\":" << h->percentileMicros(0.99) << ",\"p999_us\":" << h->percentileMicros(0.999)
+            << ",\"max_us\":" << h->maxMicros() << "}";
+        first = false;
+    }
+    out << "],\"counters\":[";
+    first = true;
+    for (const auto& [key, value] : counters_) {
+        out << (first ? "" : ",") << "{\"name\":\"" << escapeLabel(key.first) << "\",\"table\":\""
+            << escapeLabel(key.second) << "\",\"value\":" << value->load(std::memory_order_relaxed) << "}";
+        first = false;
+    }
+    out << "]}";
+    return out.str();
+}
+
+bool parseMetricsOption(const std::string& arg, MetricsOptions& options) {
+    if (arg.rfind("--metrics=", 0) == 0) {
+        options.path = arg.substr(10);
+        if (!options.format_set) {
+            bool json = endsWith(options.path, ".jsonl") || endsWith(options.path, ".json");
+            options.format = json ? MetricsOptions::Format::JsonLines : MetricsOptions::Format::Prometheus;
+        }
+    } else if (arg.rfind("--metrics-format=", 0) == 0) {
+        std::string format = arg.substr(17);
+        if (format == "prom" || format == "prometheus") options.format = MetricsOptions::Format::Prometheus;
+        else if (format == "jsonl" || format == "json") options.format = MetricsOptions::Format::JsonLines;
+        else throw std::invalid_argument("Unknown metrics format: " + format);
+        options.format_set = true;
+    } else if (arg.rfind("--metrics-interval=", 0) == 0) {
+        try { options.interval_seconds = static_cast<unsigned>(std::stoul(arg.substr(19))); }
+        catch (...) { throw std::invalid_argument("Invalid --metrics-interval value"); }
+        if (options.interval_seconds == 0) throw std::invalid_argument("Invalid --metrics-interval value");
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* metricsUsage() {
+    return "  --metrics=FILE       Write stage latency histograms and counters to FILE while running\n"
+           "                       (Prometheus textfile, or JSON lines for .json/.jsonl)\n"
+           "  --metrics-format=F   prom or jsonl, overriding the extension\n"
+           "  --metrics-interval=S Seconds between metrics dumps (default 15)\n";
+}
+
+MetricsExporter::MetricsExporter(MetricsOptions options, Metrics& metrics)
+    : options_(std::move(options)), metrics_(metrics) {
+    thread_ = std::thread([this]() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!wake_.wait_for(lock, std::chrono::seconds(options_.interval_seconds), [this]() { return stop_; })) {
+            lock.unlock();
+            try { dump(); }
+            catch (const std::exception& e) { std::cerr << "Metrics export failed: " << e.what() << "\n"; }
+            lock.lock();
+        }
+    });
+}
+
+MetricsExporter::~MetricsExporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+    // Final state of the run
+    try { dump(); }
+    catch (const std::exception& e) { std::cerr << "Metrics export failed: " << e.what() << "\n"; }
+}
+
+void MetricsExporter::dump() {
+    if (options_.format == MetricsOptions::Format::JsonLines) {
+        std::ofstream out(options_.path, std::ios::app);
+        out << metrics_.jsonLine() << "\n";
+        if (!out.flush()) throw std::runtime_error("Failed to append metrics to " + options_.path);
+        return;
+    }
+    std::string tmp = options_.path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << metrics_.prometheus();
+        if (!out.flush()) throw std::runtime_error("Failed to write metrics to " + tmp);
+    }
+    if (std::rename(tmp.c_str(), options_.path.c_str()) != 0) {
+        throw std::runtime_error("Failed to replace " + options_.path);
+    }
+}
+
+std::unique_ptr<MetricsExporter> MetricsExporter::start(const MetricsOptions& options) {
+    if (options.path.empty()) return nullptr;
+    return std::make_unique<MetricsExporter>(options);
+}
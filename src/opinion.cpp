@@ -1,4 +1,6 @@
 #include "opinion.h"
+#include "input_stream.h"
+#include "metrics.h"
 
 #include <algorithm>
 #include <cctype>
@@ -77,7 +79,7 @@ void OpinionReader::parseHeader(const std::string& header_line) {
     }
 }
 
-std::optional<std::string> OpinionReader::getColumn(const std::vector<std::string>& cols, const std::string& name) {
+std::optional<std::string> OpinionReader::getColumn(const std::vector<std::string>& cols, const std::string& name) const {
     auto it = column_map_.find(name);
     if (it == column_map_.end()) return std::nullopt;
     size_t idx = it->second;
@@ -86,7 +88,7 @@ std::optional<std::string> OpinionReader::getColumn(const std::vector<std::strin
 }
 
 // Helper: does substring starting at start look like a timestamp (YYYY-MM-DD ...)?
-static bool looksLikeTimestamp(const std::string& s, size_t start, size_t end) {
+static bool looksLikeTimestamp(const char* s, size_t start, size_t end) {
     // Find end of field (comma or end)
     size_t field_end = start;
     while (field_end < end && s[field_end] != '\n' && s[field_end] != ',') field_end++;
@@ -103,103 +105,62 @@ static bool looksLikeTimestamp(const std::string& s, size_t start, size_t end) {
     return true;
 }
 
-void OpinionReader::initStream() {
-    if (streamed_initialized_) return;
-    file_stream_ = std::ifstream(filename_, std::ios::binary);
-    if (!file_stream_) throw std::runtime_error("Could not open file: " + filename_);
-    std::string header_line;
-    std::getline(file_stream_, header_line);
-    parseHeader(header_line);
-    leftover_.clear();
-    eof_ = false;
-    streamed_initialized_ = true;
-}
-
-bool OpinionReader::readNextBatch(std::vector<std::string>& outRecords, size_t max_records, size_t chunk_bytes) {
-    if (!streamed_initialized_) initStream();
-    outRecords.clear();
-    outRecords.reserve(max_records);
-    if (eof_) return false;
-
-    std::vector<size_t> delimiter_positions;
-    delimiter_positions.reserve(2048);
-
-    // Quote balance tracking to avoid splitting inside quoted fields
-    while (outRecords.size() < max_records && !file_stream_.eof()) {
-        std::vector<char> buffer(chunk_bytes);
-        file_stream_.read(buffer.data(), chunk_bytes);
-        size_t bytes_read = file_stream_.gcount();
-        if (bytes_read == 0) { eof_ = true; break; }
-
-        std::string chunk = leftover_ + std::string(buffer.data(), bytes_read);
-        delimiter_positions.clear();
-        delimiter_positions.push_back(0);
-
-        bool in_quotes = false;
-        for (size_t i = 0; i < chunk.size(); ++i) {
-            char c = chunk[i];
-            if (c == '"') {
-                // Handle doubled quotes
-                if (in_quotes && i + 1 < chunk.size() && chunk[i + 1] == '"') { i++; continue; }
-                in_quotes = !in_quotes;
-            }
-            if (c != '\n' || in_quotes) continue;
-
-            size_t pos = i + 1; // candidate record start
-            if (pos >= chunk.size()) continue;
+bool OpinionReader::isRecordStart(const char* chunk, size_t size, size_t pos) {
+    // Skip optional CR and whitespace
+    while (pos < size && (chunk[pos] == '\r' || chunk[pos] == ' ' || chunk[pos] == '\t')) pos++;
+
+    // ID may be quoted or unquoted
+    if (pos < size && chunk[pos] == '"') {
+        pos++;
+        if (pos >= size || !std::isdigit((unsigned char)chunk[pos])) return false;
+        while (pos < size && std::isdigit((unsigned char)chunk[pos])) pos++;
+        if (pos >= size || chunk[pos] != '"') return false; // need closing quote
+        pos++;
+    } else {
+        if (pos >= size || !std::isdigit((unsigned char)chunk[pos])) return false;
+        while (pos < size && std::isdigit((unsigned char)chunk[pos])) pos++;
+    }
 
-            // Skip optional CR and whitespace
-            while (pos < chunk.size() && (chunk[pos] == '\r' || chunk[pos] == ' ' || chunk[pos] == '\t')) pos++;
+    // Skip optional whitespace before comma
+    while (pos < size && (chunk[pos] == ' ' || chunk[pos] == '\t')) pos++;
+    if (pos >= size || chunk[pos] != ',') return false;
+    pos++; // start of date_created field
 
-            // ID may be quoted or unquoted
-            if (pos < chunk.size() && chunk[pos] == '"') {
-                pos++;
-                if (pos >= chunk.size() || !std::isdigit((unsigned char)chunk[pos])) continue;
-                while (pos < chunk.size() && std::isdigit((unsigned char)chunk[pos])) pos++;
-                if (pos >= chunk.size() || chunk[pos] != '"') continue; // need closing quote
-                pos++;
-            } else {
-                if (pos >= chunk.size() || !std::isdigit((unsigned char)chunk[pos])) continue;
-                while (pos < chunk.size() && std::isdigit((unsigned char)chunk[pos])) pos++;
-            }
+    // Skip an optional opening quote on the timestamp and whitespace
+    while (pos < size && (chunk[pos] == '"' || chunk[pos] == ' ' || chunk[pos] == '\t')) pos++;
 
-            // Skip optional whitespace before comma
-            while (pos < chunk.size() && (chunk[pos] == ' ' || chunk[pos] == '\t')) pos++;
-            if (pos >= chunk.size() || chunk[pos] != ',') continue;
-            pos++; // start of date_created field
-
-            // Skip an optional opening quote on the timestamp and whitespace
-            while (pos < chunk.size() && (chunk[pos] == '"' || chunk[pos] == ' ' || chunk[pos] == '\t')) pos++;
+    return looksLikeTimestamp(chunk, pos, size);
+}
 
-            if (looksLikeTimestamp(chunk, pos, chunk.size())) {
-                delimiter_positions.push_back(i + 1);
-            }
-        }
+void OpinionReader::initStream() {
+    if (scanner_) return;
+    scanner_ = std::make_unique<RecordScanner>(filename_, &OpinionReader::isRecordStart, true);
+    parseHeader(std::string(scanner_->header()));
+}
 
-        // Slice out records
-        for (size_t j = 0; j + 1 < delimiter_positions.size() && outRecords.size() < max_records; ++j) {
-            size_t rec_start = delimiter_positions[j];
-            size_t rec_end = delimiter_positions[j + 1];
-            if (rec_start < rec_end && rec_end <= chunk.size()) {
-                std::string record = chunk.substr(rec_start, rec_end - rec_start);
-                if (!record.empty() && record.back() == '\n') record.pop_back();
-                if (!record.empty()) outRecords.push_back(std::move(record));
-            }
-        }
+bool OpinionReader::readNextBatch(std::vector<std::string_view>& outRecords, size_t max_records) {
+    if (!scanner_) initStream();
+    StageTimer timer("read", "search_opinion");
+    size_t start = scanner_->offset();
+    bool more = scanner_->nextBatch(outRecords, max_records);
+    Metrics::global().add("records_read", "search_opinion", outRecords.size());
+    Metrics::global().add("bytes_read", "search_opinion", scanner_->offset() - start);
+    return more;
+}
 
-        // Prepare leftover
-        if (delimiter_positions.size() >= 2) {
-            size_t last_delim = delimiter_positions.back();
-            if (last_delim < chunk.size()) leftover_ = chunk.substr(last_delim); else leftover_.clear();
-        } else {
-            leftover_ = std::move(chunk);
-        }
+size_t OpinionReader::buildRecordIndex(ThreadPool& pool) {
+    if (!scanner_) initStream();
+    return scanner_->buildIndex(pool);
+}
 
-        if (outRecords.size() >= max_records) break;
-    }
+void OpinionReader::setReleaseLag(size_t batches) {
+    if (!scanner_) initStream();
+    scanner_->setReleaseLag(batches);
+}
 
-    if (file_stream_.eof()) eof_ = true;
-    return !outRecords.empty();
+void OpinionReader::seek(size_t offset) {
+    if (!scanner_) initStream();
+    scanner_->seek(offset);
 }
 
 // Safe parsing with defaults (mirrors helpers in opinion_cluster.cpp)
@@ -224,7 +185,7 @@ static inline bool parse_bool_safe(const string& s, bool default_val = false) {
     }
 }
 
-bool OpinionReader::isValidRow(const vector<string>& cols) {
+bool OpinionReader::isValidRow(const vector<string>& cols) const {
     // Must have at least 2 columns
     if (cols.size() < 2) return false;
 
@@ -245,7 +206,7 @@ bool OpinionReader::isValidRow(const vector<string>& cols) {
 }
 
 // RFC-4180-ish CSV splitter with lenient handling of malformed quotes and backslash escapes.
-vector<string> OpinionReader::splitCsvLine(const string& line) {
+vector<string> OpinionReader::splitCsvLine(std::string_view line) const {
     vector<string> out;
     string field;
     bool in_quotes = false;
@@ -286,7 +247,7 @@ vector<string> OpinionReader::splitCsvLine(const string& line) {
     return out;
 }
 
-Opinion OpinionReader::parseCsvLine(const string& line) {
+Opinion OpinionReader::parseCsvLine(std::string_view line) const {
     auto cols = splitCsvLine(line);
     
     // Helper to safely get column value with default
@@ -334,7 +295,7 @@ Opinion OpinionReader::parseCsvLine(const string& line) {
 }
 
 vector<Opinion> OpinionReader::readOpinions(size_t max_lines) {
-    std::ifstream in(filename_);
+    InputStream in(filename_);
     if (!in) {
         throw std::runtime_error("Failed to open file: " + filename_);
     }
@@ -408,30 +369,8 @@ vector<Opinion> OpinionReader::readOpinions(size_t max_lines) {
     return result;
 }
 
-// Helper: check if a string looks like a timestamp at given position
-// Expected pattern: YYYY-MM-DD HH:MM:SS... (at least 10 chars for date part)
-static bool looksLikeTimestamp(const string& buffer, size_t pos, size_t& timestamp_end) {
-    if (pos >= buffer.size() || buffer.size() - pos < 10) return false;
-    
-    // Check for pattern: digit{4}-digit{2}-digit{2}
-    if (!std::isdigit(buffer[pos]) || !std::isdigit(buffer[pos+1]) || 
-        !std::isdigit(buffer[pos+2]) || !std::isdigit(buffer[pos+3])) return false;
-    if (buffer[pos+4] != '-') return false;
-    if (!std::isdigit(buffer[pos+5]) || !std::isdigit(buffer[pos+6])) return false;
-    if (buffer[pos+7] != '-') return false;
-    if (!std::isdigit(buffer[pos+8]) || !std::isdigit(buffer[pos+9])) return false;
-    
-    // Find the next comma after the timestamp
-    timestamp_end = pos + 10;
-    while (timestamp_end < buffer.size() && buffer[timestamp_end] != ',') {
-        timestamp_end++;
-    }
-    
-    return true;
-}
-
 vector<string> OpinionReader::extractRawRecords(size_t max_records) {
-    std::ifstream in(filename_, std::ios::binary);
+    InputStream in(filename_);
     if (!in) {
         throw std::runtime_error("Failed to open file: " + filename_);
     }
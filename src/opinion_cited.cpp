@@ -1,4 +1,5 @@
 #include "opinion_cited.h"
+#include "metrics.h"
 
 #include <algorithm>
 #include <cctype>
@@ -148,35 +149,32 @@ OpinionCited OpinionCitedReader::parseCsvLine(const string& line) {
     return record;
 }
 
-vector<OpinionCited> OpinionCitedReader::readBatch(size_t batch_size) {
-    vector<OpinionCited> records;
-    records.reserve(batch_size);
+void OpinionCitedReader::ensureHeader() {
+    if (header_parsed_) return;
     
-    // Parse header if not already done
-    if (!header_parsed_) {
-        string header_line;
-        if (!std::getline(file_, header_line)) {
-            throw std::runtime_error("Citation CSV file is empty or missing header");
-        }
-        
-        parseHeader(header_line);
-        
-        // Verify required columns exist
-        if (column_map_.find("id") == column_map_.end() ||
-            column_map_.find("depth") == column_map_.end() ||
-            column_map_.find("cited_opinion_id") == column_map_.end() ||
-            column_map_.find("citing_opinion_id") == column_map_.end()) {
-            throw std::runtime_error("Citation CSV missing required columns");
-        }
-        
-        header_parsed_ = true;
+    string header_line;
+    if (!std::getline(file_, header_line)) {
+        throw std::runtime_error("Citation CSV file is empty or missing header");
     }
     
-    // Read batch_size lines
+    parseHeader(header_line);
+    
+    // Verify required columns exist
+    if (column_map_.find("id") == column_map_.end() ||
+        column_map_.find("depth") == column_map_.end() ||
+        column_map_.find("cited_opinion_id") == column_map_.end() ||
+        column_map_.find("citing_opinion_id") == column_map_.end()) {
+        throw std::runtime_error("Citation CSV missing required columns");
+    }
+    
+    header_parsed_ = true;
+}
+
+bool OpinionCitedReader::nextRecord(OpinionCited& record, size_t& bytes) {
     string line;
-    size_t count = 0;
-    while (count < batch_size && std::getline(file_, line)) {
+    while (std::getline(file_, line)) {
         total_lines_read_++;
+        bytes += line.size() + 1;
         
         // Skip empty lines
         if (trim(line).empty()) {
@@ -184,18 +182,54 @@ vector<OpinionCited> OpinionCitedReader::readBatch(size_t batch_size) {
         }
         
         try {
-            records.push_back(parseCsvLine(line));
-            count++;
+            record = parseCsvLine(line);
+            return true;
         } catch (const std::exception& e) {
             std::cerr << "Warning: Failed to parse line " << (total_lines_read_ + 1) 
                       << ": " << e.what() << std::endl;
             // Continue processing other lines
         }
     }
+    return false;
+}
+
+vector<OpinionCited> OpinionCitedReader::readBatch(size_t batch_size) {
+    StageTimer timer("read", "search_opinionscited");
+    size_t bytes = 0;
+    vector<OpinionCited> records;
+    records.reserve(batch_size);
+    
+    ensureHeader();
+    
+    OpinionCited record;
+    while (records.size() < batch_size && nextRecord(record, bytes)) {
+        records.push_back(record);
+    }
     
+    Metrics::global().add("records_read", "search_opinionscited", records.size());
+    Metrics::global().add("bytes_read", "search_opinionscited", bytes);
     return records;
 }
 
+size_t OpinionCitedReader::readBatch(Int32Batch& batch, size_t batch_size) {
+    StageTimer timer("read", "search_opinionscited");
+    size_t bytes = 0;
+    if (batch.columnCount() != OpinionCited::kColumnCount) batch = Int32Batch(OpinionCited::kColumnCount);
+    batch.clear();
+    batch.reserve(batch_size);
+    
+    ensureHeader();
+    
+    OpinionCited record;
+    while (batch.size() < batch_size && nextRecord(record, bytes)) {
+        record.appendTo(batch);
+    }
+    
+    Metrics::global().add("records_read", "search_opinionscited", batch.size());
+    Metrics::global().add("bytes_read", "search_opinionscited", bytes);
+    return batch.size();
+}
+
 vector<OpinionCited> OpinionCitedReader::readAll() {
     vector<OpinionCited> records;
     
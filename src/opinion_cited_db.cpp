@@ -1,7 +1,68 @@
 #include "opinion_cited_db.h"
+#include "id_cache.h"
+#include "metrics.h"
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
+static const char* kCitedUpsertSql =
+    "INSERT INTO search_opinionscited (id, depth, cited_opinion_id, citing_opinion_id) "
+    "VALUES ($1, $2, $3, $4) ON CONFLICT (id) DO UPDATE SET depth = EXCLUDED.depth";
+
+// Placeholder cluster (id=1) referenced by every placeholder opinion, with all
+// NOT NULL fields of search_opinioncluster
+static const char* kEnsureClusterSql =
+    "INSERT INTO search_opinioncluster ("
+    "id, date_created, date_modified, judges, date_filed, "
+    "case_name_short, case_name, case_name_full, scdb_id, source, "
+    "procedural_history, attorneys, nature_of_suit, posture, syllabus, "
+    "citation_count, precedential_status, blocked, docket_id, "
+    "date_filed_is_approximate, correction, cross_reference, disposition, "
+    "filepath_json_harvard, headnotes, history, other_dates, summary, "
+    "arguments, headmatter, filepath_pdf_harvard"
+    ") VALUES ("
+    "1, NOW(), NOW(), '', '0001-01-01', "
+    "'Placeholder', 'Placeholder Case', 'Placeholder Case', '', 'C', "
+    "'', '', '', '', '', "
+    "0, 'Published', false, 1, "
+    "false, '', '', '', "
+    "'', '', '', '', '', "
+    "'', '', ''"
+    ") ON CONFLICT (id) DO NOTHING";
+
+// Minimal placeholder opinion; type '010' is Combined Opinion and sha1 must be unique
+static const char* kPlaceholderOpinionSql =
+    "INSERT INTO search_opinion ("
+    "id, date_created, date_modified, type, sha1, "
+    "download_url, local_path, plain_text, html, html_lawbox, "
+    "html_columbia, html_with_citations, extracted_by_ocr, "
+    "cluster_id, per_curiam, author_str, joined_by_str, "
+    "xml_harvard, html_anon_2020"
+    ") VALUES ("
+    "$1, NOW(), NOW(), '010', 'PLACEHOLDER_' || $1::text, "
+    "'', '', '', '', '', "
+    "'', '', false, "
+    "1, false, '', '', "
+    "'', ''"
+    ") ON CONFLICT (id) DO NOTHING";
+
+// Same placeholder for every id in the int[] parameter, in one statement
+static const char* kPlaceholderOpinionsSql =
+    "INSERT INTO search_opinion ("
+    "id, date_created, date_modified, type, sha1, "
+    "download_url, local_path, plain_text, html, html_lawbox, "
+    "html_columbia, html_with_citations, extracted_by_ocr, "
+    "cluster_id, per_curiam, author_str, joined_by_str, "
+    "xml_harvard, html_anon_2020"
+    ") SELECT "
+    "id, NOW(), NOW(), '010', 'PLACEHOLDER_' || id::text, "
+    "'', '', '', '', '', "
+    "'', '', false, "
+    "1, false, '', '', "
+    "'', '' "
+    "FROM unnest($1::int[]) AS t(id) "
+    "ON CONFLICT (id) DO NOTHING";
+
 OpinionCitedDatabase::OpinionCitedDatabase(
     const std::string& host, int port,
     const std::string& dbname, const std::string& user,
@@ -14,12 +75,13 @@ OpinionCitedDatabase::OpinionCitedDatabase(
         << " user=" << user
         << " password=" << password;
     connection_string_ = oss.str();
+    pool_ = ConnectionPool::shared(connection_string_);
 }
 
 bool OpinionCitedDatabase::testConnection() {
     try {
-        pqxx::connection conn(connection_string_);
-        return conn.is_open();
+        auto conn = pool_->acquire();
+        return conn->is_open();
     } catch (const std::exception& e) {
         std::cerr << "Connection test failed: " << e.what() << std::endl;
         return false;
@@ -30,21 +92,16 @@ void OpinionCitedDatabase::loadValidOpinionIds() {
     valid_opinion_ids_.clear();
     
     try {
-        pqxx::connection conn(connection_string_);
-        pqxx::work txn(conn);
-        
-        std::string query = "SELECT id FROM search_opinion";
-        pqxx::result res = txn.exec(query);
+        auto conn = pool_->acquire();
+        pqxx::work txn(*conn);
         
-        for (const auto& row : res) {
-            int opinion_id = row[0].as<int>();
-            valid_opinion_ids_.insert(opinion_id);
-        }
+        size_t fetched = loadIdCache(txn, "search_opinion", valid_opinion_ids_, id_snapshot_dir_, verify_id_cache_);
         
         txn.commit();
+        valid_ids_loaded_ = true;
         
         std::cout << "Loaded " << valid_opinion_ids_.size() 
-                  << " valid opinion IDs from database\n";
+                  << " valid opinion IDs (" << fetched << " read from database)\n";
                   
     } catch (const std::exception& e) {
         std::cerr << "Failed to load valid opinion IDs: " << e.what() << std::endl;
@@ -52,57 +109,42 @@ void OpinionCitedDatabase::loadValidOpinionIds() {
     }
 }
 
+void OpinionCitedDatabase::prepareStatements(pqxx::connection& conn) {
+    pool_->prepare(conn, "cited_upsert", kCitedUpsertSql);
+    pool_->prepare(conn, "cited_ensure_cluster", kEnsureClusterSql);
+    pool_->prepare(conn, "cited_placeholder_opinion", kPlaceholderOpinionSql);
+    pool_->prepare(conn, "cited_placeholder_opinions", kPlaceholderOpinionsSql);
+}
+
 bool OpinionCitedDatabase::isValidOpinionId(int opinion_id) const {
-    return valid_opinion_ids_.find(opinion_id) != valid_opinion_ids_.end();
+    return valid_opinion_ids_.contains(opinion_id);
 }
 
 bool OpinionCitedDatabase::createPlaceholderOpinion(int opinion_id) {
     try {
-        pqxx::connection conn(connection_string_);
+        auto conn = pool_->acquire();
+        prepareStatements(*conn);
+        return createPlaceholderOpinion(*conn, opinion_id);
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to create placeholder opinion for id=" << opinion_id
+                  << ": " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool OpinionCitedDatabase::createPlaceholderOpinion(pqxx::connection& conn, int opinion_id) {
+    StageTimer timer("placeholder", "search_opinionscited");
+    try {
         pqxx::work txn(conn);
         
-        // First ensure we have a placeholder cluster (id=1) that we can reference
-        // This is needed because cluster_id is NOT NULL in search_opinion
-        std::string ensure_cluster = 
-            "INSERT INTO search_opinioncluster ("
-            "id, date_created, date_modified, judges, date_filed, "
-            "case_name_short, case_name, case_name_full, scdb_id, source, "
-            "procedural_history, attorneys, nature_of_suit, posture, syllabus, "
-            "citation_count, precedential_status, blocked, docket_id, "
-            "date_filed_is_approximate, correction, cross_reference, disposition, "
-            "filepath_json_harvard, headnotes, history, other_dates, summary, "
-            "arguments, headmatter, filepath_pdf_harvard"
-            ") VALUES ("
-            "1, NOW(), NOW(), '', '0001-01-01', "
-            "'Placeholder', 'Placeholder Case', 'Placeholder Case', '', 'C', "
-            "'', '', '', '', '', "
-            "0, 'Published', false, 1, "
-            "false, '', '', '', "
-            "'', '', '', '', '', "
-            "'', '', ''"
-            ") ON CONFLICT (id) DO NOTHING";
-        txn.exec(ensure_cluster);
+        // First ensure the placeholder cluster (id=1) exists; cluster_id is NOT NULL
+        // in search_opinion, so every placeholder opinion references it
+        txn.exec_prepared("cited_ensure_cluster");
         
         // Create minimal placeholder with all required NOT NULL fields for search_opinion
-        std::ostringstream query;
-        query << "INSERT INTO search_opinion ("
-              << "id, date_created, date_modified, type, sha1, "
-              << "download_url, local_path, plain_text, html, html_lawbox, "
-              << "html_columbia, html_with_citations, extracted_by_ocr, "
-              << "cluster_id, per_curiam, author_str, joined_by_str, "
-              << "xml_harvard, html_anon_2020"
-              << ") VALUES ("
-              << opinion_id << ", "
-              << "NOW(), NOW(), '010', "  // type = '010' for Combined Opinion
-              << "'PLACEHOLDER_" << opinion_id << "', "  // sha1 must be unique
-              << "'', '', '', '', '', "  // download_url, local_path, plain_text, html, html_lawbox
-              << "'', '', false, "  // html_columbia, html_with_citations, extracted_by_ocr
-              << "1, false, '', '', "  // cluster_id (references placeholder), per_curiam, author_str, joined_by_str
-              << "'', ''"  // xml_harvard, html_anon_2020
-              << ") ON CONFLICT (id) DO NOTHING";
-        
-        pqxx::result res = txn.exec(query.str());
+        txn.exec_prepared("cited_placeholder_opinion", opinion_id);
         txn.commit();
+        Metrics::global().add("placeholders_created", "search_opinionscited", 1);
         
         // Add to valid opinion IDs cache
         valid_opinion_ids_.insert(opinion_id);
@@ -117,37 +159,94 @@ bool OpinionCitedDatabase::createPlaceholderOpinion(int opinion_id) {
     }
 }
 
+void OpinionCitedDatabase::createPlaceholderOpinions(pqxx::connection& conn, const std::vector<int>& opinion_ids) {
+    // int[] literal for unnest(); ids are plain integers, so no quoting is needed
+    std::string ids = "{";
+    for (size_t i = 0; i < opinion_ids.size(); ++i) {
+        if (i > 0) ids += ',';
+        ids += std::to_string(opinion_ids[i]);
+    }
+    ids += '}';
+    
+    StageTimer timer("placeholder", "search_opinionscited");
+    pqxx::work txn(conn);
+    txn.exec_prepared("cited_ensure_cluster");
+    txn.exec_prepared("cited_placeholder_opinions", ids);
+    txn.commit();
+    Metrics::global().add("placeholders_created", "search_opinionscited", opinion_ids.size());
+    
+    valid_opinion_ids_.insert(opinion_ids.begin(), opinion_ids.end());
+    std::cout << "Created " << opinion_ids.size() << " placeholder opinions for missing FK ids" << std::endl;
+}
+
 size_t OpinionCitedDatabase::insertCitations(
-    const std::vector<OpinionCited>& records,
-    std::vector<OpinionCited>& rejected_records,
+    const Int32Batch& records,
+    Int32Batch& rejected_records,
     std::vector<std::string>& rejection_reasons) {
     
     rejected_records.clear();
     rejection_reasons.clear();
     
     size_t inserted = 0;
+    StageTimer timer("insert", "search_opinionscited");
     
     // Insert records line by line and collect failures
     try {
-        pqxx::connection conn(connection_string_);
+        auto conn = pool_->acquire();
+        prepareStatements(*conn);
         
-        for (const auto& record : records) {
+        // Resolve the batch against the ID cache up front so the inserts below should
+        // not hit FK errors; the per-row recovery stays as a safety net
+        if (valid_ids_loaded_ && !records.empty()) {
+            const auto& cited = records.column(OpinionCited::kCitedOpinionId);
+            const auto& citing = records.column(OpinionCited::kCitingOpinionId);
+            if (!valid_opinion_ids_.containsAll(cited) || !valid_opinion_ids_.containsAll(citing)) {
+                std::vector<int> missing;
+                valid_opinion_ids_.collectMissing(cited, missing);
+                valid_opinion_ids_.collectMissing(citing, missing);
+                std::sort(missing.begin(), missing.end());
+                missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+                try {
+                    createPlaceholderOpinions(*conn, missing);
+                } catch (const std::exception& e) {
+                    std::cerr << "Batch placeholder creation failed, falling back to per-row recovery: "
+                              << e.what() << std::endl;
+                }
+            }
+        }
+        
+        if (pipeline_window_ > 0) {
+            // Upserts go out pipelined on the raw connection; only rows that failed
+            // take the placeholder/retry path on the pooled one
+            std::vector<std::vector<std::string>> rows;
+            rows.reserve(records.size());
+            for (size_t i = 0; i < records.size(); ++i) {
+                rows.push_back({std::to_string(records.at(i, OpinionCited::kId)),
+                                std::to_string(records.at(i, OpinionCited::kDepth)),
+                                std::to_string(records.at(i, OpinionCited::kCitedOpinionId)),
+                                std::to_string(records.at(i, OpinionCited::kCitingOpinionId))});
+            }
+            auto results = pipelineConnection().execPipelined("cited_upsert", rows, pipeline_window_);
+            for (size_t i = 0; i < records.size(); ++i) {
+                if (results[i].ok || recoverFailedRow(*conn, OpinionCited::fromBatch(records, i), results[i].error,
+                                                      rejected_records, rejection_reasons)) {
+                    inserted++;
+                }
+            }
+            Metrics::global().add("records_inserted", "search_opinionscited", inserted);
+            Metrics::global().add("records_rejected", "search_opinionscited", rejected_records.size());
+            return inserted;
+        }
+        
+        for (size_t i = 0; i < records.size(); ++i) {
+            OpinionCited record = OpinionCited::fromBatch(records, i);
             try {
                 // Start a new transaction for each record
-                pqxx::work txn(conn);
-                
-                // Build insert query with upsert to handle duplicates
-                std::ostringstream query;
-                query << "INSERT INTO search_opinionscited "
-                      << "(id, depth, cited_opinion_id, citing_opinion_id) VALUES ("
-                      << record.id << ", "
-                      << record.depth << ", "
-                      << record.cited_opinion_id << ", "
-                      << record.citing_opinion_id
-                      << ") ON CONFLICT (id) "
-                      << "DO UPDATE SET depth = EXCLUDED.depth";
+                pqxx::work txn(*conn);
                 
-                pqxx::result res = txn.exec(query.str());
+                // Upsert to handle duplicates
+                txn.exec_prepared("cited_upsert", record.id, record.depth,
+                                  record.cited_opinion_id, record.citing_opinion_id);
                 txn.commit();
                 
                 // Successfully inserted
@@ -155,103 +254,86 @@ size_t OpinionCitedDatabase::insertCitations(
                 
             } catch (const std::exception& e) {
                 // Individual record insertion failed - PostgreSQL will tell us why
-                std::string error_msg = e.what();
-                
-                // Check if it's an FK violation on cited_opinion_id or citing_opinion_id
-                if (error_msg.find("foreign key") != std::string::npos || 
-                    error_msg.find("violates foreign key constraint") != std::string::npos) {
-                    
-                    bool needs_retry = false;
-                    
-                    // Check for cited_opinion_id FK violation
-                    if (error_msg.find("cited_opinion_id") != std::string::npos) {
-                        std::cout << "FK violation detected for cited_opinion_id=" << record.cited_opinion_id 
-                                  << ", creating placeholder..." << std::endl;
-                        if (createPlaceholderOpinion(record.cited_opinion_id)) {
-                            needs_retry = true;
-                        }
-                    }
-                    
-                    // Check for citing_opinion_id FK violation
-                    if (error_msg.find("citing_opinion_id") != std::string::npos) {
-                        std::cout << "FK violation detected for citing_opinion_id=" << record.citing_opinion_id 
-                                  << ", creating placeholder..." << std::endl;
-                        if (createPlaceholderOpinion(record.citing_opinion_id)) {
-                            needs_retry = true;
-                        }
-                    }
-                    
-                    // Retry if we created any placeholders
-                    if (needs_retry) {
-                        try {
-                            pqxx::work retry_txn(conn);
-                            std::ostringstream retry_query;
-                            retry_query << "INSERT INTO search_opinionscited "
-                                       << "(id, depth, cited_opinion_id, citing_opinion_id) VALUES ("
-                                       << record.id << ", "
-                                       << record.depth << ", "
-                                       << record.cited_opinion_id << ", "
-                                       << record.citing_opinion_id
-                                       << ") ON CONFLICT (id) "
-                                       << "DO UPDATE SET depth = EXCLUDED.depth";
-                            
-                            retry_txn.exec(retry_query.str());
-                            retry_txn.commit();
-                            
-                            inserted++;
-                            std::cout << "Successfully inserted after creating placeholder(s)" << std::endl;
-                            continue; // Success - move to next record
-                            
-                        } catch (const std::exception& retry_e) {
-                            // Retry also failed
-                            std::string retry_error = retry_e.what();
-                            std::cerr << "REJECTED: Record " << record.toString() 
-                                      << "\n  Retry failed after creating placeholder: " << retry_error << std::endl;
-                            rejected_records.push_back(record);
-                            std::ostringstream reason;
-                            reason << "FK violation, placeholder created but retry failed: " << retry_error;
-                            rejection_reasons.push_back(reason.str());
-                        }
-                    } else {
-                        // Failed to create placeholder
-                        std::cerr << "REJECTED: Record " << record.toString() 
-                                  << "\n  Failed to create placeholder: " << error_msg << std::endl;
-                        rejected_records.push_back(record);
-                        std::ostringstream reason;
-                        reason << "FK violation, failed to create placeholder: " << error_msg;
-                        rejection_reasons.push_back(reason.str());
-                    }
-                } else {
-                    // Other types of errors - print to stderr for visibility
-                    std::cerr << "REJECTED: Record " << record.toString() 
-                              << "\n  PostgreSQL error: " << error_msg << std::endl;
-                    rejected_records.push_back(record);
-                    std::ostringstream reason;
-                    
-                    if (error_msg.find("duplicate key") != std::string::npos) {
-                        reason << "Duplicate key violation: " << error_msg;
-                    } else {
-                        reason << "DB error: " << error_msg;
-                    }
-                    
-                    rejection_reasons.push_back(reason.str());
+                if (recoverFailedRow(*conn, record, pgError(e), rejected_records, rejection_reasons)) {
+                    inserted++;
                 }
             }
         }
         
     } catch (const std::exception& e) {
         std::cerr << "Database connection failed: " << e.what() << std::endl;
+        pipeline_conn_.reset(); // pipeline state is unknown after a failure; reconnect next batch
         
         // Connection failed - reject all remaining records
-        for (const auto& record : records) {
-            rejected_records.push_back(record);
-            std::ostringstream reason;
-            reason << "Connection error: " << e.what();
-            rejection_reasons.push_back(reason.str());
+        rejected_records.append(records);
+        std::ostringstream reason;
+        reason << "Connection error: " << e.what();
+        rejection_reasons.resize(rejected_records.size(), reason.str());
+    }
+    
+    Metrics::global().add("records_inserted", "search_opinionscited", inserted);
+    Metrics::global().add("records_rejected", "search_opinionscited", rejected_records.size());
+    return inserted;
+}
+
+bool OpinionCitedDatabase::recoverFailedRow(pqxx::connection& conn, const OpinionCited& record,
+                                            const PgError& error,
+                                            Int32Batch& rejected_records,
+                                            std::vector<std::string>& rejection_reasons) {
+    if (error.kind == PgErrorKind::ForeignKey) {
+        // Both FKs reference search_opinion. Ids the cache already knows are fine; without
+        // a cache both get a placeholder (ON CONFLICT DO NOTHING keeps existing rows as they are)
+        bool needs_retry = false;
+        for (int opinion_id : {record.cited_opinion_id, record.citing_opinion_id}) {
+            if (valid_ids_loaded_ && valid_opinion_ids_.contains(opinion_id)) continue;
+            std::cout << "FK violation detected for opinion_id=" << opinion_id
+                      << ", creating placeholder..." << std::endl;
+            if (createPlaceholderOpinion(conn, opinion_id)) needs_retry = true;
         }
         
-        return inserted;
+        // Retry if we created any placeholders
+        if (needs_retry) {
+            try {
+                pqxx::work retry_txn(conn);
+                retry_txn.exec_prepared("cited_upsert", record.id, record.depth,
+                                        record.cited_opinion_id, record.citing_opinion_id);
+                retry_txn.commit();
+                
+                std::cout << "Successfully inserted after creating placeholder(s)" << std::endl;
+                return true;
+                
+            } catch (const std::exception& retry_e) {
+                // Retry also failed
+                PgError retry_error = pgError(retry_e);
+                std::cerr << "REJECTED: Record " << record.toString() 
+                          << "\n  Retry failed after creating placeholder: " << retry_error.message << std::endl;
+                record.appendTo(rejected_records);
+                rejection_reasons.push_back("FK violation, placeholder created but retry failed: " +
+                                            retry_error.describe());
+            }
+        } else {
+            // Failed to create placeholder
+            std::cerr << "REJECTED: Record " << record.toString() 
+                      << "\n  Failed to create placeholder: " << error.message << std::endl;
+            record.appendTo(rejected_records);
+            rejection_reasons.push_back("FK violation, failed to create placeholder: " + error.describe());
+        }
+    } else {
+        // Other types of errors - print to stderr for visibility
+        std::cerr << "REJECTED: Record " << record.toString() 
+                  << "\n  PostgreSQL error: " << error.message << std::endl;
+        record.appendTo(rejected_records);
+        rejection_reasons.push_back((error.kind == PgErrorKind::Unique ? "Duplicate key violation: " : "DB error: ") +
+                                    error.describe());
     }
     
-    return inserted;
+    return false;
+}
+
+PgRawConnection& OpinionCitedDatabase::pipelineConnection() {
+    if (!pipeline_conn_ || !pipeline_conn_->isOpen()) {
+        pipeline_conn_ = std::make_unique<PgRawConnection>(connection_string_);
+        pipeline_conn_->prepare("cited_upsert", kCitedUpsertSql);
+    }
+    return *pipeline_conn_;
 }
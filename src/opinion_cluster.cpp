@@ -1,4 +1,6 @@
 #include "opinion_cluster.h"
+#include "input_stream.h"
+#include "metrics.h"
 
 #include <algorithm>
 #include <cctype>
@@ -64,6 +66,39 @@ static inline bool parse_bool_safe(const string& s, bool default_val = false) {
     }
 }
 
+// Quoted CSV field; a missing optional is an empty unquoted field
+static string csv_field(const optional<string>& value) {
+    if (!value) return "";
+    string out = "\"";
+    for (char c : *value) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    return out + "\"";
+}
+
+static string csv_field(const optional<int>& value) {
+    return value ? std::to_string(*value) : "";
+}
+
+string OpinionCluster::toCsv() const {
+    std::ostringstream oss;
+    oss << id << "," << csv_field(judges) << "," << date_created << "," << date_modified << ","
+        << date_filed << "," << csv_field(slug) << "," << csv_field(case_name_short) << ","
+        << csv_field(case_name) << "," << csv_field(case_name_full) << "," << csv_field(scdb_id) << ","
+        << csv_field(source) << "," << csv_field(procedural_history) << "," << csv_field(attorneys) << ","
+        << csv_field(nature_of_suit) << "," << csv_field(posture) << "," << csv_field(syllabus) << ","
+        << citation_count << "," << csv_field(precedential_status) << "," << date_blocked.value_or("") << ","
+        << (blocked ? "t" : "f") << "," << docket_id << "," << csv_field(scdb_decision_direction) << ","
+        << csv_field(scdb_votes_majority) << "," << csv_field(scdb_votes_minority) << ","
+        << (date_filed_is_approximate ? "t" : "f") << "," << csv_field(correction) << ","
+        << csv_field(cross_reference) << "," << csv_field(disposition) << ","
+        << csv_field(filepath_json_harvard) << "," << csv_field(headnotes) << "," << csv_field(history) << ","
+        << csv_field(other_dates) << "," << csv_field(summary) << "," << csv_field(arguments) << ","
+        << csv_field(headmatter) << "," << csv_field(filepath_pdf_harvard);
+    return oss.str();
+}
+
 string OpinionCluster::toString() const {
     std::ostringstream oss;
     oss << "OpinionCluster{";
@@ -88,7 +123,7 @@ void OpinionClusterReader::parseHeader(const string& header_line) {
     }
 }
 
-optional<string> OpinionClusterReader::getColumn(const vector<string>& cols, const string& name) {
+optional<string> OpinionClusterReader::getColumn(const vector<string>& cols, const string& name) const {
     auto it = column_map_.find(name);
     if (it == column_map_.end()) return std::nullopt;
     size_t idx = it->second;
@@ -96,14 +131,14 @@ optional<string> OpinionClusterReader::getColumn(const vector<string>& cols, con
     return cols[idx];
 }
 
-bool OpinionClusterReader::isValidRow(const vector<string>& cols) {
+bool OpinionClusterReader::isValidRow(const vector<string>& cols) const {
     // We need at least the key columns: id (1), date_created (3), date_modified (4), date_filed (5), docket_id (21)
     // If we have at least 21 columns, we can extract the critical keys
     return cols.size() >= 21;
 }
 
 // RFC 4180-style CSV parsing with lenient quote handling
-vector<string> OpinionClusterReader::splitCsvLine(const string& line) {
+vector<string> OpinionClusterReader::splitCsvLine(std::string_view line) const {
     vector<string> result;
     bool in_quotes = false;
     string current;
@@ -147,7 +182,7 @@ vector<string> OpinionClusterReader::splitCsvLine(const string& line) {
     return result;
 }
 
-OpinionCluster OpinionClusterReader::parseCsvLine(const string& line) {
+OpinionCluster OpinionClusterReader::parseCsvLine(std::string_view line) const {
     auto cols = splitCsvLine(line);
     
     if (!isValidRow(cols)) {
@@ -236,7 +271,7 @@ OpinionCluster OpinionClusterReader::parseCsvLine(const string& line) {
 }
 
 // Helper to check if a string looks like a date (YYYY-MM-DD pattern)
-static bool looksLikeDate(const string& s, size_t start, size_t end) {
+static bool looksLikeDate(const char* s, size_t start, size_t end) {
     // Allow for optional leading quote
     if (start < end && s[start] == '"') start++;
     
@@ -260,7 +295,7 @@ static bool looksLikeDate(const string& s, size_t start, size_t end) {
 // Extract raw records using chunked reading with delimiter detection
 // Delimiter: newline + comma + text/null + comma + date
 vector<string> OpinionClusterReader::extractRawRecords(size_t max_records) {
-    std::ifstream file(filename_, std::ios::binary);
+    InputStream file(filename_);
     if (!file) {
         throw std::runtime_error("Could not open file: " + filename_);
     }
@@ -339,7 +374,7 @@ vector<string> OpinionClusterReader::extractRawRecords(size_t max_records) {
             if (pos >= chunk.size()) continue;
 
             // Now at start of date_filed – validate YYYY-MM-DD
-            if (looksLikeDate(chunk, pos, chunk.size())) {
+            if (looksLikeDate(chunk.data(), pos, chunk.size())) {
                 delimiter_positions.push_back(i + 1);
             }
         }
@@ -380,120 +415,83 @@ vector<string> OpinionClusterReader::extractRawRecords(size_t max_records) {
     return records;
 }
 
-void OpinionClusterReader::initStream() {
-    if (streamed_initialized_) return;
-    file_stream_ = std::ifstream(filename_, std::ios::binary);
-    if (!file_stream_) {
-        throw std::runtime_error("Could not open file: " + filename_);
-    }
-    // Read and parse header once
-    string header_line;
-    std::getline(file_stream_, header_line);
-    parseHeader(header_line);
-    leftover_.clear();
-    eof_ = false;
-    streamed_initialized_ = true;
-}
-
-bool OpinionClusterReader::readNextBatch(vector<string>& outRecords, size_t max_records, size_t chunk_bytes) {
-    if (!streamed_initialized_) initStream();
-    outRecords.clear();
-    outRecords.reserve(max_records);
-    if (eof_) return false;
-
-    vector<size_t> delimiter_positions;
-    delimiter_positions.reserve(2048);
-
-    while (outRecords.size() < max_records && !file_stream_.eof()) {
-        vector<char> buffer(chunk_bytes);
-        file_stream_.read(buffer.data(), chunk_bytes);
-        size_t bytes_read = file_stream_.gcount();
-        if (bytes_read == 0) { eof_ = true; break; }
-
-        string chunk = leftover_ + string(buffer.data(), bytes_read);
-        delimiter_positions.clear();
-        delimiter_positions.push_back(0);
-
-        // Find record boundaries using special pattern: \n + ID + , + date_created + , + date_modified
-        // Be tolerant: fields may be quoted or unquoted; date fields may be timestamps.
-        // We'll skip exactly two CSV fields after the ID and check that the next field looks like a date.
-        auto skipCsvField = [&chunk](size_t pos) -> size_t {
-            bool in_quotes = false;
-            while (pos < chunk.size()) {
-                char ch = chunk[pos];
-                if (ch == '"') {
-                    if (in_quotes && pos + 1 < chunk.size() && chunk[pos + 1] == '"') { pos += 2; continue; }
-                    in_quotes = !in_quotes;
-                    pos++;
-                    continue;
-                }
-                if (!in_quotes && ch == ',') { pos++; break; }
-                pos++;
+bool OpinionClusterReader::isRecordStart(const char* chunk, size_t size, size_t pos) {
+    // Find record boundaries using special pattern: \n + ID + , + date_created + , + date_modified
+    // Be tolerant: fields may be quoted or unquoted; date fields may be timestamps.
+    // We'll skip three CSV fields after the ID and check that the next field looks like a date.
+    auto skipCsvField = [chunk, size](size_t p) -> size_t {
+        bool in_quotes = false;
+        while (p < size) {
+            char ch = chunk[p];
+            if (ch == '"') {
+                if (in_quotes && p + 1 < size && chunk[p + 1] == '"') { p += 2; continue; }
+                in_quotes = !in_quotes;
+                p++;
+                continue;
             }
-            return pos;
-        };
-
-        for (size_t i = 0; i < chunk.size(); ++i) {
-            if (chunk[i] != '\n') continue;
+            if (!in_quotes && ch == ',') { p++; break; }
+            p++;
+        }
+        return p;
+    };
 
-            size_t pos = i + 1;
-            if (pos >= chunk.size()) continue;
+    if (pos >= size) return false;
+
+    // ID may be quoted or unquoted
+    if (chunk[pos] == '"') {
+        pos++;
+        if (pos >= size || !std::isdigit(static_cast<unsigned char>(chunk[pos]))) return false;
+        while (pos < size && std::isdigit(static_cast<unsigned char>(chunk[pos]))) pos++;
+        if (pos >= size || chunk[pos] != '"') return false;
+        pos++;
+    } else {
+        if (!std::isdigit(static_cast<unsigned char>(chunk[pos]))) return false;
+        while (pos < size && std::isdigit(static_cast<unsigned char>(chunk[pos]))) pos++;
+    }
 
-            // ID may be quoted or unquoted
-            if (chunk[pos] == '"') {
-                pos++;
-                if (pos >= chunk.size() || !std::isdigit(static_cast<unsigned char>(chunk[pos]))) continue;
-                while (pos < chunk.size() && std::isdigit(static_cast<unsigned char>(chunk[pos]))) pos++;
-                if (pos >= chunk.size() || chunk[pos] != '"') continue;
-                pos++;
-            } else {
-                if (!std::isdigit(static_cast<unsigned char>(chunk[pos]))) continue;
-                while (pos < chunk.size() && std::isdigit(static_cast<unsigned char>(chunk[pos]))) pos++;
-            }
+    if (pos >= size || chunk[pos] != ',') return false;
+    pos++; // at date_created
 
-            if (pos >= chunk.size() || chunk[pos] != ',') continue;
-            pos++; // at date_created
+    // Skip date_created, date_modified, judges (quoted/unquoted/empty)
+    pos = skipCsvField(pos);
+    if (pos >= size) return false;
+    pos = skipCsvField(pos);
+    if (pos >= size) return false;
+    pos = skipCsvField(pos);
+    if (pos >= size) return false;
 
-            // Skip date_created, date_modified, judges (quoted/unquoted/empty)
-            pos = skipCsvField(pos);
-            if (pos >= chunk.size()) continue;
-            pos = skipCsvField(pos);
-            if (pos >= chunk.size()) continue;
-            pos = skipCsvField(pos);
-            if (pos >= chunk.size()) continue;
+    // Now at start of date_filed – validate YYYY-MM-DD
+    return looksLikeDate(chunk, pos, size);
+}
 
-            // Now at start of date_filed – validate YYYY-MM-DD
-            if (looksLikeDate(chunk, pos, chunk.size())) {
-                delimiter_positions.push_back(i + 1);
-            }
-        }
+void OpinionClusterReader::initStream() {
+    if (scanner_) return;
+    // Every newline is a candidate; the boundary test does its own field-level quote handling
+    scanner_ = std::make_unique<RecordScanner>(filename_, &OpinionClusterReader::isRecordStart, false);
+    parseHeader(string(scanner_->header()));
+}
 
-        // Extract into outRecords
-        for (size_t j = 0; j + 1 < delimiter_positions.size() && outRecords.size() < max_records; ++j) {
-            size_t rec_start = delimiter_positions[j];
-            size_t rec_end = delimiter_positions[j + 1];
-            if (rec_start < rec_end && rec_end <= chunk.size()) {
-                string record = chunk.substr(rec_start, rec_end - rec_start);
-                if (!record.empty() && record.back() == '\n') record.pop_back();
-                if (!record.empty()) outRecords.push_back(std::move(record));
-            }
-        }
+bool OpinionClusterReader::readNextBatch(vector<std::string_view>& outRecords, size_t max_records) {
+    if (!scanner_) initStream();
+    StageTimer timer("read", "search_opinioncluster");
+    size_t start = scanner_->offset();
+    bool more = scanner_->nextBatch(outRecords, max_records);
+    Metrics::global().add("records_read", "search_opinioncluster", outRecords.size());
+    Metrics::global().add("bytes_read", "search_opinioncluster", scanner_->offset() - start);
+    return more;
+}
 
-        // Prepare leftover for next read
-        if (delimiter_positions.size() >= 2) {
-            size_t last_delim = delimiter_positions.back();
-            if (last_delim < chunk.size()) {
-                leftover_ = chunk.substr(last_delim);
-            } else {
-                leftover_.clear();
-            }
-        } else {
-            leftover_ = std::move(chunk);
-        }
+size_t OpinionClusterReader::buildRecordIndex(ThreadPool& pool) {
+    if (!scanner_) initStream();
+    return scanner_->buildIndex(pool);
+}
 
-        if (outRecords.size() >= max_records) break;
-    }
+void OpinionClusterReader::setReleaseLag(size_t batches) {
+    if (!scanner_) initStream();
+    scanner_->setReleaseLag(batches);
+}
 
-    if (file_stream_.eof()) eof_ = true;
-    return !outRecords.empty();
+void OpinionClusterReader::seek(size_t offset) {
+    if (!scanner_) initStream();
+    scanner_->seek(offset);
 }
@@ -1,9 +1,33 @@
 #include "opinion_cluster_db.h"
+#include "bulk_initial_load.h"
+#include "metrics.h"
+#include "pg_binary_copy.h"
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <vector>
 #include <algorithm>
 
+// ON CONFLICT DO NOTHING keeps re-runs over an already loaded file idempotent
+static const char* kClusterInsertSql = R"(
+    INSERT INTO search_opinioncluster (
+        id, judges, date_created, date_modified, date_filed, slug,
+        case_name_short, case_name, case_name_full, scdb_id, source,
+        procedural_history, attorneys, nature_of_suit, posture, syllabus,
+        citation_count, precedential_status, date_blocked, blocked, docket_id,
+        scdb_decision_direction, scdb_votes_majority, scdb_votes_minority,
+        date_filed_is_approximate, correction, cross_reference, disposition,
+        filepath_json_harvard, headnotes, history, other_dates, summary,
+        arguments, headmatter, filepath_pdf_harvard
+    ) VALUES (
+        $1, $2, $3, $4, $5, $6, $7, $8, $9, $10,
+        $11, $12, $13, $14, $15, $16, $17, $18, $19, $20,
+        $21, $22, $23, $24, $25, $26, $27, $28, $29, $30,
+        $31, $32, $33, $34, $35, $36
+    )
+    ON CONFLICT (id) DO NOTHING
+)";
+
 OpinionClusterDatabase::OpinionClusterDatabase(const std::string& host, int port,
                                                const std::string& dbname, const std::string& user,
                                                const std::string& password) {
@@ -14,12 +38,13 @@ OpinionClusterDatabase::OpinionClusterDatabase(const std::string& host, int port
         << " user=" << user
         << " password=" << password;
     connection_string_ = oss.str();
+    pool_ = ConnectionPool::shared(connection_string_);
 }
 
 bool OpinionClusterDatabase::testConnection() {
     try {
-        pqxx::connection conn(connection_string_);
-        return conn.is_open();
+        auto conn = pool_->acquire();
+        return conn->is_open();
     } catch (const std::exception& e) {
         std::cerr << "Connection test failed: " << e.what() << std::endl;
         return false;
@@ -33,32 +58,17 @@ std::string OpinionClusterDatabase::formatOptionalString(const std::optional<std
     return "";
 }
 
+void OpinionClusterDatabase::prepareStatements(pqxx::connection& conn) {
+    pool_->prepare(conn, "cluster_insert", kClusterInsertSql);
+}
+
 void OpinionClusterDatabase::insertCluster(const OpinionCluster& cluster) {
     try {
-        pqxx::connection conn(connection_string_);
-        pqxx::work txn(conn);
+        auto conn = pool_->acquire();
+        prepareStatements(*conn);
+        pqxx::work txn(*conn);
         
-        // Prepare parameterized query - all 36 fields including id
-        std::string query = R"(
-            INSERT INTO search_opinioncluster (
-                id, judges, date_created, date_modified, date_filed, slug,
-                case_name_short, case_name, case_name_full, scdb_id, source,
-                procedural_history, attorneys, nature_of_suit, posture, syllabus,
-                citation_count, precedential_status, date_blocked, blocked, docket_id,
-                scdb_decision_direction, scdb_votes_majority, scdb_votes_minority,
-                date_filed_is_approximate, correction, cross_reference, disposition,
-                filepath_json_harvard, headnotes, history, other_dates, summary,
-                arguments, headmatter, filepath_pdf_harvard
-            ) VALUES (
-                $1, $2, $3, $4, $5, $6, $7, $8, $9, $10,
-                $11, $12, $13, $14, $15, $16, $17, $18, $19, $20,
-                $21, $22, $23, $24, $25, $26, $27, $28, $29, $30,
-                $31, $32, $33, $34, $35, $36
-            )
-            ON CONFLICT (id) DO NOTHING
-        )";
-        
-        txn.exec_params(query,
+        txn.exec_prepared("cluster_insert",
             cluster.id,
             cluster.judges,
             cluster.date_created,
@@ -106,38 +116,322 @@ void OpinionClusterDatabase::insertCluster(const OpinionCluster& cluster) {
     }
 }
 
+// Column order shared by the binary COPY statements and encodeCluster()
+static const std::vector<std::string> kClusterColumns = {
+    "id", "judges", "date_created", "date_modified", "date_filed", "slug",
+    "case_name_short", "case_name", "case_name_full", "scdb_id", "source",
+    "procedural_history", "attorneys", "nature_of_suit", "posture", "syllabus",
+    "citation_count", "precedential_status", "date_blocked", "blocked", "docket_id",
+    "scdb_decision_direction", "scdb_votes_majority", "scdb_votes_minority",
+    "date_filed_is_approximate", "correction", "cross_reference", "disposition",
+    "filepath_json_harvard", "headnotes", "history", "other_dates", "summary",
+    "arguments", "headmatter", "filepath_pdf_harvard"
+};
+
+static std::string columnList(const std::string& prefix = "") {
+    std::string out;
+    for (const auto& column : kClusterColumns) {
+        if (!out.empty()) out += ", ";
+        out += prefix + column;
+    }
+    return out;
+}
+
+static const std::string kClusterCopySql =
+    "COPY search_opinioncluster (" + columnList() + ") FROM STDIN (FORMAT binary)";
+
+static const char* kStageTable = "search_opinioncluster_stage";
+
+static const std::string kStageCopySql =
+    std::string("COPY ") + kStageTable + " (" + columnList() + ") FROM STDIN (FORMAT binary)";
+
+static std::string sqlLiteral(const std::string& text) {
+    std::string out = "'";
+    for (char c : text) {
+        if (c == '\'') out += '\'';
+        out += c;
+    }
+    return out + "'";
+}
+
+// Encode one cluster as a 36-field binary tuple; throws std::invalid_argument on bad dates
+static void encodeCluster(PgBinaryCopyWriter& w, const OpinionCluster& c) {
+    w.beginRow(36);
+    w.addInt4(c.id);
+    w.addText(c.judges);
+    w.addTimestamptz(c.date_created);
+    w.addTimestamptz(c.date_modified);
+    w.addDate(c.date_filed);
+    w.addText(c.slug);
+    w.addText(c.case_name_short);
+    w.addText(c.case_name);
+    w.addText(c.case_name_full);
+    w.addText(c.scdb_id);
+    w.addText(c.source);
+    w.addText(c.procedural_history);
+    w.addText(c.attorneys);
+    w.addText(c.nature_of_suit);
+    w.addText(c.posture);
+    w.addText(c.syllabus);
+    w.addInt4(c.citation_count);
+    w.addText(c.precedential_status);
+    w.addDate(c.date_blocked);
+    w.addBool(c.blocked);
+    w.addInt4(c.docket_id);
+    w.addInt4(c.scdb_decision_direction);
+    w.addInt4(c.scdb_votes_majority);
+    w.addInt4(c.scdb_votes_minority);
+    w.addBool(c.date_filed_is_approximate);
+    w.addText(c.correction);
+    w.addText(c.cross_reference);
+    w.addText(c.disposition);
+    w.addText(c.filepath_json_harvard);
+    w.addText(c.headnotes);
+    w.addText(c.history);
+    w.addText(c.other_dates);
+    w.addText(c.summary);
+    w.addText(c.arguments);
+    w.addText(c.headmatter);
+    w.addText(c.filepath_pdf_harvard);
+}
+
+bool OpinionClusterDatabase::copyClustersBinary(const std::vector<OpinionCluster>& clusters,
+                                                std::vector<OpinionCluster>& unencodable,
+                                                std::string& error) {
+    PgBinaryCopyWriter writer;
+    for (const auto& cluster : clusters) {
+        try {
+            encodeCluster(writer, cluster);
+        } catch (const std::invalid_argument&) {
+            // Let the per-row path (and the server) decide what to do with this row
+            writer.rollbackRow();
+            unencodable.push_back(cluster);
+        }
+    }
+    writer.finish();
+    if (writer.rowCount() == 0) return true;
+    
+    try {
+        PgRawConnection& conn = rawConnection();
+        conn.exec("BEGIN");
+        conn.copyIn(kClusterCopySql, writer.data());
+        StageTimer commit_timer("commit", "search_opinioncluster");
+        conn.exec("COMMIT");
+        return true;
+    } catch (const std::exception& e) {
+        raw_conn_.reset(); // transaction state is unknown after a failure; reconnect next batch
+        error = e.what();
+        return false;
+    }
+}
+
+PgRawConnection& OpinionClusterDatabase::rawConnection() {
+    if (!raw_conn_ || !raw_conn_->isOpen()) {
+        raw_conn_ = std::make_unique<PgRawConnection>(connection_string_);
+    }
+    return *raw_conn_;
+}
+
+void OpinionClusterDatabase::buildStagingSql() {
+    struct Column {
+        std::string type;
+        bool not_null = false;
+        std::string max_length; // varchar/char limit, empty if none
+    };
+    std::map<std::string, Column> catalog;
+    std::vector<BulkInitialLoad::ForeignKey> fks;
+    {
+        auto conn = pool_->acquire();
+        pqxx::work txn(*conn);
+        pqxx::result columns = txn.exec(R"(
+            SELECT a.attname, format_type(a.atttypid, NULL), a.attnotnull,
+                   CASE WHEN a.atttypid IN ('varchar'::regtype, 'bpchar'::regtype) AND a.atttypmod > 4
+                        THEN (a.atttypmod - 4)::text ELSE '' END
+            FROM pg_attribute a
+            WHERE a.attrelid = 'search_opinioncluster'::regclass AND a.attnum > 0 AND NOT a.attisdropped
+        )");
+        for (const auto& row : columns) {
+            Column column;
+            column.type = row[1].as<std::string>();
+            column.not_null = row[2].as<bool>();
+            column.max_length = row[3].as<std::string>();
+            catalog[row[0].as<std::string>()] = column;
+        }
+        fks = BulkInitialLoad::foreignKeys(txn, "search_opinioncluster");
+        txn.commit();
+    }
+    
+    // The staging table takes whatever COPY sends: same types, but no NOT NULL and no
+    // length limits, so those checks happen in the merge where a row can be left out
+    std::string create = std::string("CREATE UNLOGGED TABLE IF NOT EXISTS ") + kStageTable + " (";
+    std::string checks;
+    for (size_t i = 0; i < kClusterColumns.size(); ++i) {
+        const std::string& name = kClusterColumns[i];
+        auto it = catalog.find(name);
+        if (it == catalog.end()) throw std::runtime_error("search_opinioncluster has no column " + name);
+        const Column& column = it->second;
+        create += (i ? ", " : "") + name + " " + (column.max_length.empty() ? column.type : "text");
+        if (column.not_null) {
+            checks += "            WHEN s." + name + " IS NULL THEN " +
+                      sqlLiteral("null value in column " + name) + "\n";
+        }
+        if (!column.max_length.empty()) {
+            checks += "            WHEN length(s." + name + ") > " + column.max_length + " THEN " +
+                      sqlLiteral("value too long for " + name + " (max " + column.max_length + ")") + "\n";
+        }
+    }
+    create += ")";
+    for (const auto& fk : fks) {
+        std::string not_null, join;
+        for (size_t i = 0; i < fk.columns.size(); ++i) {
+            if (i > 0) { not_null += " AND "; join += " AND "; }
+            not_null += "s." + fk.columns[i] + " IS NOT NULL";
+            join += "r." + fk.ref_columns[i] + " = s." + fk.columns[i];
+        }
+        checks += "            WHEN " + not_null + " AND NOT EXISTS (SELECT 1 FROM " + fk.ref_table + " r WHERE " +
+                  join + ") THEN " + sqlLiteral(fk.name + ": no matching " + fk.ref_table + " row") + "\n";
+    }
+    
+    // One statement: reason per staged row, merge of the clean ones, then the rejected ids.
+    // The LEFT JOIN from a one-row relation returns the insert count even when nothing is rejected.
+    staging_create_sql_ = create;
+    staging_merge_sql_ =
+        std::string("WITH checked AS (\n") +
+        "    SELECT s.*, " + (checks.empty() ? "NULL::text" : "CASE\n" + checks + "        END") + " AS reject_reason\n" +
+        "    FROM " + kStageTable + " s\n" +
+        "), merged AS (\n" +
+        "    INSERT INTO search_opinioncluster (" + columnList() + ")\n" +
+        "    SELECT " + columnList("c.") + " FROM checked c WHERE c.reject_reason IS NULL\n" +
+        "    ON CONFLICT (id) DO NOTHING\n" +
+        "    RETURNING 1\n" +
+        ")\n" +
+        "SELECT (SELECT count(*) FROM merged), c.id, c.reject_reason\n" +
+        "FROM (SELECT 1) one LEFT JOIN checked c ON c.reject_reason IS NOT NULL";
+}
+
+bool OpinionClusterDatabase::mergeThroughStaging(const std::vector<OpinionCluster>& clusters,
+                                                 std::vector<OpinionCluster>& unencodable,
+                                                 std::vector<OpinionCluster>& rejected_records,
+                                                 std::vector<std::string>& reasons,
+                                                 std::string& error) {
+    PgBinaryCopyWriter writer;
+    for (const auto& cluster : clusters) {
+        try {
+            encodeCluster(writer, cluster);
+        } catch (const std::invalid_argument&) {
+            // Left to the per-row path, as in bulk mode
+            writer.rollbackRow();
+            unencodable.push_back(cluster);
+        }
+    }
+    writer.finish();
+    
+    size_t inserted = 0;
+    std::map<int, std::string> rejected_ids;
+    if (writer.rowCount() > 0) {
+        try {
+            if (staging_merge_sql_.empty()) buildStagingSql();
+            PgRawConnection& conn = rawConnection();
+            if (!staging_created_) {
+                // The staging table outlives the connection, so the DDL runs once, in autocommit
+                conn.exec(staging_create_sql_);
+                staging_created_ = true;
+            }
+            conn.exec("BEGIN");
+            // Also locks the staging table until COMMIT, serializing concurrent batches
+            conn.exec(std::string("TRUNCATE ") + kStageTable);
+            conn.copyIn(kStageCopySql, writer.data());
+            auto rows = conn.query(staging_merge_sql_);
+            {
+                StageTimer commit_timer("commit", "search_opinioncluster");
+                conn.exec("COMMIT");
+            }
+            inserted = rows.empty() ? 0 : std::stoull(rows[0][0]);
+            for (const auto& row : rows) {
+                if (!row[1].empty()) rejected_ids[std::stoi(row[1])] = row[2];
+            }
+        } catch (const std::exception& e) {
+            raw_conn_.reset(); // transaction state is unknown after a failure; reconnect next batch
+            error = e.what();
+            return false;
+        }
+    }
+    
+    size_t rejected = 0;
+    for (const auto& cluster : clusters) {
+        auto it = rejected_ids.find(cluster.id);
+        if (it == rejected_ids.end()) continue;
+        rejected_records.push_back(cluster);
+        reasons.push_back(it->second);
+        rejected++;
+    }
+    Metrics::global().add("records_inserted", "search_opinioncluster", inserted);
+    Metrics::global().add("records_rejected", "search_opinioncluster", rejected);
+    
+    std::cout << "DB batch (staging merge): inserted=" << inserted
+              << " rejected=" << rejected
+              << " existing=" << (writer.rowCount() - rejected - inserted)
+              << " attempted=" << clusters.size()
+              << " unencodable=" << unencodable.size() << std::endl;
+    return true;
+}
+
 void OpinionClusterDatabase::insertClusters(const std::vector<OpinionCluster>& clusters) {
+    std::vector<OpinionCluster> rejected_records;
+    std::vector<std::string> reasons;
+    insertClusters(clusters, rejected_records, reasons);
+}
+
+void OpinionClusterDatabase::insertClusters(const std::vector<OpinionCluster>& clusters,
+                                            std::vector<OpinionCluster>& rejected_records,
+                                            std::vector<std::string>& reasons) {
     if (clusters.empty()) {
         std::cout << "No clusters to insert." << std::endl;
         return;
     }
+    StageTimer timer("insert", "search_opinioncluster");
+    
+    if (staging_merge_) {
+        std::vector<OpinionCluster> unencodable;
+        std::string merge_error;
+        if (mergeThroughStaging(clusters, unencodable, rejected_records, reasons, merge_error)) {
+            if (!unencodable.empty()) insertClustersPerRow(unencodable, rejected_records, reasons);
+            return;
+        }
+        std::cout << "Staging merge failed for batch of " << clusters.size()
+                  << ", falling back to per-row insert: " << merge_error << std::endl;
+    }
     
+    if (bulk_copy_) {
+        std::vector<OpinionCluster> unencodable;
+        std::string copy_error;
+        if (copyClustersBinary(clusters, unencodable, copy_error)) {
+            Metrics::global().add("records_inserted", "search_opinioncluster", clusters.size() - unencodable.size());
+            std::cout << "DB batch (binary COPY): inserted=" << (clusters.size() - unencodable.size())
+                      << " attempted=" << clusters.size()
+                      << " unencodable=" << unencodable.size() << std::endl;
+            if (!unencodable.empty()) insertClustersPerRow(unencodable, rejected_records, reasons);
+            return;
+        }
+        // The whole COPY was rolled back: isolate bad rows with per-row savepoints
+        std::cout << "Binary COPY rejected batch of " << clusters.size()
+                  << ", falling back to per-row insert: " << copy_error << std::endl;
+    }
+    
+    insertClustersPerRow(clusters, rejected_records, reasons);
+}
+
+void OpinionClusterDatabase::insertClustersPerRow(const std::vector<OpinionCluster>& clusters,
+                                                  std::vector<OpinionCluster>& rejected_records,
+                                                  std::vector<std::string>& reasons) {
     try {
-        pqxx::connection conn(connection_string_);
-        pqxx::work txn(conn);
+        auto conn = pool_->acquire();
+        prepareStatements(*conn);
+        pqxx::work txn(*conn);
         // Ensure DEFERRABLE constraints (like FK on docket_id) are checked immediately per row,
         // so a single bad row won't cause the entire outer transaction to fail at commit time.
         txn.exec("SET CONSTRAINTS ALL IMMEDIATE");
         
-        std::string query = R"(
-            INSERT INTO search_opinioncluster (
-                id, judges, date_created, date_modified, date_filed, slug,
-                case_name_short, case_name, case_name_full, scdb_id, source,
-                procedural_history, attorneys, nature_of_suit, posture, syllabus,
-                citation_count, precedential_status, date_blocked, blocked, docket_id,
-                scdb_decision_direction, scdb_votes_majority, scdb_votes_minority,
-                date_filed_is_approximate, correction, cross_reference, disposition,
-                filepath_json_harvard, headnotes, history, other_dates, summary,
-                arguments, headmatter, filepath_pdf_harvard
-            ) VALUES (
-                $1, $2, $3, $4, $5, $6, $7, $8, $9, $10,
-                $11, $12, $13, $14, $15, $16, $17, $18, $19, $20,
-                $21, $22, $23, $24, $25, $26, $27, $28, $29, $30,
-                $31, $32, $33, $34, $35, $36
-            )
-            ON CONFLICT (id) DO NOTHING
-        )";
-        
     int success_count = 0;
     int failure_count = 0;
     int fk_violations = 0;
@@ -150,7 +444,7 @@ void OpinionClusterDatabase::insertClusters(const std::vector<OpinionCluster>& c
             try {
                 // Use a subtransaction (savepoint) so one bad record doesn't abort the whole batch
                 pqxx::subtransaction subtxn(txn);
-                subtxn.exec_params(query,
+                subtxn.exec_prepared("cluster_insert",
                     cluster.id,
                     cluster.judges,
                     cluster.date_created,
@@ -193,27 +487,29 @@ void OpinionClusterDatabase::insertClusters(const std::vector<OpinionCluster>& c
             } catch (const std::exception& e) {
                 // Skip this record, continue with next
                 failure_count++;
-                std::string msg = e.what();
-                std::string lower = msg;
-                std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c){ return std::tolower(c); });
-                if (lower.find("foreign key") != std::string::npos) {
-                    fk_violations++;
-                } else if (lower.find("null value in column") != std::string::npos || lower.find("not-null constraint") != std::string::npos) {
-                    not_null_violations++;
-                } else if (lower.find("duplicate key value") != std::string::npos || lower.find("unique constraint") != std::string::npos) {
-                    unique_violations++;
-                } else {
-                    other_errors++;
+                PgError error = pgError(e);
+                switch (error.kind) {
+                    case PgErrorKind::ForeignKey: fk_violations++; break;
+                    case PgErrorKind::NotNull: not_null_violations++; break;
+                    case PgErrorKind::Unique: unique_violations++; break;
+                    default: other_errors++; break;
                 }
+                rejected_records.push_back(cluster);
+                reasons.push_back(error.describe());
                 if (failure_samples.size() < max_samples) {
                     std::ostringstream oss;
-                    oss << "fail id=" << cluster.id << ": " << msg;
+                    oss << "fail id=" << cluster.id << ": " << error.describe();
                     failure_samples.push_back(oss.str());
                 }
             }
         }
         
-    txn.commit();
+    {
+        StageTimer commit_timer("commit", "search_opinioncluster");
+        txn.commit();
+    }
+    Metrics::global().add("records_inserted", "search_opinioncluster", success_count);
+    Metrics::global().add("records_rejected", "search_opinioncluster", failure_count);
     // Batch-level statistics
     std::cout << "DB batch: inserted=" << success_count
               << " failed=" << failure_count
@@ -1,4 +1,6 @@
 #include "opinion_cluster_panel.h"
+#include "input_stream.h"
+#include "metrics.h"
 
 #include <algorithm>
 #include <cctype>
@@ -46,7 +48,22 @@ string OpinionClusterPanel::toCsv() const {
 }
 
 OpinionClusterPanelReader::OpinionClusterPanelReader(const string& filename) 
-    : filename_(filename) {}
+    : filename_(filename), header_parsed_(false), total_lines_read_(0) {
+    file_.open(filename_);
+    if (!file_.is_open()) {
+        throw std::runtime_error("Failed to open panel CSV file: " + filename_);
+    }
+}
+
+OpinionClusterPanelReader::~OpinionClusterPanelReader() {
+    if (file_.is_open()) {
+        file_.close();
+    }
+}
+
+bool OpinionClusterPanelReader::hasMore() const {
+    return file_.good() && !file_.eof();
+}
 
 void OpinionClusterPanelReader::parseHeader(const string& header_line) {
     header_ = splitCsvLine(header_line);
@@ -131,17 +148,11 @@ OpinionClusterPanel OpinionClusterPanelReader::parseCsvLine(const string& line)
     return panel;
 }
 
-vector<OpinionClusterPanel> OpinionClusterPanelReader::readAll() {
-    vector<OpinionClusterPanel> panels;
+void OpinionClusterPanelReader::ensureHeader() {
+    if (header_parsed_) return;
     
-    std::ifstream file(filename_);
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to open panel CSV file: " + filename_);
-    }
-    
-    // Read and parse header
     string header_line;
-    if (!std::getline(file, header_line)) {
+    if (!std::getline(file_, header_line)) {
         throw std::runtime_error("Panel CSV file is empty or missing header");
     }
     
@@ -154,11 +165,14 @@ vector<OpinionClusterPanel> OpinionClusterPanelReader::readAll() {
         throw std::runtime_error("Panel CSV missing required columns (id, opinioncluster_id, person_id)");
     }
     
-    // Read all data lines
+    header_parsed_ = true;
+}
+
+bool OpinionClusterPanelReader::nextRecord(OpinionClusterPanel& record, size_t& bytes) {
     string line;
-    size_t line_number = 1; // Start at 1 (header is line 0)
-    while (std::getline(file, line)) {
-        line_number++;
+    while (std::getline(file_, line)) {
+        total_lines_read_++;
+        bytes += line.size() + 1;
         
         // Skip empty lines
         if (trim(line).empty()) {
@@ -166,13 +180,72 @@ vector<OpinionClusterPanel> OpinionClusterPanelReader::readAll() {
         }
         
         try {
-            panels.push_back(parseCsvLine(line));
+            record = parseCsvLine(line);
+            return true;
         } catch (const std::exception& e) {
-            std::cerr << "Warning: Failed to parse line " << line_number 
+            std::cerr << "Warning: Failed to parse line " << (total_lines_read_ + 1) 
                       << ": " << e.what() << std::endl;
             // Continue processing other lines
         }
     }
+    return false;
+}
+
+vector<OpinionClusterPanel> OpinionClusterPanelReader::readBatch(size_t batch_size) {
+    StageTimer timer("read", "search_opinioncluster_panel");
+    size_t bytes = 0;
+    vector<OpinionClusterPanel> records;
+    records.reserve(batch_size);
+    
+    ensureHeader();
+    
+    OpinionClusterPanel record;
+    while (records.size() < batch_size && nextRecord(record, bytes)) {
+        records.push_back(record);
+    }
+    
+    Metrics::global().add("records_read", "search_opinioncluster_panel", records.size());
+    Metrics::global().add("bytes_read", "search_opinioncluster_panel", bytes);
+    return records;
+}
+
+size_t OpinionClusterPanelReader::readBatch(Int32Batch& batch, size_t batch_size) {
+    StageTimer timer("read", "search_opinioncluster_panel");
+    size_t bytes = 0;
+    if (batch.columnCount() != OpinionClusterPanel::kColumnCount) batch = Int32Batch(OpinionClusterPanel::kColumnCount);
+    batch.clear();
+    batch.reserve(batch_size);
     
-    return panels;
+    ensureHeader();
+    
+    OpinionClusterPanel record;
+    while (batch.size() < batch_size && nextRecord(record, bytes)) {
+        record.appendTo(batch);
+    }
+    
+    Metrics::global().add("records_read", "search_opinioncluster_panel", batch.size());
+    Metrics::global().add("bytes_read", "search_opinioncluster_panel", bytes);
+    return batch.size();
+}
+
+vector<OpinionClusterPanel> OpinionClusterPanelReader::readAll() {
+    vector<OpinionClusterPanel> records;
+    
+    // Use streaming approach for consistency
+    while (hasMore()) {
+        auto batch = readBatch(10000);
+        if (batch.empty()) break;
+        records.insert(records.end(), batch.begin(), batch.end());
+    }
+    
+    return records;
+}
+
+void OpinionClusterPanelReader::readAll(Int32Batch& batch) {
+    batch.clear();
+    Int32Batch chunk(OpinionClusterPanel::kColumnCount);
+    while (hasMore()) {
+        if (readBatch(chunk, 10000) == 0) break;
+        batch.append(chunk);
+    }
 }
@@ -1,7 +1,37 @@
 #include "opinion_cluster_panel_db.h"
+#include "id_cache.h"
+#include "pg_error.h"
+#include "metrics.h"
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
+static const char* kPanelUpsertSql =
+    "INSERT INTO search_opinioncluster_panel (id, opinioncluster_id, person_id) VALUES ($1, $2, $3) "
+    "ON CONFLICT (opinioncluster_id, person_id) DO UPDATE SET id = EXCLUDED.id";
+
+// Minimal placeholder cluster with required fields
+static const char* kPlaceholderClusterSql =
+    "INSERT INTO search_opinioncluster ("
+    "id, judges, date_created, date_modified, date_filed, "
+    "case_name_short, case_name, case_name_full, scdb_id, source, "
+    "procedural_history, attorneys, nature_of_suit, posture, syllabus, "
+    "citation_count, precedential_status, blocked, docket_id, "
+    "date_filed_is_approximate, correction, cross_reference, disposition, "
+    "filepath_json_harvard, headnotes, history, other_dates, summary, "
+    "arguments, headmatter, filepath_pdf_harvard"
+    ") VALUES ("
+    "$1, "
+    "'PLACEHOLDER', "  // judges
+    "NOW(), NOW(), '1900-01-01', "  // dates
+    "'PLACEHOLDER', 'PLACEHOLDER', 'PLACEHOLDER', "  // case names
+    "'', 'R', "  // scdb_id, source
+    "'', '', '', '', '', "  // text fields
+    "0, 'Unknown', false, 1, "  // citation_count, precedential_status, blocked, docket_id
+    "false, '', '', '', "  // date_filed_is_approximate, correction, cross_reference, disposition
+    "'', '', '', '', '', '', '', ''"  // remaining text fields
+    ") ON CONFLICT (id) DO NOTHING";
+
 OpinionClusterPanelDatabase::OpinionClusterPanelDatabase(
     const std::string& host, int port,
     const std::string& dbname, const std::string& user,
@@ -14,12 +44,13 @@ OpinionClusterPanelDatabase::OpinionClusterPanelDatabase(
         << " user=" << user
         << " password=" << password;
     connection_string_ = oss.str();
+    pool_ = ConnectionPool::shared(connection_string_);
 }
 
 bool OpinionClusterPanelDatabase::testConnection() {
     try {
-        pqxx::connection conn(connection_string_);
-        return conn.is_open();
+        auto conn = pool_->acquire();
+        return conn->is_open();
     } catch (const std::exception& e) {
         std::cerr << "Connection test failed: " << e.what() << std::endl;
         return false;
@@ -30,21 +61,16 @@ void OpinionClusterPanelDatabase::loadValidClusterIds() {
     valid_cluster_ids_.clear();
     
     try {
-        pqxx::connection conn(connection_string_);
-        pqxx::work txn(conn);
+        auto conn = pool_->acquire();
+        pqxx::work txn(*conn);
         
-        std::string query = "SELECT id FROM search_opinioncluster";
-        pqxx::result res = txn.exec(query);
-        
-        for (const auto& row : res) {
-            int cluster_id = row[0].as<int>();
-            valid_cluster_ids_.insert(cluster_id);
-        }
+        size_t fetched = loadIdCache(txn, "search_opinioncluster", valid_cluster_ids_, id_snapshot_dir_, verify_id_cache_);
         
         txn.commit();
+        valid_ids_loaded_ = true;
         
         std::cout << "Loaded " << valid_cluster_ids_.size() 
-                  << " valid cluster IDs from database\n";
+                  << " valid cluster IDs (" << fetched << " read from database)\n";
                   
     } catch (const std::exception& e) {
         std::cerr << "Failed to load valid cluster IDs: " << e.what() << std::endl;
@@ -52,39 +78,36 @@ void OpinionClusterPanelDatabase::loadValidClusterIds() {
     }
 }
 
+void OpinionClusterPanelDatabase::prepareStatements(pqxx::connection& conn) {
+    pool_->prepare(conn, "panel_upsert", kPanelUpsertSql);
+    pool_->prepare(conn, "panel_placeholder_cluster", kPlaceholderClusterSql);
+}
+
 bool OpinionClusterPanelDatabase::isValidClusterId(int cluster_id) const {
-    return valid_cluster_ids_.find(cluster_id) != valid_cluster_ids_.end();
+    return valid_cluster_ids_.contains(cluster_id);
 }
 
 bool OpinionClusterPanelDatabase::createPlaceholderCluster(int cluster_id) {
     try {
-        pqxx::connection conn(connection_string_);
+        auto conn = pool_->acquire();
+        prepareStatements(*conn);
+        return createPlaceholderCluster(*conn, cluster_id);
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to create placeholder cluster for id=" << cluster_id
+                  << ": " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool OpinionClusterPanelDatabase::createPlaceholderCluster(pqxx::connection& conn, int cluster_id) {
+    StageTimer timer("placeholder", "search_opinioncluster_panel");
+    try {
         pqxx::work txn(conn);
         
         // Create minimal placeholder with required fields
-        std::ostringstream query;
-        query << "INSERT INTO search_opinioncluster ("
-              << "id, judges, date_created, date_modified, date_filed, "
-              << "case_name_short, case_name, case_name_full, scdb_id, source, "
-              << "procedural_history, attorneys, nature_of_suit, posture, syllabus, "
-              << "citation_count, precedential_status, blocked, docket_id, "
-              << "date_filed_is_approximate, correction, cross_reference, disposition, "
-              << "filepath_json_harvard, headnotes, history, other_dates, summary, "
-              << "arguments, headmatter, filepath_pdf_harvard"
-              << ") VALUES ("
-              << cluster_id << ", "
-              << "'PLACEHOLDER', "  // judges
-              << "NOW(), NOW(), '1900-01-01', "  // dates
-              << "'PLACEHOLDER', 'PLACEHOLDER', 'PLACEHOLDER', "  // case names
-              << "'', 'R', "  // scdb_id, source
-              << "'', '', '', '', '', "  // text fields
-              << "0, 'Unknown', false, 1, "  // citation_count, precedential_status, blocked, docket_id
-              << "false, '', '', '', "  // date_filed_is_approximate, correction, cross_reference, disposition
-              << "'', '', '', '', '', '', '', ''"  // remaining text fields
-              << ") ON CONFLICT (id) DO NOTHING";
-        
-        pqxx::result res = txn.exec(query.str());
+        txn.exec_prepared("panel_placeholder_cluster", cluster_id);
         txn.commit();
+        Metrics::global().add("placeholders_created", "search_opinioncluster_panel", 1);
         
         // Add to valid cluster IDs cache
         valid_cluster_ids_.insert(cluster_id);
@@ -100,67 +123,62 @@ bool OpinionClusterPanelDatabase::createPlaceholderCluster(int cluster_id) {
 }
 
 size_t OpinionClusterPanelDatabase::insertPanels(
-    const std::vector<OpinionClusterPanel>& panels,
-    std::vector<OpinionClusterPanel>& rejected_panels,
+    const Int32Batch& panels,
+    Int32Batch& rejected_panels,
     std::vector<std::string>& rejection_reasons) {
     
     rejected_panels.clear();
     rejection_reasons.clear();
     
     size_t inserted = 0;
+    StageTimer timer("insert", "search_opinioncluster_panel");
     
     // Insert records line by line and collect failures
     try {
-        pqxx::connection conn(connection_string_);
+        auto conn = pool_->acquire();
+        prepareStatements(*conn);
         
-        for (const auto& panel : panels) {
+        // One pass over the FK column against the ID cache, so missing clusters get their
+        // placeholder before the insert rather than after a failed one
+        if (valid_ids_loaded_ && !panels.empty()) {
+            std::vector<int> missing;
+            valid_cluster_ids_.collectMissing(panels.column(OpinionClusterPanel::kOpinionClusterId), missing);
+            std::sort(missing.begin(), missing.end());
+            missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+            for (int cluster_id : missing) {
+                createPlaceholderCluster(*conn, cluster_id);
+            }
+        }
+        
+        for (size_t i = 0; i < panels.size(); ++i) {
+            OpinionClusterPanel panel = OpinionClusterPanel::fromBatch(panels, i);
             try {
                 // Start a new transaction for each record
-                pqxx::work txn(conn);
-                
-                // Build insert query with upsert to handle duplicates
-                std::ostringstream query;
-                query << "INSERT INTO search_opinioncluster_panel "
-                      << "(id, opinioncluster_id, person_id) VALUES ("
-                      << panel.id << ", "
-                      << panel.opinioncluster_id << ", "
-                      << panel.person_id
-                      << ") ON CONFLICT (opinioncluster_id, person_id) "
-                      << "DO UPDATE SET id = EXCLUDED.id";
+                pqxx::work txn(*conn);
                 
-                pqxx::result res = txn.exec(query.str());
+                // Upsert to handle duplicates
+                txn.exec_prepared("panel_upsert", panel.id, panel.opinioncluster_id, panel.person_id);
                 txn.commit();
                 
                 // Successfully inserted
                 inserted++;
                 
             } catch (const std::exception& e) {
-                // Individual record insertion failed - PostgreSQL will tell us why
-                std::string error_msg = e.what();
+                // Individual record insertion failed - the SQLSTATE says why
+                PgError error = pgError(e);
                 
-                // Check if it's an FK violation on opinioncluster_id
-                if ((error_msg.find("foreign key") != std::string::npos || 
-                     error_msg.find("violates foreign key constraint") != std::string::npos) &&
-                    error_msg.find("opinioncluster_id") != std::string::npos) {
+                // FK violation on opinioncluster_id; a cluster the cache knows points at person_id instead
+                if (error.kind == PgErrorKind::ForeignKey && !isValidClusterId(panel.opinioncluster_id)) {
                     
                     std::cout << "FK violation detected for cluster_id=" << panel.opinioncluster_id 
                               << ", creating placeholder..." << std::endl;
                     
                     // Try to create placeholder and retry insert
-                    if (createPlaceholderCluster(panel.opinioncluster_id)) {
+                    if (createPlaceholderCluster(*conn, panel.opinioncluster_id)) {
                         try {
                             // Retry the insert with upsert
-                            pqxx::work retry_txn(conn);
-                            std::ostringstream retry_query;
-                            retry_query << "INSERT INTO search_opinioncluster_panel "
-                                       << "(id, opinioncluster_id, person_id) VALUES ("
-                                       << panel.id << ", "
-                                       << panel.opinioncluster_id << ", "
-                                       << panel.person_id
-                                       << ") ON CONFLICT (opinioncluster_id, person_id) "
-                                       << "DO UPDATE SET id = EXCLUDED.id";
-                            
-                            retry_txn.exec(retry_query.str());
+                            pqxx::work retry_txn(*conn);
+                            retry_txn.exec_prepared("panel_upsert", panel.id, panel.opinioncluster_id, panel.person_id);
                             retry_txn.commit();
                             
                             inserted++;
@@ -169,30 +187,21 @@ size_t OpinionClusterPanelDatabase::insertPanels(
                             
                         } catch (const std::exception& retry_e) {
                             // Retry also failed
-                            rejected_panels.push_back(panel);
-                            std::ostringstream reason;
-                            reason << "FK violation, placeholder created but retry failed: " << retry_e.what();
-                            rejection_reasons.push_back(reason.str());
+                            panel.appendTo(rejected_panels);
+                            rejection_reasons.push_back("FK violation, placeholder created but retry failed: " +
+                                                        pgError(retry_e).describe());
                         }
                     } else {
                         // Failed to create placeholder
-                        rejected_panels.push_back(panel);
-                        std::ostringstream reason;
-                        reason << "FK violation, failed to create placeholder: " << error_msg;
-                        rejection_reasons.push_back(reason.str());
+                        panel.appendTo(rejected_panels);
+                        rejection_reasons.push_back("FK violation, failed to create placeholder: " + error.describe());
                     }
                 } else {
                     // Other types of errors
-                    rejected_panels.push_back(panel);
-                    std::ostringstream reason;
-                    
-                    if (error_msg.find("duplicate key") != std::string::npos) {
-                        reason << "Duplicate key violation: " << error_msg;
-                    } else {
-                        reason << "DB error: " << error_msg;
-                    }
-                    
-                    rejection_reasons.push_back(reason.str());
+                    panel.appendTo(rejected_panels);
+                    rejection_reasons.push_back((error.kind == PgErrorKind::Unique ? "Duplicate key violation: "
+                                                                                    : "DB error: ") +
+                                                error.describe());
                 }
             }
         }
@@ -201,15 +210,13 @@ size_t OpinionClusterPanelDatabase::insertPanels(
         std::cerr << "Database connection failed: " << e.what() << std::endl;
         
         // Connection failed - reject all remaining records
-        for (const auto& panel : panels) {
-            rejected_panels.push_back(panel);
-            std::ostringstream reason;
-            reason << "Connection error: " << e.what();
-            rejection_reasons.push_back(reason.str());
-        }
-        
-        return inserted;
+        rejected_panels.append(panels);
+        std::ostringstream reason;
+        reason << "Connection error: " << e.what();
+        rejection_reasons.resize(rejected_panels.size(), reason.str());
     }
     
+    Metrics::global().add("records_inserted", "search_opinioncluster_panel", inserted);
+    Metrics::global().add("records_rejected", "search_opinioncluster_panel", rejected_panels.size());
     return inserted;
 }
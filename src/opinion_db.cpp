@@ -1,7 +1,58 @@
 #include "opinion_db.h"
+#include "metrics.h"
+#include "pg_error.h"
 #include <iostream>
 #include <sstream>
 
+static const char* kOpinionInsertSql = R"(
+    INSERT INTO search_opinion (
+        id, date_created, date_modified, type, sha1, download_url,
+        local_path, plain_text, html, html_lawbox, html_columbia,
+        html_with_citations, extracted_by_ocr, author_id, cluster_id,
+        per_curiam, page_count, author_str, joined_by_str,
+        xml_harvard, html_anon_2020, ordering_key, main_version_id
+    ) VALUES (
+        $1, $2, $3, $4, $5, $6, $7, $8, $9, $10,
+        $11, $12, $13, $14, $15, $16, $17, $18, $19, $20, $21, $22, $23
+    )
+)";
+
+// Per-row path: rows already present (e.g. from an earlier run) are skipped
+static const char* kOpinionInsertOrSkipSql = R"(
+    INSERT INTO search_opinion (
+        id, date_created, date_modified, type, sha1, download_url,
+        local_path, plain_text, html, html_lawbox, html_columbia,
+        html_with_citations, extracted_by_ocr, author_id, cluster_id,
+        per_curiam, page_count, author_str, joined_by_str,
+        xml_harvard, html_anon_2020, ordering_key, main_version_id
+    ) VALUES (
+        $1, $2, $3, $4, $5, $6, $7, $8, $9, $10,
+        $11, $12, $13, $14, $15, $16, $17, $18, $19, $20, $21, $22, $23
+    )
+    ON CONFLICT (id) DO NOTHING
+)";
+
+static const char* kPlaceholderClusterSql = R"(
+    INSERT INTO search_opinioncluster (
+        id, judges, date_created, date_modified, date_filed,
+        case_name_short, case_name, case_name_full, scdb_id, source,
+        procedural_history, attorneys, nature_of_suit, posture, syllabus,
+        citation_count, precedential_status, blocked, docket_id,
+        date_filed_is_approximate, correction, cross_reference, disposition,
+        filepath_json_harvard, headnotes, history, other_dates, summary,
+        arguments, headmatter, filepath_pdf_harvard
+    ) VALUES (
+        $1, $2, NOW(), NOW(), CURRENT_DATE,
+        $3, $4, $5, $6, $7,
+        $8, $9, $10, $11, $12,
+        $13, $14, $15, $16,
+        $17, $18, $19, $20,
+        $21, $22, $23, $24, $25,
+        $26, $27, $28
+    )
+    ON CONFLICT (id) DO NOTHING
+)";
+
 OpinionDatabase::OpinionDatabase(const std::string& host, int port,
                                  const std::string& dbname, const std::string& user,
                                  const std::string& password) {
@@ -12,12 +63,13 @@ OpinionDatabase::OpinionDatabase(const std::string& host, int port,
         << " user=" << user
         << " password=" << password;
     connection_string_ = oss.str();
+    pool_ = ConnectionPool::shared(connection_string_);
 }
 
 bool OpinionDatabase::testConnection() {
     try {
-        pqxx::connection conn(connection_string_);
-        return conn.is_open();
+        auto conn = pool_->acquire();
+        return conn->is_open();
     } catch (const std::exception& e) {
         std::cerr << "Connection test failed: " << e.what() << std::endl;
         return false;
@@ -38,7 +90,14 @@ std::string OpinionDatabase::formatOptionalString(const std::optional<std::strin
     return "";
 }
 
-void OpinionDatabase::createPlaceholderCluster(pqxx::transaction_base& txn, int cluster_id, int docket_id) {
+void OpinionDatabase::prepareStatements(pqxx::connection& conn) {
+    pool_->prepare(conn, "opinion_insert", kOpinionInsertSql);
+    pool_->prepare(conn, "opinion_insert_or_skip", kOpinionInsertOrSkipSql);
+    pool_->prepare(conn, "opinion_placeholder_cluster", kPlaceholderClusterSql);
+}
+
+bool OpinionDatabase::createPlaceholderCluster(pqxx::transaction_base& txn, int cluster_id, int docket_id) {
+    StageTimer timer("placeholder", "search_opinion");
     // Create a minimal valid opinion cluster with the missing cluster_id
     // Use defaults respecting field size constraints:
     // - scdb_id: varchar(10)
@@ -46,28 +105,7 @@ void OpinionDatabase::createPlaceholderCluster(pqxx::transaction_base& txn, int
     // - precedential_status: varchar(50)
     // - filepath_json_harvard: varchar(1000)
     // - filepath_pdf_harvard: varchar(100)
-    std::string query = R"(
-        INSERT INTO search_opinioncluster (
-            id, judges, date_created, date_modified, date_filed, 
-            case_name_short, case_name, case_name_full, scdb_id, source,
-            procedural_history, attorneys, nature_of_suit, posture, syllabus,
-            citation_count, precedential_status, blocked, docket_id,
-            date_filed_is_approximate, correction, cross_reference, disposition,
-            filepath_json_harvard, headnotes, history, other_dates, summary,
-            arguments, headmatter, filepath_pdf_harvard
-        ) VALUES (
-            $1, $2, NOW(), NOW(), CURRENT_DATE,
-            $3, $4, $5, $6, $7,
-            $8, $9, $10, $11, $12,
-            $13, $14, $15, $16,
-            $17, $18, $19, $20,
-            $21, $22, $23, $24, $25,
-            $26, $27, $28
-        )
-        ON CONFLICT (id) DO NOTHING
-    )";
-    
-    txn.exec_params(query,
+    pqxx::result res = txn.exec_prepared("opinion_placeholder_cluster",
         cluster_id,                    // id
         "",                            // judges
         "NA",                          // case_name_short
@@ -97,28 +135,18 @@ void OpinionDatabase::createPlaceholderCluster(pqxx::transaction_base& txn, int
         "",                            // headmatter
         ""                             // filepath_pdf_harvard (varchar(100))
     );
+    bool created = res.affected_rows() > 0;
+    if (created) Metrics::global().add("placeholders_created", "search_opinion", 1);
+    return created;
 }
 
 void OpinionDatabase::insertOpinion(const Opinion& opinion) {
     try {
-        pqxx::connection conn(connection_string_);
-        pqxx::work txn(conn);
+        auto conn = pool_->acquire();
+        prepareStatements(*conn);
+        pqxx::work txn(*conn);
         
-        // Prepare parameterized query - including id from CSV data
-        std::string query = R"(
-            INSERT INTO search_opinion (
-                id, date_created, date_modified, type, sha1, download_url,
-                local_path, plain_text, html, html_lawbox, html_columbia,
-                html_with_citations, extracted_by_ocr, author_id, cluster_id,
-                per_curiam, page_count, author_str, joined_by_str,
-                xml_harvard, html_anon_2020, ordering_key, main_version_id
-            ) VALUES (
-                $1, $2, $3, $4, $5, $6, $7, $8, $9, $10,
-                $11, $12, $13, $14, $15, $16, $17, $18, $19, $20, $21, $22, $23
-            )
-        )";
-        
-        txn.exec_params(query,
+        txn.exec_prepared("opinion_insert",
             opinion.id,
             opinion.date_created,
             opinion.date_modified,
@@ -158,27 +186,87 @@ void OpinionDatabase::insertOpinions(const std::vector<Opinion>& opinions) {
         std::cout << "No opinions to insert." << std::endl;
         return;
     }
+    StageTimer timer("insert", "search_opinion");
     
+    if (bulk_copy_) {
+        std::string copy_error;
+        if (copyOpinions(opinions, copy_error)) {
+            Metrics::global().add("records_inserted", "search_opinion", opinions.size());
+            std::cout << "DB batch (COPY): inserted=" << opinions.size()
+                      << " attempted=" << opinions.size() << "\n";
+            return;
+        }
+        // COPY is all-or-nothing: replay the batch row by row to isolate the bad records
+        std::cout << "COPY rejected batch of " << opinions.size()
+                  << ", falling back to per-row insert: " << copy_error << "\n";
+    }
+    
+    insertOpinionsPerRow(opinions);
+}
+
+bool OpinionDatabase::copyOpinions(const std::vector<Opinion>& opinions, std::string& error) {
     try {
-        pqxx::connection conn(connection_string_);
-        pqxx::work txn(conn);
+        auto conn = pool_->acquire();
+        pqxx::work txn(*conn);
+        
+        // COPY has no ON CONFLICT clause, so duplicates and FK misses fail the whole
+        // statement; the caller falls back to the per-row path in that case.
+        auto stream = pqxx::stream_to::table(txn, {"search_opinion"}, {
+            "id", "date_created", "date_modified", "type", "sha1", "download_url",
+            "local_path", "plain_text", "html", "html_lawbox", "html_columbia",
+            "html_with_citations", "extracted_by_ocr", "author_id", "cluster_id",
+            "per_curiam", "page_count", "author_str", "joined_by_str",
+            "xml_harvard", "html_anon_2020", "ordering_key", "main_version_id"
+        });
+        
+        for (const auto& opinion : opinions) {
+            stream.write_values(
+                opinion.id,
+                opinion.date_created,
+                opinion.date_modified,
+                opinion.type,
+                opinion.sha1,
+                formatOptionalString(opinion.download_url),
+                opinion.local_path,
+                opinion.plain_text,
+                opinion.html,
+                opinion.html_lawbox,
+                opinion.html_columbia,
+                opinion.html_with_citations,
+                opinion.extracted_by_ocr,
+                opinion.author_id,
+                opinion.cluster_id,
+                opinion.per_curiam,
+                opinion.page_count,
+                opinion.author_str,
+                opinion.joined_by_str,
+                opinion.xml_harvard,
+                opinion.html_anon_2020,
+                opinion.ordering_key,
+                opinion.main_version_id
+            );
+        }
+        
+        stream.complete();
+        // Deferred constraints fire here, so a failing commit also counts as a rejected batch
+        StageTimer commit_timer("commit", "search_opinion");
+        txn.commit();
+        return true;
+        
+    } catch (const std::exception& e) {
+        error = e.what();
+        return false;
+    }
+}
+
+void OpinionDatabase::insertOpinionsPerRow(const std::vector<Opinion>& opinions) {
+    try {
+        auto conn = pool_->acquire();
+        prepareStatements(*conn);
+        pqxx::work txn(*conn);
         // Ensure constraints are checked immediately per row
         txn.exec("SET CONSTRAINTS ALL IMMEDIATE");
         
-        std::string query = R"(
-            INSERT INTO search_opinion (
-                id, date_created, date_modified, type, sha1, download_url,
-                local_path, plain_text, html, html_lawbox, html_columbia,
-                html_with_citations, extracted_by_ocr, author_id, cluster_id,
-                per_curiam, page_count, author_str, joined_by_str,
-                xml_harvard, html_anon_2020, ordering_key, main_version_id
-            ) VALUES (
-                $1, $2, $3, $4, $5, $6, $7, $8, $9, $10,
-                $11, $12, $13, $14, $15, $16, $17, $18, $19, $20, $21, $22, $23
-            )
-            ON CONFLICT (id) DO NOTHING
-        )";
-        
         int success_count = 0;
         int failure_count = 0;
         int fk_violations = 0;
@@ -194,7 +282,7 @@ void OpinionDatabase::insertOpinions(const std::vector<Opinion>& opinions) {
                 // Per-record subtransaction to isolate failures
                 pqxx::subtransaction sub(txn, "insert_opinion_" + std::to_string(opinion.id));
                 
-                sub.exec_params(query,
+                sub.exec_prepared("opinion_insert_or_skip",
                     opinion.id,
                     opinion.date_created,
                     opinion.date_modified,
@@ -224,24 +312,21 @@ void OpinionDatabase::insertOpinions(const std::vector<Opinion>& opinions) {
                 
             } catch (const std::exception& e) {
                 failure_count++;
-                std::string msg = e.what();
+                PgError error = pgError(e);
                 
-                // Check if this is a FK violation on cluster_id
-                bool is_cluster_fk = (msg.find("foreign key") != std::string::npos) && 
-                                     (msg.find("cluster_id") != std::string::npos);
-                
-                if (is_cluster_fk) {
+                // An FK violation is usually the cluster; the retry tells us if it was author_id instead
+                if (error.kind == PgErrorKind::ForeignKey) {
                     // Attempt to create placeholder cluster and retry
                     try {
                         // Create placeholder in its own subtransaction (silent, count later)
                         pqxx::subtransaction placeholder_sub(txn, "placeholder_cluster_" + std::to_string(opinion.cluster_id));
-                        createPlaceholderCluster(placeholder_sub, opinion.cluster_id, 2147483647);
+                        bool created = createPlaceholderCluster(placeholder_sub, opinion.cluster_id, 2147483647);
                         placeholder_sub.commit();
-                        placeholder_clusters_created++;
+                        if (created) placeholder_clusters_created++;
                         
                         // Retry the opinion insert in another subtransaction
                         pqxx::subtransaction retry_sub(txn, "retry_opinion_" + std::to_string(opinion.id));
-                        retry_sub.exec_params(query,
+                        retry_sub.exec_prepared("opinion_insert_or_skip",
                             opinion.id,
                             opinion.date_created,
                             opinion.date_modified,
@@ -274,32 +359,34 @@ void OpinionDatabase::insertOpinions(const std::vector<Opinion>& opinions) {
                         continue; // Skip the categorization below
                     } catch (const std::exception& retry_ex) {
                         std::cerr << "Failed to create placeholder or retry for opinion id=" << opinion.id 
-                                  << ": " << retry_ex.what() << "\n";
+                                  << ": " << pgError(retry_ex).describe() << "\n";
                         // Fall through to categorize as FK failure
                     }
                 }
                 
                 // Categorize failure
-                if (msg.find("foreign key") != std::string::npos) {
-                    fk_violations++;
-                } else if (msg.find("not-null") != std::string::npos || msg.find("violates not-null") != std::string::npos) {
-                    not_null_violations++;
-                } else if (msg.find("duplicate key") != std::string::npos || msg.find("unique constraint") != std::string::npos) {
-                    unique_violations++;
-                } else {
-                    other_errors++;
+                switch (error.kind) {
+                    case PgErrorKind::ForeignKey: fk_violations++; break;
+                    case PgErrorKind::NotNull: not_null_violations++; break;
+                    case PgErrorKind::Unique: unique_violations++; break;
+                    default: other_errors++; break;
                 }
                 
                 // Collect sample failures
                 if (failure_samples.size() < max_samples) {
                     std::ostringstream sample;
-                    sample << "id=" << opinion.id << " cluster_id=" << opinion.cluster_id << " msg=" << msg;
+                    sample << "id=" << opinion.id << " cluster_id=" << opinion.cluster_id << " msg=" << error.describe();
                     failure_samples.push_back(sample.str());
                 }
             }
         }
         
-        txn.commit();
+        {
+            StageTimer commit_timer("commit", "search_opinion");
+            txn.commit();
+        }
+        Metrics::global().add("records_inserted", "search_opinion", success_count);
+        Metrics::global().add("records_rejected", "search_opinion", failure_count);
         
         // Print batch statistics
         std::cout << "DB batch: inserted=" << success_count 
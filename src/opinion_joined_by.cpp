@@ -1,4 +1,6 @@
 #include "opinion_joined_by.h"
+#include "input_stream.h"
+#include "metrics.h"
 
 #include <algorithm>
 #include <cctype>
@@ -46,7 +48,22 @@ string OpinionJoinedBy::toCsv() const {
 }
 
 OpinionJoinedByReader::OpinionJoinedByReader(const string& filename) 
-    : filename_(filename) {}
+    : filename_(filename), header_parsed_(false), total_lines_read_(0) {
+    file_.open(filename_);
+    if (!file_.is_open()) {
+        throw std::runtime_error("Failed to open joined_by CSV file: " + filename_);
+    }
+}
+
+OpinionJoinedByReader::~OpinionJoinedByReader() {
+    if (file_.is_open()) {
+        file_.close();
+    }
+}
+
+bool OpinionJoinedByReader::hasMore() const {
+    return file_.good() && !file_.eof();
+}
 
 void OpinionJoinedByReader::parseHeader(const string& header_line) {
     header_ = splitCsvLine(header_line);
@@ -130,17 +147,11 @@ OpinionJoinedBy OpinionJoinedByReader::parseCsvLine(const string& line) {
     return record;
 }
 
-vector<OpinionJoinedBy> OpinionJoinedByReader::readAll() {
-    vector<OpinionJoinedBy> records;
+void OpinionJoinedByReader::ensureHeader() {
+    if (header_parsed_) return;
     
-    std::ifstream file(filename_);
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to open joined_by CSV file: " + filename_);
-    }
-    
-    // Read and parse header
     string header_line;
-    if (!std::getline(file, header_line)) {
+    if (!std::getline(file_, header_line)) {
         throw std::runtime_error("JoinedBy CSV file is empty or missing header");
     }
     
@@ -153,11 +164,14 @@ vector<OpinionJoinedBy> OpinionJoinedByReader::readAll() {
         throw std::runtime_error("JoinedBy CSV missing required columns (id, opinion_id, person_id)");
     }
     
-    // Read all data lines
+    header_parsed_ = true;
+}
+
+bool OpinionJoinedByReader::nextRecord(OpinionJoinedBy& record, size_t& bytes) {
     string line;
-    size_t line_number = 1; // Start at 1 (header is line 0)
-    while (std::getline(file, line)) {
-        line_number++;
+    while (std::getline(file_, line)) {
+        total_lines_read_++;
+        bytes += line.size() + 1;
         
         // Skip empty lines
         if (trim(line).empty()) {
@@ -165,13 +179,72 @@ vector<OpinionJoinedBy> OpinionJoinedByReader::readAll() {
         }
         
         try {
-            records.push_back(parseCsvLine(line));
+            record = parseCsvLine(line);
+            return true;
         } catch (const std::exception& e) {
-            std::cerr << "Warning: Failed to parse line " << line_number 
+            std::cerr << "Warning: Failed to parse line " << (total_lines_read_ + 1) 
                       << ": " << e.what() << std::endl;
             // Continue processing other lines
         }
     }
+    return false;
+}
+
+vector<OpinionJoinedBy> OpinionJoinedByReader::readBatch(size_t batch_size) {
+    StageTimer timer("read", "search_opinion_joined_by");
+    size_t bytes = 0;
+    vector<OpinionJoinedBy> records;
+    records.reserve(batch_size);
+    
+    ensureHeader();
+    
+    OpinionJoinedBy record;
+    while (records.size() < batch_size && nextRecord(record, bytes)) {
+        records.push_back(record);
+    }
+    
+    Metrics::global().add("records_read", "search_opinion_joined_by", records.size());
+    Metrics::global().add("bytes_read", "search_opinion_joined_by", bytes);
+    return records;
+}
+
+size_t OpinionJoinedByReader::readBatch(Int32Batch& batch, size_t batch_size) {
+    StageTimer timer("read", "search_opinion_joined_by");
+    size_t bytes = 0;
+    if (batch.columnCount() != OpinionJoinedBy::kColumnCount) batch = Int32Batch(OpinionJoinedBy::kColumnCount);
+    batch.clear();
+    batch.reserve(batch_size);
+    
+    ensureHeader();
+    
+    OpinionJoinedBy record;
+    while (batch.size() < batch_size && nextRecord(record, bytes)) {
+        record.appendTo(batch);
+    }
+    
+    Metrics::global().add("records_read", "search_opinion_joined_by", batch.size());
+    Metrics::global().add("bytes_read", "search_opinion_joined_by", bytes);
+    return batch.size();
+}
+
+vector<OpinionJoinedBy> OpinionJoinedByReader::readAll() {
+    vector<OpinionJoinedBy> records;
+    
+    // Use streaming approach for consistency
+    while (hasMore()) {
+        auto batch = readBatch(10000);
+        if (batch.empty()) break;
+        records.insert(records.end(), batch.begin(), batch.end());
+    }
     
     return records;
 }
+
+void OpinionJoinedByReader::readAll(Int32Batch& batch) {
+    batch.clear();
+    Int32Batch chunk(OpinionJoinedBy::kColumnCount);
+    while (hasMore()) {
+        if (readBatch(chunk, 10000) == 0) break;
+        batch.append(chunk);
+    }
+}
@@ -1,7 +1,52 @@
 #include "opinion_joined_by_db.h"
+#include "id_cache.h"
+#include "pg_error.h"
+#include "metrics.h"
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
+static const char* kJoinedByUpsertSql =
+    "INSERT INTO search_opinion_joined_by (id, opinion_id, person_id) VALUES ($1, $2, $3) "
+    "ON CONFLICT (opinion_id, person_id) DO UPDATE SET id = EXCLUDED.id";
+
+// Placeholder cluster (id=1) referenced by every placeholder opinion, with all
+// NOT NULL fields of search_opinioncluster
+static const char* kEnsureClusterSql =
+    "INSERT INTO search_opinioncluster ("
+    "id, date_created, date_modified, judges, date_filed, "
+    "case_name_short, case_name, case_name_full, scdb_id, source, "
+    "procedural_history, attorneys, nature_of_suit, posture, syllabus, "
+    "citation_count, precedential_status, blocked, docket_id, "
+    "date_filed_is_approximate, correction, cross_reference, disposition, "
+    "filepath_json_harvard, headnotes, history, other_dates, summary, "
+    "arguments, headmatter, filepath_pdf_harvard"
+    ") VALUES ("
+    "1, NOW(), NOW(), '', '0001-01-01', "
+    "'Placeholder', 'Placeholder Case', 'Placeholder Case', '', 'C', "
+    "'', '', '', '', '', "
+    "0, 'Published', false, 1, "
+    "false, '', '', '', "
+    "'', '', '', '', '', "
+    "'', '', ''"
+    ") ON CONFLICT (id) DO NOTHING";
+
+// Minimal placeholder opinion; type '010' is Combined Opinion and sha1 must be unique
+static const char* kPlaceholderOpinionSql =
+    "INSERT INTO search_opinion ("
+    "id, date_created, date_modified, type, sha1, "
+    "download_url, local_path, plain_text, html, html_lawbox, "
+    "html_columbia, html_with_citations, extracted_by_ocr, "
+    "cluster_id, per_curiam, author_str, joined_by_str, "
+    "xml_harvard, html_anon_2020"
+    ") VALUES ("
+    "$1, NOW(), NOW(), '010', 'PLACEHOLDER_' || $1::text, "
+    "'', '', '', '', '', "
+    "'', '', false, "
+    "1, false, '', '', "
+    "'', ''"
+    ") ON CONFLICT (id) DO NOTHING";
+
 OpinionJoinedByDatabase::OpinionJoinedByDatabase(
     const std::string& host, int port,
     const std::string& dbname, const std::string& user,
@@ -14,12 +59,13 @@ OpinionJoinedByDatabase::OpinionJoinedByDatabase(
         << " user=" << user
         << " password=" << password;
     connection_string_ = oss.str();
+    pool_ = ConnectionPool::shared(connection_string_);
 }
 
 bool OpinionJoinedByDatabase::testConnection() {
     try {
-        pqxx::connection conn(connection_string_);
-        return conn.is_open();
+        auto conn = pool_->acquire();
+        return conn->is_open();
     } catch (const std::exception& e) {
         std::cerr << "Connection test failed: " << e.what() << std::endl;
         return false;
@@ -30,21 +76,16 @@ void OpinionJoinedByDatabase::loadValidOpinionIds() {
     valid_opinion_ids_.clear();
     
     try {
-        pqxx::connection conn(connection_string_);
-        pqxx::work txn(conn);
+        auto conn = pool_->acquire();
+        pqxx::work txn(*conn);
         
-        std::string query = "SELECT id FROM search_opinion";
-        pqxx::result res = txn.exec(query);
-        
-        for (const auto& row : res) {
-            int opinion_id = row[0].as<int>();
-            valid_opinion_ids_.insert(opinion_id);
-        }
+        size_t fetched = loadIdCache(txn, "search_opinion", valid_opinion_ids_, id_snapshot_dir_, verify_id_cache_);
         
         txn.commit();
+        valid_ids_loaded_ = true;
         
         std::cout << "Loaded " << valid_opinion_ids_.size() 
-                  << " valid opinion IDs from database\n";
+                  << " valid opinion IDs (" << fetched << " read from database)\n";
                   
     } catch (const std::exception& e) {
         std::cerr << "Failed to load valid opinion IDs: " << e.what() << std::endl;
@@ -52,58 +93,41 @@ void OpinionJoinedByDatabase::loadValidOpinionIds() {
     }
 }
 
+void OpinionJoinedByDatabase::prepareStatements(pqxx::connection& conn) {
+    pool_->prepare(conn, "joined_by_upsert", kJoinedByUpsertSql);
+    pool_->prepare(conn, "joined_by_ensure_cluster", kEnsureClusterSql);
+    pool_->prepare(conn, "joined_by_placeholder_opinion", kPlaceholderOpinionSql);
+}
+
 bool OpinionJoinedByDatabase::isValidOpinionId(int opinion_id) const {
-    return valid_opinion_ids_.find(opinion_id) != valid_opinion_ids_.end();
+    return valid_opinion_ids_.contains(opinion_id);
 }
 
 bool OpinionJoinedByDatabase::createPlaceholderOpinion(int opinion_id) {
     try {
-        pqxx::connection conn(connection_string_);
+        auto conn = pool_->acquire();
+        prepareStatements(*conn);
+        return createPlaceholderOpinion(*conn, opinion_id);
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to create placeholder opinion for id=" << opinion_id
+                  << ": " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool OpinionJoinedByDatabase::createPlaceholderOpinion(pqxx::connection& conn, int opinion_id) {
+    StageTimer timer("placeholder", "search_opinion_joined_by");
+    try {
         pqxx::work txn(conn);
         
-        // First ensure we have a placeholder cluster (id=1) that we can reference
-        // This is needed because cluster_id is NOT NULL in search_opinion
-        // Include ALL required NOT NULL fields based on actual schema
-        std::string ensure_cluster = 
-            "INSERT INTO search_opinioncluster ("
-            "id, date_created, date_modified, judges, date_filed, "
-            "case_name_short, case_name, case_name_full, scdb_id, source, "
-            "procedural_history, attorneys, nature_of_suit, posture, syllabus, "
-            "citation_count, precedential_status, blocked, docket_id, "
-            "date_filed_is_approximate, correction, cross_reference, disposition, "
-            "filepath_json_harvard, headnotes, history, other_dates, summary, "
-            "arguments, headmatter, filepath_pdf_harvard"
-            ") VALUES ("
-            "1, NOW(), NOW(), '', '0001-01-01', "
-            "'Placeholder', 'Placeholder Case', 'Placeholder Case', '', 'C', "
-            "'', '', '', '', '', "
-            "0, 'Published', false, 1, "
-            "false, '', '', '', "
-            "'', '', '', '', '', "
-            "'', '', ''"
-            ") ON CONFLICT (id) DO NOTHING";
-        txn.exec(ensure_cluster);
+        // First ensure the placeholder cluster (id=1) exists; cluster_id is NOT NULL
+        // in search_opinion, so every placeholder opinion references it
+        txn.exec_prepared("joined_by_ensure_cluster");
         
         // Create minimal placeholder with all required NOT NULL fields for search_opinion
-        std::ostringstream query;
-        query << "INSERT INTO search_opinion ("
-              << "id, date_created, date_modified, type, sha1, "
-              << "download_url, local_path, plain_text, html, html_lawbox, "
-              << "html_columbia, html_with_citations, extracted_by_ocr, "
-              << "cluster_id, per_curiam, author_str, joined_by_str, "
-              << "xml_harvard, html_anon_2020"
-              << ") VALUES ("
-              << opinion_id << ", "
-              << "NOW(), NOW(), '010', "  // type = '010' for Combined Opinion
-              << "'PLACEHOLDER_" << opinion_id << "', "  // sha1 must be unique
-              << "'', '', '', '', '', "  // download_url, local_path, plain_text, html, html_lawbox
-              << "'', '', false, "  // html_columbia, html_with_citations, extracted_by_ocr
-              << "1, false, '', '', "  // cluster_id (references placeholder), per_curiam, author_str, joined_by_str
-              << "'', ''"  // xml_harvard, html_anon_2020
-              << ") ON CONFLICT (id) DO NOTHING";
-        
-        pqxx::result res = txn.exec(query.str());
+        txn.exec_prepared("joined_by_placeholder_opinion", opinion_id);
         txn.commit();
+        Metrics::global().add("placeholders_created", "search_opinion_joined_by", 1);
         
         // Add to valid opinion IDs cache
         valid_opinion_ids_.insert(opinion_id);
@@ -119,67 +143,62 @@ bool OpinionJoinedByDatabase::createPlaceholderOpinion(int opinion_id) {
 }
 
 size_t OpinionJoinedByDatabase::insertJoinedBy(
-    const std::vector<OpinionJoinedBy>& records,
-    std::vector<OpinionJoinedBy>& rejected_records,
+    const Int32Batch& records,
+    Int32Batch& rejected_records,
     std::vector<std::string>& rejection_reasons) {
     
     rejected_records.clear();
     rejection_reasons.clear();
     
     size_t inserted = 0;
+    StageTimer timer("insert", "search_opinion_joined_by");
     
     // Insert records line by line and collect failures
     try {
-        pqxx::connection conn(connection_string_);
+        auto conn = pool_->acquire();
+        prepareStatements(*conn);
         
-        for (const auto& record : records) {
+        // One pass over the FK column against the ID cache, so missing opinions get their
+        // placeholder before the insert rather than after a failed one
+        if (valid_ids_loaded_ && !records.empty()) {
+            std::vector<int> missing;
+            valid_opinion_ids_.collectMissing(records.column(OpinionJoinedBy::kOpinionId), missing);
+            std::sort(missing.begin(), missing.end());
+            missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+            for (int opinion_id : missing) {
+                createPlaceholderOpinion(*conn, opinion_id);
+            }
+        }
+        
+        for (size_t i = 0; i < records.size(); ++i) {
+            OpinionJoinedBy record = OpinionJoinedBy::fromBatch(records, i);
             try {
                 // Start a new transaction for each record
-                pqxx::work txn(conn);
-                
-                // Build insert query with upsert to handle duplicates
-                std::ostringstream query;
-                query << "INSERT INTO search_opinion_joined_by "
-                      << "(id, opinion_id, person_id) VALUES ("
-                      << record.id << ", "
-                      << record.opinion_id << ", "
-                      << record.person_id
-                      << ") ON CONFLICT (opinion_id, person_id) "
-                      << "DO UPDATE SET id = EXCLUDED.id";
+                pqxx::work txn(*conn);
                 
-                pqxx::result res = txn.exec(query.str());
+                // Upsert to handle duplicates
+                txn.exec_prepared("joined_by_upsert", record.id, record.opinion_id, record.person_id);
                 txn.commit();
                 
                 // Successfully inserted
                 inserted++;
                 
             } catch (const std::exception& e) {
-                // Individual record insertion failed - PostgreSQL will tell us why
-                std::string error_msg = e.what();
+                // Individual record insertion failed - the SQLSTATE says why
+                PgError error = pgError(e);
                 
-                // Check if it's an FK violation on opinion_id
-                if ((error_msg.find("foreign key") != std::string::npos || 
-                     error_msg.find("violates foreign key constraint") != std::string::npos) &&
-                    error_msg.find("opinion_id") != std::string::npos) {
+                // FK violation on opinion_id; an opinion the cache knows points at person_id instead
+                if (error.kind == PgErrorKind::ForeignKey && !isValidOpinionId(record.opinion_id)) {
                     
                     std::cout << "FK violation detected for opinion_id=" << record.opinion_id 
                               << ", creating placeholder..." << std::endl;
                     
                     // Try to create placeholder and retry insert
-                    if (createPlaceholderOpinion(record.opinion_id)) {
+                    if (createPlaceholderOpinion(*conn, record.opinion_id)) {
                         try {
                             // Retry the insert with upsert
-                            pqxx::work retry_txn(conn);
-                            std::ostringstream retry_query;
-                            retry_query << "INSERT INTO search_opinion_joined_by "
-                                       << "(id, opinion_id, person_id) VALUES ("
-                                       << record.id << ", "
-                                       << record.opinion_id << ", "
-                                       << record.person_id
-                                       << ") ON CONFLICT (opinion_id, person_id) "
-                                       << "DO UPDATE SET id = EXCLUDED.id";
-                            
-                            retry_txn.exec(retry_query.str());
+                            pqxx::work retry_txn(*conn);
+                            retry_txn.exec_prepared("joined_by_upsert", record.id, record.opinion_id, record.person_id);
                             retry_txn.commit();
                             
                             inserted++;
@@ -188,30 +207,21 @@ size_t OpinionJoinedByDatabase::insertJoinedBy(
                             
                         } catch (const std::exception& retry_e) {
                             // Retry also failed
-                            rejected_records.push_back(record);
-                            std::ostringstream reason;
-                            reason << "FK violation, placeholder created but retry failed: " << retry_e.what();
-                            rejection_reasons.push_back(reason.str());
+                            record.appendTo(rejected_records);
+                            rejection_reasons.push_back("FK violation, placeholder created but retry failed: " +
+                                                        pgError(retry_e).describe());
                         }
                     } else {
                         // Failed to create placeholder
-                        rejected_records.push_back(record);
-                        std::ostringstream reason;
-                        reason << "FK violation, failed to create placeholder: " << error_msg;
-                        rejection_reasons.push_back(reason.str());
+                        record.appendTo(rejected_records);
+                        rejection_reasons.push_back("FK violation, failed to create placeholder: " + error.describe());
                     }
                 } else {
                     // Other types of errors
-                    rejected_records.push_back(record);
-                    std::ostringstream reason;
-                    
-                    if (error_msg.find("duplicate key") != std::string::npos) {
-                        reason << "Duplicate key violation: " << error_msg;
-                    } else {
-                        reason << "DB error: " << error_msg;
-                    }
-                    
-                    rejection_reasons.push_back(reason.str());
+                    record.appendTo(rejected_records);
+                    rejection_reasons.push_back((error.kind == PgErrorKind::Unique ? "Duplicate key violation: "
+                                                                                    : "DB error: ") +
+                                                error.describe());
                 }
             }
         }
@@ -220,15 +230,13 @@ size_t OpinionJoinedByDatabase::insertJoinedBy(
         std::cerr << "Database connection failed: " << e.what() << std::endl;
         
         // Connection failed - reject all remaining records
-        for (const auto& record : records) {
-            rejected_records.push_back(record);
-            std::ostringstream reason;
-            reason << "Connection error: " << e.what();
-            rejection_reasons.push_back(reason.str());
-        }
-        
-        return inserted;
+        rejected_records.append(records);
+        std::ostringstream reason;
+        reason << "Connection error: " << e.what();
+        rejection_reasons.resize(rejected_records.size(), reason.str());
     }
     
+    Metrics::global().add("records_inserted", "search_opinion_joined_by", inserted);
+    Metrics::global().add("records_rejected", "search_opinion_joined_by", rejected_records.size());
     return inserted;
 }
@@ -3,16 +3,23 @@
 #include <vector>
 #include <string>
 #include <exception>
+#include <algorithm>
 #include "opinion_cluster_panel.h"
 #include "opinion_cluster_panel_db.h"
+#include "metrics.h"
+#include "pipeline.h"
 
 int main(int argc, char** argv) {
 
-    // CLI parsing: panel_ingestion_app <panels.csv> [--no-db] [--bad-records=file.csv] [--batch=N]
+    // CLI parsing: panel_ingestion_app <panels.csv> [--no-db] [--bad-records=file.csv] [--batch=N] [--queue-depth=N] [--id-snapshot-dir=DIR] [--verify-id-cache] [--metrics=FILE]
     std::string csvPath;
     std::string bad_records_file; // optional output file for bad records
+    std::string id_snapshot_dir; // where FK id cache snapshots live (empty = full scan every run)
+    bool verify_id_cache = false; // check refreshed id caches against COUNT(*)
     bool skip_db = false;
     size_t batch_records = 5000; // records per DB batch
+    size_t queue_depth = 4; // batches read ahead while the DB works
+    MetricsOptions metrics_options; // --metrics=FILE: periodic histogram/counter dumps
 
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
@@ -24,53 +31,67 @@ int main(int argc, char** argv) {
         } else if (arg.rfind("--batch=", 0) == 0) {
             try { batch_records = static_cast<size_t>(std::stoull(arg.substr(8))); }
             catch (...) { std::cerr << "Invalid --batch value\n"; return 1; }
+        } else if (arg == "--queue-depth" && i + 1 < argc) {
+            try { queue_depth = static_cast<size_t>(std::stoull(argv[++i])); }
+            catch (...) { std::cerr << "Invalid --queue-depth value\n"; return 1; }
+        } else if (arg.rfind("--queue-depth=", 0) == 0) {
+            try { queue_depth = static_cast<size_t>(std::stoull(arg.substr(14))); }
+            catch (...) { std::cerr << "Invalid --queue-depth value\n"; return 1; }
         } else if (arg == "--bad-records" && i + 1 < argc) {
             bad_records_file = argv[++i];
         } else if (arg.rfind("--bad-records=", 0) == 0) {
             bad_records_file = arg.substr(14);
+        } else if (arg == "--id-snapshot-dir" && i + 1 < argc) {
+            id_snapshot_dir = argv[++i];
+        } else if (arg.rfind("--id-snapshot-dir=", 0) == 0) {
+            id_snapshot_dir = arg.substr(18);
+        } else if (arg == "--verify-id-cache") {
+            verify_id_cache = true;
+        } else if (arg.rfind("--metrics", 0) == 0) {
+            try { if (!parseMetricsOption(arg, metrics_options)) throw std::invalid_argument("Unknown option: " + arg); }
+            catch (const std::invalid_argument& e) { std::cerr << e.what() << "\n"; return 1; }
         } else if (!arg.empty() && arg[0] == '-') {
             std::cerr << "Unknown option: " << arg << "\n";
-            std::cout << "Usage: panel_ingestion_app <panels.csv> [--no-db] [--batch=N] [--bad-records=file.csv]\n";
+            std::cout << "Usage: panel_ingestion_app <panels.csv> [--no-db] [--batch=N] [--bad-records=file.csv] [--queue-depth=N] [--id-snapshot-dir=DIR] [--verify-id-cache] [--metrics=FILE]\n";
             return 1;
         } else if (csvPath.empty()) {
             csvPath = arg; // first non-option argument is the CSV path
         } else {
             std::cerr << "Unexpected extra argument: " << arg << "\n";
-            std::cout << "Usage: panel_ingestion_app <panels.csv> [--no-db] [--batch=N] [--bad-records=file.csv]\n";
+            std::cout << "Usage: panel_ingestion_app <panels.csv> [--no-db] [--batch=N] [--bad-records=file.csv] [--queue-depth=N] [--id-snapshot-dir=DIR] [--verify-id-cache] [--metrics=FILE]\n";
             return 1;
         }
     }
 
     if (csvPath.empty()) {
-        std::cout << "Usage: panel_ingestion_app <panels.csv> [--no-db] [--batch=N] [--bad-records=file.csv]\n";
+        std::cout << "Usage: panel_ingestion_app <panels.csv> [--no-db] [--batch=N] [--bad-records=file.csv] [--queue-depth=N] [--id-snapshot-dir=DIR] [--verify-id-cache] [--metrics=FILE]\n";
         std::cout << "  --no-db              Skip database insertion (just parse and display)\n";
         std::cout << "  --batch=N            Batch size for DB insertion (default 5000)\n";
         std::cout << "  --bad-records=FILE   Save bad records to CSV file (FK violations)\n";
+        std::cout << "  --id-snapshot-dir=D  Reuse/refresh FK id cache snapshots in directory D\n";
+        std::cout << "  --verify-id-cache    Check refreshed id caches against COUNT(*) (full table scan)\n";
+        std::cout << "  --queue-depth=N      Batches read ahead while inserting (default 4)\n";
+        std::cout << metricsUsage();
         return 0;
     }
+    auto metrics_exporter = MetricsExporter::start(metrics_options);
     
     std::cout << "Reading panel records from: " << csvPath << "\n";
     
     try {
         OpinionClusterPanelReader reader(csvPath);
         
-        // Read all records from CSV
-        std::cout << "Reading all panel records from CSV...\n";
-        std::vector<OpinionClusterPanel> panels = reader.readAll();
-        std::cout << "Loaded " << panels.size() << " panel records from CSV\n";
-        
-        if (panels.empty()) {
-            std::cout << "No records found in CSV file.\n";
-            return 0;
-        }
-        
-        // Parse-only mode (skip_db)
+        // Parse-only mode (skip_db) - read first batch only for display
         if (skip_db) {
-            std::cout << "Showing first 10 parsed panel records:\n";
-            for (size_t i = 0; i < panels.size() && i < 10; ++i) {
-                std::cout << "  " << panels[i].toString() << "\n";
+            std::cout << "Reading first batch for display...\n";
+            std::vector<OpinionClusterPanel> sample_records = reader.readBatch(10);
+            std::cout << "Showing first " << sample_records.size() << " parsed panel records:\n";
+            for (size_t i = 0; i < sample_records.size(); ++i) {
+                std::cout << "  " << sample_records[i].toString() << "\n";
             }
             std::cout << "\nSkipping database insertion (--no-db flag)\n";
+            std::cout << "Note: File will be processed in batches of " << batch_records 
+                      << " when run with database.\n";
             return 0;
         }
         
@@ -83,6 +104,8 @@ int main(int argc, char** argv) {
             return 1; 
         }
         std::cout << "Connection successful!\n";
+        db.setIdSnapshotDir(id_snapshot_dir);
+        db.setVerifyIdCache(verify_id_cache);
         
         // Load valid cluster IDs for FK validation
         std::cout << "Loading valid cluster IDs from database for FK validation...\n";
@@ -103,75 +126,88 @@ int main(int argc, char** argv) {
         
         size_t total_inserted = 0, total_rejected = 0;
         size_t batch_count = 0;
+        size_t total_records_processed = 0;
         
-        // DEBUG: Collect all bad records for debugging
-        std::vector<OpinionClusterPanel> all_bad_records;
-        std::vector<std::string> all_bad_reasons;
+        // DEBUG: Keep the first few bad records for the end-of-run summary; the rest
+        // are only counted (total_rejected) and written to --bad-records
+        const size_t kBadRecordSample = 10;
+        Int32Batch first_bad_records(OpinionClusterPanel::kColumnCount);
+        std::vector<std::string> first_bad_reasons;
         
-        // Process in batches
+        // Process in batches using streaming
         std::cout << "\nProcessing records in batches of " << batch_records << "...\n";
-        for (size_t i = 0; i < panels.size(); i += batch_records) {
-            size_t batch_end = std::min(i + batch_records, panels.size());
-            std::vector<OpinionClusterPanel> batch(panels.begin() + i, panels.begin() + batch_end);
+        
+        // The reader thread reads and parses the next batches while this thread inserts;
+        // the queue depth bounds how far ahead it can get, so memory stays at a few batches.
+        runReadWritePipeline<Int32Batch>(queue_depth,
+            [&](Int32Batch& batch) {
+                if (!reader.hasMore()) return false;
+                return reader.readBatch(batch, batch_records) > 0;
+            },
+            [&](Int32Batch&& batch) {
+                size_t batch_start = total_records_processed;
+                total_records_processed += batch.size();
             
-            // Insert batch with FK validation
-            std::vector<OpinionClusterPanel> rejected_panels;
-            std::vector<std::string> rejection_reasons;
+                // Insert batch with FK validation
+                Int32Batch rejected_panels(OpinionClusterPanel::kColumnCount);
+                std::vector<std::string> rejection_reasons;
             
-            size_t inserted = db.insertPanels(batch, rejected_panels, rejection_reasons);
-            total_inserted += inserted;
-            total_rejected += rejected_panels.size();
+                size_t inserted = db.insertPanels(batch, rejected_panels, rejection_reasons);
+                total_inserted += inserted;
+                total_rejected += rejected_panels.size();
             
-            // DEBUG: Collect all rejected records into global debug vectors
-            all_bad_records.insert(all_bad_records.end(), rejected_panels.begin(), rejected_panels.end());
-            all_bad_reasons.insert(all_bad_reasons.end(), rejection_reasons.begin(), rejection_reasons.end());
+                // DEBUG: Top up the bad record sample
+                size_t keep = std::min(rejected_panels.size(), kBadRecordSample - first_bad_records.size());
+                first_bad_records.append(rejected_panels, 0, keep);
+                first_bad_reasons.insert(first_bad_reasons.end(), rejection_reasons.begin(),
+                                         rejection_reasons.begin() + keep);
             
-            // Save rejected records to bad records file
-            if (bad_records_stream.is_open() && !rejected_panels.empty()) {
-                for (size_t j = 0; j < rejected_panels.size(); ++j) {
-                    bad_records_stream << rejected_panels[j].toCsv() << ","
-                                      << "\"" << rejection_reasons[j] << "\"\n";
-                }
-                bad_records_stream.flush(); // Ensure data is written immediately
-            } else if (!rejected_panels.empty() && bad_records_file.empty()) {
-                // Show first few rejected records if no output file specified
-                if (batch_count == 0) {
-                    std::cout << "\nSample rejected records (first 5):\n";
-                    for (size_t j = 0; j < rejected_panels.size() && j < 5; ++j) {
-                        std::cout << "  " << rejected_panels[j].toString() 
-                                  << " - " << rejection_reasons[j] << "\n";
+                // Save rejected records to bad records file
+                if (bad_records_stream.is_open() && !rejected_panels.empty()) {
+                    for (size_t j = 0; j < rejected_panels.size(); ++j) {
+                        bad_records_stream << rejected_panels.rowCsv(j) << ","
+                                          << "\"" << rejection_reasons[j] << "\"\n";
+                    }
+                    bad_records_stream.flush(); // Ensure data is written immediately
+                } else if (!rejected_panels.empty() && bad_records_file.empty()) {
+                    // Show first few rejected records if no output file specified
+                    if (batch_count == 0) {
+                        std::cout << "\nSample rejected records (first 5):\n";
+                        for (size_t j = 0; j < rejected_panels.size() && j < 5; ++j) {
+                            std::cout << "  " << OpinionClusterPanel::fromBatch(rejected_panels, j).toString() 
+                                      << " - " << rejection_reasons[j] << "\n";
+                        }
+                        std::cout << "  (Use --bad-records=file.csv to save all rejected records)\n\n";
                     }
-                    std::cout << "  (Use --bad-records=file.csv to save all rejected records)\n\n";
                 }
-            }
             
-            batch_count++;
-            std::cout << "Batch " << batch_count 
-                      << ": inserted=" << inserted
-                      << ", rejected=" << rejected_panels.size()
-                      << " (records " << i << "-" << (batch_end-1) << ")\n";
-        }
+                batch_count++;
+                std::cout << "Batch " << batch_count 
+                          << ": inserted=" << inserted
+                          << ", rejected=" << rejected_panels.size()
+                          << " (records " << batch_start << "-" << (total_records_processed-1) << ")\n";
+            });
         
         if (bad_records_stream.is_open()) {
             bad_records_stream.close();
         }
         
         std::cout << "\n=== SUMMARY ===\n";
-        std::cout << "Total records:      " << panels.size() << "\n";
+        std::cout << "Total records:      " << total_records_processed << "\n";
         std::cout << "Total inserted:     " << total_inserted << "\n";
         std::cout << "Total rejected:     " << total_rejected << " (FK violations)\n";
         std::cout << "Batches processed:  " << batch_count << "\n";
         
         // DEBUG: Show statistics about bad records
         std::cout << "\n=== DEBUG: BAD RECORDS COLLECTED ===\n";
-        std::cout << "Bad records in memory: " << all_bad_records.size() << "\n";
+        std::cout << "Bad records seen: " << total_rejected << "\n";
         
         // Show first 10 bad records for debugging
-        if (!all_bad_records.empty()) {
-            std::cout << "\nFirst 10 bad records:\n";
-            for (size_t i = 0; i < all_bad_records.size() && i < 10; ++i) {
-                std::cout << "  [" << i << "] " << all_bad_records[i].toString() 
-                          << "\n      Reason: " << all_bad_reasons[i] << "\n";
+        if (!first_bad_records.empty()) {
+            std::cout << "\nFirst " << first_bad_records.size() << " bad records:\n";
+            for (size_t i = 0; i < first_bad_records.size(); ++i) {
+                std::cout << "  [" << i << "] " << OpinionClusterPanel::fromBatch(first_bad_records, i).toString() 
+                          << "\n      Reason: " << first_bad_reasons[i] << "\n";
             }
         }
         
@@ -179,7 +215,7 @@ int main(int argc, char** argv) {
             std::cout << "\nBad records saved to: " << bad_records_file << "\n";
         }
         
-        // DEBUG: Set breakpoint here to inspect all_bad_records and all_bad_reasons vectors
+        // DEBUG: Set breakpoint here to inspect first_bad_records and first_bad_reasons
         
     } catch (const std::exception& e) {
         std::cerr << "Fatal error: " << e.what() << std::endl;
@@ -1,4 +1,5 @@
 #include "parenthetical.h"
+#include "metrics.h"
 #include <iostream>
 #include <algorithm>
 #include <map>
@@ -53,6 +54,8 @@ bool ParentheticalReader::hasMore() const {
 }
 
 std::vector<Parenthetical> ParentheticalReader::readBatch(size_t batch_size) {
+    StageTimer timer("read", "search_parenthetical");
+    size_t bytes = 0;
     std::vector<Parenthetical> records;
     
     if (!file_.is_open() || file_.eof()) {
@@ -72,6 +75,7 @@ std::vector<Parenthetical> ParentheticalReader::readBatch(size_t batch_size) {
     // Read batch_size records
     std::string line;
     while (records.size() < batch_size && std::getline(file_, line)) {
+        bytes += line.size() + 1;
         if (line.empty()) continue;
         
         try {
@@ -83,6 +87,8 @@ std::vector<Parenthetical> ParentheticalReader::readBatch(size_t batch_size) {
         }
     }
     
+    Metrics::global().add("records_read", "search_parenthetical", records.size());
+    Metrics::global().add("bytes_read", "search_parenthetical", bytes);
     return records;
 }
 
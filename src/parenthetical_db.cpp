@@ -1,7 +1,36 @@
 #include "parenthetical_db.h"
+#include "id_cache.h"
+#include "metrics.h"
+#include "pg_error.h"
 #include <iostream>
 #include <sstream>
 
+static const char* kParentheticalUpsertSql =
+    "INSERT INTO search_parenthetical "
+    "(id, text, score, described_opinion_id, describing_opinion_id, group_id) "
+    "VALUES ($1, $2, $3, $4, $5, $6) ON CONFLICT (id) "
+    "DO UPDATE SET text = EXCLUDED.text, score = EXCLUDED.score, "
+    "described_opinion_id = EXCLUDED.described_opinion_id, "
+    "describing_opinion_id = EXCLUDED.describing_opinion_id, "
+    "group_id = EXCLUDED.group_id";
+
+// Placeholder group hanging off the base placeholders (opinion 1, parenthetical 1)
+static const char* kPlaceholderGroupSql =
+    "INSERT INTO search_parentheticalgroup (id, score, size, opinion_id, representative_id) "
+    "VALUES ($1, 0.0, 0, 1, 1) ON CONFLICT (id) DO NOTHING";
+
+// Placeholder opinion with cluster_id=1 (assumed to exist)
+static const char* kPlaceholderOpinionSql =
+    "INSERT INTO search_opinion ("
+    "id, date_created, date_modified, type, sha1, local_path, "
+    "plain_text, html, html_lawbox, html_columbia, html_with_citations, "
+    "extracted_by_ocr, cluster_id, per_curiam, author_str, joined_by_str, "
+    "xml_harvard, html_anon_2020"
+    ") VALUES ("
+    "$1, NOW(), NOW(), '010', 'PLACEHOLDER_' || $1::text, '', "
+    "'', '', '', '', '', false, 1, false, '', '', '', ''"
+    ") ON CONFLICT (id) DO NOTHING";
+
 ParentheticalDatabase::ParentheticalDatabase(
     const std::string& host, int port,
     const std::string& dbname, const std::string& user,
@@ -14,12 +43,13 @@ ParentheticalDatabase::ParentheticalDatabase(
         << " user=" << user
         << " password=" << password;
     connection_string_ = oss.str();
+    pool_ = ConnectionPool::shared(connection_string_);
 }
 
 bool ParentheticalDatabase::testConnection() {
     try {
-        pqxx::connection conn(connection_string_);
-        return conn.is_open();
+        auto conn = pool_->acquire();
+        return conn->is_open();
     } catch (const std::exception& e) {
         std::cerr << "Connection test failed: " << e.what() << std::endl;
         return false;
@@ -30,21 +60,15 @@ void ParentheticalDatabase::loadValidGroupIds() {
     valid_group_ids_.clear();
     
     try {
-        pqxx::connection conn(connection_string_);
-        pqxx::work txn(conn);
-        
-        std::string query = "SELECT id FROM search_parentheticalgroup";
-        pqxx::result res = txn.exec(query);
+        auto conn = pool_->acquire();
+        pqxx::work txn(*conn);
         
-        for (const auto& row : res) {
-            int group_id = row[0].as<int>();
-            valid_group_ids_.insert(group_id);
-        }
+        size_t fetched = loadIdCache(txn, "search_parentheticalgroup", valid_group_ids_, id_snapshot_dir_, verify_id_cache_);
         
         txn.commit();
         
         std::cout << "Loaded " << valid_group_ids_.size() 
-                  << " valid group IDs from database\n";
+                  << " valid group IDs (" << fetched << " read from database)\n";
                   
     } catch (const std::exception& e) {
         std::cerr << "Failed to load valid group IDs: " << e.what() << std::endl;
@@ -52,14 +76,32 @@ void ParentheticalDatabase::loadValidGroupIds() {
     }
 }
 
+void ParentheticalDatabase::prepareStatements(pqxx::connection& conn) {
+    pool_->prepare(conn, "parenthetical_upsert", kParentheticalUpsertSql);
+    pool_->prepare(conn, "parenthetical_placeholder_group", kPlaceholderGroupSql);
+    pool_->prepare(conn, "parenthetical_opinion_exists", "SELECT 1 FROM search_opinion WHERE id = $1");
+    pool_->prepare(conn, "parenthetical_placeholder_opinion", kPlaceholderOpinionSql);
+}
+
 bool ParentheticalDatabase::isValidGroupId(int group_id) const {
-    return valid_group_ids_.find(group_id) != valid_group_ids_.end();
+    return valid_group_ids_.contains(group_id);
 }
 
 bool ParentheticalDatabase::createPlaceholderGroup(int group_id, std::vector<int>& search_parentheticalgroup_placeholders) {
     try {
-        pqxx::connection conn(connection_string_);
-        
+        auto conn = pool_->acquire();
+        prepareStatements(*conn);
+        return createPlaceholderGroup(*conn, group_id, search_parentheticalgroup_placeholders);
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to create placeholder group for id=" << group_id
+                  << ": " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool ParentheticalDatabase::createPlaceholderGroup(pqxx::connection& conn, int group_id, std::vector<int>& search_parentheticalgroup_placeholders) {
+    StageTimer timer("placeholder", "search_parenthetical");
+    try {
         // CRITICAL: We need to create a complete set of base placeholders (id=1) that reference each other
         // This is complex due to circular FK constraints between the three tables
         
@@ -123,16 +165,9 @@ bool ParentheticalDatabase::createPlaceholderGroup(int group_id, std::vector<int
         
         // Step 3: Now create the actual placeholder group for the requested group_id
         pqxx::work txn(conn);
-        std::ostringstream query;
-        query << "INSERT INTO search_parentheticalgroup ("
-              << "id, score, size, opinion_id, representative_id"
-              << ") VALUES ("
-              << group_id << ", "
-              << "0.0, 0, 1, 1"
-              << ") ON CONFLICT (id) DO NOTHING";
-        
-        txn.exec(query.str());
+        txn.exec_prepared("parenthetical_placeholder_group", group_id);
         txn.commit();
+        Metrics::global().add("placeholders_created", "search_parenthetical", 1);
         
         // Add to valid group IDs cache
         valid_group_ids_.insert(group_id);
@@ -151,31 +186,32 @@ bool ParentheticalDatabase::createPlaceholderGroup(int group_id, std::vector<int
 
 bool ParentheticalDatabase::createPlaceholderOpinion(int opinion_id) {
     try {
-        pqxx::connection conn(connection_string_);
+        auto conn = pool_->acquire();
+        prepareStatements(*conn);
+        return createPlaceholderOpinion(*conn, opinion_id);
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to create placeholder opinion for id=" << opinion_id
+                  << ": " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool ParentheticalDatabase::createPlaceholderOpinion(pqxx::connection& conn, int opinion_id) {
+    StageTimer timer("placeholder", "search_parenthetical");
+    try {
         pqxx::work txn(conn);
         
         // Check if opinion already exists
-        pqxx::result check = txn.exec("SELECT 1 FROM search_opinion WHERE id = " + std::to_string(opinion_id));
+        pqxx::result check = txn.exec_prepared("parenthetical_opinion_exists", opinion_id);
         if (!check.empty()) {
             txn.commit();
             return true; // Already exists
         }
         
         // Create placeholder opinion with cluster_id=1 (assumed to exist)
-        std::ostringstream query;
-        query << "INSERT INTO search_opinion ("
-              << "id, date_created, date_modified, type, sha1, local_path, "
-              << "plain_text, html, html_lawbox, html_columbia, html_with_citations, "
-              << "extracted_by_ocr, cluster_id, per_curiam, author_str, joined_by_str, "
-              << "xml_harvard, html_anon_2020"
-              << ") VALUES ("
-              << opinion_id << ", "
-              << "NOW(), NOW(), '010', 'PLACEHOLDER_" << opinion_id << "', '', "
-              << "'', '', '', '', '', false, 1, false, '', '', '', ''"
-              << ") ON CONFLICT (id) DO NOTHING";
-        
-        txn.exec(query.str());
+        txn.exec_prepared("parenthetical_placeholder_opinion", opinion_id);
         txn.commit();
+        Metrics::global().add("placeholders_created", "search_parenthetical", 1);
         return true;
         
     } catch (const std::exception& e) {
@@ -196,103 +232,52 @@ std::pair<size_t, size_t> ParentheticalDatabase::insertParentheticals(
     
     size_t inserted = 0;
     size_t placeholders_created = 0;
+    StageTimer timer("insert", "search_parenthetical");
     
     // Insert records line by line and collect failures
     try {
-        pqxx::connection conn(connection_string_);
+        auto conn = pool_->acquire();
+        prepareStatements(*conn);
         
         for (const auto& record : records) {
             try {
                 // Start a new transaction for each record
-                pqxx::work txn(conn);
-                
-                // Build insert query with upsert to handle duplicates
-                std::ostringstream query;
-                query << "INSERT INTO search_parenthetical "
-                      << "(id, text, score, described_opinion_id, describing_opinion_id, group_id) VALUES ("
-                      << record.id << ", "
-                      << txn.quote(record.text) << ", "
-                      << record.score << ", "
-                      << record.described_opinion_id << ", "
-                      << record.describing_opinion_id << ", "
-                      << record.group_id
-                      << ") ON CONFLICT (id) "
-                      << "DO UPDATE SET text = EXCLUDED.text, score = EXCLUDED.score, "
-                      << "described_opinion_id = EXCLUDED.described_opinion_id, "
-                      << "describing_opinion_id = EXCLUDED.describing_opinion_id, "
-                      << "group_id = EXCLUDED.group_id";
+                pqxx::work txn(*conn);
                 
-                pqxx::result res = txn.exec(query.str());
+                // Upsert to handle duplicates
+                txn.exec_prepared("parenthetical_upsert", record.id, record.text, record.score,
+                                  record.described_opinion_id, record.describing_opinion_id, record.group_id);
                 txn.commit();
                 
                 // Successfully inserted
                 inserted++;
                 
             } catch (const std::exception& e) {
-                // Individual record insertion failed - PostgreSQL will tell us why
-                std::string error_msg = e.what();
+                // Individual record insertion failed - the SQLSTATE says why
+                PgError error = pgError(e);
                 
-                // Check if it's any FK violation
-                if (error_msg.find("foreign key") != std::string::npos || 
-                    error_msg.find("violates foreign key constraint") != std::string::npos) {
-                    
-                    // Determine which FK(s) are missing and create placeholders for ALL of them
-                    bool needs_described = error_msg.find("described_opinion_id") != std::string::npos;
-                    bool needs_describing = error_msg.find("describing_opinion_id") != std::string::npos;
-                    bool needs_group = error_msg.find("group_id") != std::string::npos;
-                    
-                    // Create all necessary placeholders
-                    bool described_ok = true;
-                    bool describing_ok = true;
-                    bool group_ok = true;
-                    
-                    if (needs_described) {
-                        described_ok = createPlaceholderOpinion(record.described_opinion_id);
-                    }
-                    if (needs_describing) {
-                        describing_ok = createPlaceholderOpinion(record.describing_opinion_id);
-                    }
-                    if (needs_group) {
-                        group_ok = createPlaceholderGroup(record.group_id, search_parentheticalgroup_placeholders);
-                        if (group_ok) placeholders_created++;
-                    }
-                    
-                    // If we couldn't determine the specific FK, try creating all placeholders
-                    if (!needs_described && !needs_describing && !needs_group) {
-                        // Generic FK error - create all placeholders to be safe
-                        createPlaceholderOpinion(record.described_opinion_id);
-                        createPlaceholderOpinion(record.describing_opinion_id);
-                        if (createPlaceholderGroup(record.group_id, search_parentheticalgroup_placeholders)) {
-                            placeholders_created++;
-                        }
+                if (error.kind == PgErrorKind::ForeignKey) {
+                    // The exception does not name the constraint, so ensure every referenced
+                    // row exists (placeholder inserts are no-ops for rows already present)
+                    createPlaceholderOpinion(*conn, record.described_opinion_id);
+                    createPlaceholderOpinion(*conn, record.describing_opinion_id);
+                    if (!valid_group_ids_.contains(record.group_id) &&
+                        createPlaceholderGroup(*conn, record.group_id, search_parentheticalgroup_placeholders)) {
+                        placeholders_created++;
                     }
                     
                     // Now retry the insert
                     try {
-                        pqxx::work retry_txn(conn);
-                        std::ostringstream retry_query;
-                        retry_query << "INSERT INTO search_parenthetical "
-                                   << "(id, text, score, described_opinion_id, describing_opinion_id, group_id) VALUES ("
-                                   << record.id << ", "
-                                   << retry_txn.quote(record.text) << ", "
-                                   << record.score << ", "
-                                   << record.described_opinion_id << ", "
-                                   << record.describing_opinion_id << ", "
-                                   << record.group_id
-                                   << ") ON CONFLICT (id) "
-                                   << "DO UPDATE SET text = EXCLUDED.text, score = EXCLUDED.score, "
-                                   << "described_opinion_id = EXCLUDED.described_opinion_id, "
-                                   << "describing_opinion_id = EXCLUDED.describing_opinion_id, "
-                                   << "group_id = EXCLUDED.group_id";
-                        
-                        retry_txn.exec(retry_query.str());
+                        pqxx::work retry_txn(*conn);
+                        retry_txn.exec_prepared("parenthetical_upsert", record.id, record.text, record.score,
+                                                record.described_opinion_id, record.describing_opinion_id, record.group_id);
                         retry_txn.commit();
                         
                         inserted++;
                         continue; // Success - move to next record
                         
                     } catch (const std::exception& retry_e) {
-                        std::string retry_error = retry_e.what();
+                        std::string retry_error = pgError(retry_e).describe();
                         std::cerr << "REJECTED: Record " << record.toString() 
                                   << "\n  Retry failed after creating placeholders: " << retry_error << std::endl;
                         rejected_records.push_back(record);
@@ -303,17 +288,11 @@ std::pair<size_t, size_t> ParentheticalDatabase::insertParentheticals(
                 } else {
                     // Other types of errors - print to stderr for visibility
                     std::cerr << "REJECTED: Record " << record.toString() 
-                              << "\n  PostgreSQL error: " << error_msg << std::endl;
+                              << "\n  PostgreSQL error: " << error.describe() << std::endl;
                     rejected_records.push_back(record);
-                    std::ostringstream reason;
-                    
-                    if (error_msg.find("duplicate key") != std::string::npos) {
-                        reason << "Duplicate key violation: " << error_msg;
-                    } else {
-                        reason << "DB error: " << error_msg;
-                    }
-                    
-                    rejection_reasons.push_back(reason.str());
+                    rejection_reasons.push_back((error.kind == PgErrorKind::Unique ? "Duplicate key violation: "
+                                                                                    : "DB error: ") +
+                                                error.describe());
                 }
             }
         }
@@ -328,9 +307,9 @@ std::pair<size_t, size_t> ParentheticalDatabase::insertParentheticals(
             reason << "Connection error: " << e.what();
             rejection_reasons.push_back(reason.str());
         }
-        
-        return {inserted, placeholders_created};
     }
     
+    Metrics::global().add("records_inserted", "search_parenthetical", inserted);
+    Metrics::global().add("records_rejected", "search_parenthetical", rejected_records.size());
     return {inserted, placeholders_created};
 }
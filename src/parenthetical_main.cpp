@@ -5,14 +5,20 @@
 #include <exception>
 #include "parenthetical.h"
 #include "parenthetical_db.h"
+#include "metrics.h"
+#include "pipeline.h"
 
 int main(int argc, char** argv) {
 
-    // CLI parsing: parenthetical_ingestion_app <parentheticals.csv> [--no-db] [--batch=N] [--bad-records=file.csv]
+    // CLI parsing: parenthetical_ingestion_app <parentheticals.csv> [--no-db] [--batch=N] [--bad-records=file.csv] [--queue-depth=N] [--id-snapshot-dir=DIR] [--verify-id-cache] [--metrics=FILE]
     std::string csvPath;
     std::string bad_records_file; // optional output file for bad records
+    std::string id_snapshot_dir; // where FK id cache snapshots live (empty = full scan every run)
+    bool verify_id_cache = false; // check refreshed id caches against COUNT(*)
     bool skip_db = false;
     size_t batch_records = 5000; // records per DB batch
+    size_t queue_depth = 4; // batches read ahead while the DB works
+    MetricsOptions metrics_options; // --metrics=FILE: periodic histogram/counter dumps
 
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
@@ -24,30 +30,50 @@ int main(int argc, char** argv) {
         } else if (arg.rfind("--batch=", 0) == 0) {
             try { batch_records = static_cast<size_t>(std::stoull(arg.substr(8))); }
             catch (...) { std::cerr << "Invalid --batch value\n"; return 1; }
+        } else if (arg == "--queue-depth" && i + 1 < argc) {
+            try { queue_depth = static_cast<size_t>(std::stoull(argv[++i])); }
+            catch (...) { std::cerr << "Invalid --queue-depth value\n"; return 1; }
+        } else if (arg.rfind("--queue-depth=", 0) == 0) {
+            try { queue_depth = static_cast<size_t>(std::stoull(arg.substr(14))); }
+            catch (...) { std::cerr << "Invalid --queue-depth value\n"; return 1; }
         } else if (arg == "--bad-records" && i + 1 < argc) {
             bad_records_file = argv[++i];
         } else if (arg.rfind("--bad-records=", 0) == 0) {
             bad_records_file = arg.substr(14);
+        } else if (arg == "--id-snapshot-dir" && i + 1 < argc) {
+            id_snapshot_dir = argv[++i];
+        } else if (arg.rfind("--id-snapshot-dir=", 0) == 0) {
+            id_snapshot_dir = arg.substr(18);
+        } else if (arg == "--verify-id-cache") {
+            verify_id_cache = true;
+        } else if (arg.rfind("--metrics", 0) == 0) {
+            try { if (!parseMetricsOption(arg, metrics_options)) throw std::invalid_argument("Unknown option: " + arg); }
+            catch (const std::invalid_argument& e) { std::cerr << e.what() << "\n"; return 1; }
         } else if (!arg.empty() && arg[0] == '-') {
             std::cerr << "Unknown option: " << arg << "\n";
-            std::cout << "Usage: parenthetical_ingestion_app <parentheticals.csv> [--no-db] [--batch=N] [--bad-records=file.csv]\n";
+            std::cout << "Usage: parenthetical_ingestion_app <parentheticals.csv> [--no-db] [--batch=N] [--bad-records=file.csv] [--queue-depth=N] [--id-snapshot-dir=DIR] [--verify-id-cache] [--metrics=FILE]\n";
             return 1;
         } else if (csvPath.empty()) {
             csvPath = arg; // first non-option argument is the CSV path
         } else {
             std::cerr << "Unexpected extra argument: " << arg << "\n";
-            std::cout << "Usage: parenthetical_ingestion_app <parentheticals.csv> [--no-db] [--batch=N] [--bad-records=file.csv]\n";
+            std::cout << "Usage: parenthetical_ingestion_app <parentheticals.csv> [--no-db] [--batch=N] [--bad-records=file.csv] [--queue-depth=N] [--id-snapshot-dir=DIR] [--verify-id-cache] [--metrics=FILE]\n";
             return 1;
         }
     }
 
     if (csvPath.empty()) {
-        std::cout << "Usage: parenthetical_ingestion_app <parentheticals.csv> [--no-db] [--batch=N] [--bad-records=file.csv]\n";
+        std::cout << "Usage: parenthetical_ingestion_app <parentheticals.csv> [--no-db] [--batch=N] [--bad-records=file.csv] [--queue-depth=N] [--id-snapshot-dir=DIR] [--verify-id-cache] [--metrics=FILE]\n";
         std::cout << "  --no-db              Skip database insertion (just parse and display)\n";
         std::cout << "  --batch=N            Batch size for DB insertion (default 5000)\n";
         std::cout << "  --bad-records=FILE   Save bad records to CSV file (FK violations)\n";
+        std::cout << "  --id-snapshot-dir=D  Reuse/refresh FK id cache snapshots in directory D\n";
+        std::cout << "  --verify-id-cache    Check refreshed id caches against COUNT(*) (full table scan)\n";
+        std::cout << "  --queue-depth=N      Batches read ahead while inserting (default 4)\n";
+        std::cout << metricsUsage();
         return 0;
     }
+    auto metrics_exporter = MetricsExporter::start(metrics_options);
     
     std::cout << "Reading parenthetical records from: " << csvPath << "\n";
     
@@ -77,6 +103,8 @@ int main(int argc, char** argv) {
             return 1; 
         }
         std::cout << "Connection successful!\n";
+        db.setIdSnapshotDir(id_snapshot_dir);
+        db.setVerifyIdCache(verify_id_cache);
         
         // Load valid group IDs for FK validation
         std::cout << "Loading valid group IDs from database for FK validation...\n";
@@ -110,56 +138,57 @@ int main(int argc, char** argv) {
         // Process in batches using streaming
         std::cout << "\nProcessing records in batches of " << batch_records << "...\n";
         
-        while (reader.hasMore()) {
-            // Read next batch from CSV
-            std::vector<Parenthetical> batch = reader.readBatch(batch_records);
+        // The reader thread reads and parses the next batches while this thread inserts;
+        // the queue depth bounds how far ahead it can get.
+        runReadWritePipeline<std::vector<Parenthetical>>(queue_depth,
+            [&](std::vector<Parenthetical>& batch) {
+                if (!reader.hasMore()) return false;
+                batch = reader.readBatch(batch_records);
+                return !batch.empty();
+            },
+            [&](std::vector<Parenthetical>&& batch) {
+                size_t batch_start = total_records_processed;
+                total_records_processed += batch.size();
             
-            if (batch.empty()) {
-                break; // No more records
-            }
-            
-            size_t batch_start = total_records_processed;
-            total_records_processed += batch.size();
+                // Insert batch with FK validation
+                std::vector<Parenthetical> rejected_records;
+                std::vector<std::string> rejection_reasons;
             
-            // Insert batch with FK validation
-            std::vector<Parenthetical> rejected_records;
-            std::vector<std::string> rejection_reasons;
+                auto [inserted, placeholders] = db.insertParentheticals(batch, rejected_records, rejection_reasons, search_parentheticalgroup_placeholders);
+                total_inserted += inserted;
+                total_rejected += rejected_records.size();
+                total_placeholders += placeholders;
             
-            auto [inserted, placeholders] = db.insertParentheticals(batch, rejected_records, rejection_reasons, search_parentheticalgroup_placeholders);
-            total_inserted += inserted;
-            total_rejected += rejected_records.size();
-            total_placeholders += placeholders;
+                // DEBUG: Collect all rejected records into global debug vectors
+                all_bad_records.insert(all_bad_records.end(), rejected_records.begin(), rejected_records.end());
+                all_bad_reasons.insert(all_bad_reasons.end(), rejection_reasons.begin(), rejection_reasons.end());
             
-            // DEBUG: Collect all rejected records into global debug vectors
-            all_bad_records.insert(all_bad_records.end(), rejected_records.begin(), rejected_records.end());
-            all_bad_reasons.insert(all_bad_reasons.end(), rejection_reasons.begin(), rejection_reasons.end());
-            
-            // Save rejected records to bad records file
-            if (bad_records_stream.is_open() && !rejected_records.empty()) {
-                for (size_t j = 0; j < rejected_records.size(); ++j) {
-                    bad_records_stream << rejected_records[j].toCsv() << ","
-                                      << "\"" << rejection_reasons[j] << "\"\n";
-                }
-                bad_records_stream.flush(); // Ensure data is written immediately
-            } else if (!rejected_records.empty() && bad_records_file.empty()) {
-                // Show first few rejected records if no output file specified
-                if (batch_count == 0) {
-                    std::cout << "\nSample rejected records (first 5):\n";
-                    for (size_t j = 0; j < rejected_records.size() && j < 5; ++j) {
-                        std::cout << "  " << rejected_records[j].toString() 
-                                  << " - " << rejection_reasons[j] << "\n";
+                // Save rejected records to bad records file
+                if (bad_records_stream.is_open() && !rejected_records.empty()) {
+                    for (size_t j = 0; j < rejected_records.size(); ++j) {
+                        bad_records_stream << rejected_records[j].toCsv() << ","
+                                          << "\"" << rejection_reasons[j] << "\"\n";
+                    }
+                    bad_records_stream.flush(); // Ensure data is written immediately
+                } else if (!rejected_records.empty() && bad_records_file.empty()) {
+                    // Show first few rejected records if no output file specified
+                    if (batch_count == 0) {
+                        std::cout << "\nSample rejected records (first 5):\n";
+                        for (size_t j = 0; j < rejected_records.size() && j < 5; ++j) {
+                            std::cout << "  " << rejected_records[j].toString() 
+                                      << " - " << rejection_reasons[j] << "\n";
+                        }
+                        std::cout << "  (Use --bad-records=file.csv to save all rejected records)\n\n";
                     }
-                    std::cout << "  (Use --bad-records=file.csv to save all rejected records)\n\n";
                 }
-            }
             
-            batch_count++;
-            std::cout << "Batch " << batch_count 
-                      << ": inserted=" << inserted
-                      << ", rejected=" << rejected_records.size()
-                      << ", placeholders=" << placeholders
-                      << " (records " << batch_start << "-" << (total_records_processed-1) << ")\n";
-        }
+                batch_count++;
+                std::cout << "Batch " << batch_count 
+                          << ": inserted=" << inserted
+                          << ", rejected=" << rejected_records.size()
+                          << ", placeholders=" << placeholders
+                          << " (records " << batch_start << "-" << (total_records_processed-1) << ")\n";
+            });
         
         if (bad_records_stream.is_open()) {
             bad_records_stream.close();
@@ -0,0 +1,206 @@
+#include "pg_binary_copy.h"
+
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+// 11-byte signature + flags field + header extension length
+static const char kCopySignature[] = "PGCOPY\n\377\r\n\0";
+
+// PostgreSQL stores dates/timestamps relative to 2000-01-01
+static const int64_t kPgEpochDays = 10957; // days from 1970-01-01 to 2000-01-01
+static const int64_t kMicrosPerDay = 86400LL * 1000000LL;
+
+// Days since 1970-01-01 for a proleptic Gregorian date (H. Hinnant's algorithm)
+static int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+static bool readDigits(const std::string& s, size_t& pos, size_t count, int& out) {
+    if (pos + count > s.size()) return false;
+    int v = 0;
+    for (size_t i = 0; i < count; ++i) {
+        char c = s[pos + i];
+        if (!std::isdigit(static_cast<unsigned char>(c))) return false;
+        v = v * 10 + (c - '0');
+    }
+    pos += count;
+    out = v;
+    return true;
+}
+
+// Parses "YYYY-MM-DD" starting at pos, returning days since the PostgreSQL epoch
+static bool parseDatePart(const std::string& s, size_t& pos, int64_t& pg_days) {
+    int y = 0, m = 0, d = 0;
+    if (!readDigits(s, pos, 4, y)) return false;
+    if (pos >= s.size() || s[pos] != '-') return false;
+    pos++;
+    if (!readDigits(s, pos, 2, m)) return false;
+    if (pos >= s.size() || s[pos] != '-') return false;
+    pos++;
+    if (!readDigits(s, pos, 2, d)) return false;
+    if (m < 1 || m > 12 || d < 1 || d > 31) return false;
+    pg_days = daysFromCivil(y, static_cast<unsigned>(m), static_cast<unsigned>(d)) - kPgEpochDays;
+    return true;
+}
+
+PgBinaryCopyWriter::PgBinaryCopyWriter() {
+    buffer_.reserve(1 << 20);
+    buffer_.append(kCopySignature, sizeof(kCopySignature) - 1);
+    putInt32(0); // flags
+    putInt32(0); // header extension length
+    row_mark_ = buffer_.size();
+}
+
+void PgBinaryCopyWriter::putInt16(int16_t v) {
+    uint16_t u = static_cast<uint16_t>(v);
+    char b[2] = { static_cast<char>(u >> 8), static_cast<char>(u) };
+    buffer_.append(b, 2);
+}
+
+void PgBinaryCopyWriter::putInt32(int32_t v) {
+    uint32_t u = static_cast<uint32_t>(v);
+    char b[4] = { static_cast<char>(u >> 24), static_cast<char>(u >> 16),
+                  static_cast<char>(u >> 8), static_cast<char>(u) };
+    buffer_.append(b, 4);
+}
+
+void PgBinaryCopyWriter::putInt64(int64_t v) {
+    uint64_t u = static_cast<uint64_t>(v);
+    char b[8];
+    for (int i = 7; i >= 0; --i) { b[i] = static_cast<char>(u); u >>= 8; }
+    buffer_.append(b, 8);
+}
+
+void PgBinaryCopyWriter::beginRow(int16_t field_count) {
+    row_mark_ = buffer_.size();
+    putInt16(field_count);
+    rows_++;
+}
+
+void PgBinaryCopyWriter::rollbackRow() {
+    if (rows_ == 0) return;
+    buffer_.resize(row_mark_);
+    rows_--;
+}
+
+void PgBinaryCopyWriter::addNull() {
+    putInt32(-1);
+}
+
+void PgBinaryCopyWriter::addInt4(int32_t value) {
+    putInt32(4);
+    putInt32(value);
+}
+
+void PgBinaryCopyWriter::addInt8(int64_t value) {
+    putInt32(8);
+    putInt64(value);
+}
+
+void PgBinaryCopyWriter::addBool(bool value) {
+    putInt32(1);
+    buffer_.push_back(value ? 1 : 0);
+}
+
+void PgBinaryCopyWriter::addText(const std::string& value) {
+    putInt32(static_cast<int32_t>(value.size()));
+    buffer_.append(value);
+}
+
+void PgBinaryCopyWriter::addFloat8(double value) {
+    int64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    putInt32(8);
+    putInt64(bits);
+}
+
+void PgBinaryCopyWriter::addDate(const std::string& value) {
+    int32_t days = parseDate(value);
+    putInt32(4);
+    putInt32(days);
+}
+
+void PgBinaryCopyWriter::addTimestamptz(const std::string& value) {
+    int64_t micros = parseTimestamptz(value);
+    putInt32(8);
+    putInt64(micros);
+}
+
+void PgBinaryCopyWriter::finish() {
+    putInt16(-1);
+}
+
+int32_t PgBinaryCopyWriter::parseDate(const std::string& value) {
+    size_t pos = 0;
+    int64_t days = 0;
+    if (!parseDatePart(value, pos, days) || pos != value.size()) {
+        throw std::invalid_argument("invalid date: '" + value + "'");
+    }
+    return static_cast<int32_t>(days);
+}
+
+int64_t PgBinaryCopyWriter::parseTimestamptz(const std::string& value) {
+    size_t pos = 0;
+    int64_t days = 0;
+    if (!parseDatePart(value, pos, days)) {
+        throw std::invalid_argument("invalid timestamp: '" + value + "'");
+    }
+    int64_t micros = days * kMicrosPerDay;
+    if (pos == value.size()) return micros; // date only = midnight UTC
+
+    if (value[pos] != ' ' && value[pos] != 'T') {
+        throw std::invalid_argument("invalid timestamp: '" + value + "'");
+    }
+    pos++;
+
+    int hh = 0, mi = 0, ss = 0;
+    if (!readDigits(value, pos, 2, hh) || pos >= value.size() || value[pos++] != ':' ||
+        !readDigits(value, pos, 2, mi) || pos >= value.size() || value[pos++] != ':' ||
+        !readDigits(value, pos, 2, ss) || hh > 24 || mi > 59 || ss > 60) {
+        throw std::invalid_argument("invalid timestamp: '" + value + "'");
+    }
+    micros += ((hh * 60LL + mi) * 60LL + ss) * 1000000LL;
+
+    // Fractional seconds (up to microsecond precision, extra digits truncated)
+    if (pos < value.size() && value[pos] == '.') {
+        pos++;
+        int64_t frac = 0;
+        int digits = 0;
+        while (pos < value.size() && std::isdigit(static_cast<unsigned char>(value[pos]))) {
+            if (digits < 6) { frac = frac * 10 + (value[pos] - '0'); digits++; }
+            pos++;
+        }
+        while (digits < 6) { frac *= 10; digits++; }
+        micros += frac;
+    }
+
+    // UTC offset: Z, +HH, +HHMM or +HH:MM
+    if (pos < value.size()) {
+        char sign = value[pos];
+        if (sign == 'Z') {
+            pos++;
+        } else if (sign == '+' || sign == '-') {
+            pos++;
+            int oh = 0, om = 0;
+            if (!readDigits(value, pos, 2, oh)) {
+                throw std::invalid_argument("invalid timestamp offset: '" + value + "'");
+            }
+            if (pos < value.size() && value[pos] == ':') pos++;
+            if (pos < value.size() && !readDigits(value, pos, 2, om)) {
+                throw std::invalid_argument("invalid timestamp offset: '" + value + "'");
+            }
+            int64_t offset = (oh * 60LL + om) * 60LL * 1000000LL;
+            micros -= (sign == '+') ? offset : -offset;
+        }
+    }
+    if (pos != value.size()) {
+        throw std::invalid_argument("invalid timestamp: '" + value + "'");
+    }
+    return micros;
+}
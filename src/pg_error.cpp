@@ -0,0 +1,57 @@
+#include "pg_error.h"
+
+#include <pqxx/pqxx>
+
+const char* PgError::kindName() const {
+    switch (kind) {
+        case PgErrorKind::ForeignKey: return "fk";
+        case PgErrorKind::Unique: return "unique";
+        case PgErrorKind::NotNull: return "not_null";
+        case PgErrorKind::Check: return "check";
+        case PgErrorKind::Other: return "other";
+    }
+    return "other";
+}
+
+std::string PgError::describe() const {
+    std::string out = kindName();
+    if (!sqlstate.empty()) out += " [" + sqlstate + "]";
+    if (!constraint.empty()) out += " " + constraint;
+    if (!column.empty()) out += " (" + column + ")";
+    // libpq messages end in a newline; keep the reason on one line
+    std::string text = message;
+    while (!text.empty() && (text.back() == '\n' || text.back() == ' ')) text.pop_back();
+    return out + ": " + text;
+}
+
+PgErrorKind pgErrorKind(const std::string& sqlstate) {
+    if (sqlstate == "23503") return PgErrorKind::ForeignKey;
+    if (sqlstate == "23505") return PgErrorKind::Unique;
+    if (sqlstate == "23502") return PgErrorKind::NotNull;
+    if (sqlstate == "23514") return PgErrorKind::Check;
+    return PgErrorKind::Other;
+}
+
+PgError pgError(const std::exception& e) {
+    PgError error;
+    error.message = e.what();
+    if (auto sql = dynamic_cast<const pqxx::sql_error*>(&e)) {
+        error.sqlstate = sql->sqlstate();
+        error.kind = pgErrorKind(error.sqlstate);
+    }
+    return error;
+}
+
+PgError pgError(const PGresult* res) {
+    auto field = [res](int code) {
+        const char* value = PQresultErrorField(res, code);
+        return std::string(value ? value : "");
+    };
+    PgError error;
+    error.sqlstate = field(PG_DIAG_SQLSTATE);
+    error.constraint = field(PG_DIAG_CONSTRAINT_NAME);
+    error.column = field(PG_DIAG_COLUMN_NAME);
+    error.message = PQresultErrorMessage(res);
+    error.kind = pgErrorKind(error.sqlstate);
+    return error;
+}
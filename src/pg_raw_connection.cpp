@@ -0,0 +1,203 @@
+#include "pg_raw_connection.h"
+
+#include <poll.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+PgRawConnection::PgRawConnection(const std::string& connection_string) {
+    conn_ = PQconnectdb(connection_string.c_str());
+    if (PQstatus(conn_) != CONNECTION_OK) {
+        std::string msg = PQerrorMessage(conn_);
+        PQfinish(conn_);
+        conn_ = nullptr;
+        throw std::runtime_error("Connection failed: " + msg);
+    }
+}
+
+PgRawConnection::~PgRawConnection() {
+    if (conn_) PQfinish(conn_);
+}
+
+void PgRawConnection::exec(const std::string& sql) {
+    PGresult* res = PQexec(conn_, sql.c_str());
+    ExecStatusType status = PQresultStatus(res);
+    if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK) {
+        std::string msg = PQresultErrorMessage(res);
+        PQclear(res);
+        throw std::runtime_error(msg);
+    }
+    PQclear(res);
+}
+
+std::vector<std::vector<std::string>> PgRawConnection::query(const std::string& sql) {
+    PGresult* res = PQexec(conn_, sql.c_str());
+    ExecStatusType status = PQresultStatus(res);
+    if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK) {
+        std::string msg = PQresultErrorMessage(res);
+        PQclear(res);
+        throw std::runtime_error(msg);
+    }
+    std::vector<std::vector<std::string>> rows(static_cast<size_t>(PQntuples(res)));
+    int fields = PQnfields(res);
+    for (size_t r = 0; r < rows.size(); ++r) {
+        rows[r].reserve(static_cast<size_t>(fields));
+        for (int f = 0; f < fields; ++f) {
+            rows[r].emplace_back(PQgetvalue(res, static_cast<int>(r), f), PQgetlength(res, static_cast<int>(r), f));
+        }
+    }
+    PQclear(res);
+    return rows;
+}
+
+void PgRawConnection::copyIn(const std::string& copy_sql, const std::string& payload) {
+    PGresult* res = PQexec(conn_, copy_sql.c_str());
+    if (PQresultStatus(res) != PGRES_COPY_IN) {
+        std::string msg = PQresultErrorMessage(res);
+        PQclear(res);
+        throw std::runtime_error(msg);
+    }
+    PQclear(res);
+
+    // Send in bounded pieces so libpq's output buffer stays small
+    const size_t piece = 1 << 20;
+    for (size_t off = 0; off < payload.size(); off += piece) {
+        size_t len = std::min(piece, payload.size() - off);
+        if (PQputCopyData(conn_, payload.data() + off, static_cast<int>(len)) != 1) {
+            throw std::runtime_error(std::string("COPY send failed: ") + PQerrorMessage(conn_));
+        }
+    }
+    if (PQputCopyEnd(conn_, nullptr) != 1) {
+        throw std::runtime_error(std::string("COPY end failed: ") + PQerrorMessage(conn_));
+    }
+
+    // Drain results; the COPY outcome is reported after the data is consumed
+    std::string error;
+    while ((res = PQgetResult(conn_)) != nullptr) {
+        if (PQresultStatus(res) != PGRES_COMMAND_OK && error.empty()) {
+            error = PQresultErrorMessage(res);
+        }
+        PQclear(res);
+    }
+    if (!error.empty()) throw std::runtime_error(error);
+}
+
+void PgRawConnection::prepare(const std::string& name, const std::string& sql) {
+    PGresult* res = PQprepare(conn_, name.c_str(), sql.c_str(), 0, nullptr);
+    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+        std::string msg = PQresultErrorMessage(res);
+        PQclear(res);
+        throw std::runtime_error(msg);
+    }
+    PQclear(res);
+}
+
+static std::vector<const char*> paramPointers(const std::vector<std::string>& row) {
+    std::vector<const char*> values;
+    values.reserve(row.size());
+    for (const auto& v : row) values.push_back(v.c_str());
+    return values;
+}
+
+std::vector<PgRawConnection::RowResult> PgRawConnection::execPipelined(
+    const std::string& name, const std::vector<std::vector<std::string>>& rows, size_t window) {
+    std::vector<RowResult> results(rows.size());
+    if (rows.empty()) return results;
+    if (window == 0) window = 1;
+
+#ifdef LIBPQ_HAS_PIPELINING
+    // Non-blocking, so sending never waits on a full socket while the server waits for
+    // us to read its results: every pass flushes what it can and drains what arrived
+    if (PQsetnonblocking(conn_, 1) != 0) {
+        throw std::runtime_error(std::string("Cannot enter non-blocking mode: ") + PQerrorMessage(conn_));
+    }
+    struct BlockingRestore {
+        PGconn* conn;
+        ~BlockingRestore() { PQsetnonblocking(conn, 0); }
+    } restore{conn_};
+
+    if (PQenterPipelineMode(conn_) != 1) {
+        throw std::runtime_error(std::string("Cannot enter pipeline mode: ") + PQerrorMessage(conn_));
+    }
+
+    size_t sent = 0;
+    size_t received = 0;
+    results[0].ok = true;
+    while (received < rows.size()) {
+        // Top up the window; each row is queued with its own sync
+        while (sent < rows.size() && sent - received < window) {
+            auto values = paramPointers(rows[sent]);
+            if (PQsendQueryPrepared(conn_, name.c_str(), static_cast<int>(values.size()), values.data(),
+                                    nullptr, nullptr, 0) != 1 ||
+                PQpipelineSync(conn_) != 1) {
+                throw std::runtime_error(std::string("Pipeline send failed: ") + PQerrorMessage(conn_));
+            }
+            sent++;
+        }
+
+        int pending = PQflush(conn_);
+        if (pending < 0) throw std::runtime_error(std::string("Pipeline send failed: ") + PQerrorMessage(conn_));
+
+        // Wait until the server sent something, or (with output pending) can take more
+        pollfd fd{PQsocket(conn_), static_cast<short>(POLLIN | (pending ? POLLOUT : 0)), 0};
+        if (poll(&fd, 1, -1) < 0 && errno != EINTR) {
+            throw std::runtime_error(std::string("Pipeline poll failed: ") + std::strerror(errno));
+        }
+        if ((fd.revents & (POLLIN | POLLHUP | POLLERR)) && PQconsumeInput(conn_) != 1) {
+            throw std::runtime_error(std::string("Pipeline receive failed: ") + PQerrorMessage(conn_));
+        }
+
+        // Per row: its command result, a NULL separator, then the sync. A second NULL
+        // in a row means nothing more has arrived yet.
+        bool separator = false;
+        while (received < sent && !PQisBusy(conn_)) {
+            PGresult* res = PQgetResult(conn_);
+            if (res == nullptr) {
+                if (PQstatus(conn_) != CONNECTION_OK) {
+                    throw std::runtime_error(std::string("Pipeline receive failed: ") + PQerrorMessage(conn_));
+                }
+                if (separator) break;
+                separator = true;
+                continue;
+            }
+            separator = false;
+            RowResult& out = results[received];
+            ExecStatusType status = PQresultStatus(res);
+            if (status == PGRES_PIPELINE_SYNC) {
+                PQclear(res);
+                if (++received < rows.size()) results[received].ok = true;
+                continue;
+            }
+            if (status != PGRES_COMMAND_OK && status != PGRES_TUPLES_OK && out.ok) {
+                out.ok = false;
+                if (status == PGRES_PIPELINE_ABORTED) {
+                    out.error.message = "pipeline aborted";
+                } else {
+                    out.error = pgError(res);
+                }
+            }
+            PQclear(res);
+        }
+    }
+
+    if (PQexitPipelineMode(conn_) != 1) {
+        throw std::runtime_error(std::string("Cannot exit pipeline mode: ") + PQerrorMessage(conn_));
+    }
+#else
+    for (size_t i = 0; i < rows.size(); ++i) {
+        auto values = paramPointers(rows[i]);
+        PGresult* res = PQexecPrepared(conn_, name.c_str(), static_cast<int>(values.size()), values.data(),
+                                       nullptr, nullptr, 0);
+        ExecStatusType status = PQresultStatus(res);
+        results[i].ok = status == PGRES_COMMAND_OK || status == PGRES_TUPLES_OK;
+        if (!results[i].ok) results[i].error = pgError(res);
+        PQclear(res);
+        if (PQstatus(conn_) != CONNECTION_OK) {
+            throw std::runtime_error(std::string("Connection lost: ") + PQerrorMessage(conn_));
+        }
+    }
+#endif
+    return results;
+}
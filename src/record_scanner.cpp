@@ -0,0 +1,292 @@
+#include "record_scanner.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+// Decompressed bytes requested from the stream per refill
+constexpr size_t kStreamFillBytes = 4 << 20;
+// Bytes that must follow a candidate newline before is_record_start() is trusted on
+// a partially decompressed buffer (the cluster heuristic skips several CSV fields)
+constexpr size_t kStreamLookahead = 64 << 10;
+
+} // namespace
+
+RecordScanner::RecordScanner(const std::string& filename, RecordStartFn is_record_start, bool quote_aware)
+    : is_record_start_(is_record_start), quote_aware_(quote_aware), compression_(detectCompression(filename)) {
+    if (compression_ != Compression::None) {
+        stream_ = std::make_unique<DecompressingReader>(filename, compression_);
+        const char* nl = nullptr;
+        while (!stream_eof_) {
+            size_t scanned = carry_.size();
+            fill(carry_, 64 << 10);
+            nl = static_cast<const char*>(std::memchr(carry_.data() + scanned, '\n', carry_.size() - scanned));
+            if (nl) break;
+        }
+        size_t header_end = nl ? static_cast<size_t>(nl - carry_.data()) : carry_.size();
+        header_storage_.assign(carry_.data(), header_end);
+        if (!header_storage_.empty() && header_storage_.back() == '\r') header_storage_.pop_back();
+        header_ = header_storage_;
+        pos_ = nl ? header_end + 1 : header_end;
+        carry_.erase(carry_.begin(), carry_.begin() + static_cast<std::ptrdiff_t>(pos_));
+        first_record_ = pos_;
+        return;
+    }
+
+    file_ = std::make_unique<MappedFile>(filename);
+    const char* data = file_->data();
+    size_t size = file_->size();
+    const char* nl = size ? static_cast<const char*>(std::memchr(data, '\n', size)) : nullptr;
+    size_t header_end = nl ? static_cast<size_t>(nl - data) : size;
+    header_ = std::string_view(data, header_end);
+    if (!header_.empty() && header_.back() == '\r') header_.remove_suffix(1);
+    pos_ = nl ? header_end + 1 : size;
+    first_record_ = pos_;
+}
+
+void RecordScanner::fill(std::vector<char>& buf, size_t n) {
+    size_t old = buf.size();
+    buf.resize(old + n);
+    size_t got = stream_->read(buf.data() + old, n);
+    buf.resize(old + got);
+    if (got < n) stream_eof_ = true;
+}
+
+void RecordScanner::seek(size_t offset) {
+    if (stream_) {
+        seekStream(offset);
+        return;
+    }
+    const char* data = file_->data();
+    size_t size = file_->size();
+    bool boundary = offset == first_record_ || offset == size ||
+                    (offset > first_record_ && offset < size && data[offset - 1] == '\n' &&
+                     is_record_start_(data, size, offset));
+    if (!boundary) {
+        throw std::invalid_argument("Offset " + std::to_string(offset) + " is not a record boundary in this file");
+    }
+    pos_ = offset;
+    batch_starts_.clear();
+    if (indexed_) {
+        // index_ holds record starts in file order; the first one past offset ends its record
+        index_pos_ = static_cast<size_t>(std::upper_bound(index_.begin(), index_.end(), offset) - index_.begin());
+    }
+}
+
+void RecordScanner::seekStream(size_t offset) {
+    if (offset < pos_) {
+        throw std::invalid_argument("Offset " + std::to_string(offset) + " is behind the current position " +
+                                    std::to_string(pos_) + " of a compressed stream");
+    }
+    // Discard everything before offset, remembering the byte just before it
+    char prev = '\n';
+    while (offset - pos_ > carry_.size() && !stream_eof_) {
+        if (!carry_.empty()) prev = carry_.back();
+        pos_ += carry_.size();
+        carry_.clear();
+        fill(carry_, std::min(kStreamFillBytes, offset - pos_));
+    }
+    size_t skip = std::min(offset - pos_, carry_.size());
+    if (skip > 0) prev = carry_[skip - 1];
+    carry_.erase(carry_.begin(), carry_.begin() + static_cast<std::ptrdiff_t>(skip));
+    pos_ += skip;
+
+    if (!stream_eof_ && carry_.size() < kStreamLookahead) fill(carry_, kStreamLookahead);
+    bool at_end = stream_eof_ && carry_.empty();
+    bool boundary = pos_ == offset &&
+                    (offset == first_record_ || at_end ||
+                     (prev == '\n' && is_record_start_(carry_.data(), carry_.size(), 0)));
+    if (!boundary) {
+        throw std::invalid_argument("Offset " + std::to_string(offset) + " is not a record boundary in this file");
+    }
+}
+
+// Scans the newlines in [from, to) for record starts, beginning with the given quote
+// state. Each accepted boundary resets the state because a record starts outside
+// quotes, which is what the serial scan does. on_start(offset) returns false to stop.
+// Returns the quote state where the scan ended.
+template <typename OnStart>
+static bool scanBoundaries(const CsvClassifier& classifier, const char* data, size_t size,
+                           size_t from, size_t to, bool in_quotes, bool quote_aware,
+                           RecordScanner::RecordStartFn is_record_start, OnStart on_start) {
+    alignas(64) char tail[CsvClassifier::kBlockSize];
+    for (size_t base = from; base < to; base += CsvClassifier::kBlockSize) {
+        const char* block = data + base;
+        size_t avail = size - base;
+        if (avail < CsvClassifier::kBlockSize) {
+            // Last partial block: classify a zero-padded copy instead of reading past the mapping
+            std::memcpy(tail, block, avail);
+            std::memset(tail + avail, 0, sizeof(tail) - avail);
+            block = tail;
+        }
+
+        CsvClassifier::Masks masks = classifier.classify(block);
+        size_t limit = std::min<size_t>(CsvClassifier::kBlockSize, to - base);
+        uint64_t live = limit == CsvClassifier::kBlockSize ? ~0ULL : ((1ULL << limit) - 1);
+
+        while (live) {
+            uint64_t region = 0;
+            if (quote_aware) {
+                region = CsvClassifier::prefixXor(masks.quote & live) ^ (in_quotes ? ~0ULL : 0ULL);
+            }
+            uint64_t candidates = masks.newline & live & ~region;
+            bool accepted = false;
+            while (candidates) {
+                size_t bit = static_cast<size_t>(__builtin_ctzll(candidates));
+                size_t next = base + bit + 1;
+                if (next < size && is_record_start(data, size, next)) {
+                    if (!on_start(next)) return false;
+                    // Rescan the rest of the block from the new record start, outside quotes
+                    live &= bit + 1 < 64 ? (~0ULL << (bit + 1)) : 0ULL;
+                    in_quotes = false;
+                    accepted = true;
+                    break;
+                }
+                candidates &= candidates - 1;
+            }
+            if (!accepted) {
+                if (quote_aware) in_quotes = ((region >> (limit - 1)) & 1) != 0;
+                break;
+            }
+        }
+    }
+    return in_quotes;
+}
+
+size_t RecordScanner::findRecordEnd(size_t start) const {
+    size_t size = file_->size();
+    size_t end = size;
+    scanBoundaries(classifier_, file_->data(), size, start, size, false, quote_aware_, is_record_start_,
+                   [&end](size_t next) { end = next; return false; });
+    return end;
+}
+
+size_t RecordScanner::buildIndex(ThreadPool& pool, size_t min_range_bytes) {
+    if (stream_) return 0;
+    const char* data = file_->data();
+    size_t size = file_->size();
+    index_.clear();
+    index_pos_ = 0;
+    indexed_ = true;
+    if (pos_ >= size) return 0;
+
+    // Pass 1: every range is scanned independently under both quote-state assumptions
+    size_t bytes = size - pos_;
+    size_t ranges = std::max<size_t>(1, std::min(pool.size() * 4, bytes / std::max<size_t>(min_range_bytes, 1)));
+    size_t range_bytes = (bytes / ranges + CsvClassifier::kBlockSize - 1) / CsvClassifier::kBlockSize * CsvClassifier::kBlockSize;
+
+    struct Speculation {
+        std::vector<size_t> starts[2]; // [0] = began outside quotes, [1] = began inside quotes
+        bool end_state[2] = {false, false};
+    };
+    std::vector<Speculation> spec(ranges);
+    size_t begin_offset = pos_;
+    pool.parallelRanges(ranges, [&](size_t first, size_t last, size_t) {
+        for (size_t r = first; r < last; ++r) {
+            size_t from = std::min(size, begin_offset + r * range_bytes);
+            size_t to = r + 1 == ranges ? size : std::min(size, from + range_bytes);
+            // The first range starts at a record boundary, so it is never inside quotes
+            int assumptions = (quote_aware_ && r > 0) ? 2 : 1;
+            for (int a = 0; a < assumptions; ++a) {
+                auto& out = spec[r].starts[a];
+                spec[r].end_state[a] = scanBoundaries(classifier_, data, size, from, to, a == 1, quote_aware_,
+                                                      is_record_start_, [&out](size_t next) { out.push_back(next); return true; });
+            }
+        }
+    });
+
+    // Pass 2: stitch, following the quote state actually reached at each range boundary
+    bool in_quotes = false;
+    for (auto& s : spec) {
+        int a = in_quotes ? 1 : 0;
+        index_.insert(index_.end(), s.starts[a].begin(), s.starts[a].end());
+        in_quotes = s.end_state[a];
+    }
+    return index_.size() + 1;
+}
+
+bool RecordScanner::nextBatch(std::vector<std::string_view>& out, size_t max_records) {
+    if (stream_) return nextStreamBatch(out, max_records);
+    out.clear();
+    // Everything before the oldest batch still in use has been consumed; let the kernel reclaim it
+    batch_starts_.push_back(pos_);
+    while (batch_starts_.size() > release_lag_ + 1) batch_starts_.pop_front();
+    file_->release(batch_starts_.front());
+
+    const char* data = file_->data();
+    size_t size = file_->size();
+    while (out.size() < max_records && pos_ < size) {
+        size_t start = pos_;
+        size_t end;
+        if (indexed_) {
+            end = index_pos_ < index_.size() ? index_[index_pos_++] : size;
+        } else {
+            end = findRecordEnd(start);
+        }
+        pos_ = end;
+
+        size_t rec_end = end;
+        if (end == size) {
+            // Final record: drop any trailing line terminators
+            while (rec_end > start && (data[rec_end - 1] == '\n' || data[rec_end - 1] == '\r')) rec_end--;
+        } else if (rec_end > start && data[rec_end - 1] == '\n') {
+            rec_end--;
+        }
+        if (rec_end > start) out.emplace_back(data + start, rec_end - start);
+    }
+    return !out.empty();
+}
+
+bool RecordScanner::nextStreamBatch(std::vector<std::string_view>& out, size_t max_records) {
+    out.clear();
+    // buf starts at the record at pos_; only offsets are collected while it can still grow
+    std::vector<char> buf = std::move(carry_);
+    carry_.clear();
+    std::vector<std::pair<size_t, size_t>> spans;
+    size_t start = 0, scan_from = 0;
+    bool in_quotes = false;
+    while (spans.size() < max_records) {
+        // Without the end of the data, only newlines followed by a full lookahead are judged
+        size_t safe = stream_eof_ ? buf.size() : (buf.size() > kStreamLookahead ? buf.size() - kStreamLookahead : 0);
+        size_t end = 0;
+        if (scan_from < safe) {
+            in_quotes = scanBoundaries(classifier_, buf.data(), buf.size(), scan_from, safe, in_quotes, quote_aware_,
+                                       is_record_start_, [&end](size_t next) { end = next; return false; });
+        }
+        if (end > 0) {
+            spans.emplace_back(start, end);
+            start = scan_from = end;
+            in_quotes = false;
+        } else if (stream_eof_) {
+            if (start < buf.size()) spans.emplace_back(start, buf.size());
+            start = buf.size();
+            break;
+        } else {
+            // Resume after the bytes already scanned, in the quote state reached there
+            scan_from = std::max(scan_from, safe);
+            fill(buf, kStreamFillBytes);
+        }
+    }
+
+    carry_.assign(buf.begin() + static_cast<std::ptrdiff_t>(start), buf.end());
+    buf.resize(start);
+    pos_ += start;
+    chunks_.push_back(std::move(buf));
+    while (chunks_.size() > release_lag_ + 1) chunks_.pop_front();
+
+    const std::vector<char>& chunk = chunks_.back();
+    for (const auto& span : spans) {
+        size_t rec_end = span.second;
+        if (rec_end == chunk.size() && stream_eof_ && carry_.empty()) {
+            // Final record: drop any trailing line terminators
+            while (rec_end > span.first && (chunk[rec_end - 1] == '\n' || chunk[rec_end - 1] == '\r')) rec_end--;
+        } else if (rec_end > span.first && chunk[rec_end - 1] == '\n') {
+            rec_end--;
+        }
+        if (rec_end > span.first) out.emplace_back(chunk.data() + span.first, rec_end - span.first);
+    }
+    return !out.empty();
+}
@@ -1,4 +1,5 @@
 #include "search_citation.h"
+#include "metrics.h"
 
 #include <algorithm>
 #include <cctype>
@@ -155,6 +156,8 @@ SearchCitation SearchCitationReader::parseCsvLine(const string& line) {
 }
 
 vector<SearchCitation> SearchCitationReader::readBatch(size_t batch_size) {
+    StageTimer timer("read", "search_citation");
+    size_t bytes = 0;
     vector<SearchCitation> records;
     records.reserve(batch_size);
     
@@ -184,6 +187,7 @@ vector<SearchCitation> SearchCitationReader::readBatch(size_t batch_size) {
     string line;
     size_t count = 0;
     while (count < batch_size && std::getline(file_, line)) {
+        bytes += line.size() + 1;
         total_lines_read_++;
         
         // Skip empty lines
@@ -201,5 +205,7 @@ vector<SearchCitation> SearchCitationReader::readBatch(size_t batch_size) {
         }
     }
     
+    Metrics::global().add("records_read", "search_citation", records.size());
+    Metrics::global().add("bytes_read", "search_citation", bytes);
     return records;
 }
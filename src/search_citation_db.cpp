@@ -1,7 +1,34 @@
 #include "search_citation_db.h"
+#include "id_cache.h"
+#include "metrics.h"
 #include <iostream>
 #include <sstream>
 
+static const char* kCitationUpsertSql =
+    "INSERT INTO search_citation (id, volume, reporter, page, type, cluster_id) "
+    "VALUES ($1, $2, $3, $4, $5, $6) ON CONFLICT (cluster_id, volume, reporter, page) "
+    "DO UPDATE SET id = EXCLUDED.id, type = EXCLUDED.type";
+
+// Placeholder cluster with all required NOT NULL fields
+static const char* kPlaceholderClusterSql =
+    "INSERT INTO search_opinioncluster ("
+    "id, date_created, date_modified, judges, date_filed, "
+    "case_name_short, case_name, case_name_full, scdb_id, source, "
+    "procedural_history, attorneys, nature_of_suit, posture, syllabus, "
+    "citation_count, precedential_status, blocked, docket_id, "
+    "date_filed_is_approximate, correction, cross_reference, disposition, "
+    "filepath_json_harvard, headnotes, history, other_dates, summary, "
+    "arguments, headmatter, filepath_pdf_harvard"
+    ") VALUES ("
+    "$1, NOW(), NOW(), '', '0001-01-01', "
+    "'Placeholder', 'Placeholder Case', 'Placeholder Case', '', 'C', "
+    "'', '', '', '', '', "
+    "0, 'Published', false, 1, "
+    "false, '', '', '', "
+    "'', '', '', '', '', "
+    "'', '', ''"
+    ") ON CONFLICT (id) DO NOTHING";
+
 SearchCitationDatabase::SearchCitationDatabase(
     const std::string& host, int port,
     const std::string& dbname, const std::string& user,
@@ -14,12 +41,13 @@ SearchCitationDatabase::SearchCitationDatabase(
         << " user=" << user
         << " password=" << password;
     connection_string_ = oss.str();
+    pool_ = ConnectionPool::shared(connection_string_);
 }
 
 bool SearchCitationDatabase::testConnection() {
     try {
-        pqxx::connection conn(connection_string_);
-        return conn.is_open();
+        auto conn = pool_->acquire();
+        return conn->is_open();
     } catch (const std::exception& e) {
         std::cerr << "Connection test failed: " << e.what() << std::endl;
         return false;
@@ -30,21 +58,15 @@ void SearchCitationDatabase::loadValidClusterIds() {
     valid_cluster_ids_.clear();
     
     try {
-        pqxx::connection conn(connection_string_);
-        pqxx::work txn(conn);
+        auto conn = pool_->acquire();
+        pqxx::work txn(*conn);
         
-        std::string query = "SELECT id FROM search_opinioncluster";
-        pqxx::result res = txn.exec(query);
-        
-        for (const auto& row : res) {
-            int cluster_id = row[0].as<int>();
-            valid_cluster_ids_.insert(cluster_id);
-        }
+        size_t fetched = loadIdCache(txn, "search_opinioncluster", valid_cluster_ids_, id_snapshot_dir_, verify_id_cache_);
         
         txn.commit();
         
         std::cout << "Loaded " << valid_cluster_ids_.size() 
-                  << " valid cluster IDs from database\n";
+                  << " valid cluster IDs (" << fetched << " read from database)\n";
                   
     } catch (const std::exception& e) {
         std::cerr << "Failed to load valid cluster IDs: " << e.what() << std::endl;
@@ -52,38 +74,36 @@ void SearchCitationDatabase::loadValidClusterIds() {
     }
 }
 
+void SearchCitationDatabase::prepareStatements(pqxx::connection& conn) {
+    pool_->prepare(conn, "citation_upsert", kCitationUpsertSql);
+    pool_->prepare(conn, "citation_placeholder_cluster", kPlaceholderClusterSql);
+}
+
 bool SearchCitationDatabase::isValidClusterId(int cluster_id) const {
-    return valid_cluster_ids_.find(cluster_id) != valid_cluster_ids_.end();
+    return valid_cluster_ids_.contains(cluster_id);
 }
 
 bool SearchCitationDatabase::createPlaceholderCluster(int cluster_id, std::vector<int>& search_opinioncluster_placeholders) {
     try {
-        pqxx::connection conn(connection_string_);
+        auto conn = pool_->acquire();
+        prepareStatements(*conn);
+        return createPlaceholderCluster(*conn, cluster_id, search_opinioncluster_placeholders);
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to create placeholder cluster for id=" << cluster_id
+                  << ": " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool SearchCitationDatabase::createPlaceholderCluster(pqxx::connection& conn, int cluster_id, std::vector<int>& search_opinioncluster_placeholders) {
+    StageTimer timer("placeholder", "search_citation");
+    try {
         pqxx::work txn(conn);
         
         // Create placeholder cluster with all required NOT NULL fields
-        std::ostringstream query;
-        query << "INSERT INTO search_opinioncluster ("
-              << "id, date_created, date_modified, judges, date_filed, "
-              << "case_name_short, case_name, case_name_full, scdb_id, source, "
-              << "procedural_history, attorneys, nature_of_suit, posture, syllabus, "
-              << "citation_count, precedential_status, blocked, docket_id, "
-              << "date_filed_is_approximate, correction, cross_reference, disposition, "
-              << "filepath_json_harvard, headnotes, history, other_dates, summary, "
-              << "arguments, headmatter, filepath_pdf_harvard"
-              << ") VALUES ("
-              << cluster_id << ", "
-              << "NOW(), NOW(), '', '0001-01-01', "
-              << "'Placeholder', 'Placeholder Case', 'Placeholder Case', '', 'C', "
-              << "'', '', '', '', '', "
-              << "0, 'Published', false, 1, "
-              << "false, '', '', '', "
-              << "'', '', '', '', '', "
-              << "'', '', ''"
-              << ") ON CONFLICT (id) DO NOTHING";
-        
-        pqxx::result res = txn.exec(query.str());
+        txn.exec_prepared("citation_placeholder_cluster", cluster_id);
         txn.commit();
+        Metrics::global().add("placeholders_created", "search_citation", 1);
         
         // Add to valid cluster IDs cache
         valid_cluster_ids_.insert(cluster_id);
@@ -111,30 +131,43 @@ std::pair<size_t, size_t> SearchCitationDatabase::insertCitations(
     
     size_t inserted = 0;
     size_t placeholders_created = 0;
+    StageTimer timer("insert", "search_citation");
     
     // Insert records line by line and collect failures
     try {
-        pqxx::connection conn(connection_string_);
+        auto conn = pool_->acquire();
+        prepareStatements(*conn);
+        
+        if (pipeline_window_ > 0) {
+            // Upserts go out pipelined on the raw connection; only rows that failed
+            // take the placeholder/retry path on the pooled one
+            std::vector<std::vector<std::string>> rows;
+            rows.reserve(records.size());
+            for (const auto& record : records) {
+                rows.push_back({std::to_string(record.id), std::to_string(record.volume), record.reporter,
+                                record.page, std::to_string(record.type), std::to_string(record.cluster_id)});
+            }
+            auto results = pipelineConnection().execPipelined("citation_upsert", rows, pipeline_window_);
+            for (size_t i = 0; i < records.size(); ++i) {
+                if (results[i].ok ||
+                    recoverFailedRow(*conn, records[i], results[i].error, rejected_records, rejection_reasons,
+                                     search_opinioncluster_placeholders, placeholders_created)) {
+                    inserted++;
+                }
+            }
+            Metrics::global().add("records_inserted", "search_citation", inserted);
+            Metrics::global().add("records_rejected", "search_citation", rejected_records.size());
+            return {inserted, placeholders_created};
+        }
         
         for (const auto& record : records) {
             try {
                 // Start a new transaction for each record
-                pqxx::work txn(conn);
-                
-                // Build insert query with upsert to handle duplicates
-                std::ostringstream query;
-                query << "INSERT INTO search_citation "
-                      << "(id, volume, reporter, page, type, cluster_id) VALUES ("
-                      << record.id << ", "
-                      << record.volume << ", "
-                      << txn.quote(record.reporter) << ", "
-                      << txn.quote(record.page) << ", "
-                      << record.type << ", "
-                      << record.cluster_id
-                      << ") ON CONFLICT (cluster_id, volume, reporter, page) "
-                      << "DO UPDATE SET id = EXCLUDED.id, type = EXCLUDED.type";
+                pqxx::work txn(*conn);
                 
-                pqxx::result res = txn.exec(query.str());
+                // Upsert to handle duplicates
+                txn.exec_prepared("citation_upsert", record.id, record.volume, record.reporter,
+                                  record.page, record.type, record.cluster_id);
                 txn.commit();
                 
                 // Successfully inserted
@@ -142,76 +175,16 @@ std::pair<size_t, size_t> SearchCitationDatabase::insertCitations(
                 
             } catch (const std::exception& e) {
                 // Individual record insertion failed - PostgreSQL will tell us why
-                std::string error_msg = e.what();
-                
-                // Check if it's an FK violation on cluster_id
-                if ((error_msg.find("foreign key") != std::string::npos || 
-                     error_msg.find("violates foreign key constraint") != std::string::npos) &&
-                    error_msg.find("cluster_id") != std::string::npos) {
-                    
-                    // Try to create placeholder and retry insert
-                    if (createPlaceholderCluster(record.cluster_id, search_opinioncluster_placeholders)) {
-                        placeholders_created++;
-                        try {
-                            // Retry the insert with upsert
-                            pqxx::work retry_txn(conn);
-                            std::ostringstream retry_query;
-                            retry_query << "INSERT INTO search_citation "
-                                       << "(id, volume, reporter, page, type, cluster_id) VALUES ("
-                                       << record.id << ", "
-                                       << record.volume << ", "
-                                       << retry_txn.quote(record.reporter) << ", "
-                                       << retry_txn.quote(record.page) << ", "
-                                       << record.type << ", "
-                                       << record.cluster_id
-                                       << ") ON CONFLICT (cluster_id, volume, reporter, page) "
-                                       << "DO UPDATE SET id = EXCLUDED.id, type = EXCLUDED.type";
-                            
-                            retry_txn.exec(retry_query.str());
-                            retry_txn.commit();
-                            
-                            inserted++;
-                            continue; // Success - move to next record
-                            
-                        } catch (const std::exception& retry_e) {
-                            // Retry also failed
-                            std::string retry_error = retry_e.what();
-                            std::cerr << "REJECTED: Record " << record.toString() 
-                                      << "\n  Retry failed after creating placeholder: " << retry_error << std::endl;
-                            rejected_records.push_back(record);
-                            std::ostringstream reason;
-                            reason << "FK violation, placeholder created but retry failed: " << retry_error;
-                            rejection_reasons.push_back(reason.str());
-                        }
-                    } else {
-                        // Failed to create placeholder
-                        std::cerr << "REJECTED: Record " << record.toString() 
-                                  << "\n  Failed to create placeholder: " << error_msg << std::endl;
-                        rejected_records.push_back(record);
-                        std::ostringstream reason;
-                        reason << "FK violation, failed to create placeholder: " << error_msg;
-                        rejection_reasons.push_back(reason.str());
-                    }
-                } else {
-                    // Other types of errors - print to stderr for visibility
-                    std::cerr << "REJECTED: Record " << record.toString() 
-                              << "\n  PostgreSQL error: " << error_msg << std::endl;
-                    rejected_records.push_back(record);
-                    std::ostringstream reason;
-                    
-                    if (error_msg.find("duplicate key") != std::string::npos) {
-                        reason << "Duplicate key violation: " << error_msg;
-                    } else {
-                        reason << "DB error: " << error_msg;
-                    }
-                    
-                    rejection_reasons.push_back(reason.str());
+                if (recoverFailedRow(*conn, record, pgError(e), rejected_records, rejection_reasons,
+                                     search_opinioncluster_placeholders, placeholders_created)) {
+                    inserted++;
                 }
             }
         }
         
     } catch (const std::exception& e) {
         std::cerr << "Database connection failed: " << e.what() << std::endl;
+        pipeline_conn_.reset(); // pipeline state is unknown after a failure; reconnect next batch
         
         // Connection failed - reject all remaining records
         for (const auto& record : records) {
@@ -220,9 +193,66 @@ std::pair<size_t, size_t> SearchCitationDatabase::insertCitations(
             reason << "Connection error: " << e.what();
             rejection_reasons.push_back(reason.str());
         }
-        
-        return {inserted, placeholders_created};
     }
     
+    Metrics::global().add("records_inserted", "search_citation", inserted);
+    Metrics::global().add("records_rejected", "search_citation", rejected_records.size());
     return {inserted, placeholders_created};
 }
+
+bool SearchCitationDatabase::recoverFailedRow(pqxx::connection& conn, const SearchCitation& record,
+                                              const PgError& error,
+                                              std::vector<SearchCitation>& rejected_records,
+                                              std::vector<std::string>& rejection_reasons,
+                                              std::vector<int>& search_opinioncluster_placeholders,
+                                              size_t& placeholders_created) {
+    // cluster_id is the table's only FK
+    if (error.kind == PgErrorKind::ForeignKey) {
+        
+        // Try to create placeholder and retry insert
+        if (createPlaceholderCluster(conn, record.cluster_id, search_opinioncluster_placeholders)) {
+            placeholders_created++;
+            try {
+                // Retry the insert with upsert
+                pqxx::work retry_txn(conn);
+                retry_txn.exec_prepared("citation_upsert", record.id, record.volume, record.reporter,
+                                        record.page, record.type, record.cluster_id);
+                retry_txn.commit();
+                
+                return true;
+                
+            } catch (const std::exception& retry_e) {
+                // Retry also failed
+                PgError retry_error = pgError(retry_e);
+                std::cerr << "REJECTED: Record " << record.toString() 
+                          << "\n  Retry failed after creating placeholder: " << retry_error.message << std::endl;
+                rejected_records.push_back(record);
+                rejection_reasons.push_back("FK violation, placeholder created but retry failed: " +
+                                            retry_error.describe());
+            }
+        } else {
+            // Failed to create placeholder
+            std::cerr << "REJECTED: Record " << record.toString() 
+                      << "\n  Failed to create placeholder: " << error.message << std::endl;
+            rejected_records.push_back(record);
+            rejection_reasons.push_back("FK violation, failed to create placeholder: " + error.describe());
+        }
+    } else {
+        // Other types of errors - print to stderr for visibility
+        std::cerr << "REJECTED: Record " << record.toString() 
+                  << "\n  PostgreSQL error: " << error.message << std::endl;
+        rejected_records.push_back(record);
+        rejection_reasons.push_back((error.kind == PgErrorKind::Unique ? "Duplicate key violation: " : "DB error: ") +
+                                    error.describe());
+    }
+    
+    return false;
+}
+
+PgRawConnection& SearchCitationDatabase::pipelineConnection() {
+    if (!pipeline_conn_ || !pipeline_conn_->isOpen()) {
+        pipeline_conn_ = std::make_unique<PgRawConnection>(connection_string_);
+        pipeline_conn_->prepare("citation_upsert", kCitationUpsertSql);
+    }
+    return *pipeline_conn_;
+}
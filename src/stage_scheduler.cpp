@@ -0,0 +1,176 @@
+#include "stage_scheduler.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+void StageScheduler::add(const std::string& name, std::vector<std::string> deps, std::function<void()> fn) {
+    if (has(name)) throw std::invalid_argument("Duplicate stage: " + name);
+    Stage stage;
+    stage.name = name;
+    stage.deps = std::move(deps);
+    stage.fn = std::move(fn);
+    stages_.push_back(std::move(stage));
+}
+
+bool StageScheduler::has(const std::string& name) const {
+    for (const auto& s : stages_) {
+        if (s.name == name) return true;
+    }
+    return false;
+}
+
+size_t StageScheduler::indexOf(const std::string& name) const {
+    for (size_t i = 0; i < stages_.size(); ++i) {
+        if (stages_[i].name == name) return i;
+    }
+    throw std::invalid_argument("Unknown stage: " + name);
+}
+
+std::vector<std::vector<std::string>> StageScheduler::levels() const {
+    std::vector<int> level(stages_.size(), -1);
+    std::vector<std::vector<std::string>> out;
+    size_t placed = 0;
+    // Repeatedly place stages whose dependencies are all placed (Kahn's algorithm by rounds)
+    while (placed < stages_.size()) {
+        std::vector<size_t> round;
+        for (size_t i = 0; i < stages_.size(); ++i) {
+            if (level[i] >= 0) continue;
+            bool ready = true;
+            for (const auto& dep : stages_[i].deps) {
+                if (level[indexOf(dep)] < 0) ready = false;
+            }
+            if (ready) round.push_back(i);
+        }
+        if (round.empty()) {
+            std::string cycle;
+            for (size_t i = 0; i < stages_.size(); ++i) {
+                if (level[i] < 0) cycle += (cycle.empty() ? "" : ", ") + stages_[i].name;
+            }
+            throw std::invalid_argument("Stage dependency cycle among: " + cycle);
+        }
+        out.emplace_back();
+        for (size_t i : round) {
+            level[i] = static_cast<int>(out.size() - 1);
+            out.back().push_back(stages_[i].name);
+        }
+        placed += round.size();
+    }
+    return out;
+}
+
+void StageScheduler::resolveDependencies() {
+    levels();
+    for (auto& s : stages_) {
+        s.dep_index.clear();
+        for (const auto& dep : s.deps) s.dep_index.push_back(indexOf(dep));
+        s.status = Status::Pending;
+        s.error.clear();
+        s.seconds = 0;
+    }
+}
+
+bool StageScheduler::run(size_t max_parallel) {
+    resolveDependencies();
+    if (max_parallel == 0) max_parallel = 1;
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t running = 0;
+    std::vector<std::thread> threads;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        // Skip everything downstream of a failure (a skip can cascade further)
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (auto& s : stages_) {
+                if (s.status != Status::Pending) continue;
+                for (size_t d : s.dep_index) {
+                    const Stage& dep = stages_[d];
+                    if (dep.status == Status::Failed || dep.status == Status::Skipped) {
+                        s.status = Status::Skipped;
+                        s.error = "dependency " + dep.name + " " + statusName(dep.status);
+                        changed = true;
+                        break;
+                    }
+                }
+            }
+        }
+
+        for (size_t i = 0; i < stages_.size() && running < max_parallel; ++i) {
+            Stage& s = stages_[i];
+            if (s.status != Status::Pending) continue;
+            bool ready = true;
+            for (size_t d : s.dep_index) ready = ready && stages_[d].status == Status::Succeeded;
+            if (!ready) continue;
+
+            s.status = Status::Running;
+            running++;
+            threads.emplace_back([this, i, &mutex, &finished, &running]() {
+                Stage& stage = stages_[i];
+                auto t0 = std::chrono::steady_clock::now();
+                Status result = Status::Succeeded;
+                std::string error;
+                try {
+                    stage.fn();
+                } catch (const std::exception& e) {
+                    result = Status::Failed;
+                    error = e.what();
+                } catch (...) {
+                    result = Status::Failed;
+                    error = "unknown exception";
+                }
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t0;
+                std::lock_guard<std::mutex> guard(mutex);
+                stage.status = result;
+                stage.error = error;
+                stage.seconds = elapsed.count();
+                running--;
+                finished.notify_all();
+            });
+        }
+
+        // Nothing running means nothing can become ready any more
+        if (running == 0) break;
+        finished.wait(lock);
+    }
+    lock.unlock();
+    for (auto& t : threads) t.join();
+
+    bool ok = true;
+    for (const auto& s : stages_) ok = ok && s.status == Status::Succeeded;
+    return ok;
+}
+
+StageScheduler::Status StageScheduler::status(const std::string& name) const {
+    return stages_[indexOf(name)].status;
+}
+
+const std::string& StageScheduler::error(const std::string& name) const {
+    return stages_[indexOf(name)].error;
+}
+
+double StageScheduler::seconds(const std::string& name) const {
+    return stages_[indexOf(name)].seconds;
+}
+
+std::vector<std::string> StageScheduler::names() const {
+    std::vector<std::string> out;
+    for (const auto& s : stages_) out.push_back(s.name);
+    return out;
+}
+
+const char* StageScheduler::statusName(Status status) {
+    switch (status) {
+        case Status::Pending: return "pending";
+        case Status::Running: return "running";
+        case Status::Succeeded: return "succeeded";
+        case Status::Failed: return "failed";
+        case Status::Skipped: return "skipped";
+    }
+    return "unknown";
+}
@@ -0,0 +1,52 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    if (thread_count == 0) thread_count = std::max(1u, std::thread::hardware_concurrency());
+    workers_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& t : workers_) t.join();
+}
+
+void ThreadPool::workerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) return; // stopping and drained
+            task = std::move(tasks_.front());
+            tasks_.pop();
+        }
+        task();
+    }
+}
+
+size_t ThreadPool::parallelRanges(size_t count, const std::function<void(size_t, size_t, size_t)>& fn) {
+    if (count == 0) return 0;
+    size_t ranges = std::min(count, workers_.size());
+    size_t per_range = (count + ranges - 1) / ranges;
+
+    std::vector<std::future<void>> pending;
+    pending.reserve(ranges);
+    size_t used = 0;
+    for (size_t begin = 0; begin < count; begin += per_range, ++used) {
+        size_t end = std::min(count, begin + per_range);
+        pending.push_back(submit([&fn, begin, end, used]() { fn(begin, end, used); }));
+    }
+    // Wait for every range before rethrowing so no task outlives fn
+    for (auto& f : pending) f.wait();
+    for (auto& f : pending) f.get();
+    return used;
+}
@@ -0,0 +1,602 @@
+// Unit tests for shared infrastructure (same minimal harness as opinion_test.cpp)
+#include "bulk_initial_load.h"
+#include "checkpoint.h"
+#include "csv_classifier.h"
+#include "id_set.h"
+#include "input_stream.h"
+#include "int32_batch.h"
+#include "metrics.h"
+#include "pg_binary_copy.h"
+#include "pg_error.h"
+#include "pipeline.h"
+#include "record_scanner.h"
+#include "stage_scheduler.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+#define EXPECT_TRUE(cond) do { \
+    if (!(cond)) { \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": EXPECT_TRUE failed: " #cond "\n"; \
+        ++failures; \
+    } \
+} while(0)
+
+#define EXPECT_FALSE(cond) EXPECT_TRUE(!(cond))
+
+#define EXPECT_EQ(a, b) do { \
+    auto _va = (a); auto _vb = (b); \
+    if (!((_va) == (_vb))) { \
+        std::cerr << __FILE__ << ":" << __LINE__ << ": EXPECT_EQ failed: " #a " == " #b \
+                  << " (" << _va << " != " << _vb << ")\n"; \
+        ++failures; \
+    } \
+} while(0)
+
+void Test_BinaryCopyDateAndTimestamp() {
+    EXPECT_EQ(PgBinaryCopyWriter::parseDate("2000-01-01"), 0);
+    EXPECT_EQ(PgBinaryCopyWriter::parseDate("2000-01-02"), 1);
+    EXPECT_EQ(PgBinaryCopyWriter::parseDate("1999-12-31"), -1);
+    EXPECT_EQ(PgBinaryCopyWriter::parseTimestamptz("2000-01-01 00:00:01+00"), 1000000LL);
+    EXPECT_EQ(PgBinaryCopyWriter::parseTimestamptz("2000-01-01 01:00:00.5+01"), 500000LL);
+    EXPECT_EQ(PgBinaryCopyWriter::parseTimestamptz("2000-01-01T00:00:00.000001Z"), 1LL);
+
+    bool threw = false;
+    try { PgBinaryCopyWriter::parseDate("not-a-date"); } catch (const std::invalid_argument&) { threw = true; }
+    EXPECT_TRUE(threw);
+}
+
+void Test_BinaryCopyRowLayout() {
+    PgBinaryCopyWriter w;
+    size_t header = w.data().size();
+    EXPECT_EQ(header, 19u);
+
+    w.beginRow(2);
+    w.addInt4(258);
+    w.addNull();
+    EXPECT_EQ(w.rowCount(), 1u);
+    const std::string& d = w.data();
+    // field count (2) | length 4 | 0x00000102 | length -1
+    EXPECT_EQ(static_cast<int>(d[header + 1]), 2);
+    EXPECT_EQ(static_cast<int>(d[header + 5]), 4);
+    EXPECT_EQ(static_cast<int>(d[header + 8]), 1);
+    EXPECT_EQ(static_cast<int>(d[header + 9]), 2);
+    EXPECT_EQ(static_cast<unsigned char>(d[header + 10]), 0xFFu);
+
+    w.beginRow(1);
+    w.addText(std::string("x"));
+    w.rollbackRow();
+    EXPECT_EQ(w.rowCount(), 1u);
+    w.finish();
+    EXPECT_EQ(w.data().size(), header + 14 + 2);
+}
+
+void Test_CsvClassifierKernelsAgree() {
+    EXPECT_EQ(CsvClassifier::prefixXor(0x1ULL), ~0ULL);
+    EXPECT_EQ(CsvClassifier::prefixXor(0x9ULL), 0x7ULL); // quotes at 0 and 3 -> bytes 0..2 inside
+
+    std::string block(CsvClassifier::kBlockSize, 'x');
+    for (size_t i = 0; i < block.size(); ++i) {
+        size_t h = (i * 2654435761u) >> 3;
+        if (h % 7 == 0) block[i] = '"';
+        else if (h % 5 == 0) block[i] = ',';
+        else if (h % 3 == 0) block[i] = '\n';
+    }
+    CsvClassifier::Masks ref = CsvClassifier(CsvClassifier::Isa::Scalar).classify(block.data());
+    for (auto isa : {CsvClassifier::Isa::Sse42, CsvClassifier::Isa::Avx2}) {
+        if (!CsvClassifier::supported(isa)) continue;
+        CsvClassifier::Masks m = CsvClassifier(isa).classify(block.data());
+        EXPECT_EQ(m.quote, ref.quote);
+        EXPECT_EQ(m.comma, ref.comma);
+        EXPECT_EQ(m.newline, ref.newline);
+    }
+
+    // Quoted state carries across blocks: open quote in one block closes in the next
+    bool in_quotes = false;
+    CsvClassifier::quotedRegion(1ULL << 63, in_quotes);
+    EXPECT_TRUE(in_quotes);
+    uint64_t region = CsvClassifier::quotedRegion(1ULL << 4, in_quotes);
+    EXPECT_EQ(region, 0xFULL);
+    EXPECT_FALSE(in_quotes);
+}
+
+// Record starts with a digit; continuation lines in the fixture start with text
+static bool StartsWithDigit(const char* data, size_t size, size_t pos) {
+    return pos < size && data[pos] >= '0' && data[pos] <= '9';
+}
+
+void Test_RecordScannerBoundaries() {
+    const std::string path = "record_scanner_test.csv";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "id,text\r\n"
+            << "1,\"line one\n2 inside quotes\"\n"
+            << "2,plain\n"
+            << "continued\n"
+            << "3,last";  // no trailing newline: final record must still be emitted
+    }
+
+    RecordScanner quoted(path, &StartsWithDigit, true);
+    EXPECT_TRUE(quoted.header() == "id,text");
+    std::vector<std::string_view> recs;
+    EXPECT_TRUE(quoted.nextBatch(recs, 2));
+    EXPECT_EQ(recs.size(), 2u);
+    EXPECT_TRUE(recs[0] == "1,\"line one\n2 inside quotes\"");
+    EXPECT_TRUE(recs[1] == "2,plain\ncontinued");
+    EXPECT_TRUE(quoted.nextBatch(recs, 2));
+    EXPECT_EQ(recs.size(), 1u);
+    EXPECT_TRUE(recs[0] == "3,last");
+    EXPECT_TRUE(quoted.eof());
+    EXPECT_FALSE(quoted.nextBatch(recs, 2));
+
+    // Without quote awareness the embedded "\n2" is taken as a record start
+    RecordScanner plain(path, &StartsWithDigit, false);
+    EXPECT_TRUE(plain.nextBatch(recs, 10));
+    EXPECT_EQ(recs.size(), 4u);
+
+    std::remove(path.c_str());
+}
+
+void Test_RecordScannerSeekAndCheckpoint() {
+    const std::string path = "record_seek_test.csv";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "id,text\n1,a\n2,\"b\n9 quoted\"\n3,c\n4,d\n";
+    }
+
+    RecordScanner first(path, &StartsWithDigit, true);
+    std::vector<std::string_view> recs;
+    EXPECT_TRUE(first.nextBatch(recs, 2));
+    size_t resume_at = first.offset();
+
+    Checkpoint saved;
+    saved.offset = resume_at;
+    saved.file_size = first.size();
+    saved.records = recs.size();
+    const std::string cp_path = Checkpoint::defaultPath(path);
+    saved.save(cp_path);
+    Checkpoint loaded;
+    EXPECT_TRUE(loaded.load(cp_path));
+    EXPECT_EQ(loaded.offset, resume_at);
+    EXPECT_EQ(loaded.file_size, first.size());
+    EXPECT_EQ(loaded.records, 2u);
+    EXPECT_FALSE(loaded.load(cp_path + ".missing"));
+
+    // Serial and indexed scanners both continue with record 3
+    for (bool index : {false, true}) {
+        RecordScanner resumed(path, &StartsWithDigit, true);
+        ThreadPool pool(2);
+        if (index) resumed.buildIndex(pool, 8);
+        resumed.seek(loaded.offset);
+        EXPECT_TRUE(resumed.nextBatch(recs, 10));
+        EXPECT_EQ(recs.size(), 2u);
+        EXPECT_TRUE(recs[0] == "3,c");
+        EXPECT_TRUE(resumed.eof());
+    }
+
+    // An offset in the middle of a record is rejected
+    RecordScanner bad(path, &StartsWithDigit, true);
+    bool threw = false;
+    try { bad.seek(resume_at + 1); } catch (const std::invalid_argument&) { threw = true; }
+    EXPECT_TRUE(threw);
+
+    std::remove(cp_path.c_str());
+    std::remove(path.c_str());
+}
+
+void Test_CompressedInput() {
+    if (!compressionSupported(Compression::Gzip)) return;
+    // Two concatenated gzip members (as pigz writes) splitting a quoted record:
+    // "id,text\n1,a\n2,\"b\n" + "9 q\"\n3,c\n"
+    static const unsigned char kGz[] = {
+        0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xcb, 0x4c, 0xd1, 0x29, 0x49, 0xad,
+        0x28, 0xe1, 0x32, 0xd4, 0x49, 0xe4, 0x32, 0xd2, 0x51, 0x4a, 0xe2, 0x02, 0x00, 0xdf, 0x29, 0x67,
+        0xc6, 0x11, 0x00, 0x00, 0x00, 0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xb3,
+        0x54, 0x28, 0x54, 0xe2, 0x32, 0xd6, 0x49, 0xe6, 0x02, 0x00, 0xc3, 0x5e, 0xea, 0xaa, 0x09, 0x00,
+        0x00, 0x00};
+    const std::string path = "compressed_input_test.csv.gz";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(kGz), sizeof(kGz));
+    }
+    EXPECT_TRUE(detectCompression(path) == Compression::Gzip);
+
+    RecordScanner scanner(path, &StartsWithDigit, true);
+    EXPECT_TRUE(scanner.header() == "id,text");
+    std::vector<std::string_view> recs;
+    EXPECT_TRUE(scanner.nextBatch(recs, 10));
+    EXPECT_EQ(recs.size(), 3u);
+    EXPECT_TRUE(recs[1] == "2,\"b\n9 q\"");
+    EXPECT_TRUE(recs[2] == "3,c");
+    EXPECT_FALSE(scanner.nextBatch(recs, 10));
+
+    InputStream in(path);
+    EXPECT_TRUE(in.is_open());
+    std::string line, all;
+    while (std::getline(in, line)) all += line + "|";
+    EXPECT_TRUE(all == "id,text|1,a|2,\"b|9 q\"|3,c|");
+
+    // A truncated archive is an error, not a short file
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(kGz), 30);
+    }
+    bool threw = false;
+    try {
+        InputStream cut(path);
+        while (std::getline(cut, line)) {}
+    } catch (const std::runtime_error&) { threw = true; }
+    EXPECT_TRUE(threw);
+    std::remove(path.c_str());
+}
+
+void Test_RecordIndexMatchesSerialScan() {
+    // Records with embedded quoted newlines, doubled quotes and an unbalanced quote
+    const std::string path = "record_index_test.csv";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "id,text\n";
+        unsigned seed = 12345;
+        auto next = [&seed]() { seed = seed * 1103515245u + 12345u; return (seed >> 16) & 0x7fff; };
+        for (int r = 0; r < 2000; ++r) {
+            out << r << ",";
+            int kind = static_cast<int>(next() % 5);
+            if (kind == 0) out << "\"quoted\n" << (next() % 100) << " with newline\"";
+            else if (kind == 1) out << "\"doubled \"\" quote\"";
+            else if (kind == 2) out << "plain\ncontinuation line";
+            else if (kind == 3 && r == 777) out << "\"unbalanced";
+            else out << "text" << next();
+            out << "\n";
+        }
+    }
+
+    for (bool quote_aware : {true, false}) {
+        RecordScanner serial(path, &StartsWithDigit, quote_aware);
+        RecordScanner indexed(path, &StartsWithDigit, quote_aware);
+        ThreadPool pool(4);
+        indexed.buildIndex(pool, 256); // tiny ranges so every boundary case is exercised
+
+        std::vector<std::string_view> a, b;
+        size_t total = 0;
+        bool same = true;
+        while (serial.nextBatch(a, 100)) {
+            indexed.nextBatch(b, 100);
+            same = same && a == b;
+            total += a.size();
+        }
+        EXPECT_FALSE(indexed.nextBatch(b, 100));
+        EXPECT_TRUE(same);
+        EXPECT_TRUE(total > 1000u);
+    }
+    std::remove(path.c_str());
+}
+
+void Test_ThreadPoolRanges() {
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4u);
+    EXPECT_EQ(pool.submit([] { return 41 + 1; }).get(), 42);
+
+    std::vector<int> out(1003, 0);
+    size_t ranges = pool.parallelRanges(out.size(), [&](size_t begin, size_t end, size_t) {
+        for (size_t i = begin; i < end; ++i) out[i] = static_cast<int>(i);
+    });
+    EXPECT_EQ(ranges, 4u);
+    bool ordered = true;
+    for (size_t i = 0; i < out.size(); ++i) ordered = ordered && out[i] == static_cast<int>(i);
+    EXPECT_TRUE(ordered);
+
+    bool threw = false;
+    try {
+        pool.parallelRanges(10, [](size_t begin, size_t, size_t) {
+            if (begin == 0) throw std::runtime_error("boom");
+        });
+    } catch (const std::runtime_error&) { threw = true; }
+    EXPECT_TRUE(threw);
+}
+
+void Test_BoundedQueueAndPipeline() {
+    BoundedQueue<int> q(2);
+    EXPECT_TRUE(q.push(1));
+    EXPECT_TRUE(q.push(2));
+    EXPECT_EQ(q.size(), 2u);
+    q.close();
+    EXPECT_FALSE(q.push(3));
+    int v = 0;
+    EXPECT_TRUE(q.pop(v));
+    EXPECT_EQ(v, 1);
+    EXPECT_TRUE(q.pop(v));
+    EXPECT_EQ(v, 2);
+    EXPECT_FALSE(q.pop(v));
+
+    // Three stages, depth 1: output must arrive complete and in order
+    int next = 0;
+    std::vector<int> seen;
+    runReadParseWritePipeline<int, std::string>(1,
+        [&](int& raw) { if (next == 500) return false; raw = next++; return true; },
+        [](int&& raw) { return std::to_string(raw); },
+        [&](std::string&& parsed) { seen.push_back(std::stoi(parsed)); });
+    bool ordered = seen.size() == 500;
+    for (size_t i = 0; ordered && i < seen.size(); ++i) ordered = seen[i] == static_cast<int>(i);
+    EXPECT_TRUE(ordered);
+
+    // A failing writer stops the reader and the error reaches the caller
+    bool threw = false;
+    try {
+        runReadWritePipeline<int>(2,
+            [](int& batch) { batch = 1; return true; }, // endless input
+            [](int&&) { throw std::runtime_error("db down"); });
+    } catch (const std::runtime_error&) { threw = true; }
+    EXPECT_TRUE(threw);
+}
+
+void Test_IdSetMembership() {
+    IdSet ids;
+    EXPECT_TRUE(ids.empty());
+    EXPECT_TRUE(ids.insert(0));
+    EXPECT_TRUE(ids.insert(63));
+    EXPECT_TRUE(ids.insert(64));
+    EXPECT_TRUE(ids.insert(1000000));
+    EXPECT_FALSE(ids.insert(64)); // already present
+    EXPECT_FALSE(ids.insert(-5)); // negatives are never members
+    EXPECT_EQ(ids.size(), 4u);
+
+    EXPECT_TRUE(ids.contains(0));
+    EXPECT_TRUE(ids.contains(63));
+    EXPECT_TRUE(ids.contains(64));
+    EXPECT_TRUE(ids.contains(1000000));
+    EXPECT_FALSE(ids.contains(1));
+    EXPECT_FALSE(ids.contains(-5));
+    EXPECT_FALSE(ids.contains(2000000000)); // beyond the bitmap
+
+    EXPECT_TRUE(ids.containsAll({0, 64, 1000000}));
+    EXPECT_FALSE(ids.containsAll({0, 65}));
+    std::vector<int> missing;
+    ids.collectMissing({7, 0, 7, 1000001}, missing);
+    EXPECT_EQ(missing.size(), 3u);
+    EXPECT_EQ(missing[0], 7);
+    EXPECT_EQ(missing[2], 1000001);
+
+    // One bit per id: a million ids fit in well under a megabyte
+    EXPECT_TRUE(ids.memoryBytes() < (1u << 20));
+    ids.clear();
+    EXPECT_FALSE(ids.contains(0));
+    EXPECT_EQ(ids.size(), 0u);
+}
+
+void Test_IdSetSnapshotRoundTrip() {
+    const std::string path = "/tmp/common_test_ids.snap";
+    IdSet ids;
+    for (int id : {3, 64, 65, 4097, 123456}) ids.insert(id);
+    ids.save(path, "search_opinion");
+
+    IdSet loaded;
+    EXPECT_TRUE(loaded.load(path, "search_opinion"));
+    EXPECT_EQ(loaded.size(), 5u);
+    EXPECT_EQ(loaded.maxId(), 123456);
+    EXPECT_TRUE(loaded.containsAll({3, 64, 65, 4097, 123456}));
+    EXPECT_FALSE(loaded.contains(4));
+    // Incremental refresh continues above the snapshot's max id
+    EXPECT_TRUE(loaded.insert(123457));
+    EXPECT_EQ(loaded.maxId(), 123457);
+
+    // Another table's snapshot, a missing file and a truncated file are all rejected
+    EXPECT_FALSE(loaded.load(path, "search_opinioncluster"));
+    EXPECT_TRUE(loaded.empty());
+    EXPECT_FALSE(loaded.load(path + ".missing", "search_opinion"));
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size() - 8));
+    }
+    EXPECT_FALSE(loaded.load(path, "search_opinion"));
+    std::remove(path.c_str());
+}
+
+void Test_StageScheduler() {
+    // Diamond: a -> (b, c) -> d, plus an independent e
+    StageScheduler sched;
+    std::mutex order_mutex;
+    std::vector<std::string> order;
+    std::atomic<int> running{0}, peak{0};
+    auto stage = [&](const std::string& name) {
+        return [&, name]() {
+            int now = ++running;
+            for (int p = peak.load(); now > p && !peak.compare_exchange_weak(p, now);) {}
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            --running;
+            std::lock_guard<std::mutex> lock(order_mutex);
+            order.push_back(name);
+        };
+    };
+    sched.add("a", {}, stage("a"));
+    sched.add("b", {"a"}, stage("b"));
+    sched.add("c", {"a"}, stage("c"));
+    sched.add("d", {"b", "c"}, stage("d"));
+    sched.add("e", {}, stage("e"));
+    auto levels = sched.levels();
+    EXPECT_EQ(levels.size(), 3u);
+    EXPECT_EQ(levels[0].size(), 2u);
+    EXPECT_TRUE(levels[2] == std::vector<std::string>{"d"});
+
+    EXPECT_TRUE(sched.run(4));
+    EXPECT_EQ(order.size(), 5u);
+    EXPECT_TRUE(order.back() == "d");
+    EXPECT_TRUE(peak.load() >= 2);
+
+    // A failure skips everything downstream but not unrelated stages
+    StageScheduler failing;
+    failing.add("a", {}, []() { throw std::runtime_error("boom"); });
+    failing.add("b", {"a"}, []() {});
+    failing.add("c", {"b"}, []() {});
+    failing.add("x", {}, []() {});
+    EXPECT_FALSE(failing.run(2));
+    EXPECT_TRUE(failing.status("a") == StageScheduler::Status::Failed);
+    EXPECT_TRUE(failing.error("a") == "boom");
+    EXPECT_TRUE(failing.status("b") == StageScheduler::Status::Skipped);
+    EXPECT_TRUE(failing.status("c") == StageScheduler::Status::Skipped);
+    EXPECT_TRUE(failing.status("x") == StageScheduler::Status::Succeeded);
+
+    StageScheduler cyclic;
+    cyclic.add("a", {"b"}, []() {});
+    cyclic.add("b", {"a"}, []() {});
+    bool threw = false;
+    try { cyclic.levels(); } catch (const std::invalid_argument&) { threw = true; }
+    EXPECT_TRUE(threw);
+}
+
+void Test_BulkInitialLoadStatements() {
+    EXPECT_TRUE(BulkInitialLoad::ifNotExists("CREATE INDEX a_idx ON public.t USING btree (x)") ==
+                "CREATE INDEX IF NOT EXISTS a_idx ON public.t USING btree (x)");
+    EXPECT_TRUE(BulkInitialLoad::ifNotExists("CREATE INDEX IF NOT EXISTS a_idx ON t (x)") ==
+                "CREATE INDEX IF NOT EXISTS a_idx ON t (x)");
+
+    BulkInitialLoad::ForeignKey cluster{"op_cluster_fk", {"cluster_id"}, "search_opinioncluster", {"id"}};
+    BulkInitialLoad::ForeignKey author{"op_author_fk", {"author_id"}, "people_db_person", {"id"}};
+    std::string sql = BulkInitialLoad::violationQuery("search_opinion", {cluster, author});
+    EXPECT_TRUE(sql.rfind("DELETE FROM search_opinion AS d USING", 0) == 0);
+    EXPECT_TRUE(sql.find("t.\"cluster_id\" IS NOT NULL AND NOT EXISTS (SELECT 1 FROM search_opinioncluster r "
+                         "WHERE r.\"id\" = t.\"cluster_id\")") != std::string::npos);
+    EXPECT_TRUE(sql.find("UNION ALL") != std::string::npos);
+    EXPECT_TRUE(sql.find("'op_author_fk: no matching people_db_person row'") != std::string::npos);
+    EXPECT_TRUE(sql.find("RETURNING d.*, bad.reason") != std::string::npos);
+
+    const std::string path = "/tmp/common_test_indexes.sql";
+    std::vector<std::string> defs = {"CREATE INDEX a ON t USING btree (x)", "CREATE INDEX b ON t USING gin (y)"};
+    BulkInitialLoad::saveState(path, "t", defs);
+    std::vector<std::string> loaded;
+    EXPECT_TRUE(BulkInitialLoad::loadState(path, loaded));
+    EXPECT_TRUE(loaded == defs);
+    std::remove(path.c_str());
+    EXPECT_FALSE(BulkInitialLoad::loadState(path, loaded));
+}
+
+void Test_PgErrorClassification() {
+    EXPECT_TRUE(pgErrorKind("23503") == PgErrorKind::ForeignKey);
+    EXPECT_TRUE(pgErrorKind("23505") == PgErrorKind::Unique);
+    EXPECT_TRUE(pgErrorKind("23502") == PgErrorKind::NotNull);
+    EXPECT_TRUE(pgErrorKind("23514") == PgErrorKind::Check);
+    EXPECT_TRUE(pgErrorKind("40001") == PgErrorKind::Other);
+
+    // Classification must not depend on the (localizable) message text
+    PgError fk = pgError(pqxx::sql_error("FEHLER:  Einfuegen oder Aktualisieren verletzt Fremdschluessel\n", "INSERT", "23503"));
+    EXPECT_TRUE(fk.kind == PgErrorKind::ForeignKey);
+    EXPECT_TRUE(fk.describe() == "fk [23503]: FEHLER:  Einfuegen oder Aktualisieren verletzt Fremdschluessel");
+
+    PgError other = pgError(std::runtime_error("duplicate key value violates unique constraint"));
+    EXPECT_TRUE(other.kind == PgErrorKind::Other);
+    EXPECT_TRUE(other.sqlstate.empty());
+}
+
+void Test_LatencyHistogram() {
+    // Buckets are contiguous and each value lands in the bucket whose bound covers it
+    for (uint64_t v : {0ull, 1ull, 15ull, 16ull, 17ull, 31ull, 32ull, 1000ull, 123456ull, 1ull << 40}) {
+        size_t b = LatencyHistogram::bucketIndex(v);
+        EXPECT_TRUE(v <= LatencyHistogram::bucketUpperBound(b));
+        EXPECT_TRUE(b == 0 || v > LatencyHistogram::bucketUpperBound(b - 1));
+    }
+
+    LatencyHistogram h;
+    EXPECT_EQ(h.percentileMicros(0.5), 0u);
+    for (uint64_t us = 1; us <= 1000; ++us) h.recordMicros(us);
+    EXPECT_EQ(h.count(), 1000u);
+    EXPECT_EQ(h.maxMicros(), 1000u);
+    EXPECT_EQ(h.sumMicros(), 500500u);
+    uint64_t p50 = h.percentileMicros(0.5);
+    uint64_t p99 = h.percentileMicros(0.99);
+    EXPECT_TRUE(p50 >= 500 && p50 <= 500 * 1.0625);
+    EXPECT_TRUE(p99 >= 990 && p99 <= 1000);
+    EXPECT_EQ(h.percentileMicros(1.0), 1000u);
+
+    Metrics metrics;
+    metrics.latency("insert", "search_opinion").record(std::chrono::milliseconds(3));
+    metrics.add("records_inserted", "search_opinion", 42);
+    std::string prom = metrics.prometheus();
+    EXPECT_TRUE(prom.find("ingest_stage_latency_seconds_bucket{stage=\"insert\",table=\"search_opinion\",le=\"0.002500\"} 0") != std::string::npos);
+    EXPECT_TRUE(prom.find("ingest_stage_latency_seconds_bucket{stage=\"insert\",table=\"search_opinion\",le=\"0.005000\"} 1") != std::string::npos);
+    EXPECT_TRUE(prom.find("le=\"+Inf\"} 1") != std::string::npos);
+    EXPECT_TRUE(prom.find("ingest_records_inserted_total{table=\"search_opinion\"} 42") != std::string::npos);
+    EXPECT_TRUE(metrics.jsonLine().find("\"name\":\"records_inserted\",\"table\":\"search_opinion\",\"value\":42") != std::string::npos);
+
+    MetricsOptions options;
+    EXPECT_TRUE(parseMetricsOption("--metrics=/tmp/ingest.jsonl", options));
+    EXPECT_TRUE(options.format == MetricsOptions::Format::JsonLines);
+    EXPECT_TRUE(parseMetricsOption("--metrics-interval=5", options));
+    EXPECT_EQ(options.interval_seconds, 5u);
+    EXPECT_FALSE(parseMetricsOption("--metricsx", options));
+    bool threw = false;
+    try { parseMetricsOption("--metrics-format=xml", options); } catch (const std::invalid_argument&) { threw = true; }
+    EXPECT_TRUE(threw);
+}
+
+void Test_Int32Batch() {
+    Int32Batch batch;
+    batch.append({1, 10, 100});
+    batch.append({2, 20, 200});
+    batch.append({3, 10, 300});
+    EXPECT_EQ(batch.columnCount(), 3u); // taken from the first row
+    EXPECT_EQ(batch.size(), 3u);
+    EXPECT_EQ(batch.at(2, 2), 300);
+    EXPECT_EQ(batch.rowCsv(1), std::string("2,20,200"));
+
+    bool threw = false;
+    try { batch.append({4, 40}); } catch (const std::invalid_argument&) { threw = true; }
+    EXPECT_TRUE(threw);
+    EXPECT_EQ(batch.size(), 3u);
+
+    // Slices copy whole column ranges
+    Int32Batch slice(3);
+    slice.append(batch, 1, 3);
+    EXPECT_EQ(slice.size(), 2u);
+    EXPECT_EQ(slice.at(0, 0), 2);
+    EXPECT_EQ(slice.at(1, 2), 300);
+    slice.append(batch, 3, 3); // empty range
+    EXPECT_EQ(slice.size(), 2u);
+
+    // FK checks read one column as a plain id array
+    IdSet ids;
+    ids.insert(10);
+    std::vector<int> missing;
+    ids.collectMissing(batch.column(1), missing);
+    EXPECT_EQ(missing.size(), 1u);
+    EXPECT_EQ(missing[0], 20);
+
+    slice.clear();
+    EXPECT_TRUE(slice.empty());
+    EXPECT_EQ(slice.columnCount(), 3u);
+}
+
+int main() {
+    Test_BinaryCopyDateAndTimestamp();
+    Test_BinaryCopyRowLayout();
+    Test_CsvClassifierKernelsAgree();
+    Test_RecordScannerBoundaries();
+    Test_ThreadPoolRanges();
+    Test_RecordIndexMatchesSerialScan();
+    Test_RecordScannerSeekAndCheckpoint();
+    Test_CompressedInput();
+    Test_BoundedQueueAndPipeline();
+    Test_IdSetMembership();
+    Test_IdSetSnapshotRoundTrip();
+    Test_Int32Batch();
+    Test_StageScheduler();
+    Test_BulkInitialLoadStatements();
+    Test_PgErrorClassification();
+    Test_LatencyHistogram();
+    if (failures) {
+        std::cerr << failures << " test(s) failed\n";
+        return 1;
+    }
+    std::cout << "All tests passed\n";
+    return 0;
+}